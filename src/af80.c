@@ -28,8 +28,12 @@
 #include "log.h"
 #include "memory.h"
 #include "cpu.h"
+#include "text80.h"
 #include <stdlib.h>
 
+#define AF80_ROWS 25
+#define AF80_CELL_HEIGHT 10
+
 static UBYTE *af80_rom = NULL;
 static char af80_rom_filename[FILENAME_MAX];
 static UBYTE *af80_charset = NULL;
@@ -39,6 +43,7 @@ static UBYTE *af80_screen = NULL;
 static UBYTE *af80_attrib = NULL;
 
 int AF80_enabled = FALSE;
+TEXT80_t AF80_text = { 0, 0, NULL, NULL };
 
 /* Austin Franklin information from forum posts by warerat at Atariage */
 static int rom_bank_select; /* bits 0-3 of d5f7, $0-$f 16 banks */
@@ -163,6 +168,7 @@ int AF80_Initialise(int *argc, char *argv[])
 		}
 		af80_screen = (UBYTE *)Util_malloc(0x800);
 		af80_attrib = (UBYTE *)Util_malloc(0x800);
+		TEXT80_Init(&AF80_text, AF80_ROWS, AF80_CELL_HEIGHT);
 		AF80_Reset();
 
 		/* swap palette */
@@ -183,6 +189,7 @@ void AF80_Exit(void)
 	free(af80_charset);
 	free(af80_rom);
 	af80_screen = af80_attrib = af80_charset = af80_rom = NULL;
+	TEXT80_Free(&AF80_text);
 }
 
 void AF80_InsertRightCartridge(void)
@@ -329,45 +336,56 @@ void AF80_D5PutByte(UWORD addr, UBYTE byte)
 	D(if (addr!=0xd5f7 && addr!=0xd5f6) printf("AF80 Write addr:%4x byte:%2x, cpu:%4x\n", addr, byte,CPU_remember_PC[(CPU_remember_PC_curpos-1)%CPU_REMEMBER_PC_STEPS]));
 }
 
-UBYTE AF80_GetPixels(int scanline, int column, int *colour, int blink)
+void AF80_UpdateText(void)
 {
-#define AF80_ROWS 25
-#define AF80_CELL_HEIGHT 10
-	UBYTE character;
-	int attrib;
-	UBYTE font_data;
 	int table_start = crtreg[0x0c] + ((crtreg[0x0d]&0x3f)<<8);
-	int row = scanline / AF80_CELL_HEIGHT;
-	int line = scanline % AF80_CELL_HEIGHT;
-	int screen_pos;
-	if (row  >= AF80_ROWS) {
-		return 0;
-	}
-
-	if (row >= crtreg[0x10]) {
-		screen_pos = (row-crtreg[0x10])*80 + column + crtreg[0x0e] + ((crtreg[0x0f]&0x3f)<<8);
-	}
-	else {
-		screen_pos = row*80+column + table_start;
-	}
-	screen_pos &= 0x7ff;
-	character = af80_screen[screen_pos];
-	attrib = af80_attrib[screen_pos];
-	font_data = af80_charset[character*16 + line];
-	if (attrib & 0x01) {
-	   	font_data ^= 0xff; /* invert */
-	}
-	if ((attrib & 0x02) && blink) {
-	   	font_data = 0x00; /* blink */
-	}
-	if (line+1 == AF80_CELL_HEIGHT && (attrib & 0x04)) {
-		font_data = 0xff; /* underline */
-	}
-	if (row == crtreg[0x18] && column == crtreg[0x19] && !blink) {
-		font_data = 0xff; /* cursor */
+	int row;
+	for (row = 0; row < AF80_ROWS; row++) {
+		int row_start;
+		int column;
+		if (row >= crtreg[0x10]) {
+			row_start = (row-crtreg[0x10])*80 + crtreg[0x0e] + ((crtreg[0x0f]&0x3f)<<8);
+		}
+		else {
+			row_start = row*80 + table_start;
+		}
+		for (column = 0; column < 80; column++) {
+			int screen_pos = (row_start + column) & 0x7ff;
+			UBYTE character = af80_screen[screen_pos];
+			int attrib = af80_attrib[screen_pos];
+			int cursor = row == crtreg[0x18] && column == crtreg[0x19];
+			UBYTE data[AF80_CELL_HEIGHT];
+			UBYTE fg[AF80_CELL_HEIGHT];
+			UBYTE bg[AF80_CELL_HEIGHT];
+			int colour;
+			int line;
+			if (!TEXT80_CellChanged(&AF80_text, row, column, character | (attrib << 8) | (cursor << 16)))
+				continue;
+			colour = attrib>>4; /* number of palette entry */
+			for (line = 0; line < AF80_CELL_HEIGHT; line++) {
+				UBYTE font_data = af80_charset[character*16 + line];
+				UBYTE on = colour;
+				UBYTE off = 0;
+				if (attrib & 0x01) {
+					font_data ^= 0xff; /* invert */
+				}
+				if (attrib & 0x02) {
+					on |= TEXT80_BLINK_OFF; /* blink */
+				}
+				if (line+1 == AF80_CELL_HEIGHT && (attrib & 0x04)) {
+					font_data = 0xff; /* underline */
+					on = colour;
+				}
+				else if (cursor) {
+					off = colour | TEXT80_BLINK_OFF; /* cursor */
+				}
+				data[line] = font_data;
+				fg[line] = on;
+				bg[line] = off;
+			}
+			TEXT80_DrawCell(&AF80_text, row, column, data, fg, bg);
+		}
 	}
-	*colour = attrib>>4; /* set number of palette entry */
-	return font_data;
 }
 
 void AF80_Reset(void)
@@ -2,6 +2,7 @@
 #define AF80_H_
 
 #include "atari.h"
+#include "text80.h"
 #include <stdio.h>
 
 extern int AF80_palette[16];
@@ -14,7 +15,9 @@ int AF80_D5GetByte(UWORD addr, int no_side_effects);
 void AF80_D5PutByte(UWORD addr, UBYTE byte);
 int AF80_D6GetByte(UWORD addr, int no_side_effects);
 void AF80_D6PutByte(UWORD addr, UBYTE byte);
-UBYTE AF80_GetPixels(int scanline, int column, int *colour, int blink);
+/* Image of the 80 column display, updated by AF80_UpdateText. */
+extern TEXT80_t AF80_text;
+void AF80_UpdateText(void);
 extern int AF80_enabled;
 void AF80_Reset(void);
 
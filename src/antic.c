@@ -47,10 +47,28 @@
 #ifdef NEW_CYCLE_EXACT
 #include "cycle_map.h"
 #endif
+#ifdef ANTIC_RENDER_THREAD
+#include <pthread.h>
+#endif
+#if defined(__SSE2__) && !defined(DIRTYRECT) && !defined(BASIC) && !defined(CURSES_BASIC)
+/* Draw lines of the most common ANTIC modes with SSE2, when there are no
+   PMG on them. */
+#define ANTIC_SSE2
+#include <emmintrin.h>
+#endif
 
 #define LCHOP 3			/* do not build leftmost 0..3 characters in wide mode */
 #define RCHOP 3			/* do not build rightmost 0..3 characters in wide mode */
 
+#if !defined(DIRTYRECT) && !defined(BASIC) && !defined(CURSES_BASIC)
+/* Generate collisions of lines with PMG lazily in ANTIC_COLLISIONS_ONLY
+   frames. DIRTYRECT can't draw outside Screen_atari, so it draws them all. */
+#define LAZY_COLLISIONS
+#define COLLISIONS_ONLY collisions_only
+#else
+#define COLLISIONS_ONLY FALSE
+#endif
+
 int ANTIC_break_ypos = 999;
 #if !defined(BASIC) && !defined(CURSES_BASIC)
 static int gtia_bug_active = FALSE; /* The GTIA bug mode is active */
@@ -187,11 +205,13 @@ static UBYTE *scratchFillLimit;
 void ANTIC_VideoMemset(UBYTE *ptr, UBYTE val, ULONG size)
 {
 	FILL_VIDEO(ptr, val, size);
+	ANTIC_VideoChanged(ptr, size);
 }
 
 void ANTIC_VideoPutByte(UBYTE *ptr, UBYTE val)
 {
 	WRITE_VIDEO_BYTE(ptr, val);
+	ANTIC_VideoChanged(ptr, 1);
 }
 
 
@@ -968,9 +988,23 @@ int ANTIC_Initialise(int *argc, char *argv[])
 			}
 			else a_m = TRUE;
 		}
+#ifdef ANTIC_RENDER_THREAD
+		else if (strcmp(argv[i], "-render-thread") == 0)
+			ANTIC_render_thread = TRUE;
+#endif
+#ifdef ANTIC_LINE_CACHE
+		else if (strcmp(argv[i], "-line-cache") == 0)
+			ANTIC_line_cache = TRUE;
+#endif
 		else {
 			if (strcmp(argv[i], "-help") == 0) {
 				Log_print("\t-artif <num>     Set artifacting mode 0-4 (0 = disable)");
+#ifdef ANTIC_RENDER_THREAD
+				Log_print("\t-render-thread   Draw the display in a separate thread");
+#endif
+#ifdef ANTIC_LINE_CACHE
+				Log_print("\t-line-cache      Don't redraw unchanged display lines");
+#endif
 			}
 			argv[j++] = argv[i];
 		}
@@ -1479,12 +1513,103 @@ static void draw_an_gtia_bug(const ULONG *t_pm_scanline_ptr)
 
 #endif /* PAGED_MEM */
 
+#ifdef ANTIC_SSE2
+
+/* Draws four pixel pairs for each of NCHARS bytes of DATA, two bits per
+   pixel pair, the most significant first, in COLOUR[0..3]. If ATTR is not
+   NULL, bytes with non-zero ATTR use COLOUR[4] instead of COLOUR[3].
+   Works 8 bytes (32 pixel pairs) at a time. */
+static void draw_2bpp(int nchars, const UBYTE *data, const UBYTE *attr, UWORD *ptr, const UWORD *colour)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i two = _mm_set1_epi16(2);
+	const __m128i three = _mm_set1_epi16(3);
+	/* shifts the k-th pixel pair of a byte to bits 6-7 */
+	const __m128i mul = _mm_setr_epi16(1, 4, 16, 64, 1, 4, 16, 64);
+	const __m128i c0 = _mm_set1_epi16((short) colour[0]);
+	const __m128i c1 = _mm_set1_epi16((short) colour[1]);
+	const __m128i c2 = _mm_set1_epi16((short) colour[2]);
+	const __m128i c3 = _mm_set1_epi16((short) colour[3]);
+	const __m128i c4 = _mm_set1_epi16((short) colour[attr != NULL ? 4 : 3]);
+
+	for (; nchars >= 8; nchars -= 8) {
+		/* one word per byte, then each repeated for its four pixel pairs */
+		__m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) data), zero);
+		__m128i a = attr != NULL ? _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) attr), zero) : zero;
+		__m128i d_lo = _mm_unpacklo_epi16(d, d);
+		__m128i d_hi = _mm_unpackhi_epi16(d, d);
+		__m128i a_lo = _mm_unpacklo_epi16(a, a);
+		__m128i a_hi = _mm_unpackhi_epi16(a, a);
+		__m128i dd[4];
+		__m128i aa[4];
+		int k;
+		dd[0] = _mm_unpacklo_epi32(d_lo, d_lo);
+		dd[1] = _mm_unpackhi_epi32(d_lo, d_lo);
+		dd[2] = _mm_unpacklo_epi32(d_hi, d_hi);
+		dd[3] = _mm_unpackhi_epi32(d_hi, d_hi);
+		aa[0] = _mm_unpacklo_epi32(a_lo, a_lo);
+		aa[1] = _mm_unpackhi_epi32(a_lo, a_lo);
+		aa[2] = _mm_unpacklo_epi32(a_hi, a_hi);
+		aa[3] = _mm_unpackhi_epi32(a_hi, a_hi);
+		for (k = 0; k < 4; k++) {
+			__m128i idx = _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(dd[k], mul), 6), three);
+			__m128i no_attr = _mm_cmpeq_epi16(aa[k], zero);
+			__m128i col3 = _mm_or_si128(_mm_and_si128(no_attr, c3), _mm_andnot_si128(no_attr, c4));
+			__m128i pix = _mm_and_si128(_mm_cmpeq_epi16(idx, zero), c0);
+			pix = _mm_or_si128(pix, _mm_and_si128(_mm_cmpeq_epi16(idx, one), c1));
+			pix = _mm_or_si128(pix, _mm_and_si128(_mm_cmpeq_epi16(idx, two), c2));
+			pix = _mm_or_si128(pix, _mm_and_si128(_mm_cmpeq_epi16(idx, three), col3));
+			_mm_storeu_si128((__m128i *) ptr, pix);
+			ptr += 8;
+		}
+		data += 8;
+		if (attr != NULL)
+			attr += 8;
+	}
+	for (; nchars > 0; nchars--) {
+		UBYTE d = *data++;
+		int use_attr = attr != NULL && *attr++;
+		int k;
+		for (k = 6; k >= 0; k -= 2) {
+			int pixel = (d >> k) & 3;
+			*ptr++ = pixel == 3 && use_attr ? colour[4] : colour[pixel];
+		}
+	}
+}
+
+#define SSE2_HIRES_COLOURS(colour) \
+	colour[0] = hires_norm(0x00);\
+	colour[1] = hires_norm(0x40);\
+	colour[2] = hires_norm(0x80);\
+	colour[3] = hires_norm(0xc0);
+
+#endif /* ANTIC_SSE2 */
+
 static void draw_antic_2(int nchars, const UBYTE *antic_memptr, UWORD *ptr, const ULONG *t_pm_scanline_ptr)
 {
 	INIT_BACKGROUND_6
 	INIT_ANTIC_2
 	INIT_HIRES
 
+#ifdef ANTIC_SSE2
+	if (!GTIA_pm_dirty && nchars <= 48) {
+		UBYTE data[48];
+		UWORD colour[4];
+		int i;
+		for (i = 0; i < nchars; i++) {
+			UBYTE screendata = antic_memptr[i];
+			int chdata;
+			GET_CHDATA_ANTIC_2
+			data[i] = (UBYTE) chdata;
+		}
+		SSE2_HIRES_COLOURS(colour)
+		draw_2bpp(nchars, data, NULL, ptr, colour);
+		do_border();
+		return;
+	}
+#endif
+
 	CHAR_LOOP_BEGIN
 		UBYTE screendata = *antic_memptr++;
 		int chdata;
@@ -1824,6 +1949,32 @@ static void draw_antic_4(int nchars, const UBYTE *antic_memptr, UWORD *ptr, cons
 	lookup2[0xc0] = lookup2[0x30] = lookup2[0x0c] = lookup2[0x03] = ANTIC_cl[C_PF2];
 	lookup2[0xcf] = lookup2[0x3f] = lookup2[0x1b] = lookup2[0x12] = ANTIC_cl[C_PF3];
 
+#ifdef ANTIC_SSE2
+	if (!GTIA_pm_dirty && nchars <= 48) {
+		UBYTE data[48];
+		UBYTE inverse[48];
+		UWORD colour[5];
+		int i;
+		for (i = 0; i < nchars; i++) {
+			UBYTE screendata = antic_memptr[i];
+#ifdef PAGED_MEM
+			data[i] = MEMORY_dGetByte(t_chbase + ((UWORD) (screendata & 0x7f) << 3));
+#else
+			data[i] = chptr[(screendata & 0x7f) << 3];
+#endif
+			inverse[i] = screendata & 0x80;
+		}
+		colour[0] = ANTIC_cl[C_BAK];
+		colour[1] = ANTIC_cl[C_PF0];
+		colour[2] = ANTIC_cl[C_PF1];
+		colour[3] = ANTIC_cl[C_PF2];
+		colour[4] = ANTIC_cl[C_PF3];
+		draw_2bpp(nchars, data, inverse, ptr, colour);
+		do_border();
+		return;
+	}
+#endif
+
 	CHAR_LOOP_BEGIN
 		UBYTE screendata = *antic_memptr++;
 		const UWORD *lookup;
@@ -2219,6 +2370,19 @@ static void draw_antic_e(int nchars, const UBYTE *antic_memptr, UWORD *ptr, cons
 	lookup2[0x80] = lookup2[0x20] = lookup2[0x08] = lookup2[0x02] = ANTIC_cl[C_PF1];
 	lookup2[0xc0] = lookup2[0x30] = lookup2[0x0c] = lookup2[0x03] = ANTIC_cl[C_PF2];
 
+#ifdef ANTIC_SSE2
+	if (!GTIA_pm_dirty) {
+		UWORD colour[4];
+		colour[0] = ANTIC_cl[C_BAK];
+		colour[1] = ANTIC_cl[C_PF0];
+		colour[2] = ANTIC_cl[C_PF1];
+		colour[3] = ANTIC_cl[C_PF2];
+		draw_2bpp(nchars, antic_memptr, NULL, ptr, colour);
+		do_border();
+		return;
+	}
+#endif
+
 	CHAR_LOOP_BEGIN
 		UBYTE screendata = *antic_memptr++;
 		if (IS_ZERO_ULONG(t_pm_scanline_ptr)) {
@@ -2327,6 +2491,16 @@ static void draw_antic_f(int nchars, const UBYTE *antic_memptr, UWORD *ptr, cons
 	INIT_BACKGROUND_6
 	INIT_HIRES
 
+#ifdef ANTIC_SSE2
+	if (!GTIA_pm_dirty) {
+		UWORD colour[4];
+		SSE2_HIRES_COLOURS(colour)
+		draw_2bpp(nchars, antic_memptr, NULL, ptr, colour);
+		do_border();
+		return;
+	}
+#endif
+
 	CHAR_LOOP_BEGIN
 		int screendata = *antic_memptr++;
 		if (IS_ZERO_ULONG(t_pm_scanline_ptr)) {
@@ -2642,6 +2816,769 @@ static void draw_antic_0_dmactl_bug(int nchars, const UBYTE *antic_memptr, UWORD
 }
 #endif
 
+/* Plain ANTIC mode lines --------------------------------------------------
+
+   Lines displayed in the ANTIC modes 2-f, without GTIA modes, artifacting
+   and DMACTL bugs, can be drawn or checked for collisions later, once their
+   screen data is saved and font data is read. */
+
+#ifdef LAZY_COLLISIONS
+
+#define PLAIN_BLANK 0	/* modes 0-1, or playfield DMA off */
+#define PLAIN_HIRES 1	/* modes 2, 3, f */
+#define PLAIN_4 2		/* modes 4, 5 */
+#define PLAIN_6 3		/* modes 6, 7 */
+#define PLAIN_8 4
+#define PLAIN_9 5
+#define PLAIN_A 6
+#define PLAIN_C 7		/* modes b, c */
+#define PLAIN_E 8		/* modes d, e */
+
+/* Indexes of colour registers used by plain_line_t.attr and by the
+   rendering and collision code */
+#define RC_BAK 0
+#define RC_PF0 1
+#define RC_PF1 2
+#define RC_PF2 3
+#define RC_PF3 4
+
+typedef struct {
+	int kind;
+	int nchars;
+	UBYTE data[48];			/* screen data, or font data in text modes */
+	UBYTE attr[48];			/* modes 4, 5: inverse; modes 6, 7: colour index */
+} plain_line_t;
+
+/* Instead of draw_antic_ptr(nchars, antic_memptr, ...), stores the line's
+   data in *PL. Returns FALSE if draw_antic_ptr is not a plain mode. */
+static int get_plain_line(int nchars, const UBYTE *antic_memptr, plain_line_t *pl)
+{
+	int i;
+	if (nchars <= 0 || nchars > 48)
+		return FALSE;
+	pl->nchars = nchars;
+	if (draw_antic_ptr == draw_antic_2) {
+		INIT_ANTIC_2
+		pl->kind = PLAIN_HIRES;
+		for (i = 0; i < nchars; i++) {
+			UBYTE screendata = antic_memptr[i];
+			int chdata;
+			GET_CHDATA_ANTIC_2
+			pl->data[i] = (UBYTE) chdata;
+		}
+	}
+	else if (draw_antic_ptr == draw_antic_4) {
+#ifdef PAGED_MEM
+		UWORD t_chbase = ((anticmode == 4 ? dctr : dctr >> 1) ^ chbase_20) & 0xfc07;
+#else
+		const UBYTE *chptr;
+		if (ANTIC_xe_ptr != NULL && chbase_20 < 0x8000 && chbase_20 >= 0x4000)
+			chptr = ANTIC_xe_ptr + (((anticmode == 4 ? dctr : dctr >> 1) ^ chbase_20) & 0x3c07);
+		else
+			chptr = MEMORY_mem + (((anticmode == 4 ? dctr : dctr >> 1) ^ chbase_20) & 0xfc07);
+#endif
+		ADD_FONT_CYCLES;
+		pl->kind = PLAIN_4;
+		for (i = 0; i < nchars; i++) {
+			UBYTE screendata = antic_memptr[i];
+#ifdef PAGED_MEM
+			pl->data[i] = MEMORY_dGetByte(t_chbase + ((UWORD) (screendata & 0x7f) << 3));
+#else
+			pl->data[i] = chptr[(screendata & 0x7f) << 3];
+#endif
+			pl->attr[i] = screendata & 0x80;
+		}
+	}
+	else if (draw_antic_ptr == draw_antic_6) {
+#ifdef PAGED_MEM
+		UWORD t_chbase = (anticmode == 6 ? dctr & 7 : dctr >> 1) ^ chbase_20;
+#else
+		const UBYTE *chptr;
+		if (ANTIC_xe_ptr != NULL && chbase_20 < 0x8000 && chbase_20 >= 0x4000)
+			chptr = ANTIC_xe_ptr + (((anticmode == 6 ? dctr & 7 : dctr >> 1) ^ chbase_20) - 0x4000);
+		else
+			chptr = MEMORY_mem + ((anticmode == 6 ? dctr & 7 : dctr >> 1) ^ chbase_20);
+#endif
+		ADD_FONT_CYCLES;
+		pl->kind = PLAIN_6;
+		for (i = 0; i < nchars; i++) {
+			UBYTE screendata = antic_memptr[i];
+#ifdef PAGED_MEM
+			pl->data[i] = MEMORY_dGetByte(t_chbase + ((UWORD) (screendata & 0x3f) << 3));
+#else
+			pl->data[i] = chptr[(screendata & 0x3f) << 3];
+#endif
+			pl->attr[i] = RC_PF0 + (screendata >> 6);
+		}
+	}
+	else {
+		if (draw_antic_ptr == draw_antic_f)
+			pl->kind = PLAIN_HIRES;
+		else if (draw_antic_ptr == draw_antic_8)
+			pl->kind = PLAIN_8;
+		else if (draw_antic_ptr == draw_antic_9)
+			pl->kind = PLAIN_9;
+		else if (draw_antic_ptr == draw_antic_a)
+			pl->kind = PLAIN_A;
+		else if (draw_antic_ptr == draw_antic_c)
+			pl->kind = PLAIN_C;
+		else if (draw_antic_ptr == draw_antic_e)
+			pl->kind = PLAIN_E;
+		else
+			return FALSE;
+		memcpy(pl->data, antic_memptr, nchars);
+	}
+	return TRUE;
+}
+
+/* Everything a plain line looks like when GTIA_pm_scanline is clear */
+typedef struct {
+	plain_line_t pf;
+	UWORD *line;			/* scrn_ptr of the line */
+	UWORD *ptr;				/* start of the playfield */
+	int left_border_start;
+	int left_border_chars;
+	int right_border_start;
+	int right_border_end;
+	ULONG border;			/* ANTIC_lookup_gtia9[0] */
+	UWORD colour[5];		/* BAK, PF0, PF1, PF2, PF3 */
+	UWORD hires[4];			/* hi-res pixel pairs 00, 01, 10, 11 */
+} render_line_t;
+
+/* Stores the borders and colours of the current line in *RL. */
+static void get_line_colours(render_line_t *rl)
+{
+	rl->line = scrn_ptr;
+	rl->left_border_start = LBORDER_START;
+	rl->left_border_chars = left_border_chars;
+	rl->right_border_start = right_border_start;
+	rl->right_border_end = RBORDER_END;
+	rl->border = ANTIC_lookup_gtia9[0];
+	rl->colour[RC_BAK] = ANTIC_cl[C_BAK];
+	rl->colour[RC_PF0] = ANTIC_cl[C_PF0];
+	rl->colour[RC_PF1] = ANTIC_cl[C_PF1];
+	rl->colour[RC_PF2] = ANTIC_cl[C_PF2];
+	rl->colour[RC_PF3] = ANTIC_cl[C_PF3];
+}
+
+/* Stores the playfield of the current line in *RL, like get_plain_line.
+   Returns FALSE if draw_antic_ptr is not a plain mode. */
+static int get_line_playfield(render_line_t *rl, int nchars, const UBYTE *antic_memptr, UWORD *ptr)
+{
+	if (!get_plain_line(nchars, antic_memptr, &rl->pf))
+		return FALSE;
+	rl->ptr = ptr;
+	if (rl->pf.kind == PLAIN_HIRES) {
+		INIT_HIRES
+		rl->hires[0] = hires_norm(0x00);
+		rl->hires[1] = hires_norm(0x40);
+		rl->hires[2] = hires_norm(0x80);
+		rl->hires[3] = hires_norm(0xc0);
+	}
+	return TRUE;
+}
+
+/* Lazy collisions ---------------------------------------------------------
+
+   In frames drawn with ANTIC_COLLISIONS_ONLY nothing is drawn to
+   Screen_atari. Lines without PMG can't generate playfield collisions, so
+   they are skipped. Plain mode lines with PMG are logged together with
+   their GTIA_pm_scanline, and their collisions are only generated when the
+   program reads a playfield collision register. HITCLR just empties the
+   log. Other lines are drawn into a scratch line, as they would be
+   normally. */
+
+typedef struct {
+	plain_line_t pf;
+	int x;					/* offset of the playfield in the line */
+	UBYTE pm[Screen_WIDTH / 2];
+} coll_line_t;
+
+static int collisions_only = FALSE;
+static UWORD coll_scanline[Screen_WIDTH / 2];
+static coll_line_t coll_log[Screen_HEIGHT];
+static int coll_logged = 0;
+
+/* Generates collisions of a logged line exactly as the draw_antic_*
+   routines would. */
+static void coll_resolve(const coll_line_t *cl, UBYTE colls[5])
+{
+	const UBYTE *pm = cl->pm + cl->x;
+	const UBYTE *pm_end = cl->pm + 4 * (48 - RCHOP);
+	int i;
+
+	for (i = 0; i < cl->pf.nchars; i++) {
+		UBYTE data = cl->pf.data[i];
+		int kk;
+		switch (cl->pf.kind) {
+		case PLAIN_HIRES:
+			for (kk = 0; kk < 4; kk++) {
+				if (data & 0xc0)
+					colls[RC_PF2] |= *pm;
+				pm++;
+				data <<= 2;
+			}
+			break;
+		case PLAIN_4:
+			for (kk = 0; kk < 4; kk++) {
+				int pixel = data >> 6;
+				if (pixel == 3 && cl->pf.attr[i])
+					pixel = RC_PF3;
+				colls[pixel] |= *pm++;
+				data <<= 2;
+			}
+			break;
+		case PLAIN_6:
+			for (kk = 0; kk < 8; kk++) {
+				colls[data & 0x80 ? cl->pf.attr[i] : RC_BAK] |= *pm++;
+				data <<= 1;
+			}
+			break;
+		case PLAIN_8:
+			for (kk = 0; kk < 4; kk++) {
+				if (pm >= pm_end)
+					break;
+				colls[data >> 6] |= pm[0] | pm[1] | pm[2] | pm[3];
+				pm += 4;
+				data <<= 2;
+			}
+			break;
+		case PLAIN_9:
+			for (kk = 0; kk < 4; kk++) {
+				if (pm >= pm_end)
+					break;
+				colls[data & 0x80 ? RC_PF0 : RC_BAK] |= pm[0] | pm[1];
+				colls[data & 0x40 ? RC_PF0 : RC_BAK] |= pm[2] | pm[3];
+				pm += 4;
+				data <<= 2;
+			}
+			break;
+		case PLAIN_A:
+			for (kk = 0; kk < 4; kk++) {
+				colls[data >> 6] |= pm[0] | pm[1];
+				pm += 2;
+				data <<= 2;
+			}
+			break;
+		case PLAIN_C:
+			for (kk = 0; kk < 8; kk++) {
+				colls[data & 0x80 ? RC_PF0 : RC_BAK] |= *pm++;
+				data <<= 1;
+			}
+			break;
+		case PLAIN_E:
+			for (kk = 0; kk < 4; kk++) {
+				colls[data >> 6] |= *pm++;
+				data <<= 2;
+			}
+			break;
+		}
+	}
+}
+
+void ANTIC_UpdateCollisions(void)
+{
+	UBYTE colls[5] = { 0, 0, 0, 0, 0 };
+	int i;
+	for (i = 0; i < coll_logged; i++)
+		coll_resolve(&coll_log[i], colls);
+	coll_logged = 0;
+	PF0PM |= colls[RC_PF0];
+	PF1PM |= colls[RC_PF1];
+	PF2PM |= colls[RC_PF2];
+	PF3PM |= colls[RC_PF3];
+}
+
+void ANTIC_ClearCollisions(void)
+{
+	coll_logged = 0;
+}
+
+/* Logs a line instead of draw_antic_ptr(nchars, antic_memptr, ptr, ...).
+   Returns FALSE if the line must be drawn. */
+static int coll_defer(int nchars, const UBYTE *antic_memptr, const UWORD *ptr)
+{
+	coll_line_t *cl;
+	if (coll_logged >= Screen_HEIGHT)
+		ANTIC_UpdateCollisions();
+	cl = &coll_log[coll_logged];
+	if (!get_plain_line(nchars, antic_memptr, &cl->pf))
+		return FALSE;
+	cl->x = ptr - scrn_ptr;
+	memcpy(cl->pm, GTIA_pm_scanline, sizeof(cl->pm));
+	coll_logged++;
+	return TRUE;
+}
+
+#else /* LAZY_COLLISIONS */
+
+void ANTIC_UpdateCollisions(void)
+{
+}
+
+void ANTIC_ClearCollisions(void)
+{
+}
+
+#endif /* LAZY_COLLISIONS */
+
+/* Deferred line rendering -------------------------------------------------
+
+   With ANTIC_render_thread set, ANTIC_Frame doesn't draw the display lines
+   that can't influence the emulation. Their inputs (resolved font data,
+   colours, borders) are logged instead, and a separate thread draws them
+   into Screen_atari while the CPU goes on emulating the following lines.
+   A line can be deferred if:
+   - it is drawn in one go, i.e. no display register was changed while it
+     was being displayed,
+   - no PMG is visible on it, so it generates no collisions,
+   - it is displayed in a plain ANTIC mode.
+   Other lines are drawn at once, as usual. The log is always emptied by the
+   end of ANTIC_Frame, so Screen_atari is complete when it returns. */
+
+#ifdef ANTIC_RENDER_THREAD
+
+int ANTIC_render_thread = FALSE;
+
+/* Lines are handed over to the render thread in batches */
+#define RENDER_BATCH 16
+
+static render_line_t render_log[Screen_HEIGHT];
+static int render_logged = 0;		/* written only by the emulation thread */
+static int render_published = 0;	/* guarded by render_mutex */
+static int render_done = 0;			/* guarded by render_mutex */
+static int render_thread_started = FALSE;
+static int render_thread_stop = FALSE;	/* guarded by render_mutex */
+static pthread_t render_thread_id;
+static pthread_mutex_t render_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t render_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t render_done_cond = PTHREAD_COND_INITIALIZER;
+
+static void render_fill(UWORD *ptr, UWORD colour, int n)
+{
+	while (n-- > 0)
+		WRITE_VIDEO(ptr++, colour);
+}
+
+/* Draws a logged line exactly as the draw_antic_* routines and do_border()
+   would, when GTIA_pm_scanline is clear. */
+static void render_line(const render_line_t *rl)
+{
+	const UWORD *colour = rl->colour;
+	UWORD *ptr = rl->ptr;
+	UWORD *pf_end = rl->line + 4 * (48 - RCHOP);
+	int i;
+
+	if (rl->pf.kind == PLAIN_BLANK) {
+		FILL_VIDEO(rl->line + rl->left_border_start, colour[RC_BAK], (rl->right_border_end - rl->left_border_start) * 2);
+		return;
+	}
+	for (i = 0; i < rl->pf.nchars; i++) {
+		UBYTE data = rl->pf.data[i];
+		int kk;
+		switch (rl->pf.kind) {
+		case PLAIN_HIRES:
+			if (data) {
+				WRITE_VIDEO(ptr++, rl->hires[data >> 6]);
+				WRITE_VIDEO(ptr++, rl->hires[(data >> 4) & 3]);
+				WRITE_VIDEO(ptr++, rl->hires[(data >> 2) & 3]);
+				WRITE_VIDEO(ptr++, rl->hires[data & 3]);
+			}
+			else {
+				render_fill(ptr, colour[RC_PF2], 4);
+				ptr += 4;
+			}
+			break;
+		case PLAIN_4:
+			for (kk = 0; kk < 4; kk++) {
+				int pixel = data >> 6;
+				if (pixel == 3 && rl->pf.attr[i])
+					pixel = RC_PF3;
+				WRITE_VIDEO(ptr++, colour[pixel]);
+				data <<= 2;
+			}
+			break;
+		case PLAIN_6:
+			for (kk = 0; kk < 8; kk++) {
+				WRITE_VIDEO(ptr++, data & 0x80 ? colour[rl->pf.attr[i]] : colour[RC_BAK]);
+				data <<= 1;
+			}
+			break;
+		case PLAIN_8:
+			for (kk = 0; kk < 4; kk++) {
+				if (ptr >= pf_end)
+					break;
+				render_fill(ptr, colour[data >> 6], 4);
+				ptr += 4;
+				data <<= 2;
+			}
+			break;
+		case PLAIN_9:
+			for (kk = 0; kk < 4; kk++) {
+				if (ptr >= pf_end)
+					break;
+				render_fill(ptr, colour[data & 0x80 ? RC_PF0 : RC_BAK], 2);
+				render_fill(ptr + 2, colour[data & 0x40 ? RC_PF0 : RC_BAK], 2);
+				ptr += 4;
+				data <<= 2;
+			}
+			break;
+		case PLAIN_A:
+			for (kk = 0; kk < 4; kk++) {
+				render_fill(ptr, colour[data >> 6], 2);
+				ptr += 2;
+				data <<= 2;
+			}
+			break;
+		case PLAIN_C:
+			for (kk = 0; kk < 8; kk++) {
+				WRITE_VIDEO(ptr++, colour[data & 0x80 ? RC_PF0 : RC_BAK]);
+				data <<= 1;
+			}
+			break;
+		case PLAIN_E:
+			for (kk = 0; kk < 4; kk++) {
+				WRITE_VIDEO(ptr++, colour[data >> 6]);
+				data <<= 2;
+			}
+			break;
+		}
+	}
+	/* same as do_border() */
+	ptr = rl->line + rl->left_border_start;
+	for (i = rl->left_border_chars; i; i--) {
+		ULONG *l_ptr = (ULONG *) ptr;
+		WRITE_VIDEO_LONG(l_ptr++, rl->border);
+		WRITE_VIDEO_LONG(l_ptr++, rl->border);
+		ptr = (UWORD *) l_ptr;
+	}
+	for (ptr = rl->line + rl->right_border_start; ptr < rl->line + rl->right_border_end; ptr += 4) {
+		ULONG *l_ptr = (ULONG *) ptr;
+		WRITE_VIDEO_LONG(l_ptr++, rl->border);
+		WRITE_VIDEO_LONG(l_ptr, rl->border);
+	}
+}
+
+static void *render_thread_main(void *arg)
+{
+	pthread_mutex_lock(&render_mutex);
+	for (;;) {
+		int i;
+		int n;
+		while (render_done == render_published && !render_thread_stop)
+			pthread_cond_wait(&render_work_cond, &render_mutex);
+		if (render_thread_stop)
+			break;
+		n = render_published;
+		pthread_mutex_unlock(&render_mutex);
+		for (i = render_done; i < n; i++)
+			render_line(&render_log[i]);
+		pthread_mutex_lock(&render_mutex);
+		render_done = n;
+		if (render_done == render_published)
+			pthread_cond_signal(&render_done_cond);
+	}
+	pthread_mutex_unlock(&render_mutex);
+	return NULL;
+}
+
+/* Hands the logged lines over to the render thread. */
+static void render_publish(void)
+{
+	pthread_mutex_lock(&render_mutex);
+	render_published = render_logged;
+	pthread_cond_signal(&render_work_cond);
+	pthread_mutex_unlock(&render_mutex);
+}
+
+/* Waits until all logged lines are drawn, and empties the log. */
+static void render_sync(void)
+{
+	if (render_logged == 0)
+		return;
+	pthread_mutex_lock(&render_mutex);
+	render_published = render_logged;
+	pthread_cond_signal(&render_work_cond);
+	while (render_done != render_published)
+		pthread_cond_wait(&render_done_cond, &render_mutex);
+	render_logged = render_published = render_done = 0;
+	pthread_mutex_unlock(&render_mutex);
+}
+
+/* Draws what is left in the log and stops the render thread. */
+static void render_thread_exit(void)
+{
+	if (!render_thread_started)
+		return;
+	render_sync();
+	pthread_mutex_lock(&render_mutex);
+	render_thread_stop = TRUE;
+	pthread_cond_signal(&render_work_cond);
+	pthread_mutex_unlock(&render_mutex);
+	pthread_join(render_thread_id, NULL);
+	render_thread_started = FALSE;
+	render_thread_stop = FALSE;
+}
+
+/* Returns the next free log entry if the current line can be deferred,
+   or NULL otherwise. */
+static render_line_t *render_new_line(void)
+{
+	render_line_t *rl;
+	if (!ANTIC_render_thread || GTIA_pm_dirty || render_logged >= Screen_HEIGHT)
+		return NULL;
+#ifndef NO_YPOS_BREAK_FLICKER
+	if (ANTIC_break_ypos >= 1000)
+		return NULL;
+#endif
+	if (!render_thread_started) {
+		if (pthread_create(&render_thread_id, NULL, render_thread_main, NULL) != 0) {
+			Log_print("Cannot create the render thread, drawing in the emulation thread");
+			ANTIC_render_thread = FALSE;
+			return NULL;
+		}
+		render_thread_started = TRUE;
+	}
+	rl = &render_log[render_logged];
+	get_line_colours(rl);
+	return rl;
+}
+
+static void render_log_line(void)
+{
+	if (++render_logged - render_published >= RENDER_BATCH)
+		render_publish();
+}
+
+/* Logs a line with no playfield, instead of draw_antic_0_ptr().
+   Returns FALSE if the line must be drawn at once. */
+static int render_defer_blank(void)
+{
+	render_line_t *rl;
+	if (draw_antic_0_ptr != draw_antic_0 || (rl = render_new_line()) == NULL)
+		return FALSE;
+	rl->pf.kind = PLAIN_BLANK;
+	render_log_line();
+	return TRUE;
+}
+
+/* Logs a line instead of draw_antic_ptr(nchars, antic_memptr, ptr, ...).
+   Font data is read here, as the CPU may change it before the line is
+   drawn. Returns FALSE if the line must be drawn at once. */
+static int render_defer(int nchars, const UBYTE *antic_memptr, UWORD *ptr)
+{
+	render_line_t *rl = render_new_line();
+	if (rl == NULL || !get_line_playfield(rl, nchars, antic_memptr, ptr))
+		return FALSE;
+	render_log_line();
+	return TRUE;
+}
+
+#endif /* ANTIC_RENDER_THREAD */
+
+/* Line cache --------------------------------------------------------------
+
+   With ANTIC_line_cache set, ANTIC_Frame remembers the inputs of each line
+   that could be deferred to the render thread, and doesn't draw the line
+   again while they stay the same in the following frames. Such lines are
+   cleared in Screen_dirty_lines. A line drawn in any other way is
+   forgotten, and so is a line overwritten with ANTIC_VideoPutByte,
+   ANTIC_VideoMemset or ANTIC_VideoChanged. The lines are remembered for
+   each of the last two screens that Screen_atari pointed to, as run-ahead
+   draws the look-ahead frame on a screen of its own. */
+
+#ifdef ANTIC_LINE_CACHE
+
+int ANTIC_line_cache = FALSE;
+
+#define LINE_CACHE_SCREENS 2
+
+static struct {
+	const ULONG *screen;
+	render_line_t line[Screen_HEIGHT];
+	UBYTE cached[Screen_HEIGHT];
+} line_caches[LINE_CACHE_SCREENS];
+
+/* the lines of the screen that was drawn last */
+static render_line_t *line_cache = line_caches[0].line;
+static UBYTE *line_cached = line_caches[0].cached;
+
+static int same_line(const render_line_t *a, const render_line_t *b)
+{
+	if (a->pf.kind != b->pf.kind
+	 || a->left_border_start != b->left_border_start
+	 || a->left_border_chars != b->left_border_chars
+	 || a->right_border_start != b->right_border_start
+	 || a->right_border_end != b->right_border_end
+	 || a->border != b->border
+	 || memcmp(a->colour, b->colour, sizeof(a->colour)) != 0)
+		return FALSE;
+	if (a->pf.kind == PLAIN_BLANK)
+		return TRUE;
+	if (a->ptr != b->ptr || a->pf.nchars != b->pf.nchars
+	 || memcmp(a->pf.data, b->pf.data, a->pf.nchars) != 0)
+		return FALSE;
+	switch (a->pf.kind) {
+	case PLAIN_HIRES:
+		return memcmp(a->hires, b->hires, sizeof(a->hires)) == 0;
+	case PLAIN_4:
+	case PLAIN_6:
+		return memcmp(a->pf.attr, b->pf.attr, a->pf.nchars) == 0;
+	default:
+		return TRUE;
+	}
+}
+
+/* Selects the lines remembered for Screen_atari. A screen not seen before
+   replaces the one that was not drawn last, with no lines. */
+static void line_cache_check_screen(void)
+{
+	int i;
+	for (i = 0; i < LINE_CACHE_SCREENS; i++) {
+		if (line_caches[i].screen == Screen_atari)
+			break;
+	}
+	if (i == LINE_CACHE_SCREENS) {
+		i = line_cache == line_caches[0].line ? 1 : 0;
+		line_caches[i].screen = Screen_atari;
+		memset(line_caches[i].cached, 0, sizeof(line_caches[i].cached));
+	}
+	line_cache = line_caches[i].line;
+	line_cached = line_caches[i].cached;
+}
+
+void ANTIC_ForgetLines(const ULONG *screen)
+{
+	int i;
+	for (i = 0; i < LINE_CACHE_SCREENS; i++) {
+		if (line_caches[i].screen == screen)
+			memset(line_caches[i].cached, 0, sizeof(line_caches[i].cached));
+	}
+}
+
+static int line_cache_y(void)
+{
+	return (scrn_ptr - (UWORD *) Screen_atari) / (Screen_WIDTH / 2);
+}
+
+/* Forgets the current line, when it is drawn in parts. */
+static void line_cache_forget(void)
+{
+	line_cached[line_cache_y()] = FALSE;
+}
+
+/* Checks the current line against the cache, before it is drawn in one go
+   with draw_antic_0_ptr() (if BLANK) or draw_antic_ptr(). Returns TRUE if
+   the line is already in Screen_atari, or FALSE if it must be drawn. */
+static int line_cache_hit(int blank, int nchars, const UBYTE *antic_memptr, UWORD *ptr)
+{
+	int y = line_cache_y();
+	int xpos = ANTIC_xpos;
+	render_line_t rl;
+	if (ANTIC_line_cache && !GTIA_pm_dirty
+#ifndef NO_SIMPLE_PAL_BLENDING
+	 && !ANTIC_pal_blending
+#endif
+#ifndef NO_YPOS_BREAK_FLICKER
+	 && ANTIC_break_ypos < 1000
+#endif
+	) {
+		get_line_colours(&rl);
+		rl.pf.kind = PLAIN_BLANK;
+		if (blank ? draw_antic_0_ptr == draw_antic_0 : get_line_playfield(&rl, nchars, antic_memptr, ptr)) {
+			if (line_cached[y] && same_line(&rl, &line_cache[y])) {
+				Screen_dirty_lines[y] = 0;
+				return TRUE;
+			}
+			line_cache[y] = rl;
+			line_cached[y] = TRUE;
+			/* drawing the line adds the font cycles again */
+			ANTIC_xpos = xpos;
+			return FALSE;
+		}
+	}
+	line_cached[y] = FALSE;
+	return FALSE;
+}
+
+#endif /* ANTIC_LINE_CACHE */
+
+#endif /* !defined(BASIC) && !defined(CURSES_BASIC) */
+
+/* ANTIC_VideoMemset() and ANTIC_VideoPutByte() call it in every build */
+void ANTIC_VideoChanged(const UBYTE *ptr, ULONG size)
+{
+#ifdef ANTIC_LINE_CACHE
+	long start = ptr - (const UBYTE *) Screen_atari;
+	long y;
+	long y_end;
+	if (size == 0 || start < 0 || start >= Screen_HEIGHT * Screen_WIDTH)
+		return;
+	line_cache_check_screen();
+	y_end = (start + size + Screen_WIDTH - 1) / Screen_WIDTH;
+	if (y_end > Screen_HEIGHT)
+		y_end = Screen_HEIGHT;
+	for (y = start / Screen_WIDTH; y < y_end; y++) {
+		line_cached[y] = FALSE;
+		Screen_dirty_lines[y] = 1;
+	}
+#endif
+}
+
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+
+/* Draws a line with no playfield. FULL_LINE is TRUE if the whole line is
+   drawn at once. */
+static void draw_line_0(int full_line)
+{
+#ifdef LAZY_COLLISIONS
+	if (collisions_only)
+		return; /* no playfield, no playfield collisions */
+#endif
+#ifdef ANTIC_LINE_CACHE
+	if (!full_line)
+		line_cache_forget();
+	else if (line_cache_hit(TRUE, 0, NULL, NULL))
+		return;
+#endif
+#ifdef ANTIC_RENDER_THREAD
+	if (full_line && render_defer_blank())
+		return;
+#endif
+	draw_antic_0_ptr();
+}
+
+/* Draws a line with playfield, with draw_antic_ptr(). FULL_LINE is TRUE if
+   the whole line is drawn at once. */
+static void draw_line(int full_line, int nchars, const UBYTE *antic_memptr, UWORD *ptr, const ULONG *t_pm_scanline_ptr)
+{
+#ifdef LAZY_COLLISIONS
+	if (collisions_only) {
+		if (!GTIA_pm_dirty && !gtia_bug_active) {
+#ifndef NEW_CYCLE_EXACT
+			if (anticmode < 8)
+				ANTIC_xpos += font_cycles[md];
+#endif
+			return;
+		}
+		if (!full_line || !coll_defer(nchars, antic_memptr, ptr))
+			draw_antic_ptr(nchars, antic_memptr, ptr, t_pm_scanline_ptr);
+		return;
+	}
+#endif
+#ifdef ANTIC_LINE_CACHE
+	if (!full_line)
+		line_cache_forget();
+	else if (line_cache_hit(FALSE, nchars, antic_memptr, ptr))
+		return;
+#endif
+#ifdef ANTIC_RENDER_THREAD
+	if (full_line && render_defer(nchars, antic_memptr, ptr))
+		return;
+#endif
+	draw_antic_ptr(nchars, antic_memptr, ptr, t_pm_scanline_ptr);
+}
+
 /* Artifacting ------------------------------------------------------------ */
 
 void ANTIC_UpdateArtifacting(void)
@@ -2763,6 +3700,31 @@ void ANTIC_UpdateArtifacting(void)
 
 #endif /* !defined(BASIC) && !defined(CURSES_BASIC) */
 
+void ANTIC_Exit(void)
+{
+#ifdef ANTIC_RENDER_THREAD
+	render_thread_exit();
+#endif
+}
+
+void ANTIC_AbortFrame(void)
+{
+#ifdef ANTIC_RENDER_THREAD
+	render_sync();
+#endif
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+	scrn_ptr = (UWORD *) Screen_atari;
+#endif
+#ifdef LAZY_COLLISIONS
+	collisions_only = FALSE;
+#endif
+#ifdef NEW_CYCLE_EXACT
+	/* otherwise GTIA writes before the next frame draws the display
+	   would update a line of the abandoned frame */
+	ANTIC_cur_screen_pos = ANTIC_NOT_DRAWING;
+#endif
+}
+
 /* Display List ------------------------------------------------------------ */
 
 UBYTE ANTIC_GetDLByte(UWORD *paddr)
@@ -2870,14 +3832,31 @@ void ANTIC_Frame(int draw_display)
 	int cpu2antic_index;
 #endif /* NEW_CYCLE_EXACT */
 
+#ifdef ANTIC_RENDER_THREAD
+	/* in case the previous frame was interrupted */
+	render_sync();
+#endif
 	ANTIC_ypos = 0;
 	do {
 		POKEY_Scanline();		/* check and generate IRQ */
 		OVERSCREEN_LINE;
 	} while (ANTIC_ypos < 8);
 
+#ifdef LAZY_COLLISIONS
+	collisions_only = draw_display == ANTIC_COLLISIONS_ONLY;
+	if (collisions_only)
+		/* all lines are drawn in one scratch line */
+		scrn_ptr = coll_scanline;
+	else
+#endif
 	scrn_ptr = (UWORD *) Screen_atari;
 #if !defined(BASIC) && !defined(CURSES_BASIC)
+	if (draw_display && !COLLISIONS_ONLY) {
+#ifdef ANTIC_LINE_CACHE
+		line_cache_check_screen();
+#endif
+		memset(Screen_dirty_lines, 1, sizeof(Screen_dirty_lines));
+	}
 	memset(ANTIC_scanline_hires, 0, sizeof(ANTIC_scanline_hires));
 #endif
 #ifdef NEW_CYCLE_EXACT
@@ -3097,7 +4076,8 @@ void ANTIC_Frame(int draw_display)
 			UPDATE_GTIA_BUG;
 			ANTIC_cur_screen_pos = ANTIC_NOT_DRAWING;
 			YPOS_BREAK_FLICKER;
-			scrn_ptr += Screen_WIDTH / 2;
+			if (!COLLISIONS_ONLY)
+				scrn_ptr += Screen_WIDTH / 2;
 			if (no_jvb) {
 				dctr++;
 				dctr &= 0xf;
@@ -3121,10 +4101,11 @@ void ANTIC_Frame(int draw_display)
 		ANTIC_xpos += ANTIC_DMAR;
 
 		if (anticmode < 2 || (ANTIC_DMACTL & 3) == 0) {
-			draw_antic_0_ptr();
+			draw_line_0(TRUE);
 			GOEOL;
 			YPOS_BREAK_FLICKER;
-			scrn_ptr += Screen_WIDTH / 2;
+			if (!COLLISIONS_ONLY)
+				scrn_ptr += Screen_WIDTH / 2;
 			if (no_jvb) {
 				dctr++;
 				dctr &= 0xf;
@@ -3148,7 +4129,7 @@ void ANTIC_Frame(int draw_display)
 				ANTIC_xpos -= extra_cycles[md];
 		}
 
-		draw_antic_ptr(chars_displayed[md],
+		draw_line(TRUE, chars_displayed[md],
 			antic_memory + ANTIC_margin + ch_offset[md],
 			scrn_ptr + x_min[md],
 			(ULONG *) &GTIA_pm_scanline[x_min[md]]);
@@ -3156,14 +4137,19 @@ void ANTIC_Frame(int draw_display)
 		GOEOL;
 #endif /* NEW_CYCLE_EXACT */
 		YPOS_BREAK_FLICKER;
-		scrn_ptr += Screen_WIDTH / 2;
+		if (!COLLISIONS_ONLY)
+			scrn_ptr += Screen_WIDTH / 2;
 		dctr++;
 		dctr &= 0xf;
 	} while (ANTIC_ypos < (Screen_HEIGHT + 8));
 
+#ifdef ANTIC_RENDER_THREAD
+	render_sync();
+#endif
+
 #ifndef NO_SIMPLE_PAL_BLENDING
 	/* Simple PAL blending, using only the base 256 color palette. */
-	if (ANTIC_pal_blending)
+	if (ANTIC_pal_blending && !COLLISIONS_ONLY)
 	{
 		int ypos = ANTIC_ypos - 1;
 		/* Start at the last screen line (248). */
@@ -3357,6 +4343,8 @@ void draw_partial_scanline(int l, int r)
 	/* so that r_pfactual-l_pfactual / (2,4) = number of 16,32 pixel 'chars' */
 	/* to be drawn */
 	int r_pfactual = 0;
+	/* flag: if true, the whole scanline is drawn at once */
+	int full_line;
 	/* it is the offset of the 8pixel block aligned with pf which overlaps */
 	/* the left border. We need this for modes 6-c, because in these modes */
 	/* the code will save 8pixel blocks to the left of l_pfchar and */
@@ -3482,6 +4470,8 @@ void draw_partial_scanline(int l, int r)
 		ch_adj = l_pfchar;
 	}
 	memcpy(sv_buf2, scrn_ptr + sv_bufstart2, sv_bufsize2 * sizeof(UWORD)); /* save part of screen */
+	/* only a line drawn in one go, with nothing to restore, can be deferred */
+	full_line = l == lborder_start && r == rborder_end && sv_bufsize == 0 && sv_bufsize2 == 0;
 
 	if (dont_display_playfield) {
 /* the idea here is to use draw_antic_0_ptr() to draw just the border only, since */
@@ -3493,10 +4483,10 @@ void draw_partial_scanline(int l, int r)
 		else if (l >= rborder_start) {
 			left_border_start = right_border_start;
 		}
-		draw_antic_0_ptr();
+		draw_line_0(full_line);
 	}
 	else {
-		draw_antic_ptr(nchars, /* chars_displayed[md], */
+		draw_line(full_line, nchars, /* chars_displayed[md], */
 			antic_memory + ANTIC_margin + ch_offset[md] + ch_adj,
 			scrn_ptr + x_min[md] + x_min_adj,
 			(ULONG *) &GTIA_pm_scanline[x_min[md] + x_min_adj]);
@@ -80,6 +80,14 @@ extern UBYTE ANTIC_PENV_input;
 
 int ANTIC_Initialise(int *argc, char *argv[]);
 void ANTIC_Reset(void);
+void ANTIC_Exit(void);
+/* Forgets the drawing state of a frame left with a longjmp out of
+   ANTIC_Frame(), after the state of the machine was restored. */
+void ANTIC_AbortFrame(void);
+/* DRAW_DISPLAY is TRUE to draw Screen_atari, FALSE to skip drawing (then
+   no collisions are generated) or ANTIC_COLLISIONS_ONLY to generate
+   collisions without drawing. */
+#define ANTIC_COLLISIONS_ONLY 2
 void ANTIC_Frame(int draw_display);
 UBYTE ANTIC_GetByte(UWORD addr, int no_side_effects);
 void ANTIC_PutByte(UWORD addr, UBYTE byte);
@@ -93,10 +101,21 @@ void ANTIC_UpdateArtifacting(void);
 /* Video memory access */
 void ANTIC_VideoMemset(UBYTE *ptr, UBYTE val, ULONG size);
 void ANTIC_VideoPutByte(UBYTE *ptr, UBYTE val);
+/* Call after writing SIZE bytes at PTR in Screen_atari by other means. */
+void ANTIC_VideoChanged(const UBYTE *ptr, ULONG size);
 
 /* GTIA calls it on a write to PRIOR */
 void ANTIC_SetPrior(UBYTE prior);
 
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+/* Collisions with playfield of lines drawn with ANTIC_COLLISIONS_ONLY are
+   only generated when needed. GTIA calls ANTIC_UpdateCollisions before
+   playfield collision registers are read and ANTIC_ClearCollisions on a
+   write to HITCLR. */
+void ANTIC_UpdateCollisions(void);
+void ANTIC_ClearCollisions(void);
+#endif
+
 /* Saved states */
 void ANTIC_StateSave(void);
 void ANTIC_StateRead(void);
@@ -141,4 +160,21 @@ void ANTIC_UpdateScanlinePrior(UBYTE byte);
 extern int ANTIC_pal_blending;
 #endif /* NO_SIMPLE_PAL_BLENDING */
 
+#if defined(HAVE_LIBPTHREAD) && !defined(DIRTYRECT) && !defined(USE_COLOUR_TRANSLATION_TABLE) && !defined(BASIC) && !defined(CURSES_BASIC)
+#define ANTIC_RENDER_THREAD
+/* Set to TRUE to draw display lines that don't affect the emulation in a
+   separate thread, in parallel with CPU emulation. */
+extern int ANTIC_render_thread;
+#endif
+
+#if !defined(DIRTYRECT) && !defined(BASIC) && !defined(CURSES_BASIC)
+#define ANTIC_LINE_CACHE
+/* Set to TRUE to not draw again display lines that are the same as in the
+   previous frame. Screen_dirty_lines tells which lines were drawn. */
+extern int ANTIC_line_cache;
+/* Forgets the lines of SCREEN after it has been overwritten as a whole,
+   without marking them in Screen_dirty_lines. */
+void ANTIC_ForgetLines(const ULONG *screen);
+#endif
+
 #endif /* ANTIC_H_ */
@@ -81,7 +81,11 @@
 #include "pia.h"
 #include "platform.h"
 #include "pokey.h"
+#include "romcache.h"
 #include "rtime.h"
+#ifdef RUNAHEAD
+#include "runahead.h"
+#endif
 #include "pbi.h"
 #include "sio.h"
 #include "sysrom.h"
@@ -93,6 +97,9 @@
 #if defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 #include "file_export.h"
 #endif
+#ifdef SCREENSHOTS
+#include "frame_export.h"
+#endif
 #ifndef BASIC
 #include "statesav.h"
 #ifndef __PLUS
@@ -175,6 +182,8 @@ int Atari800_turbo = FALSE;
 int Atari800_turbo_speed = 0; /* percentage speed or 0 for max turbo */
 int Atari800_start_in_monitor = FALSE;
 int Atari800_auto_frameskip = FALSE;
+int Atari800_frame_stats = FALSE;
+ULONG Atari800_frame_time_histogram[Atari800_FRAME_TIME_BUCKETS];
 
 #ifdef BENCHMARK
 static double benchmark_start_time;
@@ -366,6 +375,9 @@ int Atari800_Initialise(int *argc, char *argv[])
 #ifndef BASIC
 	const char *state_file = NULL;
 #endif
+#ifdef BENCHMARK
+	double init_start_time = Util_time();
+#endif
 #ifdef __PLUS
 	/* Atari800Win PLus doesn't use configuration files,
 	   it reads configuration from the Registry */
@@ -419,6 +431,16 @@ int Atari800_Initialise(int *argc, char *argv[])
 			else if (strcmp(argv[i], "-verbose") == 0) {
 				verbose = TRUE;
 			}
+			else if (strcmp(argv[i], "-romcache") == 0) {
+				if (i + 1 < *argc) {
+					if (!ROMCACHE_Open(argv[++i]))
+						Log_print("Cannot read ROM cache %s", argv[i]);
+				}
+				else {
+					Log_print("Missing argument for '%s'", argv[i]);
+					return FALSE;
+				}
+			}
 			else {
 				argv[j++] = argv[i];
 			}
@@ -601,6 +623,13 @@ int Atari800_Initialise(int *argc, char *argv[])
 			POKEYSND_stereo_enabled = FALSE;
 			Sound_desired.channels = 1;
 		}
+		else if (strcmp(argv[i], "-quad") == 0) {
+			POKEYSND_quad_enabled = TRUE;
+			POKEYSND_stereo_enabled = TRUE;
+			Sound_desired.channels = 2;
+		}
+		else if (strcmp(argv[i], "-noquad") == 0)
+			POKEYSND_quad_enabled = FALSE;
 #endif /* STEREO_SOUND */
 		else if (strcmp(argv[i], "-turbo") == 0) {
 			Atari800_turbo = TRUE;
@@ -707,6 +736,14 @@ int Atari800_Initialise(int *argc, char *argv[])
 #endif /* BASIC */
 			else if (strcmp(argv[i], "-monitor") == 0)
 				Atari800_start_in_monitor = TRUE;
+#if !defined(__PLUS) && !defined(LIBATARI800)
+			else if (strcmp(argv[i], "-frame-stats") == 0)
+				Atari800_frame_stats = TRUE;
+#endif
+#ifdef CPU_MONITOR_CORE
+			else if (strcmp(argv[i], "-monitor-hooks") == 0)
+				CPU_monitor_core = TRUE;
+#endif
 #ifdef MONITOR_HINTS
 			else if (strcmp(argv[i], "-label-file") == 0)
 				if (i_a) MONITOR_PreloadLabelFile(argv[++i]); else a_m = TRUE;
@@ -724,6 +761,7 @@ int Atari800_Initialise(int *argc, char *argv[])
 #ifndef __PLUS
 					help_only = TRUE;
 					Log_print("\t-config <file>   Specify alternate configuration file");
+					Log_print("\t-romcache <file> Remember ROM checksums and cartridge types in <file>");
 #endif
 					Log_print("\t-autosave-config Automatically save configuration on emulator exit");
 					Log_print("\t-no-autosave-config");
@@ -764,9 +802,17 @@ int Atari800_Initialise(int *argc, char *argv[])
 #ifdef STEREO_SOUND
 					Log_print("\t-stereo          Turn on emulation of two POKEYs");
 					Log_print("\t-nostereo        Turn off emulation of two POKEYs");
+					Log_print("\t-quad            Turn on emulation of four POKEYs (in stereo)");
+					Log_print("\t-noquad          Turn off emulation of four POKEYs");
 #endif
 					Log_print("\t-turbo           Run emulated Atari as fast as possible");
 					Log_print("\t-monitor         Start emulated Atari in the monitor");
+#if !defined(__PLUS) && !defined(LIBATARI800)
+					Log_print("\t-frame-stats     Print a histogram of frame times on exit");
+#endif
+#ifdef CPU_MONITOR_CORE
+					Log_print("\t-monitor-hooks   Always record execution history etc. for the monitor");
+#endif
 #ifdef MONITOR_BREAK
 					Log_print("\t-bbrk            Break on BRK instruction");
 					Log_print("\t-bpc <addr>      Break on PC=<addr>");
@@ -818,6 +864,9 @@ int Atari800_Initialise(int *argc, char *argv[])
 #endif
 #ifdef POKEYREC
 		|| !POKEYREC_Initialise(argc, argv)
+#endif
+#ifdef RUNAHEAD
+		|| !RUNAHEAD_Initialise(argc, argv)
 #endif
 		|| !SIO_Initialise (argc, argv)
 		|| !CARTRIDGE_Initialise(argc, argv)
@@ -854,6 +903,9 @@ int Atari800_Initialise(int *argc, char *argv[])
 #if defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 		|| !File_Export_Initialise(argc, argv)
 #endif
+#ifdef SCREENSHOTS
+		|| !Frame_Export_Initialise(argc, argv)
+#endif
 #endif
 		/* Initialise Custom Chips */
 		|| !ANTIC_Initialise(argc, argv)
@@ -978,6 +1030,7 @@ int Atari800_Initialise(int *argc, char *argv[])
 
 #ifdef BENCHMARK
 	benchmark_start_time = Util_time();
+	printf("Initialised in %.2f ms\n", (benchmark_start_time - init_start_time) * 1e3);
 #endif
 
 #ifdef SOUND
@@ -1038,10 +1091,17 @@ int Atari800_Exit(int run_monitor)
 	}
 #endif /* STAT_UNALIGNED_WORDS */
 	restart = PLATFORM_Exit(run_monitor);
+#if !defined(__PLUS) && !defined(LIBATARI800)
+	if (!restart && Atari800_frame_stats)
+		Atari800_PrintFrameTimes();
+#endif
 #ifdef CTRL_C_HANDLER
 	/* If a user pressed Ctrl+C in the monitor, avoid immediate return to it. */
 	sigint_flag = FALSE;
 #endif /* CTRL_C_HANDLER */
+	if (restart)
+		/* breakpoints may have been set or cleared in the monitor */
+		CPU_SelectCore();
 #ifndef __PLUS
 	if (!restart) {
 #ifndef LIBATARI800
@@ -1054,6 +1114,7 @@ int Atari800_Exit(int run_monitor)
 
 		/* Cleanup functions, in reverse order as the init functions in
 		   Atari800_Initialise(). */
+		ANTIC_Exit();
 #ifdef SOUND
 		Sound_Exit();
 #endif
@@ -1072,12 +1133,16 @@ int Atari800_Exit(int run_monitor)
 		PBI_Exit();
 		CASSETTE_Exit(); /* Finish writing to the cassette file */
 		CARTRIDGE_Exit();
+		ROMCACHE_Close();
 		SIO_Exit();	/* umount disks, so temporary files are deleted */
 #ifdef IDE
 		IDE_Exit();
 #endif
 #ifdef POKEYREC
 		POKEYREC_Exit();
+#endif
+#ifdef RUNAHEAD
+		RUNAHEAD_Exit();
 #endif
 		Devices_Exit();
 #ifdef R_IO_DEVICE
@@ -1085,6 +1150,9 @@ int Atari800_Exit(int run_monitor)
 #endif
 #if defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 		File_Export_StopRecording();
+#endif
+#ifdef SCREENSHOTS
+		Frame_Export_Exit();
 #endif
 		MONITOR_Exit();
 #ifdef SDL
@@ -1137,6 +1205,55 @@ static void autoframeskip(double curtime, double lasttime)
 	}
 }
 
+static double last_sync_time = 0.0;
+
+static void RecordFrameTime(double frame_time)
+{
+	int bucket = (int) (frame_time / Atari800_FRAME_TIME_BUCKET_SIZE);
+	if (bucket >= Atari800_FRAME_TIME_BUCKETS)
+		bucket = Atari800_FRAME_TIME_BUCKETS - 1;
+	Atari800_frame_time_histogram[bucket]++;
+}
+
+/* Returns the lower edge in ms of the bucket holding fraction FRAC of the frames. */
+static double FrameTimePercentile(ULONG count, double frac)
+{
+	ULONG seen = 0;
+	int i;
+	for (i = 0; i < Atari800_FRAME_TIME_BUCKETS - 1; i++) {
+		seen += Atari800_frame_time_histogram[i];
+		if (seen >= count * frac)
+			break;
+	}
+	return i * Atari800_FRAME_TIME_BUCKET_SIZE * 1000.0;
+}
+
+void Atari800_PrintFrameTimes(void)
+{
+	double sum = 0.0;
+	ULONG count = 0;
+	int i;
+
+	for (i = 0; i < Atari800_FRAME_TIME_BUCKETS; i++) {
+		ULONG n = Atari800_frame_time_histogram[i];
+		count += n;
+		/* the middle of the bucket stands for all its frames */
+		sum += (i + 0.5) * Atari800_FRAME_TIME_BUCKET_SIZE * 1000.0 * n;
+	}
+	if (count == 0)
+		return;
+	Log_print("Frame times (%lu frames):", (unsigned long) count);
+	for (i = 0; i < Atari800_FRAME_TIME_BUCKETS; i++) {
+		ULONG n = Atari800_frame_time_histogram[i];
+		if (n == 0)
+			continue;
+		Log_print(i == Atari800_FRAME_TIME_BUCKETS - 1 ? "  >=%5.1f ms: %lu" : "  %5.1f ms: %lu",
+		          i * Atari800_FRAME_TIME_BUCKET_SIZE * 1000.0, (unsigned long) n);
+	}
+	Log_print("mean %.2f ms, median %.1f ms, 99%% %.1f ms", sum / count,
+	          FrameTimePercentile(count, 0.5), FrameTimePercentile(count, 0.99));
+}
+
 void Atari800_Sync(void)
 {
 	static double lasttime = 0;
@@ -1157,8 +1274,11 @@ void Atari800_Sync(void)
 	curtime = Util_time();
 	if (Atari800_auto_frameskip)
 		autoframeskip(curtime, lasttime);
-	Util_sleep(lasttime - curtime);
+	Util_sleep_until(lasttime);
 	curtime = Util_time();
+	if (last_sync_time > 0)
+		RecordFrameTime(curtime - last_sync_time);
+	last_sync_time = curtime;
 
 	if ((lasttime + deltatime) < curtime)
 		lasttime = curtime;
@@ -1380,6 +1500,7 @@ void Atari800_Frame(void)
 	INPUT_Frame();
 #endif
 	GTIA_Frame();
+	CPU_SelectCore();
 
 #ifdef BASIC
 	basic_frame();
@@ -1393,6 +1514,13 @@ void Atari800_Frame(void)
 		basic_frame();
 #else
 		ANTIC_Frame(TRUE);
+#ifdef RUNAHEAD
+		RUNAHEAD_Frame();
+#endif
+#ifdef SCREENSHOTS
+		/* before anything is drawn over the Atari screen */
+		Frame_Export_Frame();
+#endif
 		INPUT_DrawMousePointer();
 		Screen_DrawAtariSpeed(Util_time());
 		Screen_DrawDiskLED();
@@ -1409,7 +1537,7 @@ void Atari800_Frame(void)
 #if defined(VERY_SLOW) || defined(CURSES_BASIC)
 		basic_frame();
 #else
-		ANTIC_Frame(Atari800_collisions_in_skipped_frames);
+		ANTIC_Frame(Atari800_collisions_in_skipped_frames ? ANTIC_COLLISIONS_ONLY : FALSE);
 #endif
 		Atari800_display_screen = FALSE;
 	}
@@ -111,6 +111,14 @@ extern int Atari800_refresh_rate;
 /* If TRUE, will try to maintain the emulation speed to 100% */
 extern int Atari800_auto_frameskip;
 
+/* Histogram of the times between successive Atari800_Sync() returns, in
+   buckets of Atari800_FRAME_TIME_BUCKET_SIZE seconds; the last bucket also
+   counts all longer frames. Printed on exit if Atari800_frame_stats is set. */
+#define Atari800_FRAME_TIME_BUCKETS 101
+#define Atari800_FRAME_TIME_BUCKET_SIZE 0.0005
+extern ULONG Atari800_frame_time_histogram[Atari800_FRAME_TIME_BUCKETS];
+extern int Atari800_frame_stats;
+
 /* Set to TRUE for faster emulation with Atari800_refresh_rate > 1.
    Set to FALSE for accurate emulation with Atari800_refresh_rate > 1. */
 extern int Atari800_collisions_in_skipped_frames;
@@ -181,6 +189,9 @@ UNALIGNED_STAT_DECL(memory_write_aligned_word_stat)
 /* Sleeps until it's time to emulate next Atari frame. */
 void Atari800_Sync(void);
 
+/* Logs Atari800_frame_time_histogram and its mean and percentiles. */
+void Atari800_PrintFrameTimes(void);
+
 /* Load a ROM image filename of size nbytes into buffer */
 int Atari800_LoadImage(const char *filename, UBYTE *buffer, int nbytes);
 
@@ -134,6 +134,22 @@ void atari_ntsc_init( atari_ntsc_t* ntsc, atari_ntsc_setup_t const* setup )
 				gen_kernel( &impl, y, i, q, kernel );
 				/* Atari change: no alternating burst phases - remove code for merge_fields. */
 				correct_errors( rgb, kernel );
+#ifdef ATARI_NTSC_SSE2
+				{
+					/* Atari change: copy of the kernel for the SSE2 blitters. The low
+					   32 bits are all that matter for the output. */
+					int part;
+					for ( part = 0; part < atari_ntsc_in_chunk; part++ )
+					{
+						unsigned int* out = ntsc->sse2_table [entry] [part];
+						int n;
+						for ( n = 0; n < atari_ntsc_sse2_part_size; n++ )
+							out [n] = 0;
+						for ( n = 0; n < 14; n++ )
+							out [8 + n] = (unsigned int) kernel [part * 14 + n];
+					}
+				}
+#endif
 			}
 		}
 	}
@@ -161,8 +177,173 @@ void atari_ntsc_init( atari_ntsc_t* ntsc, atari_ntsc_setup_t const* setup )
 	#error "Need 32-bit int type"
 #endif
 
+#ifdef ATARI_NTSC_SSE2
+#include <emmintrin.h>
+
+/* Atari change: SSE2 version of the blitters' inner loop, with the same
+   output. Input pixel J of a chunk adds entries 14*J to 14*J+13 of its
+   kernel to 14 consecutive output pixels, starting at pixel 2*J of the
+   chunk; so the output pixels of a chunk get the kernels of the chunk's
+   input pixels and of the two previous chunks'. In sse2_table these 14
+   entries are surrounded by zeros, so the kernel's share of output pixels
+   0-7 (7 is not used) is loaded whole. */
+static void blit_row_sse2( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* line_in,
+		int chunk_count, void* rgb_out, int format )
+{
+	/* kernels of input pixel J of the current chunk (kJ), the previous
+	   chunk (kxJ) and the one before (kxxJ) */
+	unsigned int const* k0;
+	unsigned int const* k1;
+	unsigned int const* k2;
+	unsigned int const* k3;
+	unsigned int const* kx0;
+	unsigned int const* kx1;
+	unsigned int const* kx2;
+	unsigned int const* kx3;
+	unsigned int const* kxx0;
+	unsigned int const* kxx1;
+	unsigned int const* kxx2;
+	unsigned int const* kxx3;
+	__m128i const clamp_mask = _mm_set1_epi32( atari_ntsc_clamp_mask );
+	__m128i const clamp_add = _mm_set1_epi32( atari_ntsc_clamp_add );
+	__m128i const bias16 = _mm_set1_epi32( 0x8000 );
+	__m128i const opaque = _mm_set1_epi32( format == ATARI_NTSC_RGB_FORMAT_ARGB32 ? 0xFF000000 : 0xFF );
+	atari_ntsc_out16_t* out16 = (atari_ntsc_out16_t*) rgb_out;
+	atari_ntsc_out32_t* out32 = (atari_ntsc_out32_t*) rgb_out;
+	int n;
+
+	/* same as ATARI_NTSC_BEGIN_ROW( ntsc, black, black, black, line_in [0] ) */
+	kx0 = kxx0 = ntsc->sse2_table [atari_ntsc_black] [0];
+	kx1 = kxx1 = ntsc->sse2_table [atari_ntsc_black] [1];
+	kx2 = kxx2 = ntsc->sse2_table [atari_ntsc_black] [2];
+	kx3 = ntsc->sse2_table [ATARI_NTSC_ADJ_IN( line_in [0] )] [3];
+	kxx3 = ntsc->sse2_table [atari_ntsc_black] [3];
+	++line_in;
+
+	/* the last chunk finishes the row with black pixels */
+	for ( n = 0; n <= chunk_count; n++ )
+	{
+		__m128i lo = _mm_setzero_si128();
+		__m128i hi = _mm_setzero_si128();
+		__m128i sub;
+		__m128i clamp;
+		if ( n < chunk_count )
+		{
+			k0 = ntsc->sse2_table [ATARI_NTSC_ADJ_IN( line_in [0] )] [0];
+			k1 = ntsc->sse2_table [ATARI_NTSC_ADJ_IN( line_in [1] )] [1];
+			k2 = ntsc->sse2_table [ATARI_NTSC_ADJ_IN( line_in [2] )] [2];
+			k3 = ntsc->sse2_table [ATARI_NTSC_ADJ_IN( line_in [3] )] [3];
+		}
+		else
+		{
+			k0 = ntsc->sse2_table [atari_ntsc_black] [0];
+			k1 = ntsc->sse2_table [atari_ntsc_black] [1];
+			k2 = ntsc->sse2_table [atari_ntsc_black] [2];
+			k3 = ntsc->sse2_table [atari_ntsc_black] [3];
+		}
+#define ATARI_NTSC_SSE2_ADD( kernel, offset ) {\
+	unsigned int const* e_ = (kernel) + 8 + (offset);\
+	lo = _mm_add_epi32( lo, _mm_loadu_si128( (__m128i const*) e_ ) );\
+	hi = _mm_add_epi32( hi, _mm_loadu_si128( (__m128i const*) (e_ + 4) ) );\
+}
+		ATARI_NTSC_SSE2_ADD( k0, 0 );
+		ATARI_NTSC_SSE2_ADD( k1, -2 );
+		ATARI_NTSC_SSE2_ADD( k2, -4 );
+		ATARI_NTSC_SSE2_ADD( k3, -6 );
+		ATARI_NTSC_SSE2_ADD( kx0, 7 );
+		ATARI_NTSC_SSE2_ADD( kx1, 5 );
+		ATARI_NTSC_SSE2_ADD( kx2, 3 );
+		ATARI_NTSC_SSE2_ADD( kx3, 1 );
+		ATARI_NTSC_SSE2_ADD( kxx0, 14 );
+		ATARI_NTSC_SSE2_ADD( kxx1, 12 );
+		ATARI_NTSC_SSE2_ADD( kxx2, 10 );
+		ATARI_NTSC_SSE2_ADD( kxx3, 8 );
+#undef ATARI_NTSC_SSE2_ADD
+		kxx0 = kx0; kx0 = k0;
+		kxx1 = kx1; kx1 = k1;
+		kxx2 = kx2; kx2 = k2;
+		kxx3 = kx3; kx3 = k3;
+
+		/* ATARI_NTSC_CLAMP_ */
+		sub = _mm_and_si128( _mm_srli_epi32( lo, 9 ), clamp_mask );
+		clamp = _mm_sub_epi32( clamp_add, sub );
+		lo = _mm_and_si128( _mm_or_si128( lo, clamp ), _mm_sub_epi32( clamp, sub ) );
+		sub = _mm_and_si128( _mm_srli_epi32( hi, 9 ), clamp_mask );
+		clamp = _mm_sub_epi32( clamp_add, sub );
+		hi = _mm_and_si128( _mm_or_si128( hi, clamp ), _mm_sub_epi32( clamp, sub ) );
+
+		/* ATARI_NTSC_RGB_OUT_ */
+#define ATARI_NTSC_SSE2_FIELD( raw, shift, mask ) \
+	_mm_and_si128( (shift) < 0 ? _mm_slli_epi32( raw, -(shift) ) : _mm_srli_epi32( raw, (shift) ), _mm_set1_epi32( mask ) )
+#define ATARI_NTSC_SSE2_RGB( raw, s1, m1, s2, m2, s3, m3 ) \
+	_mm_or_si128( _mm_or_si128( ATARI_NTSC_SSE2_FIELD( raw, s1, m1 ), ATARI_NTSC_SSE2_FIELD( raw, s2, m2 ) ), \
+	              ATARI_NTSC_SSE2_FIELD( raw, s3, m3 ) )
+		switch ( format )
+		{
+		case ATARI_NTSC_RGB_FORMAT_RGB16:
+			lo = ATARI_NTSC_SSE2_RGB( lo, 13, 0xF800, 8, 0x07E0, 4, 0x001F );
+			hi = ATARI_NTSC_SSE2_RGB( hi, 13, 0xF800, 8, 0x07E0, 4, 0x001F );
+			break;
+		case ATARI_NTSC_RGB_FORMAT_BGR16:
+			lo = ATARI_NTSC_SSE2_RGB( lo, 24, 0x001F, 8, 0x07E0, -7, 0xF800 );
+			hi = ATARI_NTSC_SSE2_RGB( hi, 24, 0x001F, 8, 0x07E0, -7, 0xF800 );
+			break;
+		case ATARI_NTSC_RGB_FORMAT_ARGB32:
+			lo = _mm_or_si128( ATARI_NTSC_SSE2_RGB( lo, 5, 0xFF0000, 3, 0xFF00, 1, 0xFF ), opaque );
+			hi = _mm_or_si128( ATARI_NTSC_SSE2_RGB( hi, 5, 0xFF0000, 3, 0xFF00, 1, 0xFF ), opaque );
+			break;
+		default: /* ATARI_NTSC_RGB_FORMAT_BGRA32 */
+			lo = _mm_or_si128( ATARI_NTSC_SSE2_RGB( lo, 13, 0xFF00, -5, 0xFF0000, -23, 0xFF000000 ), opaque );
+			hi = _mm_or_si128( ATARI_NTSC_SSE2_RGB( hi, 13, 0xFF00, -5, 0xFF0000, -23, 0xFF000000 ), opaque );
+			break;
+		}
+#undef ATARI_NTSC_SSE2_RGB
+#undef ATARI_NTSC_SSE2_FIELD
+
+		/* write output pixels 0-6 */
+		if ( format == ATARI_NTSC_RGB_FORMAT_RGB16 || format == ATARI_NTSC_RGB_FORMAT_BGR16 )
+		{
+			/* _mm_packs_epi32 saturates signed values */
+			__m128i out = _mm_xor_si128( _mm_packs_epi32( _mm_sub_epi32( lo, bias16 ), _mm_sub_epi32( hi, bias16 ) ),
+			                             _mm_set1_epi16( (short) 0x8000 ) );
+			_mm_storel_epi64( (__m128i*) out16, out );
+			out16 [4] = (atari_ntsc_out16_t) _mm_extract_epi16( out, 4 );
+			out16 [5] = (atari_ntsc_out16_t) _mm_extract_epi16( out, 5 );
+			out16 [6] = (atari_ntsc_out16_t) _mm_extract_epi16( out, 6 );
+			out16 += 7;
+		}
+		else
+		{
+			_mm_storeu_si128( (__m128i*) out32, lo );
+			_mm_storel_epi64( (__m128i*) (out32 + 4), hi );
+			out32 [6] = (atari_ntsc_out32_t) _mm_cvtsi128_si32( _mm_srli_si128( hi, 8 ) );
+			out32 += 7;
+		}
+		line_in += atari_ntsc_in_chunk;
+	}
+}
+
+/* Atari change: filters IN_HEIGHT rows with blit_row_sse2. */
+static void blit_sse2( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* input, long in_row_width,
+		int in_width, int in_height, void* rgb_out, long out_pitch, int format )
+{
+	int chunk_count = (in_width - 1) / atari_ntsc_in_chunk;
+	for ( ; in_height; --in_height )
+	{
+		blit_row_sse2( ntsc, input, chunk_count, rgb_out, format );
+		input += in_row_width;
+		rgb_out = (char*) rgb_out + out_pitch;
+	}
+}
+#endif /* ATARI_NTSC_SSE2 */
+
 void atari_ntsc_blit_rgb16( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* input, long in_row_width,
 		int in_width, int in_height, void* rgb_out, long out_pitch )
+#ifdef ATARI_NTSC_SSE2
+{
+	blit_sse2( ntsc, input, in_row_width, in_width, in_height, rgb_out, out_pitch, ATARI_NTSC_RGB_FORMAT_RGB16 );
+}
+#else
 {
 	int chunk_count = (in_width - 1) / atari_ntsc_in_chunk;
 	for ( ; in_height; --in_height )
@@ -217,9 +398,15 @@ void atari_ntsc_blit_rgb16( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* inp
 		rgb_out = (char*) rgb_out + out_pitch;
 	}
 }
+#endif
 
 void atari_ntsc_blit_bgr16( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* input, long in_row_width,
 		int in_width, int in_height, void* rgb_out, long out_pitch )
+#ifdef ATARI_NTSC_SSE2
+{
+	blit_sse2( ntsc, input, in_row_width, in_width, in_height, rgb_out, out_pitch, ATARI_NTSC_RGB_FORMAT_BGR16 );
+}
+#else
 {
 	int chunk_count = (in_width - 1) / atari_ntsc_in_chunk;
 	for ( ; in_height; --in_height )
@@ -274,9 +461,15 @@ void atari_ntsc_blit_bgr16( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* inp
 		rgb_out = (char*) rgb_out + out_pitch;
 	}
 }
+#endif
 
 void atari_ntsc_blit_argb32( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* input, long in_row_width,
 		int in_width, int in_height, void* rgb_out, long out_pitch )
+#ifdef ATARI_NTSC_SSE2
+{
+	blit_sse2( ntsc, input, in_row_width, in_width, in_height, rgb_out, out_pitch, ATARI_NTSC_RGB_FORMAT_ARGB32 );
+}
+#else
 {
 	int chunk_count = (in_width - 1) / atari_ntsc_in_chunk;
 	for ( ; in_height; --in_height )
@@ -331,9 +524,15 @@ void atari_ntsc_blit_argb32( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* in
 		rgb_out = (char*) rgb_out + out_pitch;
 	}
 }
+#endif
 
 void atari_ntsc_blit_bgra32( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* input, long in_row_width,
 		int in_width, int in_height, void* rgb_out, long out_pitch )
+#ifdef ATARI_NTSC_SSE2
+{
+	blit_sse2( ntsc, input, in_row_width, in_width, in_height, rgb_out, out_pitch, ATARI_NTSC_RGB_FORMAT_BGRA32 );
+}
+#else
 {
 	int chunk_count = (in_width - 1) / atari_ntsc_in_chunk;
 	for ( ; in_height; --in_height )
@@ -388,5 +587,6 @@ void atari_ntsc_blit_bgra32( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* in
 		rgb_out = (char*) rgb_out + out_pitch;
 	}
 }
+#endif
 
 #endif
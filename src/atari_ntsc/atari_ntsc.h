@@ -124,8 +124,20 @@ statement in a block (unless you're using C++). */
 /* private */
 enum { atari_ntsc_entry_size = 56 };
 typedef unsigned long atari_ntsc_rgb_t;
+
+/* Atari change: with SSE2 the built-in blitters sum 4 output pixels at once.
+   They use a copy of the table with 32-bit entries, where the 14 entries
+   of each of the 4 kernel parts are at offset 8 of 32, surrounded by zeros. */
+#if defined(__SSE2__) && !defined(ATARI_NTSC_NO_BLITTERS)
+#define ATARI_NTSC_SSE2
+enum { atari_ntsc_sse2_part_size = 32 };
+#endif
+
 struct atari_ntsc_t {
 	atari_ntsc_rgb_t table [atari_ntsc_palette_size] [atari_ntsc_entry_size];
+#ifdef ATARI_NTSC_SSE2
+	unsigned int sse2_table [atari_ntsc_palette_size] [atari_ntsc_in_chunk] [atari_ntsc_sse2_part_size];
+#endif
 };
 enum { atari_ntsc_burst_size = atari_ntsc_entry_size / atari_ntsc_burst_count };
 
@@ -103,12 +103,15 @@ static int motif_disk_sel = 1;
 #include <X11/extensions/XShm.h>
 
 static XShmSegmentInfo shminfo;
-static XImage *image = NULL;
 #ifdef USE_COLOUR_TRANSLATION_TABLE
 extern int colour_translation_table[256];
 #endif
 #endif /* SHM */
 
+/* The window's image, kept on the client side (in shared memory with SHM)
+   and uploaded where it changes. */
+static XImage *image = NULL;
+
 static int invisible = 0;
 
 #ifdef LINUX_JOYSTICK
@@ -154,17 +157,15 @@ static int clipping_height = Screen_HEIGHT;
 static Display *display = NULL;
 static Screen *screen = NULL;
 static Window window;
-#ifndef SHM
-static Pixmap pixmap;
-#endif
 static Visual *visual = NULL;
 static Colormap cmap;
 
 static GC gc;
-static GC gc_colour[256];
 static unsigned long colours[256];
 static int colors_allocated;
-static int force_redraw;  /* flag for PLATFORM_DisplayScreen: redraw whole screen after a palette change */
+/* flag for PLATFORM_DisplayScreen: compare all lines with the image, not only
+   those in Screen_dirty_lines (after a palette change or a skipped display) */
+static int force_redraw = TRUE;
 
 #ifdef XVIEW
 static Frame frame;
@@ -192,8 +193,7 @@ static Panel_item refresh_slider;
 
 static int SHIFT = 0x00;
 static int CONTROL = 0x00;
-static UBYTE *image_data = NULL;
-static int modified;
+static int modified = TRUE; /* upload the whole image */
 
 static int keypad_mode = -1;	/* Joystick */
 static int keypad_trig = 1;	/* Keypad Trigger Position */
@@ -205,14 +205,12 @@ static int mouse_stick;			/* Mouse Joystick Position */
 static int js0_mode = -1;
 static int js1_mode = -1;
 
-#ifndef SHM
-
-#define	NPOINTS	(4096 / 4)
-#define	NRECTS	(4096 / 4)
-
-static XPoint points[NPOINTS];
-static XRectangle rectangles[NRECTS];
-#endif
+/* Changed areas of the image, in window coordinates. Lines next to each
+   other make one rectangle; past MAX_DAMAGE, rectangles are merged. */
+#define MAX_DAMAGE 16
+static XRectangle damage[MAX_DAMAGE];
+static int num_damage = 0;
+static int damage_y = -1; /* line after the last rectangle, or -1 */
 
 static int keyboard_consol = INPUT_CONSOL_NONE;
 static int menu_consol = INPUT_CONSOL_NONE;
@@ -261,14 +259,7 @@ static int GetKeyCode(XEvent *event)
 
 	switch (event->type) {
 	case Expose:
-#ifndef SHM
-		XCopyArea(display, pixmap, window, gc,
-				  0, 0,
-				  window_width, window_height,
-				  0, 0);
-#else
 		modified = TRUE;
-#endif
 		break;
 	case FocusIn:
 		autorepeat_off();
@@ -2208,32 +2199,19 @@ int PLATFORM_Initialise(int *argc, char *argv[])
 
 	}
 #else
-	pixmap = XCreatePixmap(display, window,
-						   window_width, window_height, depth);
+	image = XCreateImage(display, visual, depth, ZPixmap, 0, NULL,
+						 window_width, window_height, 32, 0);
+	image->data = (char *) Util_malloc(image->bytes_per_line * window_height);
+	memset(image->data, 0, image->bytes_per_line * window_height);
 #endif /* SHM */
 
 	PLATFORM_PaletteUpdate();
 
-#ifndef SHM
-	XFillRectangle(display, pixmap, gc, 0, 0,
-				   window_width, window_height);
-	for (i = 0; i < NRECTS; i++)
-		rectangles[i].height = (windowsize == Huge) ? 3 : 2;
-#endif
-
 	XMapWindow(display, window);
 
 	XSync(display, False);
 	autorepeat_get();
 
- /*
-   ============================
-   Storage for Atari 800 Screen
-   ============================
- */
-	image_data = (UBYTE *) Util_malloc(Screen_WIDTH * Screen_HEIGHT);
-	memset(image_data, 0, Screen_WIDTH * Screen_HEIGHT);
-
 	keyboard_consol = INPUT_CONSOL_NONE;
 
 	if (x11bug) {
@@ -2271,21 +2249,14 @@ int PLATFORM_Exit(int run_monitor)
 		restart = FALSE;
 
 	if (!restart) {
-		if (image_data != NULL)
-			free(image_data);
-
 		if (display != NULL) {
 			XSync(display, True);
 
 			if (private_cmap)
 				XFreeColormap(display, cmap);
 
-#ifdef SHM
 			if (image != NULL)
 				XDestroyImage(image);
-#else
-			XFreePixmap(display, pixmap);
-#endif
 			XUnmapWindow(display, window);
 			XDestroyWindow(display, window);
 			autorepeat_restore();
@@ -2304,274 +2275,141 @@ int PLATFORM_Exit(int run_monitor)
 	return restart;
 }
 
+/* Adds Atari pixels FIRST_X to LAST_X-1 (counted from clipping_x) of line
+   Y to the damage. */
+static void AddDamage(int y, int first_x, int last_x)
+{
+	XRectangle *r;
+	y = (y - clipping_y) * clipping_factor;
+	first_x *= clipping_factor;
+	last_x *= clipping_factor;
+	if (num_damage > 0 && (damage_y == y || num_damage == MAX_DAMAGE)) {
+		r = &damage[num_damage - 1];
+		if (first_x < r->x) {
+			r->width += r->x - first_x;
+			r->x = first_x;
+		}
+		if (last_x > r->x + r->width)
+			r->width = last_x - r->x;
+		r->height = y + clipping_factor - r->y;
+	}
+	else {
+		r = &damage[num_damage++];
+		r->x = first_x;
+		r->y = y;
+		r->width = last_x - first_x;
+		r->height = clipping_factor;
+	}
+	damage_y = y + clipping_factor;
+}
+
+/* Converts the lines of Screen_atari that may have changed to the image,
+   tracking the changed pixels in damage[]. */
+#define UPDATE_IMAGE(pixel_type) \
+	{ \
+		int pitch = image->bytes_per_line / sizeof(pixel_type); \
+		pixel_type *line = (pixel_type *) image->data; \
+		for (y = clipping_y; y < clipping_y + clipping_height; y++) { \
+			if (force_redraw || Screen_dirty_lines[y]) { \
+				pixel_type *ptr = line; \
+				int first_x = -1; \
+				int last_x = 0; \
+				for (x = 0; x < clipping_width; x++) { \
+					pixel_type help_color = (pixel_type) colours[ptr2[x]]; \
+					if (help_color != *ptr) { \
+						int i; \
+						int j; \
+						if (first_x < 0) \
+							first_x = x; \
+						last_x = x + 1; \
+						for (j = 0; j < clipping_factor; j++) \
+							for (i = 0; i < clipping_factor; i++) \
+								ptr[j * pitch + i] = help_color; \
+					} \
+					ptr += clipping_factor; \
+				} \
+				if (first_x >= 0) \
+					AddDamage(y, first_x, last_x); \
+			} \
+			ptr2 += Screen_WIDTH; \
+			line += pitch * clipping_factor; \
+		} \
+	}
+
 void PLATFORM_DisplayScreen(void)
 {
 	static char status_line[64];
 	int update_status_line = FALSE;
 
-	if (!invisible) {
+	if (invisible)
+		force_redraw = TRUE;
+	else {
 		const UBYTE *ptr2 = (const UBYTE *) Screen_atari + clipping_y * Screen_WIDTH + clipping_x;
-
-#ifdef SHM
-
-		int first_x = Screen_WIDTH;
-		int last_x = -1000;
-		int first_y = Screen_HEIGHT;
-		int last_y = -1000;
 		int x;
 		int y;
+		int i;
 
-#define SHM_SET_LAST \
-		last_y = y; \
-		if (x > last_x) \
-			last_x = x; \
-		if (x < first_x) \
-			first_x = x;
-
-#define SHM_DISPLAY_SCREEN(pixel_type) \
-			pixel_type *ptr = (pixel_type *) image->data; \
-			pixel_type help_color; \
-			if (windowsize == Small) { \
-				for (y = clipping_y; y < (clipping_y + clipping_height); y++) { \
-					for (x = clipping_x; x < (clipping_x + clipping_width); x++) { \
-						help_color = colours[*ptr2++]; \
-						if (help_color != *ptr || force_redraw) { \
-							SHM_SET_LAST \
-							*ptr = help_color; \
-						} \
-						ptr++; \
-					} \
-					if (first_y > last_y && last_y >= 0) \
-						first_y = last_y; \
-					ptr2 += Screen_WIDTH - clipping_width; \
-				} \
-			} \
-			else if (windowsize == Large) { \
-				for (y = clipping_y; y < (clipping_y + clipping_height); y++) { \
-					pixel_type *ptr_second_line = ptr + window_width; \
-					for (x = clipping_x; x < (clipping_x + clipping_width); x++) { \
-						help_color = colours[*ptr2++]; \
-						if (help_color != *ptr || force_redraw) { \
-							SHM_SET_LAST \
-							ptr[0] = help_color; \
-							ptr[1] = help_color; \
-							ptr_second_line[0] = help_color; \
-							ptr_second_line[1] = help_color; \
-						} \
-						ptr += 2; \
-						ptr_second_line += 2; \
-					} \
-					if (first_y > last_y && last_y >= 0) \
-						first_y = last_y; \
-					ptr2 += Screen_WIDTH - clipping_width; \
-					ptr += window_width; \
-				} \
-			} \
-			else { \
-				for (y = clipping_y; y < (clipping_y + clipping_height); y++) { \
-					pixel_type *ptr_second_line = ptr + window_width; \
-					pixel_type *ptr_third_line = ptr + window_width + window_width; \
-					for (x = clipping_x; x < (clipping_x + clipping_width); x++) { \
-						help_color = colours[*ptr2++]; \
-						if (help_color != *ptr || force_redraw) { \
-							SHM_SET_LAST \
-							ptr[0] = help_color; \
-							ptr[1] = help_color; \
-							ptr[2] = help_color; \
-							ptr_second_line[0] = help_color; \
-							ptr_second_line[1] = help_color; \
-							ptr_second_line[2] = help_color; \
-							ptr_third_line[0] = help_color; \
-							ptr_third_line[1] = help_color; \
-							ptr_third_line[2] = help_color; \
-						} \
-						ptr += 3; \
-						ptr_second_line += 3; \
-						ptr_third_line += 3; \
-					} \
-					if (first_y > last_y && last_y >= 0) \
-						first_y = last_y; \
-					ptr2 += Screen_WIDTH - clipping_width; \
-					ptr += window_width + window_width; \
-				} \
-			}
-
+		num_damage = 0;
+		damage_y = -1;
 		if (image->bits_per_pixel == 32) {
-			SHM_DISPLAY_SCREEN(ULONG)
+			UPDATE_IMAGE(ULONG)
 		}
 		else if (image->bits_per_pixel == 16) {
-			SHM_DISPLAY_SCREEN(UWORD)
+			UPDATE_IMAGE(UWORD)
 		}
 		else if (image->bits_per_pixel == 8) {
-			SHM_DISPLAY_SCREEN(UBYTE)
-		}
-
-		if (modified) {
-			XShmPutImage(display, window, gc, image, 0, 0, 0, 0,
-					 window_width, window_height, 0);
-			modified = FALSE;
-		}
-		else if (last_y >= 0) {
-			last_x++;
-			last_y++;
-			if (first_x < clipping_x)
-				first_x = clipping_x;
-			if (last_x > clipping_x + clipping_width)
-				last_x = clipping_x + clipping_width;
-			else if (last_x <= first_x)
-				last_x = first_x + 1;
-			if (first_y < clipping_y)
-				first_y = clipping_y;
-			if (last_y > clipping_y + clipping_height)
-				last_y = clipping_y + clipping_height;
-			else if (last_y <= first_y)
-				last_y = first_y + 1;
-
-			first_x *= clipping_factor;
-			last_x *= clipping_factor;
-			first_y *= clipping_factor;
-			last_y *= clipping_factor;
-
-			XShmPutImage(display, window, gc, image,
-					 first_x - (clipping_x * clipping_factor),
-					 first_y - (clipping_y * clipping_factor),
-					 first_x - (clipping_x * clipping_factor),
-					 first_y - (clipping_y * clipping_factor),
-					 last_x - first_x, last_y - first_y, 0);
+			UPDATE_IMAGE(UBYTE)
 		}
-
-		XSync(display, FALSE);
-
-#else /* SHM */
-
-		UBYTE *ptr = image_data + clipping_y * Screen_WIDTH + clipping_x;
-		int n = 0;
-		int last_colour = -1;
-		int x;
-		int y;
-
-		switch (windowsize) {
-		case Small:
-			for (y = 0; y < clipping_height; y++) {
-				for (x = 0; x < clipping_width; x++) {
-					UBYTE colour = *ptr2++;
-					if (colour != *ptr || force_redraw) {
-						*ptr = colour;
-						if (colour != last_colour || n >= NPOINTS) {
-							if (n > 0) {
-								XDrawPoints(display, pixmap, gc_colour[last_colour],
-											points, n, CoordModeOrigin);
-								n = 0;
-								modified = TRUE;
-							}
-							last_colour = colour;
-						}
-						points[n].x = x;
-						points[n].y = y;
-						n++;
-					}
-					ptr++;
-				}
-				ptr += Screen_WIDTH - clipping_width;
-				ptr2 += Screen_WIDTH - clipping_width;
-			}
-			if (n > 0) {
-				XDrawPoints(display, pixmap, gc_colour[last_colour],
-							points, n, CoordModeOrigin);
-				modified = TRUE;
-			}
-			break;
-		case Large:
-			for (y = 0; y < window_height; y += 2) {
-				for (x = 0; x < window_width; ) {
-					UBYTE colour = *ptr2++;
-					if (colour != *ptr || force_redraw) {
-						int width = 2;
-						*ptr++ = colour;
-						if (colour != last_colour || n >= NRECTS) {
-							if (n > 0) {
-								XFillRectangles(display, pixmap, gc_colour[last_colour],
-												rectangles, n);
-								n = 0;
-								modified = TRUE;
-							}
-							last_colour = colour;
-						}
-						rectangles[n].x = x;
-						rectangles[n].y = y;
-						while ((x += 2) < window_width && colour == *ptr2 && colour != *ptr) {
-							width += 2;
-							ptr2++;
-							*ptr++ = colour;
-						}
-						rectangles[n].width = width;
-						/* rectangles[n].height = 2; */
-						n++;
-						continue;
-					}
-					ptr++;
-					x += 2;
-				}
-				ptr += Screen_WIDTH - clipping_width;
-				ptr2 += Screen_WIDTH - clipping_width;
-			}
-			if (n > 0) {
-				XFillRectangles(display, pixmap, gc_colour[last_colour],
-								rectangles, n);
-				modified = TRUE;
-			}
-			break;
-		case Huge:
-			for (y = 0; y < window_height; y += 3) {
-				for (x = 0; x < window_width; ) {
-					UBYTE colour = *ptr2++;
-					if (colour != *ptr || force_redraw) {
-						int width = 3;
-						*ptr++ = colour;
-						if (colour != last_colour || n >= NRECTS) {
-							if (n > 0) {
-								XFillRectangles(display, pixmap, gc_colour[last_colour],
-												rectangles, n);
-								n = 0;
-								modified = TRUE;
-							}
-							last_colour = colour;
-						}
-						rectangles[n].x = x;
-						rectangles[n].y = y;
-						while ((x += 3) < window_width && colour == *ptr2 && colour != *ptr) {
-							width += 3;
-							ptr2++;
-							*ptr++ = colour;
+		else {
+			/* any other format, pixel by pixel */
+			for (y = clipping_y; y < clipping_y + clipping_height; y++) {
+				if (force_redraw || Screen_dirty_lines[y]) {
+					int first_x = -1;
+					int last_x = 0;
+					for (x = 0; x < clipping_width; x++) {
+						unsigned long help_color = colours[ptr2[x]];
+						int window_x = x * clipping_factor;
+						int window_y = (y - clipping_y) * clipping_factor;
+						if (XGetPixel(image, window_x, window_y) != help_color) {
+							int j;
+							if (first_x < 0)
+								first_x = x;
+							last_x = x + 1;
+							for (j = 0; j < clipping_factor; j++)
+								for (i = 0; i < clipping_factor; i++)
+									XPutPixel(image, window_x + i, window_y + j, help_color);
 						}
-						rectangles[n].width = width;
-						/* rectangles[n].height = 3; */
-						n++;
-						continue;
 					}
-					ptr++;
-					x += 3;
+					if (first_x >= 0)
+						AddDamage(y, first_x, last_x);
 				}
-				ptr2 += Screen_WIDTH - clipping_width;
-				ptr += Screen_WIDTH - clipping_width;
+				ptr2 += Screen_WIDTH;
 			}
-			if (n > 0) {
-				XFillRectangles(display, pixmap, gc_colour[last_colour],
-								rectangles, n);
-				modified = TRUE;
-			}
-			break;
 		}
+		force_redraw = FALSE;
 
 		if (modified) {
-			XCopyArea(display, pixmap, window, gc, 0, 0,
-					  window_width, window_height, 0, 0);
-			XSync(display, FALSE);
+			num_damage = 1;
+			damage[0].x = 0;
+			damage[0].y = 0;
+			damage[0].width = window_width;
+			damage[0].height = window_height;
 			modified = FALSE;
 		}
-
-#endif /* SHM */
-
+		for (i = 0; i < num_damage; i++) {
+#ifdef SHM
+			XShmPutImage(display, window, gc, image,
+					 damage[i].x, damage[i].y, damage[i].x, damage[i].y,
+					 damage[i].width, damage[i].height, 0);
+#else
+			XPutImage(display, window, gc, image,
+					  damage[i].x, damage[i].y, damage[i].x, damage[i].y,
+					  damage[i].width, damage[i].height);
+#endif
+		}
+		/* With SHM, the image mustn't change until the server has read it. */
+		if (num_damage > 0)
+			XSync(display, FALSE);
 	}
 
 	switch (x11_monitor) {
@@ -3003,15 +2841,6 @@ void PLATFORM_PaletteUpdate(void)
 	}
 
 	if (! colors_allocated) {
-		for (i = 0; i < 256; i++) {
-			xgcvl.background = colours[0];
-			xgcvl.foreground = colours[i];
-
-			gc_colour[i] = XCreateGC(display, window,
-									 GCForeground | GCBackground,
-									 &xgcvl);
-		}
-
 		xgcvl.background = colours[0];
 		xgcvl.foreground = colours[0];
 
@@ -3021,15 +2850,6 @@ void PLATFORM_PaletteUpdate(void)
 
 	}
 	else {
-		for (i = 0; i < 256; i++) {
-			xgcvl.background = colours[0];
-			xgcvl.foreground = colours[i];
-
-			XChangeGC(display, gc_colour[i],
-					  GCForeground | GCBackground,
-					  &xgcvl);
-		}
-
 		xgcvl.background = colours[0];
 		xgcvl.foreground = colours[0];
 
@@ -3039,7 +2859,6 @@ void PLATFORM_PaletteUpdate(void)
 
 		force_redraw = TRUE;
 		PLATFORM_DisplayScreen();
-		force_redraw = FALSE;
 	}
 	colors_allocated = TRUE;
 }
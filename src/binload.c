@@ -33,6 +33,7 @@
 #include "log.h"
 #include "memory.h"
 #include "sio.h"
+#include "runahead.h"
 
 int BINLOAD_start_binloading = FALSE;
 int BINLOAD_loading_basic = 0;
@@ -74,6 +75,7 @@ static int read_word(void)
 /* Start or continue loading */
 static void loader_cont(void)
 {
+	RUNAHEAD_CHECK();
 	if (BINLOAD_bin_file == NULL)
 		return;
 	if (BINLOAD_start_binloading) {
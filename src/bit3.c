@@ -29,8 +29,12 @@
 #include "memory.h"
 #include "cpu.h"
 #include "videomode.h"
+#include "text80.h"
 #include <stdlib.h>
 
+#define BIT3_ROWS 24
+#define BIT3_CELL_HEIGHT 10
+
 static UBYTE *bit3_rom = NULL;
 static char bit3_rom_filename[FILENAME_MAX];
 static UBYTE *bit3_charset = NULL;
@@ -39,6 +43,7 @@ static char bit3_charset_filename[FILENAME_MAX];
 static UBYTE *bit3_screen = NULL;
 
 int BIT3_enabled = FALSE;
+TEXT80_t BIT3_text = { 0, 0, NULL, NULL };
 static int video_latch = 0;
 static int rom_bank_select; /* bits 5 and 0-2 of d508, $0-$f 16 banks */
 static UBYTE crtreg[0x40];
@@ -106,6 +111,7 @@ int BIT3_Initialise(int *argc, char *argv[])
 			Log_print("loaded Bit3 Full View charset image");
 		}
 		bit3_screen = (UBYTE *)Util_malloc(0x800);
+		TEXT80_Init(&BIT3_text, BIT3_ROWS, BIT3_CELL_HEIGHT);
 		VIDEOMODE_80_column = 0; /* Disable 80 column mode if set in .cfg, Bit3 uses software control for this */
 		BIT3_Reset(); /* With VIDEOMODE_80_column = 0, VIDEOMODE_Set80Column(0) will not change modes */
 
@@ -120,6 +126,7 @@ void BIT3_Exit(void)
 	free(bit3_charset);
 	free(bit3_rom);
 	bit3_screen = bit3_charset = bit3_rom = NULL;
+	TEXT80_Free(&BIT3_text);
 }
 
 int BIT3_ReadConfig(char *string, char *ptr)
@@ -209,41 +216,51 @@ void BIT3_D5PutByte(UWORD addr, UBYTE byte)
 	}
 }
 
-UBYTE BIT3_GetPixels(int scanline, int column, int *colour, int blink)
+void BIT3_UpdateText(void)
 {
-#define BIT3_ROWS 24
-#define BIT3_CELL_HEIGHT 10
-	UBYTE character;
-	UBYTE font_data;
 	int table_start = crtreg[0x0d] + ((crtreg[0x0c]&0x3f)<<8);
-	int row = scanline / BIT3_CELL_HEIGHT;
-	int line = scanline % BIT3_CELL_HEIGHT;
-	int screen_pos;
-
-	if (row  >= BIT3_ROWS) {
-		return 0;
-	}
-	screen_pos = ((row*80+column + table_start)&0x3fff);
-	character = bit3_screen[screen_pos&0x7ff];
-	font_data = bit3_charset[(character&0x7f)*16 + line];
-	if (character & 0x80) {
-		font_data ^= 0xff; /* invert */
-	}
-	if (screen_pos == (((crtreg[0x0e]&0x3f)<<8)|crtreg[0x0f]) && !blink) {
-		if (line >= (crtreg[0x0a]&0x1f) && line <= (crtreg[0x0b]&0x1f)){
-			if ((crtreg[0x0a]&0x60) == 0x00 ||
-			((crtreg[0x0a]&0x60) == 0x40 && !blink) ||
-			((crtreg[0x0a]&0x60) == 0x60 && !blink)) {
-					/* 0x00: no blinking */
-					/* 0x20: no cursor */
-					/* 0x40: blink at 1/16 field rate */
-					/* 0x60: blink at 1/32 field rate TODO */
-				font_data ^= 0xff; /* cursor */
+	int cursor_pos = ((crtreg[0x0e]&0x3f)<<8)|crtreg[0x0f];
+	int cursor_start = crtreg[0x0a]&0x1f;
+	int cursor_end = crtreg[0x0b]&0x1f;
+	/* 0x00: no blinking */
+	/* 0x20: no cursor */
+	/* 0x40: blink at 1/16 field rate */
+	/* 0x60: blink at 1/32 field rate TODO */
+	int cursor_on = (crtreg[0x0a]&0x60) != 0x20;
+	int row;
+	for (row = 0; row < BIT3_ROWS; row++) {
+		int column;
+		for (column = 0; column < 80; column++) {
+			int screen_pos = ((row*80+column + table_start)&0x3fff);
+			UBYTE character = bit3_screen[screen_pos&0x7ff];
+			int cursor = cursor_on && screen_pos == cursor_pos;
+			UBYTE data[BIT3_CELL_HEIGHT];
+			UBYTE fg[BIT3_CELL_HEIGHT];
+			UBYTE bg[BIT3_CELL_HEIGHT];
+			int line;
+			if (!TEXT80_CellChanged(&BIT3_text, row, column,
+			                        cursor ? character | 0x100 | (cursor_start << 16) | (cursor_end << 24) : character))
+				continue;
+			for (line = 0; line < BIT3_CELL_HEIGHT; line++) {
+				UBYTE font_data = bit3_charset[(character&0x7f)*16 + line];
+				if (character & 0x80) {
+					font_data ^= 0xff; /* invert */
+				}
+				data[line] = font_data;
+				/* palette entry 1 for foreground pixels */
+				if (cursor && line >= cursor_start && line <= cursor_end) {
+					/* the cursor inverts the line when blink is off */
+					fg[line] = 1 | TEXT80_BLINK_ON;
+					bg[line] = 1 | TEXT80_BLINK_OFF;
+				}
+				else {
+					fg[line] = 1;
+					bg[line] = 0;
+				}
 			}
+			TEXT80_DrawCell(&BIT3_text, row, column, data, fg, bg);
 		}
 	}
-	*colour = 1; /* set number of palette entry for foreground pixels */
-	return font_data;
 }
 
 void BIT3_Reset(void)
@@ -2,6 +2,7 @@
 #define BIT3_H_
 
 #include "atari.h"
+#include "text80.h"
 #include <stdio.h>
 
 extern int BIT3_palette[2];
@@ -14,7 +15,9 @@ int BIT3_D5GetByte(UWORD addr, int no_side_effects);
 void BIT3_D5PutByte(UWORD addr, UBYTE byte);
 int BIT3_D6GetByte(UWORD addr, int no_side_effects);
 void BIT3_D6PutByte(UWORD addr, UBYTE byte);
-UBYTE BIT3_GetPixels(int scanline, int column, int *colour, int blink);
+/* Image of the 80 column display, updated by BIT3_UpdateText. */
+extern TEXT80_t BIT3_text;
+void BIT3_UpdateText(void);
 extern int BIT3_enabled;
 void BIT3_Reset(void);
 
@@ -30,11 +30,13 @@
 #include "atari.h"
 #include "binload.h" /* BINLOAD_loading_basic */
 #include "cartridge.h"
+#include "crc32.h"
 #include "memory.h"
 #ifdef IDE
 #  include "ide.h"
 #endif
 #include "pia.h"
+#include "romcache.h"
 #include "rtime.h"
 #include "util.h"
 #ifndef BASIC
@@ -1455,6 +1457,12 @@ static void ResetCartState(CARTRIDGE_image_t *cart)
 	}
 }
 
+/* Returns CRC32 of the cartridge image, used to identify raw images. */
+static ULONG ImageCRC(CARTRIDGE_image_t const *cart)
+{
+	return ~CRC32_Update(0xffffffff, cart->image, cart->size << 10);
+}
+
 /* Before first use of the cartridge, preprocess its contents if needed. */
 static void PreprocessCart(CARTRIDGE_image_t *cart)
 {
@@ -1544,39 +1552,33 @@ static void PreprocessCart(CARTRIDGE_image_t *cart)
 		unsigned int i;
 		unsigned int const size = cart->size << 10;
 		UBYTE *new_image = (UBYTE *) Util_malloc(size);
-		/* FIXME: Can be optimised by caching the results in a conversion
-		   table, but doesn't seem to be worth it. */
-		for (i = 0; i < size; i++) {
-			unsigned int const rom_addr =
-				(i &  0x0001 ? map->addr[0] : 0) |
-				(i &  0x0002 ? map->addr[1] : 0) |
-				(i &  0x0004 ? map->addr[2] : 0) |
-				(i &  0x0008 ? map->addr[3] : 0) |
-				(i &  0x0010 ? map->addr[4] : 0) |
-				(i &  0x0020 ? map->addr[5] : 0) |
-				(i &  0x0040 ? map->addr[6] : 0) |
-				(i &  0x0080 ? map->addr[7] : 0) |
-				(i &  0x0100 ? map->addr[8] : 0) |
-				(i &  0x0200 ? map->addr[9] : 0) |
-				(i &  0x0400 ? map->addr[10] : 0) |
-				(i &  0x0800 ? map->addr[11] : 0) |
-				(i &  0x1000 ? map->addr[12] : 0) |
-				(i &  0x2000 ? map->addr[13] : 0) |
-				(i &  0x4000 ? map->addr[14] : 0) |
-				(i &  0x8000 ? map->addr[15] : 0) |
-				(i & 0x10000 ? map->addr[16] : 0);
-
-			UBYTE byte = cart->image[rom_addr];
-			new_image[i] =
-				(byte & 0x01 ? map->data[0] : 0) |
-				(byte & 0x02 ? map->data[1] : 0) |
-				(byte & 0x04 ? map->data[2] : 0) |
-				(byte & 0x08 ? map->data[3] : 0) |
-				(byte & 0x10 ? map->data[4] : 0) |
-				(byte & 0x20 ? map->data[5] : 0) |
-				(byte & 0x40 ? map->data[6] : 0) |
-				(byte & 0x80 ? map->data[7] : 0);
+		/* Each address and data line maps independently, so translate
+		   through tables: the address 6 lines at a time, the data whole. */
+		unsigned int addr_table[3][64];
+		UBYTE data_table[256];
+		for (i = 0; i < 64; i++) {
+			unsigned int bit;
+			addr_table[0][i] = addr_table[1][i] = addr_table[2][i] = 0;
+			for (bit = 0; bit < 6; bit++) {
+				if (i & (1 << bit)) {
+					addr_table[0][i] |= map->addr[bit];
+					addr_table[1][i] |= map->addr[bit + 6];
+					if (bit + 12 < 17)
+						addr_table[2][i] |= map->addr[bit + 12];
+				}
+			}
+		}
+		for (i = 0; i < 256; i++) {
+			unsigned int bit;
+			data_table[i] = 0;
+			for (bit = 0; bit < 8; bit++)
+				if (i & (1 << bit))
+					data_table[i] |= map->data[bit];
 		}
+		for (i = 0; i < size; i++)
+			new_image[i] = data_table[cart->image[addr_table[0][i & 0x3f]
+			                                      | addr_table[1][(i >> 6) & 0x3f]
+			                                      | addr_table[2][(i >> 12) & 0x3f]]];
 		free(cart->image);
 		cart->image = new_image;
 	}
@@ -1689,6 +1691,10 @@ static void AutoReboot(void)
 
 void CARTRIDGE_SetType(CARTRIDGE_image_t *cart, int type)
 {
+	/* Remember the type of a raw image, for the next time it's inserted. */
+	if (cart->raw && cart->image != NULL && type > 0 && type < CARTRIDGE_TYPE_COUNT
+	    && CARTRIDGES[type].kb == cart->size)
+		ROMCACHE_SetCartType(ImageCRC(cart), cart->size, type);
 	cart->type = type;
 	if (type == CARTRIDGE_NONE)
 		/* User cancelled setting the cartridge's type - the cartridge
@@ -1755,7 +1761,13 @@ int CARTRIDGE_ReadImage(const char *filename, CARTRIDGE_image_t *cart)
 				if (cart->type == CARTRIDGE_NONE) {
 					cart->type = type;
 				} else {
-					/* more than one cartridge type of such length - user must select */
+					/* more than one cartridge type of such length - use the
+					   type chosen before for this image, or user must select */
+					type = ROMCACHE_GetCartType(ImageCRC(cart), len);
+					if (type > 0 && type < CARTRIDGE_TYPE_COUNT && CARTRIDGES[type].kb == len) {
+						cart->type = type;
+						return 0;
+					}
 					cart->type = CARTRIDGE_UNKNOWN;
 					return len;
 				}
@@ -2048,7 +2060,8 @@ void CARTRIDGE_StateRead(UBYTE version)
 	StateSav_ReadINT(&saved_type, 1);
 	if (saved_type != CARTRIDGE_NONE) {
 		StateSav_ReadFNAME(filename);
-		if (filename[0]) {
+		/* A quick state finds the cartridge still inserted. */
+		if (filename[0] && !(StateSav_quick && strcmp(filename, CARTRIDGE_main.filename) == 0)) {
 			/* Insert the cartridge... */
 			if (CARTRIDGE_Insert(filename) >= 0) {
 				/* And set the type to the saved type, in case it was a raw cartridge image */
@@ -2072,7 +2085,7 @@ void CARTRIDGE_StateRead(UBYTE version)
 	
 		StateSav_ReadINT(&saved_type, 1);
 		StateSav_ReadFNAME(filename);
-		if (filename[0]) {
+		if (filename[0] && !(StateSav_quick && strcmp(filename, CARTRIDGE_piggyback.filename) == 0)) {
 			/* Insert the cartridge... */
 			if (CARTRIDGE_Insert_Second(filename) >= 0) {
 				/* And set the type to the saved type, in case it was a raw cartridge image */
@@ -35,6 +35,7 @@
 #include "log.h"
 #include "util.h"
 #include "pokey.h"
+#include "runahead.h"
 
 static IMG_TAPE_t *cassette_file = NULL;
 
@@ -265,6 +266,21 @@ unsigned int CASSETTE_GetSize(void)
 	return IMG_TAPE_GetSize(cassette_file);
 }
 
+unsigned int CASSETTE_GetTime(unsigned int position)
+{
+	if (cassette_file == NULL)
+		return 0;
+	if (position > 0)
+		position--;
+	return IMG_TAPE_GetTime(cassette_file, position) / 1000;
+}
+
+void CASSETTE_SeekTime(unsigned int seconds)
+{
+	if (cassette_file != NULL)
+		CASSETTE_Seek(IMG_TAPE_FindTime(cassette_file, seconds * 1000) + 1);
+}
+
 void CASSETTE_Seek(unsigned int position)
 {
 	if (cassette_file != NULL) {
@@ -305,6 +321,8 @@ void CASSETTE_PutByte(int byte)
 void CASSETTE_TapeMotor(int onoff)
 {
 	if (cassette_motor != onoff) {
+		if (cassette_file != NULL)
+			RUNAHEAD_CHECK();
 		if (CASSETTE_record && CASSETTE_writable)
 			/* Recording disabled, flush the tape */
 			IMG_TAPE_Flush(cassette_file);
@@ -67,6 +67,10 @@ void CASSETTE_ResetPOKEY(void);
 unsigned int CASSETTE_GetSize(void);
 /* Return current position (block number) of the mounted tape (counted from 1). */
 unsigned int CASSETTE_GetPosition(void);
+/* Return tape time in seconds at the start of block POSITION (counted from 1). */
+unsigned int CASSETTE_GetTime(unsigned int position);
+/* Position the tape at the block that plays SECONDS after the tape start. */
+void CASSETTE_SeekTime(unsigned int seconds);
 
 /* --- Functions used by patched SIO --- */
 /* -- SIO_Handler() -- */
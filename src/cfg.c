@@ -35,6 +35,9 @@
 #include "memory.h"
 #include "pbi.h"
 #include "rtime.h"
+#ifdef RUNAHEAD
+#include "runahead.h"
+#endif
 #include "sysrom.h"
 #ifdef XEP80_EMULATION
 #include "xep80.h"
@@ -65,6 +68,9 @@
 #if defined(HAVE_LIBPNG) || defined(HAVE_LIBZ) || defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 #include "file_export.h"
 #endif
+#ifdef SCREENSHOTS
+#include "frame_export.h"
+#endif
 
 int CFG_save_on_exit = FALSE;
 
@@ -222,6 +228,11 @@ int CFG_LoadConfig(const char *alternate_config_filename)
 #ifdef STEREO_SOUND
 				POKEYSND_stereo_enabled = Util_sscanbool(ptr);
 				Sound_desired.channels = POKEYSND_stereo_enabled ? 2 : 1;
+#endif /* STEREO_SOUND */
+			}
+			else if (strcmp(string, "QUAD_POKEY") == 0) {
+#ifdef STEREO_SOUND
+				POKEYSND_quad_enabled = Util_sscanbool(ptr);
 #endif /* STEREO_SOUND */
 			}
 			else if (strcmp(string, "SPEAKER_SOUND") == 0) {
@@ -303,6 +314,10 @@ int CFG_LoadConfig(const char *alternate_config_filename)
 			}
 			else if (RTIME_ReadConfig(string, ptr)) {
 			}
+#ifdef RUNAHEAD
+			else if (RUNAHEAD_ReadConfig(string, ptr)) {
+			}
+#endif
 #ifdef XEP80_EMULATION
 			else if (XEP80_ReadConfig(string, ptr)) {
 			}
@@ -338,6 +353,10 @@ int CFG_LoadConfig(const char *alternate_config_filename)
 #if defined(HAVE_LIBPNG) || defined(HAVE_LIBZ) || defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 			else if (File_Export_ReadConfig(string, ptr)) {
 			}
+#endif
+#ifdef SCREENSHOTS
+			else if (Frame_Export_ReadConfig(string, ptr)) {
+			}
 #endif
 			else {
 #ifdef SUPPORTS_PLATFORM_CONFIGURE
@@ -439,6 +458,7 @@ int CFG_WriteConfig(void)
 	fprintf(fp, "ENABLE_NEW_POKEY=%d\n", POKEYSND_enable_new_pokey);
 #ifdef STEREO_SOUND
 	fprintf(fp, "STEREO_POKEY=%d\n", POKEYSND_stereo_enabled);
+	fprintf(fp, "QUAD_POKEY=%d\n", POKEYSND_quad_enabled);
 #endif
 #ifdef CONSOLE_SOUND
 	fprintf(fp, "SPEAKER_SOUND=%d\n", POKEYSND_console_sound_enabled);
@@ -456,6 +476,9 @@ int CFG_WriteConfig(void)
 	CARTRIDGE_WriteConfig(fp);
 	CASSETTE_WriteConfig(fp);
 	RTIME_WriteConfig(fp);
+#ifdef RUNAHEAD
+	RUNAHEAD_WriteConfig(fp);
+#endif
 #ifdef XEP80_EMULATION
 	XEP80_WriteConfig(fp);
 #endif
@@ -482,6 +505,9 @@ int CFG_WriteConfig(void)
 #if defined(HAVE_LIBPNG) || defined(HAVE_LIBZ) || defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 	File_Export_WriteConfig(fp);
 #endif
+#ifdef SCREENSHOTS
+	Frame_Export_WriteConfig(fp);
+#endif
 #ifdef SUPPORTS_PLATFORM_CONFIGSAVE
 	PLATFORM_ConfigSave(fp);
 #endif
@@ -27,6 +27,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 #include "cfg.h"
 #include "util.h"
 #include "log.h"
@@ -73,12 +78,42 @@ static AUDIO_CODEC_t *known_audio_codecs[] = {
 	NULL,
 };
 
+int audio_param_samplerate = -1;
+#ifdef CODECS_AUDIO_THREAD
+int audio_param_thread = TRUE;
+#endif
 #ifdef AUDIO_CODEC_MP3
 int audio_param_bitrate = 128;
-int audio_param_samplerate = -1;
 int audio_param_quality = 4;
 #endif
 
+#ifndef M_PI
+#define M_PI		3.14159265358979323846
+#endif
+
+/* Sample rate conversion: a windowed sinc filter, its coefficients tabulated
+   for RESAMPLE_PHASES + 1 positions between input samples and interpolated
+   in between. */
+#define RESAMPLE_PHASES 256
+#define RESAMPLE_MIN_TAPS 64
+#define RESAMPLE_MAX_TAPS 512
+#define RESAMPLE_KAISER_BETA 8.0
+
+static int resample_in_rate;
+static int resample_out_rate;
+static int resample_sample_size;
+static int resample_num_channels;
+static int resample_taps;
+static float *resample_filter = NULL;
+/* input samples of each channel, one after another, not yet consumed */
+static float *resample_input = NULL;
+static int resample_input_size;
+static int resample_input_length;
+/* position of the next output sample in resample_input */
+static double resample_position;
+static UBYTE *resample_output = NULL;
+static int resample_output_size;
+
 static AUDIO_CODEC_t *match_audio_codec(char *id)
 {
 	AUDIO_CODEC_t **a = known_audio_codecs;
@@ -139,22 +174,28 @@ int CODECS_AUDIO_Initialise(int *argc, char *argv[])
 			}
 			else a_m = TRUE;
 		}
-#ifdef AUDIO_CODEC_MP3
-		else if (strcmp(argv[i], "-ab") == 0) {
+		else if (strcmp(argv[i], "-ar") == 0) {
 			if (i_a) {
-				audio_param_bitrate = Util_sscandec(argv[++i]);
-				if (audio_param_bitrate < 8 || audio_param_bitrate > 320) {
-					Log_print("Invalid bitrate; must be between 8 and 320 kbps");
+				audio_param_samplerate = Util_sscandec(argv[++i]);
+				if (audio_param_samplerate < 8000 || audio_param_samplerate > 192000) {
+					Log_print("Invalid output samplerate; must be between 8000 and 192000 Hz");
 					return FALSE;
 				}
 			}
 			else a_m = TRUE;
 		}
-		else if (strcmp(argv[i], "-ar") == 0) {
+#ifdef CODECS_AUDIO_THREAD
+		else if (strcmp(argv[i], "-athread") == 0)
+			audio_param_thread = TRUE;
+		else if (strcmp(argv[i], "-no-athread") == 0)
+			audio_param_thread = FALSE;
+#endif
+#ifdef AUDIO_CODEC_MP3
+		else if (strcmp(argv[i], "-ab") == 0) {
 			if (i_a) {
-				audio_param_samplerate = Util_sscandec(argv[++i]);
-				if (audio_param_samplerate < 8000 || audio_param_samplerate > 48000) {
-					Log_print("Invalid output samplerate; must be between 8000 and 48000 Hz");
+				audio_param_bitrate = Util_sscandec(argv[++i]);
+				if (audio_param_bitrate < 8 || audio_param_bitrate > 320) {
+					Log_print("Invalid bitrate; must be between 8 and 320 kbps");
 					return FALSE;
 				}
 			}
@@ -176,9 +217,13 @@ int CODECS_AUDIO_Initialise(int *argc, char *argv[])
 				char buf[256];
 				Log_print(audio_codec_args(buf));
 				Log_print("\t                 Select audio codec (default: auto)");
+				Log_print("\t-ar <num>        Set audio recording sample rate in Hz (8000..192000, default: same as -dsprate)");
+#ifdef CODECS_AUDIO_THREAD
+				Log_print("\t-athread         Encode audio recordings in a separate thread (default)");
+				Log_print("\t-no-athread      Encode audio recordings in the emulation thread");
+#endif
 #ifdef AUDIO_CODEC_MP3
 				Log_print("\t-ab <num>        Set audio recording bitrate in kbps (8..320, default: 128)");
-				Log_print("\t-ar <num>        Set audio recording sample rate in Hz (8000..48000, default: same as -dsprate)");
 				Log_print("\t-aq <num>        Set audio recording quality (0..9, default 5)");
 #endif
 			}
@@ -211,6 +256,14 @@ int CODECS_AUDIO_ReadConfig(char *string, char *ptr)
 			}
 		}
 	}
+#ifdef CODECS_AUDIO_THREAD
+	else if (strcmp(string, "AUDIO_CODEC_THREAD") == 0) {
+		int value = Util_sscanbool(ptr);
+		if (value < 0)
+			return FALSE;
+		audio_param_thread = value;
+	}
+#endif
 	else return FALSE;
 	return TRUE;
 }
@@ -223,6 +276,9 @@ void CODECS_AUDIO_WriteConfig(FILE *fp)
 	else {
 		fprintf(fp, "AUDIO_CODEC=%s\n", requested_audio_codec->codec_id);
 	}
+#ifdef CODECS_AUDIO_THREAD
+	fprintf(fp, "AUDIO_CODEC_THREAD=%d\n", audio_param_thread);
+#endif
 }
 
 int CODECS_AUDIO_CheckType(char *codec_id)
@@ -238,9 +294,240 @@ int CODECS_AUDIO_CheckType(char *codec_id)
 	return strcmp(codec_id, a->codec_id) == 0;
 }
 
+static double bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	int k;
+
+	for (k = 1; k < 50 && term > sum * 1e-12; k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+/* Prepares the conversion of samples from IN_RATE to OUT_RATE. */
+static void resample_init(int in_rate, int out_rate, int sample_size, int num_channels)
+{
+	double cutoff;
+	int half;
+	int phase;
+
+	resample_in_rate = in_rate;
+	resample_out_rate = out_rate;
+	resample_sample_size = sample_size;
+	resample_num_channels = num_channels;
+	if (in_rate == out_rate)
+		return;
+
+	/* Cut off at 92% of the lower of the two Nyquist frequencies (cutoff is
+	   in cycles per input sample). The lower the cutoff, the longer the
+	   filter for the same steepness. */
+	cutoff = 0.46 * (out_rate < in_rate ? (double) out_rate / in_rate : 1.0);
+	resample_taps = (int) ceil(RESAMPLE_MIN_TAPS * 0.46 / cutoff);
+	resample_taps = (resample_taps + 3) & ~3;
+	if (resample_taps > RESAMPLE_MAX_TAPS)
+		resample_taps = RESAMPLE_MAX_TAPS;
+	half = resample_taps / 2;
+
+	resample_filter = (float *) Util_malloc((RESAMPLE_PHASES + 1) * resample_taps * sizeof(float));
+	for (phase = 0; phase <= RESAMPLE_PHASES; phase++) {
+		float *coef = resample_filter + phase * resample_taps;
+		double sum = 0.0;
+		int k;
+		for (k = 0; k < resample_taps; k++) {
+			/* distance between the output sample and input sample k */
+			double t = k - (half - 1) - (double) phase / RESAMPLE_PHASES;
+			double w = t / half;
+			double value = t == 0.0 ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+			if (w > -1.0 && w < 1.0)
+				value *= bessel_i0(RESAMPLE_KAISER_BETA * sqrt(1.0 - w * w)) / bessel_i0(RESAMPLE_KAISER_BETA);
+			else
+				value = 0.0;
+			coef[k] = (float) value;
+			sum += value;
+		}
+		for (k = 0; k < resample_taps; k++)
+			coef[k] = (float) (coef[k] / sum);
+	}
+
+	/* The first output sample is at the first input sample, with silence
+	   before it. */
+	resample_input_size = in_rate / 10 + resample_taps;
+	resample_input = (float *) Util_malloc(resample_input_size * num_channels * sizeof(float));
+	memset(resample_input, 0, resample_input_size * num_channels * sizeof(float));
+	resample_input_length = half - 1;
+	resample_position = 0.0;
+	resample_output_size = 0;
+}
+
+static void resample_end(void)
+{
+	free(resample_filter);
+	free(resample_input);
+	free(resample_output);
+	resample_filter = NULL;
+	resample_input = NULL;
+	resample_output = NULL;
+}
+
+/* Returns the sum of INPUT[k] times the coefficient interpolated at FRAC
+   between COEF0[k] and COEF1[k], for k below TAPS, a multiple of 4. */
+static float resample_dot(const float *input, const float *coef0, const float *coef1, float frac, int taps)
+{
+#ifdef __SSE__
+	__m128 sum = _mm_setzero_ps();
+	__m128 f = _mm_set1_ps(frac);
+	float result[4];
+	int k;
+
+	for (k = 0; k < taps; k += 4) {
+		__m128 c0 = _mm_loadu_ps(coef0 + k);
+		__m128 c = _mm_add_ps(c0, _mm_mul_ps(f, _mm_sub_ps(_mm_loadu_ps(coef1 + k), c0)));
+		sum = _mm_add_ps(sum, _mm_mul_ps(c, _mm_loadu_ps(input + k)));
+	}
+	_mm_storeu_ps(result, sum);
+	return (result[0] + result[2]) + (result[1] + result[3]);
+#else
+	float sum = 0.0f;
+	int k;
+
+	for (k = 0; k < taps; k++)
+		sum += (coef0[k] + frac * (coef1[k] - coef0[k])) * input[k];
+	return sum;
+#endif
+}
+
+/* Makes room for FRAMES more input samples of each channel. */
+static void resample_reserve(int frames)
+{
+	int channels = resample_num_channels;
+	int c;
+
+	if (resample_input_length + frames > resample_input_size) {
+		int size = resample_input_length + frames + resample_in_rate / 10;
+		float *input = (float *) Util_malloc(size * channels * sizeof(float));
+		for (c = 0; c < channels; c++)
+			memcpy(input + c * size, resample_input + c * resample_input_size, resample_input_length * sizeof(float));
+		free(resample_input);
+		resample_input = input;
+		resample_input_size = size;
+	}
+}
+
+/* Computes the output samples that the input so far allows, at positions
+   below END, and drops the input samples no longer needed. Returns the
+   number of samples stored at *RESULT. */
+static int resample_run(double end, const UBYTE **result)
+{
+	int channels = resample_num_channels;
+	double step;
+	int max_output;
+	int output_frames = 0;
+	int drop;
+	int c;
+
+	max_output = (int) ((resample_input_length - resample_position) * resample_out_rate / resample_in_rate) + 2;
+	if (max_output * channels * resample_sample_size > resample_output_size) {
+		resample_output_size = max_output * channels * resample_sample_size;
+		resample_output = (UBYTE *) Util_realloc(resample_output, resample_output_size);
+	}
+
+	step = (double) resample_in_rate / resample_out_rate;
+	while ((int) resample_position + resample_taps <= resample_input_length && resample_position < end) {
+		int start = (int) resample_position;
+		double phase = (resample_position - start) * RESAMPLE_PHASES;
+		int p = (int) phase;
+		const float *coef = resample_filter + p * resample_taps;
+		for (c = 0; c < channels; c++) {
+			float value = resample_dot(resample_input + c * resample_input_size + start, coef, coef + resample_taps, (float) (phase - p), resample_taps);
+			int index = output_frames * channels + c;
+			if (resample_sample_size == 2) {
+				int sample = (int) floor(value + 0.5f);
+				((SWORD *) resample_output)[index] = sample > 32767 ? 32767 : sample < -32768 ? -32768 : sample;
+			}
+			else {
+				int sample = (int) floor(value / 256.0f + 0.5f) + 0x80;
+				resample_output[index] = sample > 0xff ? 0xff : sample < 0 ? 0 : sample;
+			}
+		}
+		output_frames++;
+		resample_position += step;
+	}
+
+	/* drop the input samples that won't be used any more */
+	drop = (int) resample_position;
+	if (drop > resample_input_length)
+		drop = resample_input_length;
+	if (drop > 0) {
+		for (c = 0; c < channels; c++) {
+			float *input = resample_input + c * resample_input_size;
+			memmove(input, input + drop, (resample_input_length - drop) * sizeof(float));
+		}
+		resample_input_length -= drop;
+		resample_position -= drop;
+	}
+
+	*result = resample_output;
+	return output_frames * channels;
+}
+
+int CODECS_AUDIO_Resample(const UBYTE *source, int num_samples, const UBYTE **result)
+{
+	int channels = resample_num_channels;
+	int frames = num_samples / channels;
+	int c;
+	int i;
+
+	if (resample_in_rate == resample_out_rate) {
+		*result = source;
+		return num_samples;
+	}
+
+	resample_reserve(frames);
+	for (c = 0; c < channels; c++) {
+		float *input = resample_input + c * resample_input_size + resample_input_length;
+		if (resample_sample_size == 2) {
+			const SWORD *ptr = (const SWORD *) source + c;
+			for (i = 0; i < frames; i++, ptr += channels)
+				input[i] = *ptr;
+		}
+		else {
+			const UBYTE *ptr = source + c;
+			for (i = 0; i < frames; i++, ptr += channels)
+				input[i] = (float) ((*ptr - 0x80) << 8);
+		}
+	}
+	resample_input_length += frames;
+
+	return resample_run(resample_input_length, result);
+}
+
+int CODECS_AUDIO_ResampleFlush(const UBYTE **result)
+{
+	int half = resample_taps / 2;
+	/* the output sample at position P is centred on input sample
+	   P + half - 1, so those below END are centred on real input */
+	double end;
+	int c;
+
+	if (resample_in_rate == resample_out_rate)
+		return 0;
+
+	end = resample_input_length - (half - 1);
+	resample_reserve(half + 1);
+	for (c = 0; c < resample_num_channels; c++)
+		memset(resample_input + c * resample_input_size + resample_input_length, 0, (half + 1) * sizeof(float));
+	resample_input_length += half + 1;
+
+	return resample_run(end, result);
+}
+
 int CODECS_AUDIO_Init(void)
 {
 	int sample_size;
+	int sample_rate;
 	float fps;
 
 	if (!audio_codec) {
@@ -259,11 +546,17 @@ int CODECS_AUDIO_Init(void)
 	}
 
 	fps = Atari800_tv_mode == Atari800_TV_PAL ? Atari800_FPS_PAL : Atari800_FPS_NTSC;
-	audio_buffer_size = audio_codec->init(POKEYSND_playback_freq, fps, sample_size, POKEYSND_num_pokeys);
+	sample_rate = audio_param_samplerate > 0 ? audio_param_samplerate : POKEYSND_playback_freq;
+	audio_buffer_size = audio_codec->init(sample_rate, fps, sample_size, POKEYSND_num_pokeys);
 	if (audio_buffer_size < 0) {
 		File_Export_SetErrorMessageArg("Failed init of %s codec", audio_codec->codec_id);
 		return 0;
 	}
+	resample_init(POKEYSND_playback_freq, sample_rate, sample_size, POKEYSND_num_pokeys);
+	if (sample_rate != POKEYSND_playback_freq) {
+		/* the number of converted samples in a frame varies */
+		audio_buffer_size += 4 * sample_size * POKEYSND_num_pokeys;
+	}
 	audio_buffer = (UBYTE *)Util_malloc(audio_buffer_size);
 	audio_out = audio_codec->audio_out();
 
@@ -274,6 +567,7 @@ void CODECS_AUDIO_End(void)
 {
 	if (audio_codec)
 		audio_codec->end();
+	resample_end();
 	if (audio_buffer) {
 		free(audio_buffer);
 		audio_buffer_size = 0;
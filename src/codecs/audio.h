@@ -76,9 +76,15 @@ extern AUDIO_OUT_t *audio_out;
 extern int audio_buffer_size;
 extern UBYTE *audio_buffer;
 
+/* Sample rate of recordings, or -1 for the rate of the emulated sound */
+extern int audio_param_samplerate;
+#ifdef HAVE_LIBPTHREAD
+#define CODECS_AUDIO_THREAD
+/* Set to TRUE to encode audio recordings in a separate thread */
+extern int audio_param_thread;
+#endif
 #ifdef AUDIO_CODEC_MP3
 extern int audio_param_bitrate;
-extern int audio_param_samplerate;
 extern int audio_param_quality;
 #endif
 
@@ -87,6 +93,15 @@ int CODECS_AUDIO_ReadConfig(char *string, char *ptr);
 void CODECS_AUDIO_WriteConfig(FILE *fp);
 int CODECS_AUDIO_CheckType(char *codec_id);
 int CODECS_AUDIO_Init(void);
+/* Converts NUM_SAMPLES samples (of all channels) at SOURCE from the emulated
+   sample rate to audio_param_samplerate. Returns the number of samples
+   stored at *RESULT, which is SOURCE if there is nothing to convert. Some
+   samples are kept for the next call. */
+int CODECS_AUDIO_Resample(const UBYTE *source, int num_samples, const UBYTE **result);
+/* Converts the samples kept by CODECS_AUDIO_Resample, with silence after
+   them, at the end of a recording. Returns the number of samples stored
+   at *RESULT. */
+int CODECS_AUDIO_ResampleFlush(const UBYTE **result);
 void CODECS_AUDIO_End(void);
 
 
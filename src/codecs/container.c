@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "screen.h"
 #include "util.h"
 #include "log.h"
@@ -34,6 +35,7 @@
 #include "codecs/container.h"
 #ifdef AUDIO_RECORDING
 #include "sound.h"
+#include "pokeysnd.h"
 #include "codecs/audio.h"
 #include "codecs/container_wav.h"
 #ifdef AUDIO_CODEC_MP3
@@ -44,6 +46,9 @@
 #include "codecs/video.h"
 #include "codecs/container_avi.h"
 #endif
+#ifdef CODECS_AUDIO_THREAD
+#include <pthread.h>
+#endif
 
 /* Global pointer to current multimedia container, or NULL if one has not been
    initialized. This pointer should not be used after a call to
@@ -99,6 +104,70 @@ static ULONG total_video_size;
 static ULONG smallest_video_frame;
 static ULONG largest_video_frame;
 
+#ifdef AUDIO_RECORDING
+/* bytes of audio written and not yet added to byteswritten */
+static ULONG new_audio_bytes;
+#endif
+
+#ifdef CODECS_AUDIO_THREAD
+/* With audio_param_thread set, the samples are queued and encoded in a
+   separate thread, which writes the audio frames to the file between the
+   video frames. Audio-only recordings only wait if the queue is full, i.e.
+   the encoder is seconds behind. A video frame waits for the audio before
+   it, which is encoded while the video codec works, so that the file is
+   the same as without the thread. The queue's chunks are filled and emptied
+   without holding audio_mutex, which only guards handing them over. */
+#define AUDIO_QUEUE_SIZE 256
+
+typedef struct {
+	UBYTE *samples;
+	int size;
+	int num_samples;
+} audio_chunk_t;
+
+static audio_chunk_t audio_queue[AUDIO_QUEUE_SIZE];
+static int audio_thread_running = FALSE;
+static pthread_t audio_thread_id;
+static pthread_mutex_t audio_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t audio_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t audio_space_cond = PTHREAD_COND_INITIALIZER;
+/* guarded by audio_mutex, as are new_audio_bytes and the audio statistics
+   while the thread runs */
+static int audio_queue_first;
+static int audio_queue_length;
+static int audio_queued_samples;
+static int audio_max_queued_samples;
+static int audio_quit;
+static int audio_failed;
+
+static void start_audio_thread(void);
+static int stop_audio_thread(int discard);
+#endif /* CODECS_AUDIO_THREAD */
+
+/* The audio thread and the emulation thread take turns writing to the file.
+   With DRAIN set, also waits until the audio thread has written all queued
+   audio, so that the frames are interleaved the same as without the thread. */
+static void lock_file(int drain)
+{
+#ifdef CODECS_AUDIO_THREAD
+	if (audio_thread_running) {
+		pthread_mutex_lock(&audio_mutex);
+		if (drain) {
+			while (audio_queue_length > 0)
+				pthread_cond_wait(&audio_space_cond, &audio_mutex);
+		}
+	}
+#endif
+}
+
+static void unlock_file(void)
+{
+#ifdef CODECS_AUDIO_THREAD
+	if (audio_thread_running)
+		pthread_mutex_unlock(&audio_mutex);
+#endif
+}
+
 
 static CONTAINER_t *match_container(const char *id)
 {
@@ -174,6 +243,9 @@ int CONTAINER_Open(const char *filename)
 		total_audio_size = 0;
 		smallest_audio_frame = 0xffffffff;
 		largest_audio_frame = 0;
+#ifdef AUDIO_RECORDING
+		new_audio_bytes = 0;
+#endif
 
 #ifdef AUDIO_RECORDING
 		if (Sound_enabled) {
@@ -237,39 +309,23 @@ int CONTAINER_Open(const char *filename)
 	if (!fp) {
 		close_codecs();
 	}
+#ifdef CODECS_AUDIO_THREAD
+	else if (audio_codec && audio_param_thread) {
+		start_audio_thread();
+	}
+#endif
 
 	return (fp != NULL);
 }
 
 #ifdef AUDIO_RECORDING
-int CONTAINER_AddAudioSamples(const UBYTE *buf, int num_samples)
+/* Encodes the converted samples and writes the audio frames to the file, or
+   with a NULL BUF the frames that the codec still holds. */
+static int encode_audio(const UBYTE *buf, int num_samples)
 {
 	int result;
 	int size;
 
-	if (!fp || !audio_codec) return 0;
-
-	if (!buf) {
-		/* This happens at file close time, checking if audio codec has samples
-		   remaining */
-		if (!audio_codec->another_frame()) {
-			/* If the codec doesn't support buffered frames or there's nothing
-			   remaining, there's no need to try to write another frame */
-			return 1;
-		}
-	}
-	else
-#ifdef VIDEO_RECORDING
-		if (!video_codec)
-#endif
-	{
-		/* Before file close time, there is one call to this function every
-		   video frame. If the video codec is not being used, we need to count
-		   frames here because frame count is used to determine the duration of
-		   the audio file. */
-		video_frame_count++;
-	}
-
 	do {
 		size = audio_codec->frame(buf, num_samples, audio_buffer, audio_buffer_size);
 		if (size < 0) {
@@ -278,12 +334,14 @@ int CONTAINER_AddAudioSamples(const UBYTE *buf, int num_samples)
 			return 0;
 		}
 
+		lock_file(FALSE);
 		/* If audio frame size is zero, that means the codec needs more samples
 		   before it can create a frame. See audio_codec_adpcm.c for an example.
 		   Only if there is some data do we write the frame to the file. */
 		if (size > 0) {
 			if (!container->audio_frame(fp, audio_buffer, size)) {
 				/* failed during write; force close of file */
+				unlock_file();
 				return 0;
 			}
 
@@ -291,7 +349,7 @@ int CONTAINER_AddAudioSamples(const UBYTE *buf, int num_samples)
 			num_samples = 0;
 
 			/* update statistics */
-			byteswritten += size;
+			new_audio_bytes += size;
 			audio_frame_count++;
 			total_audio_size += size;
 		}
@@ -301,14 +359,166 @@ int CONTAINER_AddAudioSamples(const UBYTE *buf, int num_samples)
 		if (size > largest_audio_frame) {
 			largest_audio_frame = size;
 		}
+		unlock_file();
 	} while (audio_codec->another_frame());
 
+	lock_file(FALSE);
 	result = container->size_check(ftell(fp));
+	unlock_file();
 	if (!result) {
 		Log_print("%s maximum file size reached, closing file", container->container_id);
 	}
 	return result;
 }
+
+/* Converts and encodes the samples, or with a NULL BUF writes the frames
+   that the codec still holds. Runs in the audio thread if there is one. */
+static int write_audio(const UBYTE *buf, int num_samples)
+{
+	if (buf)
+		num_samples = CODECS_AUDIO_Resample(buf, num_samples, &buf);
+	return encode_audio(buf, num_samples);
+}
+
+#ifdef CODECS_AUDIO_THREAD
+static void *audio_thread_main(void *arg)
+{
+	pthread_mutex_lock(&audio_mutex);
+	for (;;) {
+		audio_chunk_t *chunk;
+		int result;
+		while (audio_queue_length == 0 && !audio_quit)
+			pthread_cond_wait(&audio_work_cond, &audio_mutex);
+		if (audio_queue_length == 0)
+			break;
+		chunk = &audio_queue[audio_queue_first];
+		pthread_mutex_unlock(&audio_mutex);
+		/* after a failure the samples are dropped until the file is closed */
+		result = audio_failed || write_audio(chunk->samples, chunk->num_samples);
+		pthread_mutex_lock(&audio_mutex);
+		if (!result)
+			audio_failed = TRUE;
+		audio_queued_samples -= chunk->num_samples;
+		audio_queue_first = (audio_queue_first + 1) % AUDIO_QUEUE_SIZE;
+		audio_queue_length--;
+		pthread_cond_signal(&audio_space_cond);
+	}
+	pthread_mutex_unlock(&audio_mutex);
+	return NULL;
+}
+
+static void start_audio_thread(void)
+{
+	audio_queue_first = 0;
+	audio_queue_length = 0;
+	audio_queued_samples = 0;
+	audio_max_queued_samples = 0;
+	audio_quit = FALSE;
+	audio_failed = FALSE;
+	audio_thread_running = TRUE;
+	if (pthread_create(&audio_thread_id, NULL, audio_thread_main, NULL) != 0) {
+		Log_print("Cannot create the audio thread, encoding audio in the emulation thread");
+		audio_thread_running = FALSE;
+	}
+}
+
+/* Waits until the queued samples are encoded, or with DISCARD set drops
+   them, and stops the audio thread. Returns FALSE if some audio couldn't be
+   written. */
+static int stop_audio_thread(int discard)
+{
+	int i;
+
+	if (!audio_thread_running)
+		return TRUE;
+	pthread_mutex_lock(&audio_mutex);
+	if (discard)
+		audio_failed = TRUE;
+	audio_quit = TRUE;
+	pthread_cond_signal(&audio_work_cond);
+	pthread_mutex_unlock(&audio_mutex);
+	pthread_join(audio_thread_id, NULL);
+	audio_thread_running = FALSE;
+	for (i = 0; i < AUDIO_QUEUE_SIZE; i++) {
+		free(audio_queue[i].samples);
+		audio_queue[i].samples = NULL;
+		audio_queue[i].size = 0;
+	}
+	Log_print("audio encoder lag: max %d ms", (int) ((double) audio_max_queued_samples / POKEYSND_num_pokeys * 1000 / POKEYSND_playback_freq));
+	return !audio_failed;
+}
+
+/* Hands the samples over to the audio thread. */
+static int queue_audio(const UBYTE *buf, int num_samples)
+{
+	audio_chunk_t *chunk;
+	int size = num_samples * (POKEYSND_snd_flags & POKEYSND_BIT16 ? 2 : 1);
+	int result;
+
+	pthread_mutex_lock(&audio_mutex);
+	while (audio_queue_length == AUDIO_QUEUE_SIZE)
+		pthread_cond_wait(&audio_space_cond, &audio_mutex);
+	chunk = &audio_queue[(audio_queue_first + audio_queue_length) % AUDIO_QUEUE_SIZE];
+	pthread_mutex_unlock(&audio_mutex);
+
+	/* the audio thread doesn't look at the chunks after the queue */
+	if (size > chunk->size) {
+		chunk->samples = (UBYTE *) Util_realloc(chunk->samples, size);
+		chunk->size = size;
+	}
+	memcpy(chunk->samples, buf, size);
+	chunk->num_samples = num_samples;
+
+	pthread_mutex_lock(&audio_mutex);
+	audio_queue_length++;
+	audio_queued_samples += num_samples;
+	if (audio_queued_samples > audio_max_queued_samples)
+		audio_max_queued_samples = audio_queued_samples;
+	pthread_cond_signal(&audio_work_cond);
+	byteswritten += new_audio_bytes;
+	new_audio_bytes = 0;
+	result = !audio_failed;
+	pthread_mutex_unlock(&audio_mutex);
+	return result;
+}
+#endif /* CODECS_AUDIO_THREAD */
+
+int CONTAINER_AddAudioSamples(const UBYTE *buf, int num_samples)
+{
+	int result;
+
+	if (!fp || !audio_codec) return 0;
+
+	if (!buf) {
+		/* This happens at file close time, checking if audio codec has samples
+		   remaining */
+		if (!audio_codec->another_frame()) {
+			/* If the codec doesn't support buffered frames or there's nothing
+			   remaining, there's no need to try to write another frame */
+			return 1;
+		}
+	}
+	else
+#ifdef VIDEO_RECORDING
+		if (!video_codec)
+#endif
+	{
+		/* Before file close time, there is one call to this function every
+		   video frame. If the video codec is not being used, we need to count
+		   frames here because frame count is used to determine the duration of
+		   the audio file. */
+		video_frame_count++;
+	}
+
+#ifdef CODECS_AUDIO_THREAD
+	if (audio_thread_running && buf)
+		return queue_audio(buf, num_samples);
+#endif
+	result = write_audio(buf, num_samples);
+	byteswritten += new_audio_bytes;
+	new_audio_bytes = 0;
+	return result;
+}
 #endif
 
 #ifdef VIDEO_RECORDING
@@ -342,6 +552,8 @@ int CONTAINER_AddVideoFrame(void)
 		Log_print("video codec %s failed encoding frame", video_codec->codec_id);
 		return 0;
 	}
+	/* the audio of this frame goes first */
+	lock_file(TRUE);
 	result = container->video_frame(fp, video_buffer, size, is_keyframe);
 	if (result) {
 		/* update statistics */
@@ -356,10 +568,13 @@ int CONTAINER_AddVideoFrame(void)
 		}
 
 		result = container->size_check(ftell(fp));
+		unlock_file();
 		if (!result) {
 			Log_print("%s maximum file size reached, closing file", container->container_id);
 		}
 	}
+	else
+		unlock_file();
 
 	return result;
 }
@@ -382,8 +597,21 @@ int CONTAINER_Close(int file_ok)
 	/* Note that all video frames will be written, but the audio codec may
 		still have frames buffered. */
 
+#ifdef CODECS_AUDIO_THREAD
+	if (!stop_audio_thread(!file_ok))
+		file_ok = FALSE;
+#endif
 #ifdef AUDIO_RECORDING
-	if (file_ok && audio_codec && audio_codec->flush((float)(video_frame_count / fps))) {
+	if (file_ok && audio_codec) {
+		/* the last samples still in the sample rate converter */
+		const UBYTE *tail;
+		int num_samples = CODECS_AUDIO_ResampleFlush(&tail);
+		if (num_samples > 0 && !encode_audio(tail, num_samples))
+			result = 0;
+	}
+	byteswritten += new_audio_bytes;
+	new_audio_bytes = 0;
+	if (result && file_ok && audio_codec && audio_codec->flush((float)(video_frame_count / fps))) {
 		/* Force audio codec to write out any remaining frames. This only
 			occurs in codecs that buffer frames or force fixed block sizes */
 		result = CONTAINER_AddAudioSamples(NULL, 0);
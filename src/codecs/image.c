@@ -24,8 +24,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "screen.h"
+#include "colours.h"
 #include "cfg.h"
+#include "file_export.h"
 #include "util.h"
 #include "log.h"
 #ifdef SUPPORTS_CHANGE_VIDEOMODE
@@ -83,6 +86,27 @@ void CODECS_IMAGE_SetMargins(void)
 	image_codec_height = Screen_visible_y2 - image_codec_top_margin;
 }
 
+void CODECS_IMAGE_SetFrame(IMAGE_CODEC_frame_t *frame, UBYTE *ptr1, UBYTE *ptr2)
+{
+	frame->ptr1 = ptr1;
+	frame->ptr2 = ptr2;
+	memcpy(frame->palette, Colours_table, sizeof(frame->palette));
+	frame->left_margin = image_codec_left_margin;
+	frame->top_margin = image_codec_top_margin;
+	frame->width = image_codec_width;
+	frame->height = image_codec_height;
+#if defined(HAVE_LIBPNG) || defined(HAVE_LIBZ)
+	frame->compression_level = FILE_EXPORT_compression_level;
+#else
+	frame->compression_level = 6;
+#endif
+#ifdef HAVE_LIBPNG
+	frame->fast = FILE_EXPORT_png_fast;
+#else
+	frame->fast = FALSE;
+#endif
+}
+
 /* Sets the global image_codec if the filename has an extension that matches a known
    image codec. Also sets the margins so the codec is ready to save images */
 int CODECS_IMAGE_Init(const char *filename)
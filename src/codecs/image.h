@@ -3,8 +3,22 @@
 
 #include "atari.h"
 
-/* Save current screen (possibly interlaced) to a file */
-typedef int (*IMAGE_CODEC_SaveToFile)(FILE *fp, UBYTE *ptr1, UBYTE *ptr2);
+/* A screen to save, with everything the codecs need, so that it can be saved
+   while the emulation goes on (see frame_export.c). */
+typedef struct {
+	const UBYTE *ptr1; /* Screen_WIDTH x Screen_HEIGHT, as Screen_atari */
+	const UBYTE *ptr2; /* interlaced scan lines to blend with ptr1, or NULL */
+	int palette[256]; /* as Colours_table */
+	int left_margin;
+	int top_margin;
+	int width;
+	int height;
+	int compression_level; /* PNG: zlib level 0-9 */
+	int fast; /* PNG: save faster, in bigger files */
+} IMAGE_CODEC_frame_t;
+
+/* Save a screen (possibly interlaced) to a file */
+typedef int (*IMAGE_CODEC_SaveToFile)(FILE *fp, const IMAGE_CODEC_frame_t *frame);
 
 /* Save current screen (possibly interlaced) to a buffer */
 typedef int (*IMAGE_CODEC_SaveToBuffer)(UBYTE *buf, int bufsize, UBYTE *ptr1, UBYTE *ptr2);
@@ -23,6 +37,8 @@ extern int image_codec_width;
 extern int image_codec_height;
 
 void CODECS_IMAGE_SetMargins(void);
+/* Fill FRAME with PTR1 and PTR2, and the current palette, margins and settings */
+void CODECS_IMAGE_SetFrame(IMAGE_CODEC_frame_t *frame, UBYTE *ptr1, UBYTE *ptr2);
 int CODECS_IMAGE_Init(const char *filename);
 int CODECS_IMAGE_SaveScreen(FILE *fp, UBYTE *ptr1, UBYTE *ptr2);
 
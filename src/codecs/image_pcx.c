@@ -24,13 +24,12 @@
 
 #include <stdio.h>
 #include "screen.h"
-#include "colours.h"
 #include "file_export.h"
 #include "codecs/image.h"
 
 
 /* PCX_SaveScreen saves the screen data to the file in PCX format, optionally
-   using interlace if ptr2 is not NULL.
+   using interlace if frame->ptr2 is not NULL.
 
    PCX format is a lossless image file format derived from PC Paintbrush, a
    DOS-era paint program, and is widely supported by image viewers. The
@@ -43,12 +42,9 @@
    format.
 
    fp:          file pointer of file open for writing
-   ptr1:        pointer to Screen_atari
-   ptr2:        (optional) pointer to another array of size Screen_atari containing
-                the interlaced scan lines to blend with ptr1. Set to NULL if no
-				interlacing.
+   frame:       the screen (see IMAGE_CODEC_frame_t)
 */
-static int PCX_SaveScreen(FILE *fp, UBYTE *ptr1, UBYTE *ptr2)
+static int PCX_SaveScreen(FILE *fp, const IMAGE_CODEC_frame_t *frame)
 {
 	int i;
 	int x;
@@ -56,6 +52,10 @@ static int PCX_SaveScreen(FILE *fp, UBYTE *ptr1, UBYTE *ptr2)
 	UBYTE plane = 16;	/* 16 = Red, 8 = Green, 0 = Blue */
 	UBYTE last;
 	UBYTE count;
+	const int *palette = frame->palette;
+	const UBYTE *ptr1 = frame->ptr1;
+	const UBYTE *ptr2 = frame->ptr2;
+	int width = frame->width;
 
 	fputc(0xa, fp);   /* pcx signature */
 	fputc(0x5, fp);   /* version 5 */
@@ -63,29 +63,29 @@ static int PCX_SaveScreen(FILE *fp, UBYTE *ptr1, UBYTE *ptr2)
 	fputc(0x8, fp);   /* bits per pixel */
 	fputw(0, fp);     /* XMin */
 	fputw(0, fp);     /* YMin */
-	fputw(image_codec_width - 1, fp); /* XMax */
-	fputw(image_codec_height - 1, fp);        /* YMax */
+	fputw(width - 1, fp); /* XMax */
+	fputw(frame->height - 1, fp);        /* YMax */
 	fputw(0, fp);     /* HRes */
 	fputw(0, fp);     /* VRes */
 	for (i = 0; i < 48; i++)
 		fputc(0, fp); /* EGA color palette */
 	fputc(0, fp);     /* reserved */
 	fputc(ptr2 != NULL ? 3 : 1, fp); /* number of bit planes */
-	fputw(image_codec_width, fp);  /* number of bytes per scan line per color plane */
+	fputw(width, fp);  /* number of bytes per scan line per color plane */
 	fputw(1, fp);     /* palette info */
-	fputw(image_codec_width, fp); /* screen resolution */
-	fputw(image_codec_height, fp);
+	fputw(width, fp); /* screen resolution */
+	fputw(frame->height, fp);
 	for (i = 0; i < 54; i++)
 		fputc(0, fp);  /* unused */
 
-	ptr1 += (Screen_WIDTH * image_codec_top_margin) + image_codec_left_margin;
+	ptr1 += (Screen_WIDTH * frame->top_margin) + frame->left_margin;
 	if (ptr2 != NULL) {
-		ptr2 += (Screen_WIDTH * image_codec_top_margin) + image_codec_left_margin;
+		ptr2 += (Screen_WIDTH * frame->top_margin) + frame->left_margin;
 	}
-	for (y = 0; y < image_codec_height; ) {
+	for (y = 0; y < frame->height; ) {
 		x = 0;
 		do {
-			last = ptr2 != NULL ? (((Colours_table[*ptr1] >> plane) & 0xff) + ((Colours_table[*ptr2] >> plane) & 0xff)) >> 1 : *ptr1;
+			last = ptr2 != NULL ? (((palette[*ptr1] >> plane) & 0xff) + ((palette[*ptr2] >> plane) & 0xff)) >> 1 : *ptr1;
 			count = 0xc0;
 			do {
 				ptr1++;
@@ -93,22 +93,22 @@ static int PCX_SaveScreen(FILE *fp, UBYTE *ptr1, UBYTE *ptr2)
 					ptr2++;
 				count++;
 				x++;
-			} while (last == (ptr2 != NULL ? (((Colours_table[*ptr1] >> plane) & 0xff) + ((Colours_table[*ptr2] >> plane) & 0xff)) >> 1 : *ptr1)
-						&& count < 0xff && x < image_codec_width);
+			} while (last == (ptr2 != NULL ? (((palette[*ptr1] >> plane) & 0xff) + ((palette[*ptr2] >> plane) & 0xff)) >> 1 : *ptr1)
+						&& count < 0xff && x < width);
 			if (count > 0xc1 || last >= 0xc0)
 				fputc(count, fp);
 			fputc(last, fp);
-		} while (x < image_codec_width);
+		} while (x < width);
 
 		if (ptr2 != NULL && plane) {
-			ptr1 -= image_codec_width;
-			ptr2 -= image_codec_width;
+			ptr1 -= width;
+			ptr2 -= width;
 			plane -= 8;
 		}
 		else {
-			ptr1 += Screen_WIDTH - image_codec_width;
+			ptr1 += Screen_WIDTH - width;
 			if (ptr2 != NULL) {
-				ptr2 += Screen_WIDTH - image_codec_width;
+				ptr2 += Screen_WIDTH - width;
 				plane = 16;
 			}
 			y++;
@@ -119,9 +119,9 @@ static int PCX_SaveScreen(FILE *fp, UBYTE *ptr1, UBYTE *ptr2)
 		/* write palette */
 		fputc(0xc, fp);
 		for (i = 0; i < 256; i++) {
-			fputc(Colours_GetR(i), fp);
-			fputc(Colours_GetG(i), fp);
-			fputc(Colours_GetB(i), fp);
+			fputc((palette[i] >> 16) & 0xff, fp);
+			fputc((palette[i] >> 8) & 0xff, fp);
+			fputc(palette[i] & 0xff, fp);
 		}
 	}
 
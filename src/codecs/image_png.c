@@ -29,7 +29,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include "screen.h"
-#include "colours.h"
 #include "util.h"
 #include "log.h"
 #include "file_export.h"
@@ -37,6 +36,7 @@
 #include "codecs/image_png.h"
 
 #include <png.h>
+#include <zlib.h>
 
 #ifdef VIDEO_CODEC_PNG
 static int current_png_size = -1;
@@ -59,23 +59,24 @@ static void png_write_fn_callback(png_structp png_ptr, png_bytep data, png_size_
 #endif /* VIDEO_CODEC_PNG */
 
 /* PNG_SaveScreen saves the screen data to the file in PNG format, optionally
-   using interlace if ptr2 is not NULL.
+   using interlace if frame->ptr2 is not NULL.
 
    PNG format is a lossless image file format that compresses much better than
    PCX. Because it depends on the external libpng library, it is only compiled
    in atari800 if requested and libpng is found on the system.
 
-   fp:          file pointer of file open for writing
-   ptr1:        pointer to Screen_atari
-   ptr2:        (optional) pointer to another array of size Screen_atari containing
-                the interlaced scan lines to blend with ptr1. Set to NULL if no
-				interlacing.
+   fp:          file pointer of file open for writing, or NULL to save to
+                image_buffer
+   frame:       the screen (see IMAGE_CODEC_frame_t)
 */
-static int PNG_SaveScreen(FILE *fp, UBYTE *ptr1, UBYTE *ptr2)
+static int PNG_SaveScreen(FILE *fp, const IMAGE_CODEC_frame_t *frame)
 {
 	png_structp png_ptr;
 	png_infop info_ptr;
 	png_bytep rows[Screen_HEIGHT];
+	const int *palette = frame->palette;
+	const UBYTE *ptr1 = frame->ptr1;
+	const UBYTE *ptr2 = frame->ptr2;
 
 	png_ptr = png_create_write_struct(
 		PNG_LIBPNG_VER_STRING,
@@ -98,9 +99,17 @@ static int PNG_SaveScreen(FILE *fp, UBYTE *ptr1, UBYTE *ptr2)
 		png_init_io(png_ptr, fp);
 	}
 
-	png_set_compression_level(png_ptr, FILE_EXPORT_compression_level);
+	png_set_compression_level(png_ptr, frame->compression_level);
+	if (frame->fast) {
+		/* Atari screens are mostly runs of one colour, so instead of trying
+		   every filter on every row and searching for matches, take runs of
+		   equal bytes: palette indices as they are, RGB pixels as differences
+		   to the pixel on the left. */
+		png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, ptr2 == NULL ? PNG_FILTER_NONE : PNG_FILTER_SUB);
+		png_set_compression_strategy(png_ptr, Z_RLE);
+	}
 	png_set_IHDR(
-		png_ptr, info_ptr, image_codec_width, image_codec_height,
+		png_ptr, info_ptr, frame->width, frame->height,
 		8, ptr2 == NULL ? PNG_COLOR_TYPE_PALETTE : PNG_COLOR_TYPE_RGB,
 		PNG_INTERLACE_NONE,
 		PNG_COMPRESSION_TYPE_DEFAULT,
@@ -108,16 +117,16 @@ static int PNG_SaveScreen(FILE *fp, UBYTE *ptr1, UBYTE *ptr2)
 	);
 	if (ptr2 == NULL) {
 		int i;
-		png_color palette[256];
+		png_color png_palette[256];
 		for (i = 0; i < 256; i++) {
-			palette[i].red = Colours_GetR(i);
-			palette[i].green = Colours_GetG(i);
-			palette[i].blue = Colours_GetB(i);
+			png_palette[i].red = (png_byte) (palette[i] >> 16);
+			png_palette[i].green = (png_byte) (palette[i] >> 8);
+			png_palette[i].blue = (png_byte) palette[i];
 		}
-		png_set_PLTE(png_ptr, info_ptr, palette, 256);
-		ptr1 += (Screen_WIDTH * image_codec_top_margin) + image_codec_left_margin;
-		for (i = 0; i < image_codec_height; i++) {
-			rows[i] = ptr1;
+		png_set_PLTE(png_ptr, info_ptr, png_palette, 256);
+		ptr1 += (Screen_WIDTH * frame->top_margin) + frame->left_margin;
+		for (i = 0; i < frame->height; i++) {
+			rows[i] = (png_bytep) ptr1;
 			ptr1 += Screen_WIDTH;
 		}
 	}
@@ -125,20 +134,20 @@ static int PNG_SaveScreen(FILE *fp, UBYTE *ptr1, UBYTE *ptr2)
 		png_bytep ptr3;
 		int x;
 		int y;
-		ptr1 += (Screen_WIDTH * image_codec_top_margin) + image_codec_left_margin;
-		ptr2 += (Screen_WIDTH * image_codec_top_margin) + image_codec_left_margin;
-		ptr3 = (png_bytep) Util_malloc(3 * image_codec_width * image_codec_height);
-		for (y = 0; y < image_codec_height; y++) {
+		ptr1 += (Screen_WIDTH * frame->top_margin) + frame->left_margin;
+		ptr2 += (Screen_WIDTH * frame->top_margin) + frame->left_margin;
+		ptr3 = (png_bytep) Util_malloc(3 * frame->width * frame->height);
+		for (y = 0; y < frame->height; y++) {
 			rows[y] = ptr3;
-			for (x = 0; x < image_codec_width; x++) {
-				*ptr3++ = (png_byte) ((Colours_GetR(*ptr1) + Colours_GetR(*ptr2)) >> 1);
-				*ptr3++ = (png_byte) ((Colours_GetG(*ptr1) + Colours_GetG(*ptr2)) >> 1);
-				*ptr3++ = (png_byte) ((Colours_GetB(*ptr1) + Colours_GetB(*ptr2)) >> 1);
-				ptr1++;
-				ptr2++;
+			for (x = 0; x < frame->width; x++) {
+				int c1 = palette[*ptr1++];
+				int c2 = palette[*ptr2++];
+				*ptr3++ = (png_byte) ((((c1 >> 16) & 0xff) + ((c2 >> 16) & 0xff)) >> 1);
+				*ptr3++ = (png_byte) ((((c1 >> 8) & 0xff) + ((c2 >> 8) & 0xff)) >> 1);
+				*ptr3++ = (png_byte) (((c1 & 0xff) + (c2 & 0xff)) >> 1);
 			}
-			ptr1 += Screen_WIDTH - image_codec_width;
-			ptr2 += Screen_WIDTH - image_codec_width;
+			ptr1 += Screen_WIDTH - frame->width;
+			ptr2 += Screen_WIDTH - frame->width;
 		}
 	}
 	png_set_rows(png_ptr, info_ptr, rows);
@@ -158,13 +167,15 @@ static int PNG_SaveScreen(FILE *fp, UBYTE *ptr1, UBYTE *ptr2)
 /* Instead of saving PNG to a file, this function allows saving the screen to a buffer */
 static int PNG_SaveToBuffer(UBYTE *buf, int bufsize, UBYTE *ptr1, UBYTE *ptr2)
 {
+	IMAGE_CODEC_frame_t frame;
 	int result;
 
+	CODECS_IMAGE_SetFrame(&frame, ptr1, ptr2);
 	image_buffer = buf;
 	max_buffer_size = bufsize;
 	current_png_size = 0;
 
-	result = PNG_SaveScreen(NULL, ptr1, ptr2);
+	result = PNG_SaveScreen(NULL, &frame);
 
 	image_buffer = NULL;
 	max_buffer_size = 0;
@@ -33,6 +33,7 @@
 #include "codecs/image.h"
 #include "codecs/video.h"
 #include "codecs/video_mrle.h"
+#include "codecs/video_a8fd.h"
 #ifdef VIDEO_CODEC_PNG
 #include "codecs/video_mpng.h"
 #endif
@@ -61,6 +62,7 @@ int video_codec_keyframe_interval = 0;
 static VIDEO_CODEC_t *known_video_codecs[] = {
 	&Video_Codec_MRLE,
 	&Video_Codec_MSRLE,
+	&Video_Codec_A8FD,
 #ifdef VIDEO_CODEC_PNG
 	&Video_Codec_MPNG,
 #endif
@@ -0,0 +1,330 @@
+/*
+ * video_a8fd.c - Video codec for Atari800 frame differences
+ *
+ * Copyright (C) 2024 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+#include <stdlib.h>
+#include "codecs/video.h"
+#include "codecs/video_a8fd.h"
+#include "screen.h"
+#include "util.h"
+
+/* This file implements a lossless codec of its own, fourcc code 'A8FD',
+   made to record long sessions at little cost: it only looks at the lines
+   that changed and needs no search beyond LZ4's hash of 4 bytes. Only
+   atari800's tools/a8fd_decode plays it back.
+
+   A frame starts with a flags byte:
+
+     bit 0 (A8FD_KEYFRAME): the frame doesn't depend on the previous one
+     bit 1 (A8FD_LZ4): 4 bytes follow with the size of the line data (little
+                       endian), then the line data compressed in an LZ4 block;
+                       otherwise the line data follows as is
+
+   An empty frame is the same as the previous frame.
+
+   The line data describes the lines from top to bottom, with a byte telling
+   how each line is coded:
+
+     0x00 n        the next n lines (1-255) are the same as in the previous
+                   frame
+     0x01 packed   the pixels of the line
+     0x02 packed   the pixels of the line XOR the same pixels of the previous
+                   frame
+
+   A packed line is a sequence of runs until the width of the frame is
+   filled. A run starts with a byte c: c < 0x80 is followed by c + 1 bytes to
+   copy; c >= 0x80 is followed by one byte to repeat c - 125 (3-130) times. */
+
+#define A8FD_KEYFRAME 0x01
+#define A8FD_LZ4 0x02
+
+#define OP_SKIP 0x00
+#define OP_PIXELS 0x01
+#define OP_XOR 0x02
+
+#define MAX_LITERALS 128
+#define MIN_RUN 3
+#define MAX_RUN 130
+
+/* LZ4 block format constants: a match is at least 4 bytes, the last match
+   starts at least 12 bytes before the end and the last 5 bytes are
+   literals. */
+#define LZ4_HASH_BITS 12
+#define LZ4_MIN_MATCH 4
+#define LZ4_MF_LIMIT 12
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_BOUND(size) ((size) + (size) / 255 + 16)
+
+static int video_left_margin;
+static int video_top_margin;
+static int video_width;
+static int video_height;
+
+static UBYTE *reference_screen = NULL;
+/* line data of the current frame */
+static UBYTE *line_data = NULL;
+static int line_data_size;
+/* a line XOR the reference line, and the line packed */
+static UBYTE *xor_line = NULL;
+static UBYTE *xor_packed = NULL;
+
+static int lz4_table[1 << LZ4_HASH_BITS];
+
+static UBYTE *pack_literals(UBYTE *buf, const UBYTE *ptr, const UBYTE *ptr_end)
+{
+	while (ptr < ptr_end) {
+		int count = ptr_end - ptr;
+		if (count > MAX_LITERALS)
+			count = MAX_LITERALS;
+		*buf++ = (UBYTE) (count - 1);
+		memcpy(buf, ptr, count);
+		buf += count;
+		ptr += count;
+	}
+	return buf;
+}
+
+/* Packs the video_width bytes at PTR to BUF. Returns the end of the packed
+   data. */
+static UBYTE *pack_line(UBYTE *buf, const UBYTE *ptr)
+{
+	const UBYTE *ptr_end = ptr + video_width;
+	const UBYTE *literals = ptr;
+
+	while (ptr < ptr_end) {
+		const UBYTE *run_end = ptr + 1;
+		while (run_end < ptr_end && *run_end == *ptr && run_end - ptr < MAX_RUN)
+			run_end++;
+		if (run_end - ptr >= MIN_RUN) {
+			buf = pack_literals(buf, literals, ptr);
+			*buf++ = (UBYTE) (0x80 + (run_end - ptr) - MIN_RUN);
+			*buf++ = *ptr;
+			literals = run_end;
+		}
+		ptr = run_end;
+	}
+	return pack_literals(buf, literals, ptr_end);
+}
+
+/* Codes the lines of SOURCE to line_data, and copies the changed lines to
+   the reference screen. Returns the size of the line data, or zero if no
+   line changed. */
+static int code_lines(const UBYTE *source, int keyframe)
+{
+	UBYTE *buf = line_data;
+	int skip = 0;
+	int changed = FALSE;
+	/* Screen_dirty_lines tells which lines ANTIC may have changed since the
+	   last frame, which is the reference screen. */
+	int dirty_hint = source == (const UBYTE *) Screen_atari;
+	int y;
+
+	for (y = video_top_margin; y < video_top_margin + video_height; y++) {
+		const UBYTE *ptr = source + y * Screen_WIDTH + video_left_margin;
+		UBYTE *ref = reference_screen + y * Screen_WIDTH + video_left_margin;
+
+		if (!keyframe && ((dirty_hint && !Screen_dirty_lines[y]) || memcmp(ptr, ref, video_width) == 0)) {
+			skip++;
+			continue;
+		}
+		while (skip > 0) {
+			int count = skip > 255 ? 255 : skip;
+			*buf++ = OP_SKIP;
+			*buf++ = (UBYTE) count;
+			skip -= count;
+		}
+		buf[0] = OP_PIXELS;
+		if (keyframe)
+			buf = pack_line(buf + 1, ptr);
+		else {
+			UBYTE *pixels_end = pack_line(buf + 1, ptr);
+			UBYTE *xor_end;
+			int x;
+			for (x = 0; x < video_width; x++)
+				xor_line[x] = ptr[x] ^ ref[x];
+			xor_end = pack_line(xor_packed, xor_line);
+			if (xor_end - xor_packed < pixels_end - (buf + 1)) {
+				buf[0] = OP_XOR;
+				memcpy(buf + 1, xor_packed, xor_end - xor_packed);
+				buf += 1 + (xor_end - xor_packed);
+			}
+			else
+				buf = pixels_end;
+		}
+		memcpy(ref, ptr, video_width);
+		changed = TRUE;
+	}
+	/* the skip at the end needn't be told */
+	return changed ? buf - line_data : 0;
+}
+
+static UBYTE *lz4_length(UBYTE *buf, int length)
+{
+	while (length >= 255) {
+		*buf++ = 255;
+		length -= 255;
+	}
+	*buf++ = (UBYTE) length;
+	return buf;
+}
+
+/* Writes an LZ4 sequence: the literals from ANCHOR to PTR, then a match of
+   MATCH_LENGTH bytes at OFFSET bytes back, or no match if MATCH_LENGTH is
+   zero. */
+static UBYTE *lz4_sequence(UBYTE *buf, const UBYTE *anchor, const UBYTE *ptr, int offset, int match_length)
+{
+	int literals = ptr - anchor;
+	UBYTE *token = buf++;
+	*token = (UBYTE) ((literals >= 15 ? 15 : literals) << 4);
+	if (literals >= 15)
+		buf = lz4_length(buf, literals - 15);
+	memcpy(buf, anchor, literals);
+	buf += literals;
+	if (match_length > 0) {
+		match_length -= LZ4_MIN_MATCH;
+		*token |= match_length >= 15 ? 15 : match_length;
+		*buf++ = (UBYTE) offset;
+		*buf++ = (UBYTE) (offset >> 8);
+		if (match_length >= 15)
+			buf = lz4_length(buf, match_length - 15);
+	}
+	return buf;
+}
+
+static ULONG read_ulong(const UBYTE *ptr)
+{
+	ULONG value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+/* Compresses SIZE bytes of SRC to an LZ4 block in BUF, which must have room
+   for LZ4_BOUND(SIZE) bytes. Returns the size of the block. */
+static int lz4_compress(UBYTE *buf, const UBYTE *src, int size)
+{
+	UBYTE *buf_start = buf;
+	const UBYTE *ptr = src;
+	const UBYTE *anchor = src;
+	const UBYTE *src_end = src + size;
+	const UBYTE *match_limit = src_end - LZ4_LAST_LITERALS;
+	int misses = 0;
+
+	memset(lz4_table, 0xff, sizeof(lz4_table));
+	while (size >= LZ4_MF_LIMIT && ptr <= src_end - LZ4_MF_LIMIT) {
+		ULONG sequence = read_ulong(ptr);
+		int hash = (int) ((sequence * 2654435761U) >> (32 - LZ4_HASH_BITS)) & ((1 << LZ4_HASH_BITS) - 1);
+		int candidate = lz4_table[hash];
+		lz4_table[hash] = ptr - src;
+		if (candidate < 0 || (ptr - src) - candidate > LZ4_MAX_OFFSET
+		    || read_ulong(src + candidate) != sequence) {
+			/* step faster through data that doesn't compress */
+			ptr += 1 + (misses++ >> 6);
+			continue;
+		}
+		{
+			const UBYTE *match = src + candidate + LZ4_MIN_MATCH;
+			const UBYTE *match_end = ptr + LZ4_MIN_MATCH;
+			while (match_end < match_limit && *match_end == *match) {
+				match_end++;
+				match++;
+			}
+			buf = lz4_sequence(buf, anchor, ptr, (ptr - src) - candidate, match_end - ptr);
+			ptr = anchor = match_end;
+			misses = 0;
+		}
+	}
+	buf = lz4_sequence(buf, anchor, src_end, 0, 0);
+	return buf - buf_start;
+}
+
+static int A8FD_Init(int width, int height, int left_margin, int top_margin)
+{
+	int line_size;
+
+	video_width = width;
+	video_height = height;
+	video_left_margin = left_margin;
+	video_top_margin = top_margin;
+
+	/* worst case per line: an op to skip the line before, the line's op,
+	   and literals with a byte for each 128 */
+	line_size = 2 + 1 + width + (width + MAX_LITERALS - 1) / MAX_LITERALS;
+	line_data_size = line_size * height;
+
+	reference_screen = (UBYTE *) Util_malloc(Screen_WIDTH * Screen_HEIGHT);
+	memset(reference_screen, 0, Screen_WIDTH * Screen_HEIGHT);
+	line_data = (UBYTE *) Util_malloc(line_data_size);
+	xor_line = (UBYTE *) Util_malloc(width);
+	xor_packed = (UBYTE *) Util_malloc(line_size);
+
+	return 5 + LZ4_BOUND(line_data_size);
+}
+
+static int A8FD_CreateFrame(UBYTE *source, int keyframe, UBYTE *buf, int bufsize)
+{
+	int size;
+	int compressed_size;
+
+	size = code_lines(source, keyframe);
+	if (size == 0)
+		return 0;
+
+	buf[0] = keyframe ? A8FD_KEYFRAME : 0;
+	compressed_size = lz4_compress(buf + 5, line_data, size);
+	if (compressed_size < size) {
+		buf[0] |= A8FD_LZ4;
+		buf[1] = (UBYTE) size;
+		buf[2] = (UBYTE) (size >> 8);
+		buf[3] = (UBYTE) (size >> 16);
+		buf[4] = (UBYTE) (size >> 24);
+		return 5 + compressed_size;
+	}
+	memcpy(buf + 1, line_data, size);
+	return 1 + size;
+}
+
+static int A8FD_End(void)
+{
+	free(reference_screen);
+	free(line_data);
+	free(xor_line);
+	free(xor_packed);
+	reference_screen = NULL;
+	line_data = NULL;
+	xor_line = NULL;
+	xor_packed = NULL;
+
+	return 1;
+}
+
+VIDEO_CODEC_t Video_Codec_A8FD = {
+	"a8fd",
+	"Atari800 Frame Differences",
+	{'A', '8', 'F', 'D'},
+	{'A', '8', 'F', 'D'},
+	TRUE,
+	&A8FD_Init,
+	&A8FD_CreateFrame,
+	&A8FD_End,
+};
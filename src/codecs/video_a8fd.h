@@ -0,0 +1,9 @@
+#ifndef CODECS_VIDEO_A8FD_H_
+#define CODECS_VIDEO_A8FD_H_
+
+#include "atari.h"
+#include "codecs/video.h"
+
+extern VIDEO_CODEC_t Video_Codec_A8FD;
+
+#endif /* CODECS_VIDEO_A8FD_H_ */
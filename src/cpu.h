@@ -46,7 +46,27 @@ void CPU_Reset(void);
 void CPU_StateSave(UBYTE SaveVerbose);
 void CPU_StateRead(UBYTE SaveVerbose, UBYTE StateVersion);
 void CPU_NMI(void);
+
+#if !defined(FALCON_CPUASM) && (defined(MONITOR_BREAK) || defined(MONITOR_BREAKPOINTS) || defined(MONITOR_TRACE) || defined(MONITOR_PROFILE))
+#define CPU_MONITOR_CORE
+/* The 6502 core is compiled twice: CPU_GO_fast without the monitor's
+   execution history, breakpoints, TRACE and profiling, and CPU_GO_monitor
+   with them. CPU_GO points to one of them. */
+extern void (*CPU_GO)(int limit);
+void CPU_GO_fast(int limit);
+void CPU_GO_monitor(int limit);
+/* Set to TRUE to always run CPU_GO_monitor, e.g. to have the execution
+   history when a program crashes. */
+extern int CPU_monitor_core;
+/* Points CPU_GO to CPU_GO_monitor if CPU_monitor_core is set or the monitor
+   has a breakpoint, step, trace or profile to take care of, or to
+   CPU_GO_fast otherwise. Called at the start of each frame and after
+   leaving the monitor. */
+void CPU_SelectCore(void);
+#else
 void CPU_GO(int limit);
+#define CPU_SelectCore()
+#endif
 #define CPU_GenerateIRQ() (CPU_IRQ = 1)
 
 extern UWORD CPU_regPC;
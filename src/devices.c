@@ -75,6 +75,7 @@
 #ifdef R_IO_DEVICE
 #include "rdevice.h"
 #endif
+#include "runahead.h"
 #ifdef __PLUS
 #include "misc_win.h"
 #endif
@@ -823,6 +824,7 @@ static void Devices_H_Open(void)
 	char timetext[16];
 #endif
 
+	RUNAHEAD_CHECK();
 	if (devbug)
 		Log_print("HHOPEN");
 
@@ -984,6 +986,7 @@ static void Devices_H_Open(void)
 
 static void Devices_H_Close(void)
 {
+	RUNAHEAD_CHECK();
 	if (devbug)
 		Log_print("HHCLOS");
 	if (!Devices_GetIOCB())
@@ -998,6 +1001,7 @@ static void Devices_H_Close(void)
 
 static void Devices_H_Read(void)
 {
+	RUNAHEAD_CHECK();
 	if (devbug)
 		Log_print("HHREAD");
 	if (!Devices_GetIOCB())
@@ -1064,6 +1068,7 @@ static void Devices_H_Read(void)
 
 static void Devices_H_Write(void)
 {
+	RUNAHEAD_CHECK();
 	if (devbug)
 		Log_print("HHWRIT");
 	if (!Devices_GetIOCB())
@@ -1087,6 +1092,154 @@ static void Devices_H_Write(void)
 	}
 }
 
+/* Block transfers used by Devices_H_CIO, which handles CIO GET/PUT
+   CHARACTERS and GET/PUT RECORD for a whole IOCB buffer instead of letting
+   CIO call Devices_H_Read/Devices_H_Write once per byte. The results,
+   including the read-ahead byte and the CR/LF state, are the same as
+   for the equivalent sequence of single byte calls. */
+
+/* data moved between the Atari buffer and the stream */
+static UBYTE h_blockbuf[0x10000];
+
+/* file data read ahead for translated and record reads */
+static UBYTE h_chunk[4096];
+static size_t h_chunk_pos;
+static size_t h_chunk_len;
+
+static int Devices_H_ChunkGetc(FILE *fp)
+{
+	if (h_chunk_pos == h_chunk_len) {
+		h_chunk_len = fread(h_chunk, 1, sizeof(h_chunk), fp);
+		h_chunk_pos = 0;
+		if (h_chunk_len == 0)
+			return EOF;
+	}
+	return h_chunk[h_chunk_pos++];
+}
+
+/* Reads up to LEN (> 0) bytes for h_iocb into h_blockbuf. If RECORD is TRUE,
+   stops after EOL and skips the rest of a record that doesn't fit.
+   Returns the number of bytes stored; *status receives the CIO status. */
+static int Devices_H_ReadBlock(int len, int record, UBYTE *status)
+{
+	FILE *fp = h_fp[h_iocb];
+	int count = 0;
+	int truncated = FALSE;
+	int ch;
+
+	if (h_lastop[h_iocb] != 'r') {
+		if (h_lastop[h_iocb] == 'w')
+			fseek(fp, 0, SEEK_CUR);
+		h_lastbyte[h_iocb] = fgetc(fp);
+		h_lastop[h_iocb] = 'r';
+	}
+	if (h_lastbyte[h_iocb] == EOF) {
+		*status = 136; /* end of file */
+		return 0;
+	}
+
+	if (!record && !h_textmode[h_iocb]) {
+		/* plain binary data: one fread for the whole buffer */
+		h_blockbuf[0] = (UBYTE) h_lastbyte[h_iocb];
+		count = 1 + (int) fread(h_blockbuf + 1, 1, len - 1, fp);
+		h_lastbyte[h_iocb] = fgetc(fp);
+		if (count < len)
+			*status = 136; /* end of file */
+		else
+			*status = feof(fp) ? 3 : 1;
+		return count;
+	}
+
+	/* The read-ahead byte starts the chunk. */
+	h_chunk[0] = (UBYTE) h_lastbyte[h_iocb];
+	h_chunk_len = 1 + fread(h_chunk + 1, 1, sizeof(h_chunk) - 1, fp);
+	h_chunk_pos = 0;
+	for (;;) {
+		ch = Devices_H_ChunkGetc(fp);
+		if (ch == EOF) {
+			h_lastbyte[h_iocb] = EOF;
+			*status = 136; /* end of file */
+			return count;
+		}
+		if (h_textmode[h_iocb]) {
+			switch (ch) {
+			case 0x0d:
+				h_wascr[h_iocb] = TRUE;
+				ch = 0x9b;
+				break;
+			case 0x0a:
+				if (h_wascr[h_iocb]) {
+					/* ignore LF next to CR */
+					ch = Devices_H_ChunkGetc(fp);
+					if (ch == EOF) {
+						/* Devices_H_Read keeps the LF as the read-ahead byte */
+						h_lastbyte[h_iocb] = 0x0a;
+						*status = 136; /* end of file */
+						return count;
+					}
+					if (ch == 0x0d)
+						ch = 0x9b;
+					else
+						h_wascr[h_iocb] = FALSE;
+				}
+				else
+					ch = 0x9b;
+				break;
+			default:
+				h_wascr[h_iocb] = FALSE;
+				break;
+			}
+		}
+		if (count < len)
+			h_blockbuf[count++] = (UBYTE) ch;
+		else
+			truncated = TRUE;
+		if (record ? ch == 0x9b : count == len)
+			break;
+	}
+
+	/* Give back the unused part of the chunk and read ahead as usual. */
+	if (h_chunk_pos < h_chunk_len)
+		fseek(fp, -(long) (h_chunk_len - h_chunk_pos), SEEK_CUR);
+	h_lastbyte[h_iocb] = fgetc(fp);
+	if (truncated)
+		*status = 137; /* truncated record */
+	else
+		*status = feof(fp) ? 3 : 1;
+	return count;
+}
+
+/* Writes LEN (> 0) bytes from h_blockbuf for h_iocb. If RECORD is TRUE,
+   stops after EOL, or appends EOL if there is none in the buffer.
+   Returns the number of bytes taken from the buffer. */
+static int Devices_H_WriteBlock(int len, int record)
+{
+	FILE *fp = h_fp[h_iocb];
+	int count = len;
+	int add_eol = FALSE;
+	int i;
+
+	if (h_lastop[h_iocb] == 'r')
+		fseek(fp, 0, SEEK_CUR);
+	h_lastop[h_iocb] = 'w';
+	if (record) {
+		const UBYTE *eol = (const UBYTE *) memchr(h_blockbuf, 0x9b, len);
+		if (eol != NULL)
+			count = (int) (eol - h_blockbuf) + 1;
+		else {
+			h_blockbuf[len] = 0x9b;
+			add_eol = TRUE;
+		}
+	}
+	if (h_textmode[h_iocb]) {
+		for (i = 0; i < count + add_eol; i++)
+			if (h_blockbuf[i] == 0x9b)
+				h_blockbuf[i] = '\n';
+	}
+	fwrite(h_blockbuf, 1, count + add_eol, fp);
+	return count;
+}
+
 static void Devices_H_Status(void)
 {
 	if (devbug)
@@ -1426,6 +1579,7 @@ static int Devices_H_BinReadWord(void)
 
 static void Devices_H_BinLoaderCont(void)
 {
+	RUNAHEAD_CHECK();
 	if (*binf == NULL)
 		return;
 	if (BINLOAD_start_binloading) {
@@ -1774,6 +1928,7 @@ static void Devices_H_ToAbsolutePath(void)
 
 static void Devices_H_Special(void)
 {
+	RUNAHEAD_CHECK();
 	if (devbug)
 		Log_print("HHSPEC");
 
@@ -1875,6 +2030,7 @@ static char spool_file[FILENAME_MAX];
 
 static void Devices_P_Close(void)
 {
+	RUNAHEAD_CHECK();
 	if (devbug)
 		Log_print("PHCLOS");
 
@@ -1904,6 +2060,7 @@ static void Devices_P_Close(void)
 
 static void Devices_P_Open(void)
 {
+	RUNAHEAD_CHECK();
 	if (devbug)
 		Log_print("PHOPEN");
 
@@ -1925,6 +2082,7 @@ static void Devices_P_Write(void)
 {
 	UBYTE byte;
 
+	RUNAHEAD_CHECK();
 	if (devbug)
 		Log_print("PHWRIT");
 
@@ -1945,6 +2103,7 @@ static void Devices_P_Status(void)
 
 static void Devices_P_Init(void)
 {
+	RUNAHEAD_CHECK();
 	if (devbug)
 		Log_print("PHINIT");
 
@@ -1970,6 +2129,8 @@ static void Devices_E_Read(void)
 {
 	int ch;
 
+	RUNAHEAD_CHECK();
+
 	ch = getchar();
 	switch (ch) {
 	case EOF:
@@ -1991,6 +2152,8 @@ static void Devices_E_Write(void)
 {
 	UBYTE ch;
 
+	RUNAHEAD_CHECK();
+
 	ch = CPU_regA;
 	/* XXX: are '\f', '\b' and '\a' fully portable? */
 	switch (ch) {
@@ -2023,6 +2186,8 @@ static void Devices_K_Read(void)
 	int ch;
 	int ch2;
 
+	RUNAHEAD_CHECK();
+
 	ch = getchar();
 	switch (ch) {
 	case EOF:
@@ -2061,6 +2226,7 @@ struct DEV_B dev_b_status;
 
 static void Devices_B_Open(void)
 {
+	RUNAHEAD_CHECK();
 	if (devbug)
 		Log_print("B: OPEN");
 
@@ -2080,6 +2246,7 @@ static void Devices_B_Open(void)
 
 static void Devices_B_Close(void)
 {
+	RUNAHEAD_CHECK();
 	if (devbug)
 		Log_print("B: CLOSE (%s)", dev_b_status.url);
 
@@ -2094,6 +2261,8 @@ static void Devices_B_Write(void)
 {
 	UBYTE byte;
 
+	RUNAHEAD_CHECK();
+
 	byte = CPU_regA;
 
 	if (devbug)
@@ -2255,6 +2424,7 @@ static void Devices_IgnoreReady(void)
 
 static void Devices_GetBasicCommand(void)
 {
+	RUNAHEAD_CHECK();
 	if (basic_command_ptr != NULL) {
 		CPU_regA = *basic_command_ptr++;
 		CPU_regY = 1;
@@ -2276,6 +2446,7 @@ static void Devices_GetBasicCommand(void)
 
 static void Devices_OpenBasicFile(void)
 {
+	RUNAHEAD_CHECK();
 	if (BINLOAD_bin_file != NULL) {
 		if (BINLOAD_loading_basic == BINLOAD_LOADING_BASIC_LISTED) {
 			/* determine its type now rather than during the loading */
@@ -2314,6 +2485,7 @@ static void Devices_OpenBasicFile(void)
 
 static void Devices_ReadBasicFile(void)
 {
+	RUNAHEAD_CHECK();
 	if (BINLOAD_bin_file != NULL) {
 		int ch = fgetc(BINLOAD_bin_file);
 		if (ch == EOF) {
@@ -2362,6 +2534,7 @@ static void Devices_ReadBasicFile(void)
 
 static void Devices_CloseBasicFile(void)
 {
+	RUNAHEAD_CHECK();
 	if (BINLOAD_bin_file != NULL) {
 		fclose(BINLOAD_bin_file);
 		BINLOAD_bin_file = NULL;
@@ -2392,6 +2565,13 @@ int Devices_enable_p_patch = TRUE;
 int Devices_enable_r_patch = FALSE;
 int Devices_enable_b_patch = FALSE;
 
+#define CIOV 0xe456
+
+/* address of the OS CIO routine, taken from the JMP at CIOV */
+static UWORD cio_address = 0;
+
+static void Devices_H_CIO(void);
+
 /* Devices_PatchOS is called by ESC_PatchOS to modify standard device
    handlers in Atari OS. It puts escape codes at beginnings of OS routines,
    so the patches work even if they are called directly, without CIO.
@@ -2407,6 +2587,16 @@ int Devices_PatchOS(void)
 	int i;
 	int patched = FALSE;
 
+	/* CIOV is a JMP to CIO in all OS versions. Put H: block transfers
+	   in front of it. */
+	if (Devices_enable_h_patch && MEMORY_dGetByte(CIOV) == 0x4c) {
+		cio_address = MEMORY_dGetWord(CIOV + 1);
+		ESC_AddEscRts(CIOV, ESC_HHCIO, Devices_H_CIO);
+		patched = TRUE;
+	}
+	else
+		ESC_Remove(ESC_HHCIO);
+
 	switch (Atari800_os_version) {
 	case SYSROM_A_NTSC:
 	case SYSROM_A_PAL:
@@ -2449,7 +2639,7 @@ int Devices_PatchOS(void)
 		break;
 #endif /* EMUOS_ALTIRRA */
 	default:
-		return FALSE;
+		return patched;
 	}
 
 	for (i = 0; i < 5; i++) {
@@ -2606,6 +2796,85 @@ static UWORD b_entry_address = 0;
 #define B_PATCH_INIT    0xd1e3
 #define B_DEVICE_END    0xd1e5
 
+/* Handles CIO GET/PUT CHARACTERS and GET/PUT RECORD on an open H: IOCB
+   in one step. Returns FALSE if the call must go to the OS CIO. */
+static int Devices_H_BlockIO(void)
+{
+	UWORD iocb;
+	UBYTE hid;
+	UBYTE command;
+	UBYTE status = 1;
+	UWORD bufadr;
+	int len;
+	int count;
+
+	if ((CPU_regX & 0x8f) != 0)
+		return FALSE;
+	iocb = Devices_IOCB0 + CPU_regX;
+	hid = MEMORY_dGetByte(iocb + Devices_ICHID);
+	/* hid is the IOCB's offset in HATABS, 0xff if the IOCB is closed */
+	if (hid > 30 || MEMORY_dGetWord(HATABS + hid + 1) != H_TABLE_ADDRESS)
+		return FALSE;
+	h_iocb = CPU_regX >> 4;
+	if (h_fp[h_iocb] == NULL)
+		return FALSE;
+	command = MEMORY_dGetByte(iocb + Devices_ICCOM);
+	bufadr = MEMORY_dGetWord(iocb + Devices_ICBAL);
+	len = MEMORY_dGetWord(iocb + Devices_ICBLL);
+	/* zero length transfers a single byte in A; leave them and access
+	   mode errors to CIO */
+	if (len == 0)
+		return FALSE;
+	switch (command) {
+	case 0x05: /* GET RECORD */
+	case 0x07: /* GET CHARACTERS */
+		if ((MEMORY_dGetByte(iocb + Devices_ICAX1) & 0x04) == 0)
+			return FALSE;
+		RUNAHEAD_CHECK();
+		if (devbug)
+			Log_print("HHCIO GET %04X %d", bufadr, len);
+		count = Devices_H_ReadBlock(len, command == 0x05, &status);
+		MEMORY_CopyToMem(h_blockbuf, bufadr, count);
+		if (count > 0)
+			CPU_regA = h_blockbuf[count - 1];
+		break;
+	case 0x09: /* PUT RECORD */
+	case 0x0b: /* PUT CHARACTERS */
+		if ((MEMORY_dGetByte(iocb + Devices_ICAX1) & 0x08) == 0)
+			return FALSE;
+		RUNAHEAD_CHECK();
+		if (devbug)
+			Log_print("HHCIO PUT %04X %d", bufadr, len);
+		MEMORY_CopyFromMem(bufadr, h_blockbuf, len);
+		count = Devices_H_WriteBlock(len, command == 0x09);
+		/* h_blockbuf now holds the host bytes, so return the last Atari
+		   byte written like Devices_H_Write: a record always ends with EOL */
+		CPU_regA = command == 0x09 ? 0x9b : MEMORY_dGetByte(bufadr + count - 1);
+		break;
+	default:
+		return FALSE;
+	}
+
+	MEMORY_dPutByte(iocb + Devices_ICSTA, status);
+	MEMORY_dPutWord(iocb + Devices_ICBLL, count);
+	/* leave the zero page IOCB, ICIDNO and CIOCHR as CIO does */
+	MEMORY_dCopyFromMem(iocb, MEMORY_mem + Devices_ICHIDZ, 12);
+	MEMORY_dPutByte(0x2e, CPU_regX);
+	MEMORY_dPutByte(0x2f, CPU_regA);
+	CPU_regY = status;
+	if (status & 0x80)
+		CPU_SetN;
+	else
+		CPU_ClrN;
+	return TRUE;
+}
+
+static void Devices_H_CIO(void)
+{
+	if (!Devices_H_BlockIO())
+		CPU_regPC = cio_address; /* skip RTS, continue in CIO */
+}
+
 void Devices_Frame(void)
 {
 	if (Devices_enable_h_patch)
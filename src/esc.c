@@ -34,6 +34,7 @@
 #include "sio.h"
 #include "sysrom.h"
 #include "ui.h"
+#include "runahead.h"
 #include <stdlib.h>
 
 #ifdef LIBATARI800
@@ -57,6 +58,7 @@ static ESC_FunctionType esc_function[256];
    use with standard Atari OSes only. */
 static void CassetteLeaderLoad(void)
 {
+	RUNAHEAD_CHECK();
 	CASSETTE_LeaderLoad();
 
 	/* registers for SETVBV: third system timer, ~0.1 sec */
@@ -69,6 +71,7 @@ static void CassetteLeaderLoad(void)
    use with standard Atari OSes only. */
 static void CassetteLeaderSave(void)
 {
+	RUNAHEAD_CHECK();
 	CASSETTE_LeaderSave();
 
 	/* registers for SETVBV: third system timer, ~0.1 sec */
@@ -82,6 +85,7 @@ static void CassetteLeaderSave(void)
    routine when reading or writing the tape leader. */
 static void CassetteLeaderAltirra(void)
 {
+	RUNAHEAD_CHECK();
 	if (CPU_regX == 1)
 		CASSETTE_LeaderLoad();
 	else
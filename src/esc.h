@@ -64,6 +64,7 @@ enum ESC_t {
 	ESC_HHSTAT = 0xc4,
 	ESC_HHSPEC = 0xc5,
 	ESC_HHINIT = 0xc6,
+	ESC_HHCIO = 0xc7,
 
 	/* B: device. */
 	ESC_BOPEN = 0xe0,
@@ -55,6 +55,9 @@ char *FILE_EXPORT_error_message = error_msg;
 #if defined(HAVE_LIBPNG) || defined(HAVE_LIBZ)
 int FILE_EXPORT_compression_level = 6;
 #endif
+#ifdef HAVE_LIBPNG
+int FILE_EXPORT_png_fast = FALSE;
+#endif
 
 #if defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 
@@ -102,6 +105,12 @@ int File_Export_Initialise(int *argc, char *argv[])
 			else a_m = TRUE;
 		}
 #endif
+#ifdef HAVE_LIBPNG
+		else if (strcmp(argv[i], "-png-fast") == 0)
+			FILE_EXPORT_png_fast = TRUE;
+		else if (strcmp(argv[i], "-no-png-fast") == 0)
+			FILE_EXPORT_png_fast = FALSE;
+#endif
 #ifdef AUDIO_RECORDING
 		else if (strcmp(argv[i], "-aname") == 0) {
 			if (i_a)
@@ -122,6 +131,10 @@ int File_Export_Initialise(int *argc, char *argv[])
 				Log_print("\t-compression-level <n>");
 				Log_print("\t                 Set zlib/PNG compression level 0-9 (default 6)");
 #endif
+#ifdef HAVE_LIBPNG
+				Log_print("\t-png-fast        Save PNG files faster but bigger");
+				Log_print("\t-no-png-fast     Save PNG files as small as the compression level allows");
+#endif
 #ifdef AUDIO_RECORDING
 				Log_print("\t-aname <p>       Set filename pattern for audio recording");
 #endif
@@ -164,6 +177,14 @@ int File_Export_ReadConfig(char *string, char *ptr)
 		else return FALSE;
 	}
 #endif
+#ifdef HAVE_LIBPNG
+	else if (strcmp(string, "PNG_FAST") == 0) {
+		int value = Util_sscanbool(ptr);
+		if (value < 0)
+			return FALSE;
+		FILE_EXPORT_png_fast = value;
+	}
+#endif
 #ifdef VIDEO_RECORDING
 	else if (CODECS_VIDEO_ReadConfig(string, ptr)) {
 	}
@@ -181,6 +202,9 @@ void File_Export_WriteConfig(FILE *fp)
 #if defined(HAVE_LIBPNG) || defined(HAVE_LIBZ)
 	fprintf(fp, "COMPRESSION_LEVEL=%d\n", FILE_EXPORT_compression_level);
 #endif
+#ifdef HAVE_LIBPNG
+	fprintf(fp, "PNG_FAST=%d\n", FILE_EXPORT_png_fast);
+#endif
 #ifdef VIDEO_RECORDING
 	CODECS_VIDEO_WriteConfig(fp);
 #endif
@@ -379,10 +403,12 @@ int File_Export_SaveScreen(const char *filename, UBYTE *ptr1, UBYTE *ptr2) {
 
 	CODECS_IMAGE_Init(filename);
 	if (image_codec) {
+		IMAGE_CODEC_frame_t frame;
 		fp = fopen(filename, "wb");
 		if (fp == NULL)
 			return 0;
-		result = image_codec->to_file(fp, ptr1, ptr2);
+		CODECS_IMAGE_SetFrame(&frame, ptr1, ptr2);
+		result = image_codec->to_file(fp, &frame);
 		fclose(fp);
 	}
 	return result;
@@ -6,6 +6,11 @@
 #if defined(HAVE_LIBPNG) || defined(HAVE_LIBZ)
 extern int FILE_EXPORT_compression_level;
 #endif
+#ifdef HAVE_LIBPNG
+/* Set to TRUE to save PNG files faster, without row filters and with
+   run-length deflate, at the cost of bigger files. */
+extern int FILE_EXPORT_png_fast;
+#endif
 
 int File_Export_Initialise(int *argc, char *argv[]);
 int File_Export_ReadConfig(char *string, char *ptr);
@@ -20,6 +20,7 @@
  * along with Atari800; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
+#include "config.h"
 #include <stdlib.h>
 #include <math.h>
 
@@ -32,6 +33,10 @@
 #include "log.h"
 #include "util.h"
 
+#ifdef FILTER_NTSC_THREADS
+#include <pthread.h>
+#endif
+
 atari_ntsc_setup_t FILTER_NTSC_setup;
 
 static atari_ntsc_setup_t const * const presets[] = {
@@ -164,6 +169,15 @@ int FILTER_NTSC_ReadConfig(char *option, char *ptr)
 		return Util_sscandouble(ptr, &FILTER_NTSC_setup.bleed);
 	else if (strcmp(option, "FILTER_NTSC_BURST_PHASE") == 0)
 		return Util_sscandouble(ptr, &FILTER_NTSC_setup.burst_phase);
+#ifdef FILTER_NTSC_THREADS
+	else if (strcmp(option, "FILTER_NTSC_THREADS") == 0) {
+		int value = Util_sscandec(ptr);
+		if (value < 1 || value > FILTER_NTSC_MAX_THREADS)
+			return FALSE;
+		FILTER_NTSC_threads = value;
+		return TRUE;
+	}
+#endif
 	else
 		return FALSE;
 }
@@ -176,6 +190,9 @@ void FILTER_NTSC_WriteConfig(FILE *fp)
 	fprintf(fp, "FILTER_NTSC_FRINGING=%g\n", FILTER_NTSC_setup.fringing);
 	fprintf(fp, "FILTER_NTSC_BLEED=%g\n", FILTER_NTSC_setup.bleed);
 	fprintf(fp, "FILTER_NTSC_BURST_PHASE=%g\n", FILTER_NTSC_setup.burst_phase);
+#ifdef FILTER_NTSC_THREADS
+	fprintf(fp, "FILTER_NTSC_THREADS=%d\n", FILTER_NTSC_threads);
+#endif
 }
 
 int FILTER_NTSC_Initialise(int *argc, char *argv[])
@@ -217,6 +234,17 @@ int FILTER_NTSC_Initialise(int *argc, char *argv[])
 				FILTER_NTSC_setup.burst_phase = atof(argv[++i]);
 			else a_m = TRUE;
 		}
+#ifdef FILTER_NTSC_THREADS
+		else if (strcmp(argv[i], "-ntsc-threads") == 0) {
+			if (i_a) {
+				FILTER_NTSC_threads = Util_sscandec(argv[++i]);
+				if (FILTER_NTSC_threads < 1 || FILTER_NTSC_threads > FILTER_NTSC_MAX_THREADS) {
+					Log_print("Invalid value for -ntsc-threads");
+					return FALSE;
+				}
+			} else a_m = TRUE;
+		}
+#endif
 		else if (strcmp(argv[i], "-ntsc-filter-preset") == 0) {
 			if (i_a) {
 				int idx = CFG_MatchTextParameter(argv[++i], preset_cfg_strings, FILTER_NTSC_PRESET_SIZE);
@@ -237,6 +265,9 @@ int FILTER_NTSC_Initialise(int *argc, char *argv[])
 				Log_print("\t-ntsc-burstphase <n>  Set burst phase (artifact colours) for NTSC filter (default %.2g)", FILTER_NTSC_setup.burst_phase);
 				Log_print("\t-ntsc-filter-preset composite|svideo|rgb|monochrome");
 				Log_print("\t                      Use one of predefined NTSC filter adjustments");
+#ifdef FILTER_NTSC_THREADS
+				Log_print("\t-ntsc-threads <n>     Filter the screen in <n> threads (default %d)", FILTER_NTSC_threads);
+#endif
 			}
 			argv[j++] = argv[i];
 		}
@@ -250,3 +281,90 @@ int FILTER_NTSC_Initialise(int *argc, char *argv[])
 
 	return TRUE;
 }
+
+#ifdef FILTER_NTSC_THREADS
+
+int FILTER_NTSC_threads = 1;
+
+static int num_workers = 0;
+static pthread_t workers[FILTER_NTSC_MAX_THREADS - 1];
+static pthread_mutex_t band_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t band_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t band_done_cond = PTHREAD_COND_INITIALIZER;
+/* The current job; guarded by band_mutex */
+static void (*band_func)(int first, int last, void *arg);
+static void *band_arg;
+static int band_height;
+static int band_count = 0;
+static int band_next = 0;
+static int band_pending = 0;
+
+/* Processes bands of the current job until none are left. Called with
+   band_mutex locked, returns with it locked. */
+static void RunBands(void)
+{
+	while (band_next < band_count) {
+		int band = band_next++;
+		void (*func)(int first, int last, void *arg) = band_func;
+		void *arg = band_arg;
+		int first = band_height * band / band_count;
+		int last = band_height * (band + 1) / band_count;
+		pthread_mutex_unlock(&band_mutex);
+		(*func)(first, last, arg);
+		pthread_mutex_lock(&band_mutex);
+		if (--band_pending == 0)
+			pthread_cond_signal(&band_done_cond);
+	}
+}
+
+static void *WorkerMain(void *arg)
+{
+	pthread_mutex_lock(&band_mutex);
+	for (;;) {
+		while (band_next >= band_count)
+			pthread_cond_wait(&band_work_cond, &band_mutex);
+		RunBands();
+	}
+	return NULL;
+}
+
+void FILTER_NTSC_ForEachBand(int height, void (*func)(int first, int last, void *arg), void *arg)
+{
+	int count = FILTER_NTSC_threads;
+	if (count > height)
+		count = height;
+	while (num_workers < count - 1) {
+		if (pthread_create(&workers[num_workers], NULL, WorkerMain, NULL) != 0) {
+			Log_print("Cannot create NTSC filter threads, filtering in %d", num_workers + 1);
+			FILTER_NTSC_threads = num_workers + 1;
+			count = FILTER_NTSC_threads;
+			break;
+		}
+		num_workers++;
+	}
+	if (count <= 1) {
+		(*func)(0, height, arg);
+		return;
+	}
+	pthread_mutex_lock(&band_mutex);
+	band_func = func;
+	band_arg = arg;
+	band_height = height;
+	band_count = count;
+	band_next = 0;
+	band_pending = count;
+	pthread_cond_broadcast(&band_work_cond);
+	RunBands();
+	while (band_pending > 0)
+		pthread_cond_wait(&band_done_cond, &band_mutex);
+	pthread_mutex_unlock(&band_mutex);
+}
+
+#else /* FILTER_NTSC_THREADS */
+
+void FILTER_NTSC_ForEachBand(int height, void (*func)(int first, int last, void *arg), void *arg)
+{
+	(*func)(0, height, arg);
+}
+
+#endif /* FILTER_NTSC_THREADS */
@@ -2,6 +2,7 @@
 #define FILTER_NTSC_H_
 
 #include <stdio.h>
+#include "config.h"
 #include "atari_ntsc/atari_ntsc.h"
 
 /* Limits for the adjustable values. */
@@ -61,4 +62,16 @@ void FILTER_NTSC_WriteConfig(FILE *fp);
 /* NTSC filter initialisation and processing of command-line arguments. */
 int FILTER_NTSC_Initialise(int *argc, char *argv[]);
 
+#ifdef HAVE_LIBPTHREAD
+#define FILTER_NTSC_THREADS
+/* Number of threads that filter the screen, 1 to FILTER_NTSC_MAX_THREADS. */
+extern int FILTER_NTSC_threads;
+#define FILTER_NTSC_MAX_THREADS 16
+#endif
+
+/* Calls FUNC(FIRST, LAST, ARG) for bands of rows FIRST to LAST-1 that
+   together cover rows 0 to HEIGHT-1, with FILTER_NTSC_threads bands being
+   processed at once. Returns when all of them are done. */
+void FILTER_NTSC_ForEachBand(int height, void (*func)(int first, int last, void *arg), void *arg);
+
 #endif /* FILTER_NTSC_H_ */
@@ -0,0 +1,448 @@
+/*
+ * frame_export.c - saving screenshots and sequences of frames in the background
+ *
+ * Copyright (C) 2024 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "frame_export.h"
+#include "file_export.h"
+#include "screen.h"
+#include "log.h"
+#include "util.h"
+#include "codecs/image.h"
+#ifdef FRAME_EXPORT_THREADS
+#include <pthread.h>
+#endif
+
+/* Images waiting to be saved. When the queue is full, queueing waits. */
+#define QUEUE_SIZE 16
+
+#define TAR_BLOCK 512
+
+typedef struct {
+	IMAGE_CODEC_t *codec;
+	IMAGE_CODEC_frame_t frame;
+	UBYTE *screens; /* the copy of frame.ptr1 and frame.ptr2 */
+	int to_tar; /* save to tar_fp rather than a file */
+	char filename[FILENAME_MAX]; /* the file, or the name in the tar file */
+} job_t;
+
+/* The running sequence */
+static int sequence = FALSE;
+static char sequence_format[FILENAME_MAX];
+static int sequence_no_max;
+static int sequence_no;
+static FILE *tar_fp = NULL;
+static char tar_filename[FILENAME_MAX];
+static char tar_extension[8];
+
+/* The last image that couldn't be saved, reported by the main thread */
+static char failed_filename[FILENAME_MAX];
+static int num_failed = 0;
+
+#ifdef FRAME_EXPORT_THREADS
+int FRAME_EXPORT_threads = 2;
+
+static int num_workers = 0;
+static int threads_failed = FALSE;
+static int quit_workers = FALSE;
+static pthread_t workers[FRAME_EXPORT_MAX_THREADS];
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t tar_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queue_space_cond = PTHREAD_COND_INITIALIZER;
+/* Guarded by queue_mutex, as are failed_filename and num_failed */
+static job_t *queue[QUEUE_SIZE];
+static int queue_first = 0;
+static int queue_length = 0;
+static int jobs_running = 0;
+#endif /* FRAME_EXPORT_THREADS */
+
+/* Writes the header of a tar file entry. */
+static void WriteTarHeader(FILE *fp, const char *name, long size)
+{
+	UBYTE header[TAR_BLOCK];
+	unsigned int checksum = 0;
+	int i;
+
+	memset(header, 0, sizeof(header));
+	Util_strlcpy((char *) header, name, 100);
+	strcpy((char *) header + 100, "0000644");
+	strcpy((char *) header + 108, "0000000");
+	strcpy((char *) header + 116, "0000000");
+	sprintf((char *) header + 124, "%011lo", (unsigned long) size);
+	sprintf((char *) header + 136, "%011lo", (unsigned long) time(NULL));
+	memset(header + 148, ' ', 8);
+	header[156] = '0'; /* regular file */
+	memcpy(header + 257, "ustar\0" "00", 8);
+	for (i = 0; i < TAR_BLOCK; i++)
+		checksum += header[i];
+	sprintf((char *) header + 148, "%06o", checksum);
+	fwrite(header, 1, TAR_BLOCK, fp);
+}
+
+/* Copies the SIZE bytes of SRC to the tar file as an entry called NAME. */
+static int WriteTarEntry(const char *name, FILE *src, long size)
+{
+	UBYTE buffer[8 * TAR_BLOCK];
+	long left = size;
+
+	WriteTarHeader(tar_fp, name, size);
+	rewind(src);
+	while (left > 0) {
+		size_t count = left < (long) sizeof(buffer) ? (size_t) left : sizeof(buffer);
+		if (fread(buffer, 1, count, src) != count)
+			return FALSE;
+		fwrite(buffer, 1, count, tar_fp);
+		left -= count;
+	}
+	/* pad the entry to whole blocks */
+	memset(buffer, 0, TAR_BLOCK);
+	if (size % TAR_BLOCK != 0)
+		fwrite(buffer, 1, TAR_BLOCK - size % TAR_BLOCK, tar_fp);
+	return !ferror(tar_fp);
+}
+
+/* Saves a queued image; may run in a worker thread. */
+static void SaveJob(job_t *job)
+{
+	FILE *fp;
+	int result = FALSE;
+
+	/* Entries of a tar file need their size first, so they are saved to a
+	   temporary file and copied. */
+	fp = job->to_tar ? tmpfile() : fopen(job->filename, "wb");
+	if (fp != NULL) {
+		result = job->codec->to_file(fp, &job->frame);
+		if (result && job->to_tar) {
+			long size = ftell(fp);
+#ifdef FRAME_EXPORT_THREADS
+			pthread_mutex_lock(&tar_mutex);
+#endif
+			result = size >= 0 && tar_fp != NULL && WriteTarEntry(job->filename, fp, size);
+#ifdef FRAME_EXPORT_THREADS
+			pthread_mutex_unlock(&tar_mutex);
+#endif
+		}
+		fclose(fp);
+	}
+	if (!result) {
+#ifdef FRAME_EXPORT_THREADS
+		pthread_mutex_lock(&queue_mutex);
+#endif
+		Util_strlcpy(failed_filename, job->filename, sizeof(failed_filename));
+		num_failed++;
+#ifdef FRAME_EXPORT_THREADS
+		pthread_mutex_unlock(&queue_mutex);
+#endif
+	}
+	free(job->screens);
+	free(job);
+}
+
+/* Logs the images that couldn't be saved since the last call. */
+static void ReportFailures(void)
+{
+	char filename[FILENAME_MAX];
+	int count;
+
+#ifdef FRAME_EXPORT_THREADS
+	pthread_mutex_lock(&queue_mutex);
+#endif
+	count = num_failed;
+	num_failed = 0;
+	Util_strlcpy(filename, failed_filename, sizeof(filename));
+#ifdef FRAME_EXPORT_THREADS
+	pthread_mutex_unlock(&queue_mutex);
+#endif
+	if (count == 1)
+		Log_print("Failed saving to file: %s", filename);
+	else if (count > 1)
+		Log_print("Failed saving %d images, the last to: %s", count, filename);
+}
+
+#ifdef FRAME_EXPORT_THREADS
+
+static void *WorkerMain(void *arg)
+{
+	pthread_mutex_lock(&queue_mutex);
+	for (;;) {
+		job_t *job;
+		while (queue_length == 0 && !quit_workers)
+			pthread_cond_wait(&queue_work_cond, &queue_mutex);
+		if (queue_length == 0)
+			break;
+		job = queue[queue_first];
+		queue_first = (queue_first + 1) % QUEUE_SIZE;
+		queue_length--;
+		jobs_running++;
+		pthread_cond_signal(&queue_space_cond);
+		pthread_mutex_unlock(&queue_mutex);
+		SaveJob(job);
+		pthread_mutex_lock(&queue_mutex);
+		jobs_running--;
+		pthread_cond_signal(&queue_space_cond);
+	}
+	pthread_mutex_unlock(&queue_mutex);
+	return NULL;
+}
+
+static void AddJob(job_t *job)
+{
+	while (num_workers < FRAME_EXPORT_threads && !threads_failed) {
+		if (pthread_create(&workers[num_workers], NULL, WorkerMain, NULL) != 0) {
+			Log_print("Cannot create threads to save images");
+			threads_failed = TRUE;
+			break;
+		}
+		num_workers++;
+	}
+	if (num_workers == 0) {
+		SaveJob(job);
+		return;
+	}
+	pthread_mutex_lock(&queue_mutex);
+	while (queue_length == QUEUE_SIZE)
+		pthread_cond_wait(&queue_space_cond, &queue_mutex);
+	queue[(queue_first + queue_length) % QUEUE_SIZE] = job;
+	queue_length++;
+	pthread_cond_signal(&queue_work_cond);
+	pthread_mutex_unlock(&queue_mutex);
+}
+
+/* Waits until all queued images are saved. */
+static void WaitForJobs(void)
+{
+	pthread_mutex_lock(&queue_mutex);
+	while (queue_length > 0 || jobs_running > 0)
+		pthread_cond_wait(&queue_space_cond, &queue_mutex);
+	pthread_mutex_unlock(&queue_mutex);
+}
+
+#else /* FRAME_EXPORT_THREADS */
+
+static void AddJob(job_t *job)
+{
+	SaveJob(job);
+}
+
+static void WaitForJobs(void)
+{
+}
+
+#endif /* FRAME_EXPORT_THREADS */
+
+/* Queues the screen to be saved with the current image_codec. */
+static void QueueScreen(const char *filename, int to_tar, UBYTE *ptr1, UBYTE *ptr2)
+{
+	job_t *job = (job_t *) Util_malloc(sizeof(job_t));
+	int size = Screen_WIDTH * Screen_HEIGHT;
+	UBYTE *screens = (UBYTE *) Util_malloc(ptr2 != NULL ? 2 * size : size);
+
+	memcpy(screens, ptr1, size);
+	if (ptr2 != NULL)
+		memcpy(screens + size, ptr2, size);
+	job->codec = image_codec;
+	CODECS_IMAGE_SetFrame(&job->frame, screens, ptr2 != NULL ? screens + size : NULL);
+	job->screens = screens;
+	job->to_tar = to_tar;
+	Util_strlcpy(job->filename, filename, sizeof(job->filename));
+	AddJob(job);
+}
+
+int Frame_Export_Queue(const char *filename, UBYTE *ptr1, UBYTE *ptr2)
+{
+	ReportFailures();
+	if (!CODECS_IMAGE_Init(filename))
+		return FALSE;
+	QueueScreen(filename, FALSE, ptr1, ptr2);
+	return TRUE;
+}
+
+int Frame_Export_StartSequence(const char *pattern)
+{
+	Frame_Export_StopSequence();
+	if (Util_striendswith(pattern, ".tar")) {
+		/* "frames.png.tar": the extension before ".tar" gives the format */
+		char name[FILENAME_MAX];
+		char *ext;
+		Util_strlcpy(name, pattern, sizeof(name));
+		name[strlen(name) - 4] = '\0';
+		ext = strrchr(name, '.');
+		if (ext == NULL || strlen(ext + 1) >= sizeof(tar_extension)
+		    || !CODECS_IMAGE_Init(ext + 1)) {
+			Log_print("Give the image format of the tar file, like \"frames.png.tar\"");
+			return FALSE;
+		}
+		strcpy(tar_extension, ext + 1);
+		tar_fp = fopen(pattern, "wb");
+		if (tar_fp == NULL) {
+			Log_print("Failed saving to file: %s", pattern);
+			return FALSE;
+		}
+		Util_strlcpy(tar_filename, pattern, sizeof(tar_filename));
+	}
+	else {
+		sequence_no_max = Util_filenamepattern(pattern, sequence_format, sizeof(sequence_format), NULL);
+		if (sequence_no_max <= 1) {
+			Log_print("Mark the frame number in the file name with hashes, like \"frame######.png\"");
+			return FALSE;
+		}
+		if (!File_Export_ImageTypeSupported(pattern)) {
+			Log_print("Unsupported image type for file: %s", pattern);
+			return FALSE;
+		}
+	}
+	sequence_no = 0;
+	sequence = TRUE;
+	return TRUE;
+}
+
+void Frame_Export_StopSequence(void)
+{
+	if (!sequence)
+		return;
+	sequence = FALSE;
+	WaitForJobs();
+	if (tar_fp != NULL) {
+		UBYTE end[2 * TAR_BLOCK];
+		memset(end, 0, sizeof(end));
+		fwrite(end, 1, sizeof(end), tar_fp);
+		if (fclose(tar_fp) != 0)
+			Log_print("Failed saving to file: %s", tar_filename);
+		tar_fp = NULL;
+	}
+	ReportFailures();
+	Log_print("Saved %d frames", sequence_no);
+}
+
+void Frame_Export_Frame(void)
+{
+	char filename[FILENAME_MAX];
+
+	if (!sequence)
+		return;
+	ReportFailures();
+	if (tar_fp != NULL) {
+		snprintf(filename, sizeof(filename), "%08d.%s", sequence_no, tar_extension);
+		CODECS_IMAGE_Init(tar_extension);
+	}
+	else {
+		snprintf(filename, sizeof(filename), sequence_format, sequence_no % sequence_no_max);
+		CODECS_IMAGE_Init(filename);
+	}
+	QueueScreen(filename, tar_fp != NULL, (UBYTE *) Screen_atari, NULL);
+	sequence_no++;
+}
+
+int Frame_Export_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	const char *sequence_pattern = NULL;
+
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc); /* is argument available? */
+		int a_m = FALSE; /* error, argument missing! */
+
+		if (strcmp(argv[i], "-shot-sequence") == 0) {
+			if (i_a)
+				sequence_pattern = argv[++i];
+			else a_m = TRUE;
+		}
+#ifdef FRAME_EXPORT_THREADS
+		else if (strcmp(argv[i], "-shot-threads") == 0) {
+			if (i_a) {
+				FRAME_EXPORT_threads = Util_sscandec(argv[++i]);
+				if (FRAME_EXPORT_threads < 1 || FRAME_EXPORT_threads > FRAME_EXPORT_MAX_THREADS) {
+					Log_print("Invalid value for -shot-threads");
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
+#endif
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-shot-sequence <p>");
+				Log_print("\t                 Save every displayed frame to files named by pattern <p>,");
+				Log_print("\t                 like frame######.png, or to a tar file like frames.png.tar");
+#ifdef FRAME_EXPORT_THREADS
+				Log_print("\t-shot-threads <n>");
+				Log_print("\t                 Save screenshots in <n> threads (default %d)", FRAME_EXPORT_threads);
+#endif
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	if (sequence_pattern != NULL)
+		return Frame_Export_StartSequence(sequence_pattern);
+	return TRUE;
+}
+
+int Frame_Export_ReadConfig(char *string, char *ptr)
+{
+	if (0) {}
+#ifdef FRAME_EXPORT_THREADS
+	else if (strcmp(string, "SCREENSHOT_THREADS") == 0) {
+		int value = Util_sscandec(ptr);
+		if (value < 1 || value > FRAME_EXPORT_MAX_THREADS)
+			return FALSE;
+		FRAME_EXPORT_threads = value;
+	}
+#endif
+	else return FALSE; /* no match */
+	return TRUE; /* matched something */
+}
+
+void Frame_Export_WriteConfig(FILE *fp)
+{
+#ifdef FRAME_EXPORT_THREADS
+	fprintf(fp, "SCREENSHOT_THREADS=%d\n", FRAME_EXPORT_threads);
+#endif
+}
+
+void Frame_Export_Exit(void)
+{
+	Frame_Export_StopSequence();
+	WaitForJobs();
+	ReportFailures();
+#ifdef FRAME_EXPORT_THREADS
+	pthread_mutex_lock(&queue_mutex);
+	quit_workers = TRUE;
+	pthread_cond_broadcast(&queue_work_cond);
+	pthread_mutex_unlock(&queue_mutex);
+	while (num_workers > 0)
+		pthread_join(workers[--num_workers], NULL);
+	quit_workers = FALSE;
+#endif
+}
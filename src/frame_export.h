@@ -0,0 +1,41 @@
+#ifndef FRAME_EXPORT_H_
+#define FRAME_EXPORT_H_
+
+#include "config.h"
+#include "atari.h"
+
+/* Saving screenshots and sequences of frames in the background: the screen
+   is copied when it is queued and saved later, by worker threads if
+   available, so that saving doesn't hold up the emulation. */
+
+#ifdef HAVE_LIBPTHREAD
+#define FRAME_EXPORT_THREADS
+/* Number of threads that save the queued images, 1 to
+   FRAME_EXPORT_MAX_THREADS. */
+extern int FRAME_EXPORT_threads;
+#define FRAME_EXPORT_MAX_THREADS 16
+#endif
+
+int Frame_Export_Initialise(int *argc, char *argv[]);
+int Frame_Export_ReadConfig(char *string, char *ptr);
+void Frame_Export_WriteConfig(FILE *fp);
+/* Saves everything queued and stops the sequence. */
+void Frame_Export_Exit(void);
+
+/* Queues PTR1 (and the interlaced scan lines PTR2, or NULL) to be saved to
+   FILENAME, in the format its extension gives. Returns FALSE if the format
+   is not supported. */
+int Frame_Export_Queue(const char *filename, UBYTE *ptr1, UBYTE *ptr2);
+
+/* Starts saving every displayed frame. PATTERN is a file name with hashes
+   for the frame number, like "frame######.png", or the name of a tar file
+   to write the frames to, with the image format before ".tar", like
+   "frames.png.tar". Returns FALSE on error. */
+int Frame_Export_StartSequence(const char *pattern);
+/* Waits for the frames of the sequence to be saved and stops it. */
+void Frame_Export_StopSequence(void);
+/* Queues the current screen if a sequence is running. Called after each
+   frame drawn by ANTIC_Frame. */
+void Frame_Export_Frame(void);
+
+#endif /* FRAME_EXPORT_H_ */
@@ -433,6 +433,10 @@ void GTIA_Frame(void)
 
 UBYTE GTIA_GetByte(UWORD addr, int no_side_effects)
 {
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+	if ((addr & 0x1f) <= GTIA_OFFSET_P3PF)
+		ANTIC_UpdateCollisions();
+#endif
 	switch (addr & 0x1f) {
 	case GTIA_OFFSET_M0PF:
 #ifdef NEW_CYCLE_EXACT
@@ -1057,6 +1061,9 @@ void GTIA_PutByte(UWORD addr, UBYTE byte)
 		GTIA_M0PL = GTIA_M1PL = GTIA_M2PL = GTIA_M3PL = 0;
 		GTIA_P0PL = GTIA_P1PL = GTIA_P2PL = GTIA_P3PL = 0;
 		PF0PM = PF1PM = PF2PM = PF3PM = 0;
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+		ANTIC_ClearCollisions();
+#endif
 #ifdef NEW_CYCLE_EXACT
 		hitclr_pos = ANTIC_XPOS * 2 - 37;
 		collision_curpos = hitclr_pos;
@@ -1203,6 +1210,9 @@ void GTIA_StateSave(void)
 {
 	int next_console_value = 7;
 
+#ifndef CURSES_BASIC
+	ANTIC_UpdateCollisions();
+#endif
 	STATESAV_TAG(gtia);
 	StateSav_SaveUBYTE(&GTIA_HPOSP0, 1);
 	StateSav_SaveUBYTE(&GTIA_HPOSP1, 1);
@@ -1251,12 +1261,19 @@ void GTIA_StateSave(void)
 	StateSav_SaveINT(&GTIA_speaker, 1);
 	StateSav_SaveINT(&next_console_value, 1);
 	StateSav_SaveUBYTE(GTIA_TRIG_latch, 4);
+#ifdef RUNAHEAD
+	if (StateSav_quick)
+		StateSav_SaveINT(&GTIA_consol_override, 1);
+#endif
 }
 
 void GTIA_StateRead(UBYTE version)
 {
 	int next_console_value;	/* ignored */
 
+#ifndef CURSES_BASIC
+	ANTIC_ClearCollisions();
+#endif
 	StateSav_ReadUBYTE(&GTIA_HPOSP0, 1);
 	StateSav_ReadUBYTE(&GTIA_HPOSP1, 1);
 	StateSav_ReadUBYTE(&GTIA_HPOSP2, 1);
@@ -1305,6 +1322,10 @@ void GTIA_StateRead(UBYTE version)
 	StateSav_ReadINT(&next_console_value, 1);
 	if (version >= 7)
 		StateSav_ReadUBYTE(GTIA_TRIG_latch, 4);
+#ifdef RUNAHEAD
+	if (StateSav_quick)
+		StateSav_ReadINT(&GTIA_consol_override, 1);
+#endif
 
 	GTIA_PutByte(GTIA_OFFSET_HPOSP0, GTIA_HPOSP0);
 	GTIA_PutByte(GTIA_OFFSET_HPOSP1, GTIA_HPOSP1);
@@ -69,6 +69,10 @@
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>
 #endif
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#  include <sys/mman.h>
+#  define IDE_MMAP
+#endif
 
 #define SECTOR_SIZE 512
 #define STD_HEADS   16          
@@ -206,6 +210,244 @@ static void ide_reset(struct ide_device *s) {
     s->media_changed = 0;
 }
 
+/* Sector cache. The image is read and written in lines of CACHE_LINE_SECTORS
+ * sectors kept in a small LRU cache, so the few-sector transfers the Atari
+ * makes don't each cost a host seek and read/write. Misses during sequential
+ * reading fetch READ_AHEAD_LINES lines at once. Writes stay in the cache
+ * until FLUSH CACHE, eviction, too many dirty lines, or exit. */
+#define CACHE_LINE_SECTORS 16
+#define CACHE_LINE_SIZE    (CACHE_LINE_SECTORS * SECTOR_SIZE)
+#define CACHE_LINES        64       /* 512 KB */
+#define READ_AHEAD_LINES   4
+#define MAX_DIRTY_LINES    32
+
+static int ide_use_cache = TRUE;
+static int ide_use_mmap = FALSE;
+
+/* number of bytes of the line present in the image */
+static int ide_line_bytes(struct ide_device *s, int64_t line) {
+    int64_t left = s->filesize - line * CACHE_LINE_SIZE;
+    return left < CACHE_LINE_SIZE ? (int)left : CACHE_LINE_SIZE;
+}
+
+static int ide_cache_writeback(struct ide_device *s, struct ide_cache_line *c) {
+    int len = ide_line_bytes(s, c->line);
+
+    if (IDE_debug)
+        fprintf(stderr, "ide: write back line %" PRId64 "\n", c->line);
+
+    if (fseeko(s->file, c->line * CACHE_LINE_SIZE, SEEK_SET) < 0
+        || fwrite(c->data, len, 1, s->file) != 1) {
+        fprintf(stderr, "ide: write back FAILED\n");
+        return FALSE;
+    }
+    c->dirty = 0;
+    s->dirty_lines--;
+    return TRUE;
+}
+
+/* Writes all dirty lines in image order and flushes the file. */
+static int ide_cache_flush(struct ide_device *s) {
+    int ret = TRUE;
+
+    if (s->map) {
+#ifdef IDE_MMAP
+        if (msync(s->map, s->filesize, MS_SYNC) != 0)
+            ret = FALSE;
+#endif
+        return ret;
+    }
+
+    while (s->dirty_lines > 0) {
+        struct ide_cache_line *first = NULL;
+        int i;
+        for (i = 0; i < s->cache_lines; i++)
+            if (s->cache[i].dirty && (!first || s->cache[i].line < first->line))
+                first = &s->cache[i];
+        if (!ide_cache_writeback(s, first)) {
+            ret = FALSE;
+            break;
+        }
+    }
+    if (s->file)
+        fflush(s->file);
+    return ret;
+}
+
+static struct ide_cache_line *ide_cache_find(struct ide_device *s, int64_t line) {
+    int i;
+    for (i = 0; i < s->cache_lines; i++)
+        if (s->cache[i].line == line)
+            return &s->cache[i];
+    return NULL;
+}
+
+/* Picks the least recently used line, writing it back if needed. */
+static struct ide_cache_line *ide_cache_victim(struct ide_device *s) {
+    struct ide_cache_line *c = &s->cache[0];
+    int i;
+    for (i = 1; i < s->cache_lines; i++)
+        if (s->cache[i].stamp < c->stamp)
+            c = &s->cache[i];
+    if (c->dirty && !ide_cache_writeback(s, c))
+        return NULL;
+    c->line = -1;
+    return c;
+}
+
+/* Returns the cache line holding sector_num, reading it (and when reading
+ * sequentially, the lines following it) from the image on a miss. */
+static struct ide_cache_line *ide_cache_get(struct ide_device *s,
+                                            int64_t sector_num, int reading) {
+    int64_t line = sector_num / CACHE_LINE_SECTORS;
+    int64_t last_line = (s->nb_sectors - 1) / CACHE_LINE_SECTORS;
+    struct ide_cache_line *c, *ret;
+    int i, ahead = 1;
+
+    c = ide_cache_find(s, line);
+    if (c) {
+        c->stamp = ++s->cache_clock;
+        return c;
+    }
+
+    if (reading && sector_num == s->next_sector)
+        ahead = READ_AHEAD_LINES;
+
+    /* read the line and, for read-ahead, any uncached lines after it */
+    ret = NULL;
+    for (i = 0; i < ahead && line + i <= last_line; i++) {
+        int len;
+        if (i > 0 && ide_cache_find(s, line + i))
+            break;
+        if (!(c = ide_cache_victim(s)))
+            return NULL;
+        len = ide_line_bytes(s, line + i);
+        /* seek every time, writing back the victim moves the file position */
+        if (fseeko(s->file, (line + i) * CACHE_LINE_SIZE, SEEK_SET) < 0
+            || fread(c->data, len, 1, s->file) != 1)
+            return ret;
+        if (len < CACHE_LINE_SIZE)
+            memset(c->data + len, 0, CACHE_LINE_SIZE - len);
+        c->line = line + i;
+        c->stamp = ++s->cache_clock;
+        if (i == 0)
+            ret = c;
+    }
+    /* the line asked for is the most recently used, not the read-ahead */
+    if (ret)
+        ret->stamp = ++s->cache_clock;
+    return ret;
+}
+
+static int ide_read_sectors(struct ide_device *s, int64_t sector_num,
+                            uint8_t *buf, int n) {
+    if (sector_num < 0 || sector_num + n > s->nb_sectors)
+        return FALSE;
+
+    if (s->map) {
+        memcpy(buf, s->map + sector_num * SECTOR_SIZE, n * SECTOR_SIZE);
+        return TRUE;
+    }
+    if (!s->cache) {
+        return fseeko(s->file, sector_num * SECTOR_SIZE, SEEK_SET) >= 0
+            && fread(buf, n * SECTOR_SIZE, 1, s->file) == 1;
+    }
+
+    while (n--) {
+        struct ide_cache_line *c = ide_cache_get(s, sector_num, TRUE);
+        if (!c)
+            return FALSE;
+        memcpy(buf, c->data + (sector_num % CACHE_LINE_SECTORS) * SECTOR_SIZE,
+               SECTOR_SIZE);
+        buf += SECTOR_SIZE;
+        s->next_sector = ++sector_num;
+    }
+    return TRUE;
+}
+
+static int ide_write_sectors(struct ide_device *s, int64_t sector_num,
+                             const uint8_t *buf, int n) {
+    if (sector_num < 0 || sector_num + n > s->nb_sectors)
+        return FALSE;
+
+    if (s->map) {
+        memcpy(s->map + sector_num * SECTOR_SIZE, buf, n * SECTOR_SIZE);
+        return TRUE;
+    }
+    if (!s->cache) {
+        if (fseeko(s->file, sector_num * SECTOR_SIZE, SEEK_SET) < 0
+            || fwrite(buf, n * SECTOR_SIZE, 1, s->file) != 1)
+            return FALSE;
+        fflush(s->file);
+        return TRUE;
+    }
+
+    while (n--) {
+        struct ide_cache_line *c = ide_cache_get(s, sector_num, FALSE);
+        if (!c)
+            return FALSE;
+        memcpy(c->data + (sector_num % CACHE_LINE_SECTORS) * SECTOR_SIZE, buf,
+               SECTOR_SIZE);
+        if (!c->dirty) {
+            c->dirty = 1;
+            s->dirty_lines++;
+        }
+        buf += SECTOR_SIZE;
+        sector_num++;
+    }
+    if (s->dirty_lines > MAX_DIRTY_LINES)
+        return ide_cache_flush(s);
+    return TRUE;
+}
+
+static void ide_cache_init(struct ide_device *s) {
+    int i;
+
+#ifdef IDE_MMAP
+    if (ide_use_mmap) {
+        void *map = mmap(NULL, s->filesize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fileno(s->file), 0);
+        if (map != MAP_FAILED) {
+            s->map = map;
+            return;
+        }
+        Log_print("ide: mmap failed, using the sector cache");
+    }
+#endif
+
+    if (!ide_use_cache)
+        return;
+
+    s->cache_lines = CACHE_LINES;
+    s->cache = Util_malloc(CACHE_LINES * sizeof(struct ide_cache_line));
+    for (i = 0; i < CACHE_LINES; i++) {
+        s->cache[i].line  = -1;
+        s->cache[i].stamp = 0;
+        s->cache[i].dirty = 0;
+        s->cache[i].data  = Util_malloc(CACHE_LINE_SIZE);
+    }
+    s->dirty_lines = 0;
+    s->cache_clock = 0;
+    s->next_sector = -1;
+}
+
+static void ide_cache_free(struct ide_device *s) {
+    int i;
+
+    ide_cache_flush(s);
+#ifdef IDE_MMAP
+    if (s->map)
+        munmap(s->map, s->filesize);
+#endif
+    s->map = NULL;
+    if (s->cache) {
+        for (i = 0; i < s->cache_lines; i++)
+            free(s->cache[i].data);
+        free(s->cache);
+        s->cache = NULL;
+    }
+}
+
 static int ide_init_drive(struct ide_device *s, char *filename) {
     if (!(s->file = fopen(filename, "rb+"))) {
         Log_print("%s: %s", filename, strerror(errno));
@@ -226,6 +468,7 @@ static int ide_init_drive(struct ide_device *s, char *filename) {
     }
 
     s->nb_sectors = s->filesize / SECTOR_SIZE;
+    ide_cache_init(s);
 
     /* use standard physical disk geometry */
     s->cylinders = s->nb_sectors / (STD_HEADS * STD_SECTORS);
@@ -234,6 +477,7 @@ static int ide_init_drive(struct ide_device *s, char *filename) {
         s->cylinders = 16383;
     else if (s->cylinders < 2) {
         Log_print("%s: image file too small\n", filename);
+        ide_cache_free(s);
         fclose(s->file);
         return FALSE;
     }
@@ -396,9 +640,7 @@ static void ide_sector_read(struct ide_device *s) {
         if (n > s->req_nb_sectors)
             n = s->req_nb_sectors;
 
-        if (fseeko(s->file, sector_num * SECTOR_SIZE, SEEK_SET) < 0)
-            goto fail;
-        if (fread(s->io_buffer, n * SECTOR_SIZE, 1, s->file) != 1)
+        if (!ide_read_sectors(s, sector_num, s->io_buffer, n))
             goto fail;
 
         if (IDE_debug) fprintf(stderr, "sector read OK\n");
@@ -428,15 +670,10 @@ static void ide_sector_write(struct ide_device *s) {
     if (n > s->req_nb_sectors)
         n = s->req_nb_sectors;
 
-    if (fseeko(s->file, sector_num * SECTOR_SIZE, SEEK_SET) < 0) {
-        fprintf(stderr, "FSEEKO FAILED\n");
+    if (!ide_write_sectors(s, sector_num, s->io_buffer, n)) {
+        fprintf(stderr, "WRITE FAILED\n");
         goto fail;
     }
-    if (fwrite(s->io_buffer, n * SECTOR_SIZE, 1, s->file) != 1) {
-        fprintf(stderr, "FWRITE FAILED\n");
-        goto fail;
-    }
-    fflush(s->file);
 
     s->nsector -= n;
     if (s->nsector == 0) {
@@ -608,7 +845,8 @@ static void ide_command(struct ide_device *s, uint8_t val) {
 
     case WIN_FLUSH_CACHE:
     case WIN_FLUSH_CACHE_EXT:
-        fflush(s->file);
+        if (!ide_cache_flush(s))
+            goto abort_cmd;
         break;
 
     case WIN_STANDBY:
@@ -882,11 +1120,19 @@ int IDE_Initialise(int *argc, char *argv[]) {
             IDE_debug = 1;
         } else if (!strcmp(argv[i], "-ide_cf")) {
             device.is_cf = 1;
+        } else if (!strcmp(argv[i], "-ide_nocache")) {
+            ide_use_cache = FALSE;
+        } else if (!strcmp(argv[i], "-ide_mmap")) {
+            ide_use_mmap = TRUE;
         } else {
              if (!strcmp(argv[i], "-help")) {
                  Log_print("\t-ide <file>      Enable IDE emulation");
                  Log_print("\t-ide_debug       Enable IDE Debug Output");
                  Log_print("\t-ide_cf          Enable CF emulation");
+                 Log_print("\t-ide_nocache     Write every IDE sector through to the image");
+#ifdef IDE_MMAP
+                 Log_print("\t-ide_mmap        Access the IDE image through mmap()");
+#endif
              }
              argv[j++] = argv[i];
         }
@@ -904,6 +1150,7 @@ int IDE_Initialise(int *argc, char *argv[]) {
 void IDE_Exit(void)
 {
 	if (IDE_enabled) {
+		ide_cache_free(&device);
 		fclose(device.file);
 		IDE_enabled = FALSE;
 	}
@@ -12,6 +12,14 @@ struct ide_device;
 
 typedef void EndTransferFunc(struct ide_device *);
 
+/* one entry of the sector cache */
+struct ide_cache_line {
+    int64_t line;           /* line number in the image, -1 if unused */
+    uint32_t stamp;         /* last access, for LRU replacement */
+    int dirty;
+    uint8_t *data;
+};
+
 struct ide_device {
     int bus_status;
     int bus_unit;
@@ -22,6 +30,14 @@ struct ide_device {
     off_t filesize;
     int blocksize;
 
+    /* sector cache (see ide.c) */
+    struct ide_cache_line *cache;
+    int cache_lines;
+    int dirty_lines;
+    uint32_t cache_clock;
+    int64_t next_sector;    /* sector following the last read, for read-ahead */
+    uint8_t *map;           /* whole image when mmap()ed, else NULL */
+
     int cylinders, heads, sectors;
 
     int drive_serial;
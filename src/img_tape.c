@@ -33,8 +33,6 @@
 #include "sio.h"
 #include "util.h"
 
-enum { MAX_BLOCKS = 2048 };
-
 /* Standard record length, needed by ReadRecord() when reading raw files */
 enum { DEFAULT_BUFFER_SIZE = 132 };
 
@@ -44,7 +42,11 @@ enum { DEFAULT_BAUDRATE = 600 };
 struct IMG_TAPE_t {
 	FILE *file; /* Stream for reading/writing of the tape image */
 	int isCAS; /* Indicates if the file is in CAS format, or a raw binary file */
-	UBYTE *buffer; /* Holds bytes of the last read or currently written data block */
+	UBYTE *image; /* Contents of the whole CAS file, kept in sync when writing */
+	size_t image_size; /* Number of bytes in IMAGE */
+	size_t image_allocated; /* Size of the space allocated for IMAGE */
+	UBYTE const *data; /* Bytes of the block being read - points into IMAGE or BUFFER */
+	UBYTE *buffer; /* Holds bytes of the currently written block, or of the last read block of a raw file */
 	size_t buffer_size; /* Size of the space allocated for BUFFER */
 	ULONG savetime; /* Time elapsed since last byte writing, in CPU ticks */
 	ULONG save_gap; /* Length of the IRG before the currently written block */
@@ -53,8 +55,10 @@ struct IMG_TAPE_t {
 	int block_is_fsk; /* FALSE - current chunk's type  is "data", otherwise "fsk " */
 	int block_length; /* Length of the block currently held in BUFFER */
 	int num_blocks; /* Number of data blocks in the whole file */
-	ULONG block_offsets[MAX_BLOCKS]; /* File offsets for each data block*/
-	int block_baudrates[MAX_BLOCKS]; /* Baudrates for each data block in the file */
+	int index_size; /* Number of entries allocated in the arrays below (> NUM_BLOCKS) */
+	ULONG *block_offsets; /* File offsets for each data block*/
+	int *block_baudrates; /* Baudrates for each data block in the file */
+	ULONG *block_times; /* Tape time in ms at the start of each block's gap */
 	char description[CASSETTE_DESCRIPTION_MAX]; /* Tape description, only for CAS files */
 	int was_writing; /* Indicated if the last operation on the file was writing */
 };
@@ -96,6 +100,46 @@ int IMG_TAPE_FileSupported(UBYTE const start_bytes[4])
 	    && start_bytes[2] == 'J' && start_bytes[3] == 'I';
 }
 
+/* Make room in the block index for entries up to and including BLOCK. */
+static void GrowIndex(IMG_TAPE_t *file, int block)
+{
+	if (block >= file->index_size) {
+		file->index_size = file->index_size == 0 ? 256 : file->index_size * 2;
+		if (file->index_size <= block)
+			file->index_size = block + 1;
+		file->block_offsets = (ULONG *)Util_realloc(file->block_offsets, file->index_size * sizeof(ULONG));
+		file->block_baudrates = (int *)Util_realloc(file->block_baudrates, file->index_size * sizeof(int));
+		file->block_times = (ULONG *)Util_realloc(file->block_times, file->index_size * sizeof(ULONG));
+	}
+}
+
+/* Append LENGTH bytes to the in-memory copy of the CAS file. */
+static void AppendImage(IMG_TAPE_t *file, UBYTE const *bytes, size_t length)
+{
+	if (file->image_size + length > file->image_allocated) {
+		file->image_allocated *= 2;
+		if (file->image_allocated < file->image_size + length)
+			file->image_allocated = file->image_size + length;
+		file->image = (UBYTE *)Util_realloc(file->image, file->image_allocated);
+	}
+	memcpy(file->image + file->image_size, bytes, length);
+	file->image_size += length;
+}
+
+/* Returns duration in ms of a data block of LENGTH bytes at BAUDRATE, or of
+   a FSK block holding LENGTH bytes of signal lengths at DATA. */
+static ULONG BlockDuration(int is_fsk, UBYTE const *data, int length, int baudrate)
+{
+	if (is_fsk) {
+		ULONG tenths = 0;
+		int i;
+		for (i = 0; i + 1 < length; i += 2)
+			tenths += data[i] | (data[i + 1] << 8);
+		return tenths / 10;
+	}
+	return baudrate > 0 ? (ULONG)length * 10 * 1000 / baudrate : 0;
+}
+
 /* Write contents of the file's block buffer to file, as a separate record;
    then empty the buffer.
    Returns TRUE on success or FALSE on write error. */
@@ -119,13 +163,20 @@ static int WriteRecord(IMG_TAPE_t *file)
 	header.aux_hi = (file->save_gap >> 8) & 0xff;
 	if (fwrite(&header, 1, 8, file->file) != 8)
 		return FALSE;
+	/* write record */
+	result = fwrite(file->buffer, 1, file->block_length, file->file) == file->block_length;
+	/* keep the in-memory copy and the index in sync with the file */
+	file->image_size = file->block_offsets[file->num_blocks];
+	AppendImage(file, (UBYTE const *)&header, 8);
+	AppendImage(file, file->buffer, file->block_length);
+	GrowIndex(file, file->num_blocks + 1);
 	/* Saving is supported only with standard baudrate. */
 	file->block_baudrates[file->num_blocks] = DEFAULT_BAUDRATE;
 	file->num_blocks++;
 	file->block_offsets[file->num_blocks] = file->block_offsets[file->num_blocks - 1] + file->block_length + 8;
+	file->block_times[file->num_blocks] = file->block_times[file->num_blocks - 1] + file->save_gap
+		+ BlockDuration(FALSE, NULL, file->block_length, DEFAULT_BAUDRATE);
 	file->current_block = file->num_blocks;
-	/* write record */
-	result = fwrite(file->buffer, 1, file->block_length, file->file) == file->block_length;
 	if (result) {
 		file->save_gap = 0;
 		file->block_length = 0;
@@ -158,69 +209,81 @@ IMG_TAPE_t *IMG_TAPE_Open(char const *filename, int *writable, char const **desc
 		return NULL;
 	}
 	img->description[0] = '\0';
+	img->was_writing = FALSE;
+	img->buffer = NULL;
+	img->data = NULL;
+
+	img->image = NULL;
+	img->image_size = img->image_allocated = 0;
+	img->index_size = 0;
+	img->block_offsets = NULL;
+	img->block_baudrates = NULL;
+	img->block_times = NULL;
+	GrowIndex(img, 0);
+	img->block_times[0] = 0;
 
 	if (fread(&header, 1, 6, img->file) == 6
 		&& header.identifier[0] == 'F'
 		&& header.identifier[1] == 'U'
 		&& header.identifier[2] == 'J'
 		&& header.identifier[3] == 'I') {
-		/* CAS file */
+		/* CAS file - read it whole and index its chunks in one pass */
+		ULONG offset;
 		UWORD length;
 		UWORD skip;
 		int blocks;
 		int baudrate = DEFAULT_BAUDRATE;
 
 		img->isCAS = TRUE;
-		fseek(img->file, 2L, SEEK_CUR);	/* ignore the aux bytes */
+		img->image_allocated = img->image_size = Util_flen(img->file);
+		img->image = (UBYTE *)Util_malloc(img->image_allocated);
+		if (fseek(img->file, 0, SEEK_SET) != 0
+		    || fread(img->image, 1, img->image_size, img->file) != img->image_size) {
+			IMG_TAPE_Close(img);
+			return NULL;
+		}
 
 		/* read or skip file description */
 		skip = length = header.length_lo | (header.length_hi << 8);
+		if (8 + (ULONG)length > img->image_size) {
+			IMG_TAPE_Close(img);
+			return NULL;
+		}
 		if (length < CASSETTE_DESCRIPTION_MAX)
 			skip = 0;
 		else
 			skip -= CASSETTE_DESCRIPTION_MAX - 1;
-		if (length > 0)
-			if (fread(img->description, 1, length - skip, img->file) < (length - skip)) {
-				fclose(img->file);
-				free(img);
-				return NULL;
-			}
+		memcpy(img->description, img->image + 8, length - skip);
 		img->description[length - skip] = '\0';
-		fseek(img->file, skip, SEEK_CUR);
 
-		/* count number of blocks */
+		/* index data blocks */
 		blocks = 0;
+		offset = 8 + length;
 		img->block_baudrates[0] = DEFAULT_BAUDRATE;
-		img->block_offsets[0] = ftell(img->file);
-		for (;;) {
-			/* chunk header is always 8 bytes */
-			if (fread(&header, 1, 8, img->file) != 8)
-				break;
-			length = header.length_lo + (header.length_hi << 8);
-			if (header.identifier[0] == 'b' &&
-			    header.identifier[1] == 'a' &&
-			    header.identifier[2] == 'u' &&
-			    header.identifier[3] == 'd') {
-				baudrate=header.aux_lo + (header.aux_hi << 8);
+		img->block_offsets[0] = offset;
+		/* chunk header is always 8 bytes */
+		while (offset + 8 <= img->image_size) {
+			UBYTE const *chunk = img->image + offset;
+			length = chunk[4] + (chunk[5] << 8);
+			if (memcmp(chunk, "baud", 4) == 0) {
+				baudrate = chunk[6] + (chunk[7] << 8);
 				img->block_offsets[blocks] += length + 8;
 			}
-			else if ((header.identifier[0] == 'd' &&
-			          header.identifier[1] == 'a' &&
-			          header.identifier[2] == 't' &&
-			          header.identifier[3] == 'a') ||
-			         (header.identifier[0] == 'f' &&
-			          header.identifier[1] == 's' &&
-			          header.identifier[2] == 'k' &&
-			          header.identifier[3] == ' ')) {
-				img->block_baudrates[blocks] = baudrate;
-				if (++blocks >= MAX_BLOCKS) {
-					--blocks;
+			else if (memcmp(chunk, "data", 4) == 0 || memcmp(chunk, "fsk ", 4) == 0) {
+				/* don't read past a truncated last chunk */
+				if (offset + 8 + length > img->image_size)
 					break;
-				}
+				img->block_baudrates[blocks] = baudrate;
+				GrowIndex(img, blocks + 1);
+				img->block_times[blocks + 1] = img->block_times[blocks] + (chunk[6] + (chunk[7] << 8))
+					+ BlockDuration(chunk[0] == 'f', chunk + 8, length, baudrate);
+				++blocks;
 				img->block_offsets[blocks] = img->block_offsets[blocks - 1] + length + 8;
 			}
-			/* skip possibly present data block */
-			fseek(img->file, length, SEEK_CUR);
+			else
+				/* unknown chunk before a block */
+				img->block_offsets[blocks] += length + 8;
+			offset += length + 8;
 		}
 		img->num_blocks = blocks;
 		*description = img->description;
@@ -228,7 +291,13 @@ IMG_TAPE_t *IMG_TAPE_Open(char const *filename, int *writable, char const **desc
 	else {
 		/* raw file */
 		int file_length = Util_flen(img->file);
+		int i;
 		img->num_blocks = ((file_length + 127) >> 7) + 1;
+		GrowIndex(img, img->num_blocks);
+		/* 132-byte records at 600 baud, see ReadNextRecord() */
+		for (i = 0; i < img->num_blocks; i++)
+			img->block_times[i + 1] = img->block_times[i] + (i == 0 ? 19200 : 260)
+				+ BlockDuration(FALSE, NULL, 132, DEFAULT_BAUDRATE);
 		img->isCAS = FALSE;
 		*writable = FALSE; /* Writing raw files is not supported */
 		*description = NULL;
@@ -240,7 +309,6 @@ IMG_TAPE_t *IMG_TAPE_Open(char const *filename, int *writable, char const **desc
 	img->block_length = 0;
 	img->current_block = 0;
 	img->buffer = (UBYTE *)Util_malloc((img->buffer_size = DEFAULT_BUFFER_SIZE) * sizeof(UBYTE));
-	img->was_writing = FALSE;
 
 	return img;
 }
@@ -251,6 +319,10 @@ void IMG_TAPE_Close(IMG_TAPE_t *file)
 		CassetteFlush(file);
 	fclose(file->file);
 	free(file->buffer);
+	free(file->image);
+	free(file->block_offsets);
+	free(file->block_baudrates);
+	free(file->block_times);
 	free(file);
 }
 
@@ -300,9 +372,25 @@ IMG_TAPE_t *IMG_TAPE_Create(char const *filename, char const *description)
 	img->block_length = 0;
 	img->current_block = 0;
 	img->num_blocks = 0;
+	img->index_size = 0;
+	img->block_offsets = NULL;
+	img->block_baudrates = NULL;
+	img->block_times = NULL;
+	GrowIndex(img, 0);
 	img->block_offsets[0] = strlen(description) + 16;
+	img->block_times[0] = 0;
 	img->buffer = (UBYTE *)Util_malloc((img->buffer_size = DEFAULT_BUFFER_SIZE) * sizeof(UBYTE));
 	img->was_writing = TRUE;
+	img->data = NULL;
+
+	/* in-memory copy of what was written above */
+	img->image_allocated = img->image_size = img->block_offsets[0];
+	img->image = (UBYTE *)Util_malloc(img->image_allocated);
+	if (fseek(file, 0, SEEK_SET) != 0
+	    || fread(img->image, 1, img->image_size, file) != img->image_size) {
+		IMG_TAPE_Close(img);
+		return NULL;
+	}
 
 	return img;
 }
@@ -336,24 +424,16 @@ static int ReadNextRecord(IMG_TAPE_t *file, int *gap)
 	}
 
 	if (file->isCAS) {
-		CAS_Header header;
-
-		if (fseek(file->file, file->block_offsets[file->current_block], SEEK_SET) != 0
-		    || fread(&header, 1, 8, file->file) < 8)
-			return FALSE;
+		/* The block was indexed at open or when written, so it lies
+		   completely inside the in-memory image. */
+		UBYTE const *chunk = file->image + file->block_offsets[file->current_block];
 
 		/* Determine chunk type - can be either "fsk " or "data". */
-		file->block_is_fsk = header.identifier[0] == 'f' &&
-		                     header.identifier[1] == 's' &&
-		                     header.identifier[2] == 'k' &&
-		                     header.identifier[3] == ' ';
-
-		length = header.length_lo + (header.length_hi << 8);
-		*gap = header.aux_lo + (header.aux_hi << 8);
-		/* read block into buffer */
-		EnlargeBuffer(file, length);
-		if (fread(file->buffer, 1, length, file->file) < length)
-			return FALSE;
+		file->block_is_fsk = chunk[0] == 'f';
+
+		length = chunk[4] + (chunk[5] << 8);
+		*gap = chunk[6] + (chunk[7] << 8);
+		file->data = chunk + 8;
 	}
 	else {
 		file->block_is_fsk = FALSE;
@@ -381,6 +461,7 @@ static int ReadNextRecord(IMG_TAPE_t *file, int *gap)
 				file->buffer[2] = 0xfc;	/* full record */
 		}
 		file->buffer[0x83] = SIO_ChkSum(file->buffer, 0x83);
+		file->data = file->buffer;
 	}
 	file->block_length = length;
 	return TRUE;
@@ -409,14 +490,14 @@ int IMG_TAPE_Read(IMG_TAPE_t *file, unsigned int *duration, int *is_gap, UBYTE *
 
 	if (file->block_is_fsk) {
 		/* Compose a 16-bit word with length of a signal in 1/10 of ms. */
-		unsigned int len = file->buffer[file->next_blockbyte++];
-		len |= ((unsigned int)file->buffer[file->next_blockbyte++]) << 8;
+		unsigned int len = file->data[file->next_blockbyte++];
+		len |= ((unsigned int)file->data[file->next_blockbyte++]) << 8;
 
 		/* Convert len from 1/10ms to CPU ticks. */
 		*duration = len * 178 + len * 9790 / 10000; /* (len * 1789790 / 10000), avoiding overflow */
 		*is_gap = TRUE;
 	} else {
-		*byte = file->buffer[file->next_blockbyte++];
+		*byte = file->data[file->next_blockbyte++];
 		*is_gap = FALSE;
 		/* Next event will be after 10 bits of data gets loaded. */
 		*duration = 10 * 1789790 / (file->isCAS ? file->block_baudrates[file->current_block] : 600);
@@ -497,6 +578,28 @@ void IMG_TAPE_Seek(IMG_TAPE_t *file, unsigned int position)
 	file->block_length = 0;
 }
 
+unsigned int IMG_TAPE_GetTime(IMG_TAPE_t *file, unsigned int position)
+{
+	if (position > (unsigned int)file->num_blocks)
+		position = file->num_blocks;
+	return file->block_times[position];
+}
+
+unsigned int IMG_TAPE_FindTime(IMG_TAPE_t *file, unsigned int ms)
+{
+	/* Binary search for the last block starting at or before MS. */
+	unsigned int lo = 0;
+	unsigned int hi = file->num_blocks;
+	while (lo < hi) {
+		unsigned int mid = (lo + hi + 1) / 2;
+		if (file->block_times[mid] <= ms)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
 int IMG_TAPE_SerinStatus(IMG_TAPE_t *file, int event_time_left)
 {
 	if (file->was_writing || file->next_blockbyte == 0)
@@ -527,7 +630,7 @@ int IMG_TAPE_SerinStatus(IMG_TAPE_t *file, int event_time_left)
 			return 0;
 
 		/* eval tone to return */
-		return (file->buffer[file->next_blockbyte - 1] >> (8 - bit)) & 1;
+		return (file->data[file->next_blockbyte - 1] >> (8 - bit)) & 1;
 	}
 }
 
@@ -588,10 +691,10 @@ int IMG_TAPE_ReadToMemory(IMG_TAPE_t *file, UWORD dest_addr, int length)
 		return FALSE;
 
 	/* Copy record to memory, excluding the checksum byte if it exists. */
-	MEMORY_CopyToMem(file->buffer + file->next_blockbyte, dest_addr, read_length >= length ? length : read_length);
+	MEMORY_CopyToMem(file->data + file->next_blockbyte, dest_addr, read_length >= length ? length : read_length);
 	file->next_blockbyte += (read_length >= length + 1 ? length + 1 : read_length);
 	return read_length >= length + 1 &&
-	       file->buffer[length] == SIO_ChkSum(file->buffer, length);
+	       file->data[length] == SIO_ChkSum(file->data, length);
 }
 
 int IMG_TAPE_WriteFromMemory(IMG_TAPE_t *file, UWORD src_addr, int length, int gap)
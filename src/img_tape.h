@@ -74,6 +74,12 @@ unsigned int IMG_TAPE_GetSize(IMG_TAPE_t *file);
 /* Positions the file at the start of a block given in POSITION (counted from
    0). */
 void IMG_TAPE_Seek(IMG_TAPE_t *file, unsigned int position);
+/* Returns tape time in ms at the start of block POSITION (counted from 0),
+   or at the end of the tape if POSITION is past the last block. */
+unsigned int IMG_TAPE_GetTime(IMG_TAPE_t *file, unsigned int position);
+/* Returns the block (counted from 0) that is playing MS milliseconds after
+   the start of the tape. */
+unsigned int IMG_TAPE_FindTime(IMG_TAPE_t *file, unsigned int ms);
 
 /* Returns direct state of POKEY's serial input port during tape reading.
    EVENT_TIME_LEFT is number of CPU ticks left till the end of the byte that's
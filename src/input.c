@@ -1046,6 +1046,8 @@ void INPUT_DrawMousePointer(void)
 				if (y <= 117)
 					PLOT(0, 2);
 			}
+			y = y >= 2 ? 2 * y - 4 : 0;
+			ANTIC_VideoChanged((UBYTE *) Screen_atari + Screen_WIDTH * y, Screen_WIDTH * 10);
 		}
 	}
 }
@@ -52,6 +52,7 @@
 #include "libatari800/video.h"
 #include "libatari800/sound.h"
 #include "libatari800/statesav.h"
+#include "libatari800/watch.h"
 
 
 #ifdef HAVE_SETJMP
@@ -232,6 +233,7 @@ int libatari800_next_frame(input_template_t *input)
 		}
 	}
 	PLATFORM_DisplayScreen();
+	LIBATARI800_Watch_Update(TRUE);
 	return !libatari800_error_code;
 }
 
@@ -321,6 +323,33 @@ UBYTE *libatari800_get_screen_ptr()
 }
 
 
+/** Copy a part of the screen in a chosen pixel format
+ *
+ * Converts the rectangle of the emulated screen (see
+ * \a libatari800_get_screen_ptr) at @a left, @a top of size @a width by
+ * @a height directly into caller-provided memory, taking every @a step-th
+ * pixel horizontally and vertically. For example, the usual 320x192 area
+ * halved is left=32, top=24, width=320, height=192, step=2.
+ *
+ * Output is packed rows of (width / step) pixels, (height / step) rows, in
+ * the current palette. LIBATARI800_SCREEN_ARTIFACT may be ORed with
+ * LIBATARI800_SCREEN_GRAY, LIBATARI800_SCREEN_RGB24 or
+ * LIBATARI800_SCREEN_RGBA32 to run the frame through the Altirra NTSC/PAL
+ * artifacting engine first, which is much slower.
+ *
+ * @param dest buffer of at least (width / step) * (height / step) * bytes per
+ * pixel bytes
+ *
+ * @param format one of the LIBATARI800_SCREEN_* pixel formats
+ *
+ * @returns number of bytes stored, or 0 if the arguments are invalid
+ */
+int libatari800_copy_screen(UBYTE *dest, int format, int left, int top, int width, int height, int step)
+{
+	return LIBATARI800_Video_CopyScreen(dest, format, left, top, width, height, step);
+}
+
+
 /** Return pointer to sound data
  *
  * If sound is used, each emulated frame will fill the sound buffer with samples
@@ -426,6 +455,33 @@ int libatari800_get_frame_number() {
 }
 
 
+/** Return whether the self-test ROM is mapped in
+ *
+ * This is the same value as the \a selftest_enabled flag stored by \a
+ * libatari800_get_current_state, but is cheap enough to be checked after
+ * every frame.
+ *
+ * @returns TRUE if the XL/XE self-test ROM is currently enabled
+ */
+int libatari800_get_selftest_enabled() {
+	return MEMORY_selftest_enabled;
+}
+
+
+/** Return the current ANTIC display list address
+ *
+ * This is the address ANTIC will fetch the next display list instruction
+ * from, so between frames it normally points back to the start of the
+ * display list after a JVB instruction. It is zero if ANTIC has not yet been
+ * given a display list.
+ *
+ * @returns ANTIC display list program counter
+ */
+UWORD libatari800_get_antic_dlist() {
+	return ANTIC_dlist;
+}
+
+
 /** Save the state of the emulator
  *
  * Save the state of the emulator into a data structure that can later be used
@@ -479,6 +535,62 @@ void libatari800_restore_state(emulator_state_t *state)
 	MEMORY_selftest_enabled = state->flags.selftest_enabled;
 	Atari800_nframes = state->flags.nframes;
 	sample_residual = (double)state->flags.sample_residual / (double)0xffffffff;
+	LIBATARI800_Watch_Update(FALSE);
+}
+
+
+/** Set the list of watched memory locations
+ *
+ * Watched locations are read and decoded after every emulated frame into a
+ * compact array of values, see \a libatari800_get_watch_values, so the
+ * caller doesn't have to copy and decode the whole memory to get e.g. the
+ * score and the number of lives.
+ *
+ * Each location is either an address as seen by the CPU (bank
+ * LIBATARI800_WATCH_CPU; hardware registers are read without side effects),
+ * or an address in 0x4000-0x7fff of a given XE extended RAM bank, which is
+ * read whether or not the bank is currently switched in.
+ *
+ * @param watches array of @a count locations, copied by the emulator
+ *
+ * @param count number of locations, at most LIBATARI800_MAX_WATCHES; 0 clears
+ * the list
+ *
+ * @retval FALSE if a location is invalid; the previous list is kept
+ * @retval TRUE if successful
+ */
+int libatari800_set_watches(const watch_template_t *watches, int count)
+{
+	return LIBATARI800_Watch_Set(watches, count);
+}
+
+
+/** Return the values of watched memory locations
+ *
+ * The values are updated after each call to \a libatari800_next_frame and
+ * \a libatari800_restore_state, and when the list is set.
+ *
+ * @returns pointer to an array of decoded values, one for each location set
+ * by \a libatari800_set_watches
+ */
+const int *libatari800_get_watch_values(void)
+{
+	return LIBATARI800_Watch_GetValues();
+}
+
+
+/** Set the function called when a watched value changes
+ *
+ * After each emulated frame @a callback is called once for every watched
+ * location whose decoded value differs from that after the previous frame,
+ * so the caller learns about changes without polling the values.
+ *
+ * @param callback function receiving the index of the location in the watch
+ * list and its old and new value, or NULL
+ */
+void libatari800_set_watch_callback(void (*callback)(int index, int old_value, int new_value))
+{
+	LIBATARI800_Watch_callback = callback;
 }
 
 
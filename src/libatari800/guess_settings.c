@@ -1,6 +1,18 @@
+#include "config.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#if defined(HAVE_FORK) && defined(HAVE_SYS_WAIT_H) && defined(HAVE_UNISTD_H)
+/* Candidate configurations are tried in parallel, each in a forked process */
+#define GUESS_PARALLEL
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include "libatari800.h"
 
 #define MACHINE_TYPE_800 0x01
@@ -138,9 +150,8 @@ char *default_args[] = {
 char memo_pad_text[] = "\x21\x34\x21\x32\x29\x00\x23\x2F\x2D\x30\x35\x34\x25\x32\x00\x0D\x00\x2D\x25\x2D\x2F\x00\x30\x21\x24"; /* ATARI COMPUTER - MEMO PAD */
 char memo_pad_altirra[] = "\x21\x6C\x74\x69\x72\x72\x61\x2F\x33"; /* AltirraOS */
 
-int check_memo_pad(emulator_state_t *state) {
-	antic_state_t *antic = (antic_state_t *)&state->state[state->tags.antic];
-	UBYTE *memory = (UBYTE *)&state->state[state->tags.base_ram];
+int check_memo_pad(void) {
+	UBYTE *memory = libatari800_get_main_memory_ptr();
 	UWORD ramtop;
 	UWORD gr0;
 
@@ -157,7 +168,7 @@ int check_memo_pad(emulator_state_t *state) {
 		$bc42.
 	 */
 	ramtop = memory[0x6a] << 8;
-	if (antic->dlist == ramtop - 0x3e0) {
+	if (libatari800_get_antic_dlist() == ramtop - 0x3e0) {
 		gr0 = ramtop - 0x3c0;
 		if (memcmp(&memory[gr0 + 2], memo_pad_text, sizeof(memo_pad_text)) == 0) {
 			return TRUE;
@@ -171,6 +182,10 @@ int check_memo_pad(emulator_state_t *state) {
 
 #define BAD_DLIST_MIN_FRAMES 200
 
+/* Run the emulator for up to num_frames, stopping at the first failure.
+   Status flags are read directly after each frame; a full state save would
+   cost more than emulating the frame itself.
+*/
 int run_emulator(int num_args, int num_frames, int verbose) {
 	int i;
 
@@ -183,15 +198,14 @@ int run_emulator(int num_args, int num_frames, int verbose) {
 	libatari800_init(num_args, test_args);
 	if (libatari800_error_code) return 0;
 
-	emulator_state_t state;
 	input_template_t input;
+	libatari800_clear_input_array(&input);
 
 	int frame = 0;
 	int selftest_count = 0;
 	while (frame < num_frames) {
 		libatari800_next_frame(&input);
-		libatari800_get_current_state(&state);
-		if (state.flags.selftest_enabled) {
+		if (libatari800_get_selftest_enabled()) {
 			selftest_count++;
 			if (selftest_count > 10) {
 				frame = -frame;
@@ -201,7 +215,7 @@ int run_emulator(int num_args, int num_frames, int verbose) {
 		}
 		switch (libatari800_error_code) {
 			case 0:
-			if (check_memo_pad(&state)) {
+			if (check_memo_pad()) {
 				libatari800_error_code = LIBATARI800_MEMO_PAD;
 				frame = -frame;
 				goto exit;
@@ -224,113 +238,275 @@ exit:
 	return frame;
 }
 
+/* Return the first entry in the cart list matching the size of the image, or
+   if cart_kb is negative, the entry for the cart type given by the CART
+   header. Returns NULL if the machine has no such cart type.
+*/
 cart_types_t *get_first_cart(machine_config_t *machine, int cart_kb) {
 	cart_types_t *cart_desc = NULL;
 
 	if (cart_kb > 0) {
 		if (machine->type & MACHINE_TYPE_5200) cart_desc = cart_list_5200;
 		else cart_desc = cart_list_a8;
-		while (cart_desc->size < cart_kb) cart_desc++;
+		while (cart_desc->size && (cart_desc->size != cart_kb)) cart_desc++;
 	}
 	else if (cart_kb < 0) {
 		/* cart_kb is the negative cart type */
 		if (machine->type & MACHINE_TYPE_5200) cart_desc = cart_list_5200;
 		else cart_desc = cart_list_a8;
 		while (cart_desc->size && (cart_desc->type != -cart_kb)) cart_desc++;
-
-		/* if we go through the entire list, the cart must not work in this machine */
-		if (!cart_desc->size) cart_desc = NULL;
 	}
+
+	/* if we go through the entire list, the cart must not work in this machine */
+	if (cart_desc && !cart_desc->size) cart_desc = NULL;
 	return cart_desc;
 }
 
-/* Run the emulator using a given set of command line args. If it could be a
-   cartridge, run it multiple times trying the various cart types corresponding
-   to its size.
+/* One permutation of machine and cart type to be tried */
+typedef struct {
+	machine_config_t *machine;
+	cart_types_t *cart_desc; /* NULL to run the image without a cart type */
+	int num_frames;
+	int status;              /* CANDIDATE_* below */
+	int frames;              /* result of run_emulator */
+	int error_code;          /* libatari800_error_code after the run */
+#ifdef GUESS_PARALLEL
+	pid_t pid;
+	int fd;
+#endif
+} candidate_t;
+
+#define CANDIDATE_WAITING 0
+#define CANDIDATE_RUNNING 1
+#define CANDIDATE_DONE 2
+#define CANDIDATE_SKIPPED 3
+
+/* Add the permutations to try for a given machine. If the image could be a
+   cartridge, it is tried with all the cart types corresponding to its size,
+   and finally as a plain file.
 */
-int run_machine(machine_config_t *machine, char *pathname, int num_frames, int cart_kb, int verbose) {
-	int success;
-	int any_success = 0;
-	char **machine_args;
+int add_candidates(candidate_t *candidates, int num, machine_config_t *machine, int num_frames, int cart_kb) {
 	cart_types_t *cart_desc = get_first_cart(machine, cart_kb);
-	char cart_type_string[16];
+	candidate_t *c;
 
 	if (cart_kb < 0 && !cart_desc) {
 		/* have an exact match for a cart type, but not compatible machine */
-		return 0;
+		return num;
 	}
 	num_frames = num_frames < machine->min_frames ? machine->min_frames : num_frames;
 	while (1) {
-		/* args array is modified by atari800, so need to recreate it each time */
-		int num_args = 0;
-		while (num_args < (sizeof(default_args) / sizeof(default_args[0]))) {
-			test_args[num_args] = default_args[num_args];
-			// printf("default arg %d: %s\n", num_args, default_args[num_args]);
-			num_args++;
+		c = &candidates[num++];
+		memset(c, 0, sizeof(*c));
+		c->machine = machine;
+		c->cart_desc = cart_desc;
+		c->num_frames = num_frames;
+		if (!cart_desc || (cart_kb < 0)) break;
+		cart_desc++;
+		if (cart_desc->size != cart_kb) cart_desc = NULL;
+	}
+	return num;
+}
+
+/* Run the emulator using the command line args of a candidate */
+void run_candidate(candidate_t *c, char *pathname, int verbose) {
+	char **machine_args;
+	char cart_type_string[16];
+
+	/* args array is modified by atari800, so need to recreate it each time */
+	int num_args = 0;
+	while (num_args < (sizeof(default_args) / sizeof(default_args[0]))) {
+		test_args[num_args] = default_args[num_args];
+		num_args++;
+	}
+	machine_args = c->machine->args;
+	while (*machine_args) {
+		test_args[num_args++] = *machine_args++;
+	}
+	if (c->cart_desc) {
+		test_args[num_args++] = "-cart-type";
+		sprintf(cart_type_string, "%d", c->cart_desc->type);
+		test_args[num_args++] = cart_type_string;
+		test_args[num_args++] = "-cart";
+	}
+	test_args[num_args++] = pathname;
+
+	c->frames = run_emulator(num_args, c->num_frames, verbose);
+	c->error_code = libatari800_error_code;
+	c->status = CANDIDATE_DONE;
+}
+
+void print_candidate(candidate_t *c, char *pathname, int verbose) {
+	char **machine_args;
+	machine_config_t *machine = c->machine;
+
+	if (!verbose) {
+		if (c->frames > 0) {
+			printf("%s: %s (", pathname, machine->label);
+			machine_args = machine->args;
+			while (*machine_args) {
+				printf("%s", *machine_args);
+				machine_args++;
+				if (*machine_args) printf(" ");
+			}
+			if (c->cart_desc) {
+				printf(" -cart-type %d", c->cart_desc->type);
+			}
+			printf(")\n");
 		}
-		machine_args = machine->args;
-		while (*machine_args) {
-			// printf("arg %d: %s\n", num_args, *machine_args);
-			test_args[num_args++] = *machine_args++;
+	}
+	else {
+		printf("%s: %s", pathname, machine->label);
+		if (c->frames > 0) printf(" status: OK through %d frames", c->frames);
+		else {
+			printf(" status: FAIL");
+			if (c->error_code) {
+				libatari800_error_code = c->error_code;
+				printf(" (%s)", libatari800_error_message());
+			}
 		}
-		if (cart_desc && ((cart_desc->size == cart_kb) || (cart_kb < 0))) {
-			test_args[num_args++] = "-cart-type";
-			sprintf(cart_type_string, "%d", cart_desc->type);
-			test_args[num_args++] = cart_type_string;
-			test_args[num_args++] = "-cart";
+		if (c->cart_desc) {
+			printf(" (cart=%d '%s')", c->cart_desc->type, c->cart_desc->label);
 		}
-		test_args[num_args++] = pathname;
-
-		success = run_emulator(num_args, num_frames, verbose);
-		if (success) any_success++;
-		if (!verbose) {
-			if (success > 0) {
-				printf("%s: %s (", pathname, machine->label);
-				machine_args = machine->args;
-				while (*machine_args) {
-					printf("%s", *machine_args);
-					machine_args++;
-					if (*machine_args) printf(" ");
-				}
-				if (cart_desc) {
-					printf(" -cart-type %d", cart_desc->type);
-				}
-				printf(")\n");
+		printf("\n");
+	}
+}
+
+#ifdef GUESS_PARALLEL
+/* Start a child process to run the candidate, which reports the result
+   through a pipe. Returns FALSE if the process couldn't be created.
+*/
+int start_candidate(candidate_t *c, char *pathname, int verbose) {
+	int fds[2];
+	int result[2];
+
+	if (pipe(fds) < 0) return FALSE;
+	fflush(stdout);
+	c->pid = fork();
+	if (c->pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		return FALSE;
+	}
+	if (c->pid == 0) {
+		close(fds[0]);
+		run_candidate(c, pathname, verbose);
+		result[0] = c->frames;
+		result[1] = c->error_code;
+		if (write(fds[1], result, sizeof(result)) != sizeof(result)) _exit(1);
+		fflush(stdout);
+		_exit(0);
+	}
+	close(fds[1]);
+	c->fd = fds[0];
+	c->status = CANDIDATE_RUNNING;
+	return TRUE;
+}
+
+/* Collect the result of a child process that has exited */
+void finish_candidate(candidate_t *c) {
+	int result[2];
+
+	if (read(c->fd, result, sizeof(result)) == sizeof(result)) {
+		c->frames = result[0];
+		c->error_code = result[1];
+		c->status = CANDIDATE_DONE;
+	}
+	else {
+		/* killed, or crashed outside the emulated machine */
+		c->status = CANDIDATE_SKIPPED;
+	}
+	close(c->fd);
+}
+#endif /* GUESS_PARALLEL */
+
+/* Try all candidates, running up to max_jobs of them at the same time. If
+   first_only is set, stop as soon as the first candidate (in list order)
+   is known to succeed.
+*/
+void run_candidates(candidate_t *candidates, int num, char *pathname, int max_jobs, int first_only, int verbose) {
+	int next = 0;
+	int last = num; /* candidates from here on are no longer needed */
+	int i;
+
+#ifdef GUESS_PARALLEL
+	int running = 0;
+
+	while (next < last || running) {
+		pid_t pid;
+		int status;
+
+		while (running < max_jobs && next < last) {
+			if (max_jobs > 1 && start_candidate(&candidates[next], pathname, verbose)) {
+				running++;
 			}
-		}
-		else {
-			printf("%s: %s", pathname, machine->label);
-			if (success > 0) printf(" status: OK through %d frames", success);
 			else {
-				printf(" status: FAIL");
-				if (libatari800_error_code) {
-					printf(" (%s)", libatari800_error_message());
-				}
+				/* no parallelism wanted or possible: run it here */
+				run_candidate(&candidates[next], pathname, verbose);
+				if (first_only && candidates[next].frames > 0) last = next + 1;
 			}
-			if (cart_desc) {
-				printf(" (cart=%d '%s')", cart_desc->type, cart_desc->label);
-			}
-			printf("\n");
+			next++;
 		}
-		if (!cart_desc || (cart_kb < 0)) break;
-		if (cart_desc) {
-			cart_desc++;
-			if (cart_desc->size != cart_kb) cart_desc = NULL;
+		if (!running) break;
+
+		pid = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		for (i = 0; i < next; i++) {
+			candidate_t *c = &candidates[i];
+			if (c->status != CANDIDATE_RUNNING || c->pid != pid) continue;
+			finish_candidate(c);
+			running--;
+			if (first_only && c->frames > 0 && i < last) {
+				int j;
+				last = i + 1;
+				/* later permutations are not needed any more */
+				for (j = last; j < next; j++) {
+					if (candidates[j].status == CANDIDATE_RUNNING) kill(candidates[j].pid, SIGKILL);
+				}
+			}
+			break;
 		}
 	}
-	return any_success;
+#else
+	while (next < last) {
+		run_candidate(&candidates[next], pathname, verbose);
+		if (first_only && candidates[next].frames > 0) last = next + 1;
+		next++;
+	}
+#endif /* GUESS_PARALLEL */
+
+	/* candidates never started, or no longer needed */
+	for (i = last; i < num; i++) candidates[i].status = CANDIDATE_SKIPPED;
 }
 
 #define CHUNK_SIZE 1024
 #define INVALID_FILE_SIZE 999999
 
+/* A cartridge image may well start with $FF $FF, so only treat it as an
+   executable if the first segment header also makes sense. A run of $FF
+   bytes from an erased bank gives a segment at $FFFF, which no real
+   executable loads first. */
+static int is_xex_header(const UBYTE *header, size_t total_len) {
+	unsigned int start, end;
+
+	if (header[0] != 0xff || header[1] != 0xff) {
+		return FALSE;
+	}
+	start = header[2] | (header[3] << 8);
+	end = header[4] | (header[5] << 8);
+	return start != 0xffff && end >= start && 6 + (end - start + 1) <= total_len;
+}
+
 /* Scan the file pointed to by pathname as a candidate for a cartridge.
-   Return size in KB if a valid cart size, 0 if invalid cart size, or <0 for
-   a cart type identified by the cart header.
+   Return size in KB if a valid cart size, 0 if invalid cart size or the file
+   starts with the header of another image type, or <0 for a cart type
+   identified by the cart header.
 */
 int guess_cart_kb(char *pathname, int verbose) {
 	char buf[CHUNK_SIZE];
-	char header[16];
+	UBYTE header[16];
 	FILE *fp = fopen(pathname, "rb");
 	size_t current_len, total_len = 0;
 	int kb, cart_type;
@@ -347,6 +523,7 @@ int guess_cart_kb(char *pathname, int verbose) {
 		}
 		total_len += current_len;
 	} while (current_len == CHUNK_SIZE);
+	fclose(fp);
 	if (total_len == 0) {
 		return INVALID_FILE_SIZE;
 	}
@@ -362,12 +539,18 @@ int guess_cart_kb(char *pathname, int verbose) {
 			}
 			cart_desc++;
 		}
-		if (verbose > 1) printf("%s: possible cartridge; size=%dkb\n", pathname, kb);
+		/* Executables and ATR images often have a size that's a multiple of
+		   1 KB too; trying them with every cart type of that size is just a
+		   waste of time. */
+		if (is_xex_header(header, total_len) || (header[0] == 0x96 && header[1] == 0x02)) {
+			found = FALSE;
+		}
+		else if (verbose > 1) printf("%s: possible cartridge; size=%dkb\n", pathname, kb);
 	}
 	else if (total_len == (kb * 1024) + 16) {
 		/* possible .car file */
 		if (header[0] == 0x43 && header[1] == 0x41 && header[2] == 0x52 && header[3] == 0x54) {
-			cart_type = header[7];
+			cart_type = (header[4] << 24) | (header[5] << 16) | (header[6] << 8) | header[7];
 			if (verbose > 1) printf("%s: cart type %d; size=%dkb\n", pathname, cart_type, kb);
 			kb = -cart_type;
 			found = TRUE;
@@ -381,9 +564,6 @@ int guess_cart_kb(char *pathname, int verbose) {
 }
 
 int main(int argc, char **argv) {
-	input_template_t input;
-	libatari800_clear_input_array(&input);
-
 	/* one time init stuff */
 	int verbose = 1;
 	int machine_flag = MACHINE_TYPE_ALL;
@@ -393,6 +573,13 @@ int main(int argc, char **argv) {
 	int video_flag = MACHINE_VIDEO_ALL;
 	int video_flag_encountered = FALSE;
 	int num_frames = 1000;
+	int max_jobs = 1;
+	int first_only = FALSE;
+
+#if defined(GUESS_PARALLEL) && defined(HAVE_SYSCONF) && defined(_SC_NPROCESSORS_ONLN)
+	max_jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (max_jobs < 1) max_jobs = 1;
+#endif
 
 	int i;
 	for (i=1; i<argc; i++) {
@@ -409,6 +596,13 @@ int main(int argc, char **argv) {
 			else if (strcmp(argv[i], "-s") == 0) {
 				verbose = 0;
 			}
+			else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+				max_jobs = atoi(argv[++i]);
+				if (max_jobs < 1) max_jobs = 1;
+			}
+			else if (strcmp(argv[i], "-first") == 0) {
+				first_only = TRUE;
+			}
 			else if (strcmp(argv[i], "-800") == 0) {
 				if (!machine_flag_encountered) machine_flag = 0;
 				machine_flag |= MACHINE_TYPE_800;
@@ -456,20 +650,37 @@ int main(int argc, char **argv) {
 		else {
 			int successful_count = 0;
 			machine_config_t *machine = machine_config;
+			candidate_t *candidates;
+			int num_candidates = 0;
+			int j;
 			int cart_kb = guess_cart_kb(argv[i], verbose);
 			if (cart_kb == INVALID_FILE_SIZE) continue;
+
+			/* at most every cart type plus the plain file for each machine */
+			candidates = (candidate_t *)malloc(sizeof(machine_config) / sizeof(machine_config[0]) * (sizeof(cart_list_a8) / sizeof(cart_list_a8[0]) + 1) * sizeof(candidate_t));
+			if (!candidates) {
+				printf("%s: out of memory\n", argv[i]);
+				return 1;
+			}
 			while (machine->label) {
 				if (machine->type & machine_flag && machine->type & os_flag && machine->type & video_flag) {
 					if (verbose > 1) {
 						printf("trying %s\n", machine->label);
 					}
-					if (run_machine(machine, argv[i], num_frames, cart_kb, verbose)) successful_count++;
+					num_candidates = add_candidates(candidates, num_candidates, machine, num_frames, cart_kb);
 				}
 				else if (verbose > 1) {
 					printf("skipping %s\n", machine->label);
 				}
 				machine++;
 			}
+			run_candidates(candidates, num_candidates, argv[i], max_jobs, first_only, verbose);
+			for (j = 0; j < num_candidates; j++) {
+				if (candidates[j].status != CANDIDATE_DONE) continue;
+				print_candidate(&candidates[j], argv[i], verbose);
+				if (candidates[j].frames != 0) successful_count++;
+			}
+			free(candidates);
 			if (!successful_count && !verbose) printf("%s: FAIL\n", argv[i]);
 		}
 	}
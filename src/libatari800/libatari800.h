@@ -257,6 +257,26 @@ typedef struct {
     int Base_mult[4];
 } pokey_state_t;
 
+/* Decodings of watched memory, for watch_template_t.decoding */
+#define LIBATARI800_WATCH_BYTE 0 /* unsigned byte */
+#define LIBATARI800_WATCH_SBYTE 1 /* signed byte */
+#define LIBATARI800_WATCH_WORD 2 /* 16-bit word, low byte first */
+#define LIBATARI800_WATCH_WORD_BE 3 /* 16-bit word, high byte first */
+#define LIBATARI800_WATCH_BCD 4 /* packed BCD number of length bytes, most significant first */
+#define LIBATARI800_WATCH_BCD_LE 5 /* packed BCD number of length bytes, least significant first */
+
+/* watch_template_t.bank value for memory as seen by the CPU */
+#define LIBATARI800_WATCH_CPU -1
+
+#define LIBATARI800_MAX_WATCHES 256
+
+typedef struct {
+    UWORD address;
+    UBYTE decoding;
+    UBYTE length; /* 1-4, for BCD numbers only */
+    int bank; /* LIBATARI800_WATCH_CPU, or XE RAM bank (0 is base RAM) for 0x4000-0x7fff */
+} watch_template_t;
+
 extern int libatari800_error_code;
 #define LIBATARI800_UNIDENTIFIED_CART_TYPE 1
 #define LIBATARI800_CPU_CRASH 2
@@ -284,6 +304,16 @@ UBYTE *libatari800_get_main_memory_ptr();
 
 UBYTE *libatari800_get_screen_ptr();
 
+/* Pixel formats for libatari800_copy_screen */
+#define LIBATARI800_SCREEN_INDEXED 0 /* 1 byte: Atari colour index */
+#define LIBATARI800_SCREEN_GRAY 1 /* 1 byte: luminance */
+#define LIBATARI800_SCREEN_RGB24 2 /* 3 bytes: R, G, B */
+#define LIBATARI800_SCREEN_RGBA32 3 /* 4 bytes: R, G, B, 255 */
+/* Flag to OR with a non-indexed format to use Altirra artifacting */
+#define LIBATARI800_SCREEN_ARTIFACT 0x100
+
+int libatari800_copy_screen(UBYTE *dest, int format, int left, int top, int width, int height, int step);
+
 UBYTE *libatari800_get_sound_buffer();
 
 int libatari800_get_sound_buffer_len();
@@ -300,12 +330,21 @@ float libatari800_get_fps();
 
 int libatari800_get_frame_number();
 
+int libatari800_get_selftest_enabled();
+
+UWORD libatari800_get_antic_dlist();
+
 void libatari800_get_current_state(emulator_state_t *state);
 
 void libatari800_restore_state(emulator_state_t *state);
 
 void libatari800_exit();
 
+/* Memory watch functions */
+int libatari800_set_watches(const watch_template_t *watches, int count);
+const int *libatari800_get_watch_values(void);
+void libatari800_set_watch_callback(void (*callback)(int index, int old_value, int new_value));
+
 /* Disk management functions */
 int libatari800_mount_disk(int drive_num, const char *filename, int read_only);
 void libatari800_unmount_disk(int drive_num);
@@ -45,6 +45,9 @@
 #include "cartridge.h"
 #include "ui.h"
 #include "cfg.h"
+#ifdef SCREENSHOTS
+#include "frame_export.h"
+#endif
 #include "libatari800/main.h"
 #include "libatari800/init.h"
 #include "libatari800/input.h"
@@ -127,7 +130,11 @@ void LIBATARI800_Frame(void)
 	Devices_Frame();
 	INPUT_Frame();
 	GTIA_Frame();
+	CPU_SelectCore();
 	ANTIC_Frame(TRUE);
+#ifdef SCREENSHOTS
+	Frame_Export_Frame();
+#endif
 	INPUT_DrawMousePointer();
 	Screen_DrawAtariSpeed(Util_time());
 	Screen_DrawDiskLED();
@@ -0,0 +1,712 @@
+/*
+ * sap_render.c - render SAP music files to audio files without emulating
+ * the display
+ *
+ * Copyright (C) 2024 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/* Music players only need the 6502 and POKEY, so instead of running whole
+   frames through Atari800_Frame, this program runs the CPU a scanline at a
+   time with just the memory refresh cycles of ANTIC taken away, and calls
+   POKEY_Scanline for the timers. Nothing is drawn. The player routine
+   returns to a JMP to itself at the top of the stack page; while the CPU is
+   there, the scanlines are not emulated at all and only the sound is
+   generated, which is where nearly all of the time goes. */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(HAVE_FORK) && defined(HAVE_SYS_WAIT_H) && defined(HAVE_UNISTD_H)
+/* Files are rendered in parallel, each in a forked process */
+#define RENDER_PARALLEL
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "atari.h"
+#include "antic.h"
+#include "cpu.h"
+#include "file_export.h"
+#include "log.h"
+#include "memory.h"
+#include "pia.h"
+#include "pokey.h"
+#include "pokeysnd.h"
+#include "libatari800/cpu_crash.h"
+
+#ifdef AUDIO_RECORDING
+#include "codecs/audio.h"
+
+/* The routines return to a JMP to itself, above the part of the stack page
+   that they use. */
+#define STUB_ADDR 0x01fd
+#define STACK_START 0xfc
+
+/* The longest time the INIT routine may take, in frames */
+#define MAX_INIT_FRAMES 500
+
+#define DEFAULT_SECONDS 180
+
+/* An empty config file, so that the user's settings don't change the
+   machine and no config file messages are logged */
+#ifdef HAVE_WINDOWS_H
+#define EMPTY_CONFIG "NUL"
+#else
+#define EMPTY_CONFIG "/dev/null"
+#endif
+
+typedef struct {
+	char type;
+	int stereo;
+	int ntsc;
+	int songs;
+	int defsong;
+	int fastplay;
+	UWORD init;
+	UWORD player;
+	UWORD music;
+	int have_init;
+	int have_player;
+	int have_music;
+	double *durations;
+	/* the binary part: blocks of start and end address and the data */
+	UBYTE *data;
+	int data_len;
+} sap_t;
+
+/* One song of a file to be rendered */
+typedef struct {
+	char *pathname;
+	int song;
+	char *output;
+	int ok;
+#ifdef RENDER_PARALLEL
+	pid_t pid;
+	int running;
+#endif
+} job_t;
+
+static int engine_mz = -1;
+static int mz_quality = -1;
+static int sample_rate = 44100;
+static int bits16 = TRUE;
+static int quad = FALSE;
+static double seconds = 0;
+static int verbose = 1;
+
+static int parse_time(const char *s, double *result)
+{
+	int minutes;
+	double secs;
+	if (sscanf(s, "%d:%lf", &minutes, &secs) != 2 || minutes < 0 || secs < 0)
+		return FALSE;
+	*result = minutes * 60 + secs;
+	return TRUE;
+}
+
+static int parse_hex(const char *s, UWORD *result)
+{
+	unsigned int value;
+	if (sscanf(s, "%x", &value) != 1 || value > 0xffff)
+		return FALSE;
+	*result = (UWORD) value;
+	return TRUE;
+}
+
+static void free_sap(sap_t *sap)
+{
+	free(sap->durations);
+	free(sap->data);
+}
+
+/* Reads the header and the binary part of a SAP file. Returns FALSE and
+   prints why if the file can't be played. */
+static int load_sap(const char *pathname, sap_t *sap)
+{
+	FILE *fp;
+	UBYTE *buf;
+	long len;
+	long pos;
+	int times = 0;
+
+	memset(sap, 0, sizeof(*sap));
+	sap->songs = 1;
+	fp = fopen(pathname, "rb");
+	if (fp == NULL) {
+		perror(pathname);
+		return FALSE;
+	}
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	buf = (UBYTE *) malloc(len + 1);
+	if (buf == NULL || len < 0 || fread(buf, 1, len, fp) != (size_t) len) {
+		fprintf(stderr, "%s: read error\n", pathname);
+		fclose(fp);
+		free(buf);
+		return FALSE;
+	}
+	fclose(fp);
+	if (len < 5 || memcmp(buf, "SAP\r\n", 5) != 0) {
+		fprintf(stderr, "%s: not a SAP file\n", pathname);
+		free(buf);
+		return FALSE;
+	}
+
+	/* the header is lines of "TAG value" up to the $FF $FF of the binary part */
+	pos = 5;
+	while (pos + 1 < len && !(buf[pos] == 0xff && buf[pos + 1] == 0xff)) {
+		char line[256];
+		char *value;
+		int n = 0;
+		while (pos < len && buf[pos] != '\r' && buf[pos] != '\n') {
+			if (n < (int) sizeof(line) - 1)
+				line[n++] = (char) buf[pos];
+			pos++;
+		}
+		while (pos < len && (buf[pos] == '\r' || buf[pos] == '\n'))
+			pos++;
+		line[n] = '\0';
+		value = strchr(line, ' ');
+		if (value != NULL)
+			*value++ = '\0';
+		else
+			value = line + n;
+
+		if (strcmp(line, "TYPE") == 0)
+			sap->type = value[0];
+		else if (strcmp(line, "STEREO") == 0)
+			sap->stereo = TRUE;
+		else if (strcmp(line, "NTSC") == 0)
+			sap->ntsc = TRUE;
+		else if (strcmp(line, "SONGS") == 0) {
+			sap->songs = atoi(value);
+			if (sap->songs < 1 || sap->songs > 32)
+				sap->songs = 1;
+		}
+		else if (strcmp(line, "DEFSONG") == 0)
+			sap->defsong = atoi(value);
+		else if (strcmp(line, "FASTPLAY") == 0)
+			sap->fastplay = atoi(value);
+		else if (strcmp(line, "INIT") == 0)
+			sap->have_init = parse_hex(value, &sap->init);
+		else if (strcmp(line, "PLAYER") == 0)
+			sap->have_player = parse_hex(value, &sap->player);
+		else if (strcmp(line, "MUSIC") == 0)
+			sap->have_music = parse_hex(value, &sap->music);
+		else if (strcmp(line, "TIME") == 0) {
+			double t;
+			if (sap->durations == NULL)
+				sap->durations = (double *) calloc(32, sizeof(double));
+			if (sap->durations != NULL && times < 32 && parse_time(value, &t))
+				sap->durations[times] = t;
+			times++;
+		}
+	}
+	if (pos + 1 >= len) {
+		fprintf(stderr, "%s: no binary data\n", pathname);
+		free(sap->durations);
+		free(buf);
+		return FALSE;
+	}
+	sap->data = (UBYTE *) malloc(len - pos);
+	memcpy(sap->data, buf + pos, len - pos);
+	sap->data_len = (int) (len - pos);
+	free(buf);
+
+	if (sap->type != 'B' && sap->type != 'C') {
+		fprintf(stderr, "%s: TYPE %c is not supported, only B and C\n", pathname, sap->type ? sap->type : '?');
+		free_sap(sap);
+		return FALSE;
+	}
+	if (!sap->have_player || (sap->type == 'B' && !sap->have_init) || (sap->type == 'C' && !sap->have_music)) {
+		fprintf(stderr, "%s: missing player addresses\n", pathname);
+		free_sap(sap);
+		return FALSE;
+	}
+	if (sap->defsong < 0 || sap->defsong >= sap->songs)
+		sap->defsong = 0;
+	if (sap->fastplay <= 0)
+		sap->fastplay = sap->ntsc ? Atari800_TV_NTSC : Atari800_TV_PAL;
+	return TRUE;
+}
+
+/* Copies the blocks of the binary part to RAM. Returns FALSE if they are
+   corrupt. */
+static int copy_blocks(const sap_t *sap)
+{
+	const UBYTE *ptr = sap->data;
+	const UBYTE *end = sap->data + sap->data_len;
+
+	while (end - ptr >= 4) {
+		int start;
+		int last;
+		if (ptr[0] == 0xff && ptr[1] == 0xff) {
+			ptr += 2;
+			continue;
+		}
+		start = ptr[0] | (ptr[1] << 8);
+		last = ptr[2] | (ptr[3] << 8);
+		ptr += 4;
+		if (last < start || end - ptr < last - start + 1)
+			return FALSE;
+		for (; start <= last; start++) {
+			/* skip the I/O area */
+			if (start < 0xd000 || start >= 0xd800)
+				MEMORY_mem[start] = *ptr;
+			ptr++;
+		}
+	}
+	return ptr == end;
+}
+
+/* Sets up a 64K RAM machine: OS ROM and BASIC off, the JMP to itself the
+   routines return to, and the CPU waiting there. */
+static void setup_machine(void)
+{
+	MEMORY_HandlePORTB(0xfe, (UBYTE) (PIA_PORTB | PIA_PORTB_mask));
+	PIA_PORTB = 0xfe;
+	PIA_PORTB_mask = 0x00;
+	PIA_PBCTL = 0x3c;
+	memset(MEMORY_mem, 0, 0xd000);
+	memset(MEMORY_mem + 0xd800, 0, 0x10000 - 0xd800);
+
+	MEMORY_mem[STUB_ADDR] = 0x4c;
+	MEMORY_mem[STUB_ADDR + 1] = (UBYTE) STUB_ADDR;
+	MEMORY_mem[STUB_ADDR + 2] = (UBYTE) (STUB_ADDR >> 8);
+	CPU_regPC = STUB_ADDR;
+	CPU_regS = STACK_START;
+	CPU_regP = 0x34;
+	CPU_PutStatus();
+	CPU_IRQ = 0;
+	ANTIC_NMIEN = 0;
+	ANTIC_wsync_halt = 0;
+	ANTIC_xpos = 0;
+	ANTIC_ypos = 0;
+	CPU_SelectCore();
+}
+
+/* Starts a routine at ADDR that returns with RTS. */
+static void call_routine(UWORD addr, UBYTE a, UBYTE x, UBYTE y)
+{
+	CPU_regS = STACK_START;
+	MEMORY_mem[0x100 + CPU_regS--] = (UBYTE) ((STUB_ADDR - 1) >> 8);
+	MEMORY_mem[0x100 + CPU_regS--] = (UBYTE) (STUB_ADDR - 1);
+	CPU_regPC = addr;
+	CPU_regA = a;
+	CPU_regX = x;
+	CPU_regY = y;
+	CPU_regP = 0x34;
+	CPU_PutStatus();
+}
+
+#define ROUTINE_RUNNING (CPU_regPC != STUB_ADDR)
+
+static void run_scanline(void)
+{
+	if (ROUTINE_RUNNING) {
+		ANTIC_xpos += ANTIC_DMAR;
+		CPU_GO(ANTIC_LINE_C);
+		ANTIC_xpos -= ANTIC_LINE_C;
+	}
+	ANTIC_screenline_cpu_clock += ANTIC_LINE_C;
+	if (++ANTIC_ypos >= Atari800_tv_mode)
+		ANTIC_ypos = 0;
+	POKEY_Scanline();
+}
+
+/* Runs scanlines until the routine returns. The sound of the scanlines is
+   thrown away if the recording hasn't started yet. Returns FALSE if the
+   routine doesn't return in MAX_INIT_FRAMES. */
+static int run_routine(void)
+{
+	int lines = 0;
+	while (ROUTINE_RUNNING) {
+		if (lines >= MAX_INIT_FRAMES * Atari800_tv_mode)
+			return FALSE;
+		run_scanline();
+		if (++lines % Atari800_tv_mode == 0)
+			POKEYSND_UpdateProcessBuffer();
+	}
+	return TRUE;
+}
+
+static int init_song(const sap_t *sap, int song)
+{
+	if (sap->type == 'C') {
+		call_routine((UWORD) (sap->player + 3), 0x70, (UBYTE) sap->music, (UBYTE) (sap->music >> 8));
+		if (!run_routine())
+			return FALSE;
+		call_routine((UWORD) (sap->player + 3), 0x00, (UBYTE) song, 0);
+	}
+	else
+		call_routine(sap->init, (UBYTE) song, 0, 0);
+	return run_routine();
+}
+
+/* Renders the given number of frames, calling the player routine every
+   FASTPLAY scanlines; a call that is due while the previous one still runs
+   is made as soon as it returns. */
+static void play_frames(const sap_t *sap, long frames)
+{
+	UWORD play_addr = sap->type == 'C' ? (UWORD) (sap->player + 6) : sap->player;
+	int next_play = 0;
+	long frame;
+
+	for (frame = 0; frame < frames; frame++) {
+		int line;
+		for (line = 0; line < Atari800_tv_mode; line++) {
+			if (--next_play <= 0 && !ROUTINE_RUNNING) {
+				call_routine(play_addr, 0, 0, 0);
+				next_play += sap->fastplay;
+			}
+			run_scanline();
+		}
+		POKEYSND_UpdateProcessBuffer();
+	}
+}
+
+/* Renders one song of a file. Returns TRUE if the audio file was written. */
+static int render_song(job_t *job)
+{
+	sap_t sap;
+	char *args[16];
+	char rate_string[16];
+	int num_args = 0;
+	double song_seconds;
+	long frames;
+	clock_t start;
+	double elapsed;
+
+	if (!load_sap(job->pathname, &sap))
+		return FALSE;
+	if (job->song < 0)
+		job->song = sap.defsong;
+	if (job->song >= sap.songs) {
+		fprintf(stderr, "%s: there is no song %d\n", job->pathname, job->song);
+		free_sap(&sap);
+		return FALSE;
+	}
+	song_seconds = seconds;
+	if (song_seconds <= 0)
+		song_seconds = sap.durations != NULL && sap.durations[job->song] > 0 ? sap.durations[job->song] : DEFAULT_SECONDS;
+
+	args[num_args++] = "atari800";
+	args[num_args++] = "-config";
+	args[num_args++] = EMPTY_CONFIG;
+	args[num_args++] = "-xl";
+	args[num_args++] = "-xl-rev";
+	args[num_args++] = "altirra";
+	args[num_args++] = "-nobasic";
+	args[num_args++] = sap.ntsc ? "-ntsc" : "-pal";
+	args[num_args++] = "-sound";
+	args[num_args++] = "-dsprate";
+	sprintf(rate_string, "%d", sample_rate);
+	args[num_args++] = rate_string;
+	args[num_args++] = bits16 ? "-audio16" : "-audio8";
+#ifdef STEREO_SOUND
+	args[num_args++] = sap.stereo ? "-stereo" : "-nostereo";
+	args[num_args++] = sap.stereo && quad ? "-quad" : "-noquad";
+#endif
+	args[num_args] = NULL;
+	if (!libatari800_init(num_args, args)) {
+		fprintf(stderr, "%s: can't initialise the emulator\n", job->pathname);
+		free_sap(&sap);
+		return FALSE;
+	}
+
+	/* the POKEY engine */
+	if (engine_mz >= 0)
+		POKEYSND_enable_new_pokey = engine_mz;
+	if (mz_quality >= 0)
+		POKEYSND_SetMzQuality(mz_quality);
+	POKEYSND_DoInit();
+#ifdef CODECS_AUDIO_THREAD
+	/* the other jobs keep the other CPUs busy */
+	audio_param_thread = FALSE;
+#endif
+
+	setup_machine();
+	if (!copy_blocks(&sap)) {
+		fprintf(stderr, "%s: the binary part is corrupt\n", job->pathname);
+		free_sap(&sap);
+		return FALSE;
+	}
+
+#ifdef HAVE_SETJMP
+	if (setjmp(libatari800_cpu_crash)) {
+		fprintf(stderr, "%s: the player crashed at $%04X\n", job->pathname, CPU_regPC);
+		if (File_Export_IsRecording()) {
+			File_Export_StopRecording();
+			remove(job->output);
+		}
+		free_sap(&sap);
+		return FALSE;
+	}
+#endif
+	if (!init_song(&sap, job->song)) {
+		fprintf(stderr, "%s: the INIT routine doesn't return\n", job->pathname);
+		free_sap(&sap);
+		return FALSE;
+	}
+
+	if (!File_Export_StartRecording(job->output)) {
+		fprintf(stderr, "%s: %s\n", job->output, FILE_EXPORT_error_message ? FILE_EXPORT_error_message : "can't write");
+		free_sap(&sap);
+		return FALSE;
+	}
+	frames = (long) (song_seconds * (Atari800_tv_mode == Atari800_TV_PAL ? Atari800_FPS_PAL : Atari800_FPS_NTSC) + 0.5);
+	start = clock();
+	play_frames(&sap, frames);
+	if (!File_Export_StopRecording()) {
+		fprintf(stderr, "%s: %s\n", job->output, FILE_EXPORT_error_message ? FILE_EXPORT_error_message : "write error");
+		free_sap(&sap);
+		return FALSE;
+	}
+	elapsed = (double) (clock() - start) / CLOCKS_PER_SEC;
+	if (verbose) {
+		printf("%s: song %d, %d:%02d to %s", job->pathname, job->song,
+		       (int) song_seconds / 60, (int) song_seconds % 60, job->output);
+		if (elapsed > 0)
+			printf(" in %.2f s (%.0fx real time)", elapsed, song_seconds / elapsed);
+		printf("\n");
+	}
+	free_sap(&sap);
+	return TRUE;
+}
+
+/* Renders one song of a file and prints the emulator's log messages, or
+   drops them with -s. Returns TRUE if the audio file was written. */
+static int render(job_t *job)
+{
+	int result = render_song(job);
+#ifdef BUFFERED_LOG
+	if (verbose)
+		Log_flushlog();
+	else
+		*Log_buffer = '\0';
+#endif
+	return result;
+}
+
+/* Returns the name of the audio file for a song: the name of the SAP file
+   with the extension replaced, and the song number if there are more. */
+static char *output_name(const char *pathname, int song, int all_songs)
+{
+	const char *base = strrchr(pathname, '/');
+	const char *dot = strrchr(pathname, '.');
+	size_t len = strlen(pathname);
+	char *name;
+
+	if (dot != NULL && (base == NULL || dot > base))
+		len = dot - pathname;
+	name = (char *) malloc(len + 16);
+	memcpy(name, pathname, len);
+	if (all_songs)
+		sprintf(name + len, ".%d.wav", song);
+	else
+		strcpy(name + len, ".wav");
+	return name;
+}
+
+#ifdef RENDER_PARALLEL
+/* Runs the jobs in child processes, up to max_jobs at the same time. */
+static void run_jobs(job_t *jobs, int num, int max_jobs)
+{
+	int next = 0;
+	int running = 0;
+
+	while (next < num || running) {
+		pid_t pid;
+		int status;
+		int i;
+
+		while (running < max_jobs && next < num) {
+			job_t *job = &jobs[next++];
+			/* even one at a time, each song gets a fresh emulator, so the
+			   output doesn't depend on the songs rendered before */
+			fflush(stdout);
+			job->pid = fork();
+			if (job->pid == 0) {
+				int ok = render(job);
+				fflush(stdout);
+				_exit(ok ? 0 : 1);
+			}
+			if (job->pid > 0) {
+				job->running = TRUE;
+				running++;
+			}
+			else
+				job->ok = render(job);
+		}
+		if (!running)
+			break;
+
+		pid = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (i = 0; i < next; i++) {
+			if (jobs[i].running && jobs[i].pid == pid) {
+				jobs[i].running = FALSE;
+				jobs[i].ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+				running--;
+				break;
+			}
+		}
+	}
+}
+#else
+static void run_jobs(job_t *jobs, int num, int max_jobs)
+{
+	int i;
+	for (i = 0; i < num; i++)
+		jobs[i].ok = render(&jobs[i]);
+}
+#endif /* RENDER_PARALLEL */
+
+static void usage(void)
+{
+	printf("Usage: sap_render [options] file.sap...\n"
+	       "Renders SAP (TYPE B and C) music files to WAV files next to them.\n"
+	       "\t-engine mz|rf   POKEY sound engine: MZPOKEYSND (default) or Ron Fries'\n"
+	       "\t-quality <n>    Quality of the MZPOKEYSND engine (0-2)\n"
+	       "\t-rate <hz>      Sample rate (default 44100)\n"
+	       "\t-8bit           8-bit samples instead of 16-bit\n"
+	       "\t-quad           Four POKEYs (up to $D23F) for the STEREO files\n"
+	       "\t-time <m:ss>    Length of the songs, instead of their TIME or 3:00\n"
+	       "\t-song <n>       Render song n (from 0) instead of the default song\n"
+	       "\t-all            Render all songs, to file.<n>.wav\n"
+	       "\t-j <n>          Number of files rendered in parallel (default: CPUs)\n"
+	       "\t-s              Don't report the rendered files\n");
+}
+
+int main(int argc, char **argv)
+{
+	job_t *jobs;
+	int num_jobs = 0;
+	int max_jobs = 1;
+	int song = -1;
+	int all_songs = FALSE;
+	int failed = 0;
+	int i;
+
+#if defined(RENDER_PARALLEL) && defined(HAVE_SYSCONF) && defined(_SC_NPROCESSORS_ONLN)
+	max_jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (max_jobs < 1)
+		max_jobs = 1;
+#endif
+
+	jobs = (job_t *) calloc(argc * 32, sizeof(job_t));
+	if (jobs == NULL)
+		return 1;
+	for (i = 1; i < argc; i++) {
+		int i_a = i + 1 < argc;
+		if (strcmp(argv[i], "-engine") == 0 && i_a) {
+			i++;
+			if (strcmp(argv[i], "mz") == 0)
+				engine_mz = TRUE;
+			else if (strcmp(argv[i], "rf") == 0)
+				engine_mz = FALSE;
+			else {
+				usage();
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-quality") == 0 && i_a)
+			mz_quality = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-rate") == 0 && i_a)
+			sample_rate = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-8bit") == 0)
+			bits16 = FALSE;
+		else if (strcmp(argv[i], "-quad") == 0)
+			quad = TRUE;
+		else if (strcmp(argv[i], "-time") == 0 && i_a) {
+			if (!parse_time(argv[++i], &seconds))
+				seconds = atof(argv[i]);
+		}
+		else if (strcmp(argv[i], "-song") == 0 && i_a)
+			song = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-all") == 0)
+			all_songs = TRUE;
+		else if (strcmp(argv[i], "-j") == 0 && i_a) {
+			max_jobs = atoi(argv[++i]);
+			if (max_jobs < 1)
+				max_jobs = 1;
+		}
+		else if (strcmp(argv[i], "-s") == 0)
+			verbose = 0;
+		else if (argv[i][0] == '-') {
+			usage();
+			return argv[i][1] == 'h' ? 0 : 1;
+		}
+		else if (all_songs) {
+			sap_t sap;
+			int n;
+			if (!load_sap(argv[i], &sap)) {
+				failed++;
+				continue;
+			}
+			for (n = 0; n < sap.songs; n++) {
+				jobs[num_jobs].pathname = argv[i];
+				jobs[num_jobs].song = n;
+				jobs[num_jobs].output = output_name(argv[i], n, TRUE);
+				num_jobs++;
+			}
+			free_sap(&sap);
+		}
+		else {
+			jobs[num_jobs].pathname = argv[i];
+			jobs[num_jobs].song = song;
+			jobs[num_jobs].output = output_name(argv[i], song, FALSE);
+			num_jobs++;
+		}
+	}
+	if (num_jobs == 0 && failed == 0) {
+		usage();
+		return 1;
+	}
+
+	run_jobs(jobs, num_jobs, max_jobs);
+	for (i = 0; i < num_jobs; i++) {
+		if (!jobs[i].ok)
+			failed++;
+		free(jobs[i].output);
+	}
+	free(jobs);
+	return failed ? 1 : 0;
+}
+
+#else /* AUDIO_RECORDING */
+
+int main(int argc, char **argv)
+{
+	fprintf(stderr, "sap_render needs atari800 built with audio recording\n");
+	return 1;
+}
+
+#endif /* AUDIO_RECORDING */
@@ -0,0 +1,366 @@
+/* shm_server - runs libatari800 driven through POSIX shared memory, so that
+   one trainer process can step many emulator processes and read their
+   screen, sound and RAM without copying. See shm_server.h for the protocol.
+
+   With -bench <n> it starts n servers itself and steps them all in turns
+   with no input, reporting steps per second and the step latency.
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_SHM_OPEN) && defined(HAVE_SEMAPHORE_H) && defined(HAVE_SYS_MMAN_H) \
+	&& defined(HAVE_FORK) && defined(HAVE_SYS_WAIT_H) && defined(HAVE_UNISTD_H) \
+	&& defined(HAVE_GETTIMEOFDAY) && defined(HAVE_SEM_TIMEDWAIT)
+#define SHM_SERVER
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "libatari800.h"
+
+#ifdef SHM_SERVER
+#include "shm_server.h"
+
+#define DEFAULT_NAME "/atari800"
+#define DEFAULT_BENCH_STEPS 1000
+/* How long the benchmark sleeps on one server before checking the others
+   again, which is also the resolution of the other servers' latencies */
+#define BENCH_POLL_US 100
+/* How often a process waiting for its peer checks that the peer still runs */
+#define PEER_CHECK_US 100000
+
+char *emulator_args[64];
+int num_emulator_args = 0;
+
+/* Create the shared memory object NAME and map it. Returns NULL on error. */
+shm_server_t *create_shm(const char *name) {
+	shm_server_t *shm;
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+	if (fd < 0) {
+		perror(name);
+		return NULL;
+	}
+	if (ftruncate(fd, sizeof(shm_server_t)) < 0) {
+		perror(name);
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+	shm = (shm_server_t *)mmap(NULL, sizeof(shm_server_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED) {
+		perror(name);
+		shm_unlink(name);
+		return NULL;
+	}
+	shm->magic = SHM_SERVER_MAGIC;
+	shm->version = SHM_SERVER_VERSION;
+	shm->num_slots = SHM_SERVER_NUM_SLOTS;
+	shm->slot_size = sizeof(shm_server_slot_t);
+	shm->frames = 1;
+	shm->copy_flags = SHM_SERVER_COPY_ALL;
+	libatari800_clear_input_array(&shm->input);
+	if (sem_init(&shm->request, 1, 0) < 0 || sem_init(&shm->done, 1, 0) < 0) {
+		perror("sem_init");
+		munmap(shm, sizeof(shm_server_t));
+		shm_unlink(name);
+		return NULL;
+	}
+	return shm;
+}
+
+void wait_sem(sem_t *sem) {
+	while (sem_wait(sem) < 0 && errno == EINTR);
+}
+
+/* Wait until SEM is posted, at most TIMEOUT_US microseconds. Returns TRUE
+   if it was posted. */
+int timed_wait_sem(sem_t *sem, long timeout_us) {
+	struct timeval tv;
+	struct timespec ts;
+	long usec;
+
+	gettimeofday(&tv, NULL);
+	usec = tv.tv_usec + timeout_us;
+	ts.tv_sec = tv.tv_sec + usec / 1000000;
+	ts.tv_nsec = (usec % 1000000) * 1000;
+	while (sem_timedwait(sem, &ts) < 0) {
+		if (errno != EINTR)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* Returns TRUE, and reports it, if benchmark server I has exited. */
+int server_exited(pid_t pid, int i) {
+	int status;
+	if (waitpid(pid, &status, WNOHANG) != pid)
+		return FALSE;
+	fprintf(stderr, "shm_server: server %d exited unexpectedly\n", i);
+	return TRUE;
+}
+
+/* Run the emulator, executing commands from the client until told to quit.
+   With a non-zero PARENT, the client is the parent process with that ID,
+   and the server quits when it is gone. Returns the process exit code. */
+int serve(shm_server_t *shm, pid_t parent) {
+	int next_slot = 0;
+
+	if (!libatari800_init(num_emulator_args, emulator_args)) {
+		fprintf(stderr, "shm_server: %s\n", libatari800_error_message());
+		/* tell the client it won't be served */
+		shm->magic = 0;
+		sem_post(&shm->done);
+		return 1;
+	}
+	sem_post(&shm->done);
+	for (;;) {
+		shm_server_slot_t *slot;
+		int flags;
+		int i;
+
+		if (parent == 0)
+			wait_sem(&shm->request);
+		else {
+			while (!timed_wait_sem(&shm->request, PEER_CHECK_US)) {
+				if (getppid() != parent) {
+					libatari800_exit();
+					return 1;
+				}
+			}
+		}
+		if (shm->command == SHM_SERVER_CMD_QUIT)
+			break;
+		if (shm->command != SHM_SERVER_CMD_STEP) {
+			sem_post(&shm->done);
+			continue;
+		}
+
+		for (i = 0; i < (int)shm->frames; i++) {
+			if (!libatari800_next_frame(&shm->input))
+				break;
+		}
+		slot = &shm->slots[next_slot];
+		flags = shm->copy_flags;
+		slot->frame = libatari800_get_frame_number();
+		slot->error_code = libatari800_error_code;
+		if (flags & SHM_SERVER_COPY_SCREEN)
+			memcpy(slot->screen, libatari800_get_screen_ptr(), SHM_SERVER_SCREEN_SIZE);
+		slot->sound_len = 0;
+		if (flags & SHM_SERVER_COPY_SOUND) {
+			int len = libatari800_get_sound_buffer_len();
+			if (len > SHM_SERVER_SOUND_SIZE)
+				len = SHM_SERVER_SOUND_SIZE;
+			memcpy(slot->sound, libatari800_get_sound_buffer(), len);
+			slot->sound_len = len;
+		}
+		if (flags & SHM_SERVER_COPY_RAM)
+			memcpy(slot->ram, libatari800_get_main_memory_ptr(), SHM_SERVER_RAM_SIZE);
+		shm->slot = next_slot;
+		next_slot = (next_slot + 1) % SHM_SERVER_NUM_SLOTS;
+		sem_post(&shm->done);
+	}
+	libatari800_exit();
+	return 0;
+}
+
+double now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+/* Start NUM_SERVERS servers and step each NUM_STEPS times, all of them
+   concurrently in every round. */
+int bench(int num_servers, int num_steps, int frames) {
+	shm_server_t **shms = (shm_server_t **)calloc(num_servers, sizeof(shm_server_t *));
+	pid_t *pids = (pid_t *)calloc(num_servers, sizeof(pid_t));
+	double *posted = (double *)calloc(num_servers, sizeof(double));
+	int *pending = (int *)calloc(num_servers, sizeof(int));
+	double *latencies = (double *)malloc(sizeof(double) * num_servers * num_steps);
+	char name[64];
+	double start;
+	double elapsed;
+	int num_latencies = 0;
+	int num_pending;
+	int waited;
+	int result = 0;
+	int i;
+	int step;
+
+	if (!shms || !pids || !posted || !pending || !latencies) {
+		fprintf(stderr, "shm_server: out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < num_servers; i++) {
+		sprintf(name, "/atari800-bench-%d-%d", (int)getpid(), i);
+		shms[i] = create_shm(name);
+		if (!shms[i]) {
+			num_servers = i;
+			result = 1;
+			goto quit;
+		}
+		/* the servers don't need the name: it's unlinked right away */
+		shm_unlink(name);
+		shms[i]->frames = frames;
+		shms[i]->command = SHM_SERVER_CMD_STEP;
+		fflush(stdout);
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			perror("fork");
+			num_servers = i;
+			result = 1;
+			goto quit;
+		}
+		if (pids[i] == 0)
+			_exit(serve(shms[i], getppid()));
+	}
+	for (i = 0; i < num_servers && !result; i++) {
+		while (!timed_wait_sem(&shms[i]->done, PEER_CHECK_US)) {
+			if (server_exited(pids[i], i)) {
+				result = 1;
+				break;
+			}
+		}
+		if (shms[i]->magic != SHM_SERVER_MAGIC)
+			result = 1;
+	}
+	if (result)
+		goto quit;
+
+	start = now();
+	for (step = 0; step < num_steps; step++) {
+		for (i = 0; i < num_servers; i++) {
+			posted[i] = now();
+			pending[i] = TRUE;
+			sem_post(&shms[i]->request);
+		}
+		/* Check all servers after each wait, so that a latency ends about
+		   when that server is done rather than when the client gets round to
+		   waiting for it. In between, sleep on the oldest pending one. */
+		num_pending = num_servers;
+		waited = -1;
+		while (num_pending > 0) {
+			int oldest = -1;
+			for (i = 0; i < num_servers; i++) {
+				if (!pending[i])
+					continue;
+				if (i == waited || sem_trywait(&shms[i]->done) == 0) {
+					latencies[num_latencies++] = now() - posted[i];
+					pending[i] = FALSE;
+					num_pending--;
+				}
+				else if (oldest < 0)
+					oldest = i;
+			}
+			waited = -1;
+			if (oldest < 0)
+				break;
+			if (timed_wait_sem(&shms[oldest]->done, BENCH_POLL_US))
+				waited = oldest;
+			else if (server_exited(pids[oldest], oldest)) {
+				result = 1;
+				goto quit;
+			}
+		}
+	}
+	elapsed = now() - start;
+
+	qsort(latencies, num_latencies, sizeof(double), compare_doubles);
+	printf("%d servers, %d steps of %d frames: %.0f steps/s\n",
+		num_servers, num_steps, frames, num_latencies / elapsed);
+	printf("latency ms: p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+		latencies[num_latencies / 2] * 1e3,
+		latencies[num_latencies * 9 / 10] * 1e3,
+		latencies[num_latencies * 99 / 100] * 1e3,
+		latencies[num_latencies * 999 / 1000] * 1e3,
+		latencies[num_latencies - 1] * 1e3);
+
+quit:
+	for (i = 0; i < num_servers; i++) {
+		shms[i]->command = SHM_SERVER_CMD_QUIT;
+		sem_post(&shms[i]->request);
+	}
+	for (i = 0; i < num_servers; i++)
+		waitpid(pids[i], NULL, 0);
+	free(latencies);
+	free(pending);
+	free(posted);
+	free(pids);
+	free(shms);
+	return result;
+}
+
+int main(int argc, char **argv) {
+	char *name = DEFAULT_NAME;
+	int num_bench = 0;
+	int num_steps = DEFAULT_BENCH_STEPS;
+	int frames = 1;
+	int i;
+
+	emulator_args[num_emulator_args++] = "atari800";
+	for (i = 1; i < argc; i++) {
+		int available = i + 1 < argc;
+		if (strcmp(argv[i], "-shm") == 0 && available)
+			name = argv[++i];
+		else if (strcmp(argv[i], "-bench") == 0 && available)
+			num_bench = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-steps") == 0 && available)
+			num_steps = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-frames") == 0 && available)
+			frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-help") == 0) {
+			printf("Usage: %s [options] [atari800 options]\n", argv[0]);
+			printf("\t-shm <name>     Serve through shared memory object <name> (default %s)\n", DEFAULT_NAME);
+			printf("\t-bench <n>      Start <n> servers and report their speed and latency\n");
+			printf("\t-steps <n>      Steps per server in the benchmark (default %d)\n", DEFAULT_BENCH_STEPS);
+			printf("\t-frames <n>     Frames per step in the benchmark (default 1)\n");
+			return 0;
+		}
+		else if (num_emulator_args < (int)(sizeof(emulator_args) / sizeof(emulator_args[0])) - 1)
+			emulator_args[num_emulator_args++] = argv[i];
+	}
+	emulator_args[num_emulator_args] = NULL;
+
+	if (num_bench > 0) {
+		if (num_steps < 1 || frames < 1) {
+			fprintf(stderr, "%s: invalid benchmark parameters\n", argv[0]);
+			return 1;
+		}
+		return bench(num_bench, num_steps, frames);
+	}
+	else {
+		shm_server_t *shm = create_shm(name);
+		int result;
+		if (!shm)
+			return 1;
+		result = serve(shm, 0);
+		shm_unlink(name);
+		return result;
+	}
+}
+
+#else /* SHM_SERVER */
+
+int main(int argc, char **argv) {
+	fprintf(stderr, "%s: POSIX shared memory is not supported on this system\n", argv[0]);
+	return 1;
+}
+
+#endif /* SHM_SERVER */
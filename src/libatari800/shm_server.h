@@ -0,0 +1,62 @@
+#ifndef LIBATARI800_SHM_SERVER_H_
+#define LIBATARI800_SHM_SERVER_H_
+
+#include <semaphore.h>
+#include <stdint.h>
+
+#include "libatari800.h"
+
+/* Layout of the POSIX shared memory object through which shm_server is
+   driven. The server creates the object and posts DONE when the emulator
+   is ready (or, with MAGIC cleared, when it failed to start). For each step
+   the client fills in COMMAND, FRAMES, COPY_FLAGS and INPUT, posts REQUEST
+   and waits for DONE; the results are then in SLOTS[SLOT]. Results go to the
+   slots in turn, so the client may read the result of one step while the
+   server runs the next one. */
+
+#define SHM_SERVER_MAGIC 0x30303841 /* "A800" */
+#define SHM_SERVER_VERSION 1
+
+#define SHM_SERVER_NUM_SLOTS 2
+#define SHM_SERVER_SCREEN_SIZE (384 * 240)
+#define SHM_SERVER_SOUND_SIZE 16384
+#define SHM_SERVER_RAM_SIZE 65536
+
+/* Values of shm_server_t.command */
+#define SHM_SERVER_CMD_STEP 1 /* run FRAMES frames with INPUT */
+#define SHM_SERVER_CMD_QUIT 2 /* exit, removing the shared memory object */
+
+/* Bits of shm_server_t.copy_flags: which parts of the slot to fill */
+#define SHM_SERVER_COPY_SCREEN 1
+#define SHM_SERVER_COPY_SOUND 2
+#define SHM_SERVER_COPY_RAM 4
+#define SHM_SERVER_COPY_ALL 7
+
+typedef struct {
+	uint32_t frame; /* libatari800_get_frame_number() after the step */
+	int32_t error_code; /* libatari800_error_code after the step */
+	uint32_t sound_len; /* bytes of SOUND filled */
+	uint32_t reserved;
+	UBYTE screen[SHM_SERVER_SCREEN_SIZE];
+	UBYTE sound[SHM_SERVER_SOUND_SIZE];
+	UBYTE ram[SHM_SERVER_RAM_SIZE];
+} shm_server_slot_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num_slots;
+	uint32_t slot_size;
+	sem_t request;
+	sem_t done;
+	/* written by the client */
+	uint32_t command;
+	uint32_t frames;
+	uint32_t copy_flags;
+	input_template_t input;
+	/* written by the server */
+	uint32_t slot;
+	shm_server_slot_t slots[SHM_SERVER_NUM_SLOTS];
+} shm_server_t;
+
+#endif /* LIBATARI800_SHM_SERVER_H_ */
@@ -23,13 +23,33 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include "config.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "atari.h"
+#include "libatari800.h"
+#include "antic.h"
+#include "colours.h"
+#include "gtia.h"
 #include "platform.h"
 #include "screen.h"
+#include "util.h"
+#include "altirra_artifacting/artifacting_c.h"
 #include "libatari800/video.h"
 
+/* The screen is centred in the larger frame the artifacting engine works on. */
+#define ARTIF_PAD_X ((ATC_ARTIFACTING_N - Screen_WIDTH) / 2)
+#define ARTIF_PAD_Y ((ATC_ARTIFACTING_M - Screen_HEIGHT) / 2)
+/* The engine outputs two pixels per input pixel. */
+#define ARTIF_STRIDE (ATC_ARTIFACTING_N * 2)
+
+static ATC_ArtifactingEngine *artif_engine = NULL;
+static int artif_pal = -1;
+static UBYTE *artif_input = NULL;
+static uint32_t *artif_output = NULL;
+
 void PLATFORM_DisplayScreen(void){
 }
 
@@ -38,4 +58,159 @@ int LIBATARI800_Video_Initialise(int *argc, char *argv[]) {
 }
 
 void LIBATARI800_Video_Exit(void) {
+	if (artif_engine != NULL) {
+		atc_artifacting_destroy(artif_engine);
+		artif_engine = NULL;
+	}
+	free(artif_input);
+	artif_input = NULL;
+	free(artif_output);
+	artif_output = NULL;
+	artif_pal = -1;
+}
+
+/* Runs the current frame through the Altirra artifacting engine, leaving
+   0x00RRGGBB pixels in artif_output. */
+static void ArtifactScreen(void)
+{
+	int pal = Atari800_tv_mode == Atari800_TV_PAL;
+	const UBYTE *src = (const UBYTE *)Screen_atari;
+	int y;
+
+	if (artif_engine == NULL) {
+		artif_engine = atc_artifacting_create();
+		artif_input = (UBYTE *)Util_malloc(ATC_ARTIFACTING_N * ATC_ARTIFACTING_M);
+		artif_output = (uint32_t *)Util_malloc(sizeof(uint32_t) * ARTIF_STRIDE * ATC_ARTIFACTING_M);
+	}
+	if (pal != artif_pal) {
+		ATC_ColorParams color_params;
+		ATC_ArtifactingParams artifact_params;
+		if (pal)
+			atc_color_params_default_pal(&color_params);
+		else
+			atc_color_params_default_ntsc(&color_params);
+		atc_artifacting_params_default(&artifact_params);
+		atc_artifacting_set_color_params(artif_engine, &color_params, NULL, NULL, ATC_MONITOR_COLOR, 0);
+		atc_artifacting_set_artifacting_params(artif_engine, &artifact_params);
+		artif_pal = pal;
+	}
+
+	memset(artif_input, GTIA_COLBK, ATC_ARTIFACTING_N * ATC_ARTIFACTING_M);
+	for (y = 0; y < Screen_HEIGHT; y++)
+		memcpy(artif_input + (ARTIF_PAD_Y + y) * ATC_ARTIFACTING_N + ARTIF_PAD_X,
+		       src + y * Screen_WIDTH, Screen_WIDTH);
+
+	/* PAL decoding keeps a delay line, so all lines must be processed in order. */
+	atc_artifacting_begin_frame(artif_engine, pal, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+	for (y = 0; y < ATC_ARTIFACTING_M; y++) {
+		int line = y - ARTIF_PAD_Y;
+		int hires = line >= 0 && line < Screen_HEIGHT && ANTIC_scanline_hires[line] != 0;
+		atc_artifacting_artifact8(artif_engine, (uint32_t)y, artif_output + y * ARTIF_STRIDE,
+		                          artif_input + y * ATC_ARTIFACTING_N, hires, 0, 1);
+	}
+}
+
+/* Stores the pixel RGB (0x00RRGGBB) in the 4-byte palette entry ENTRY
+   in the layout of FORMAT. */
+static void SetEntry(UBYTE *entry, int format, int rgb)
+{
+	int r = (rgb >> 16) & 0xff;
+	int g = (rgb >> 8) & 0xff;
+	int b = rgb & 0xff;
+	if (format == LIBATARI800_SCREEN_GRAY)
+		/* ITU-R BT.601 luma */
+		entry[0] = (UBYTE)((r * 77 + g * 150 + b * 29) >> 8);
+	else {
+		entry[0] = (UBYTE)r;
+		entry[1] = (UBYTE)g;
+		entry[2] = (UBYTE)b;
+		entry[3] = 0xff;
+	}
+}
+
+int LIBATARI800_Video_CopyScreen(UBYTE *dest, int format, int left, int top, int width, int height, int step)
+{
+	int artifact = (format & LIBATARI800_SCREEN_ARTIFACT) != 0;
+	int bpp;
+	int out_width;
+	int out_height;
+	int x;
+	int y;
+	/* Output bytes of each Atari colour. */
+	UBYTE palette[256][4];
+
+	format &= ~LIBATARI800_SCREEN_ARTIFACT;
+	switch (format) {
+	case LIBATARI800_SCREEN_INDEXED:
+		if (artifact)
+			return 0;
+		/* FALLTHROUGH */
+	case LIBATARI800_SCREEN_GRAY:
+		bpp = 1;
+		break;
+	case LIBATARI800_SCREEN_RGB24:
+		bpp = 3;
+		break;
+	case LIBATARI800_SCREEN_RGBA32:
+		bpp = 4;
+		break;
+	default:
+		return 0;
+	}
+	if (dest == NULL || step < 1 || left < 0 || top < 0 || width < step || height < step
+	 || left + width > Screen_WIDTH || top + height > Screen_HEIGHT)
+		return 0;
+	out_width = width / step;
+	out_height = height / step;
+
+	if (artifact)
+		ArtifactScreen();
+	else if (format == LIBATARI800_SCREEN_INDEXED) {
+		for (x = 0; x < 256; x++)
+			palette[x][0] = (UBYTE)x;
+	}
+	else {
+		for (x = 0; x < 256; x++)
+			SetEntry(palette[x], format, Colours_table[x]);
+	}
+
+	for (y = 0; y < out_height; y++) {
+		const UBYTE *src = (const UBYTE *)Screen_atari + (top + y * step) * Screen_WIDTH + left;
+		if (artifact) {
+			/* The engine dominates the cost here, so convert pixel by pixel,
+			   averaging the two engine pixels of each Atari pixel. */
+			const uint32_t *line = artif_output + (ARTIF_PAD_Y + top + y * step) * ARTIF_STRIDE
+			                       + (ARTIF_PAD_X + left) * 2;
+			for (x = 0; x < out_width; x++) {
+				uint32_t c1 = line[x * step * 2];
+				uint32_t c2 = line[x * step * 2 + 1];
+				SetEntry(palette[0], format, (int)(((c1 & 0xfefefe) >> 1) + ((c2 & 0xfefefe) >> 1)));
+				memcpy(dest, palette[0], bpp);
+				dest += bpp;
+			}
+			continue;
+		}
+		switch (bpp) {
+		case 1:
+			for (x = 0; x < out_width; x++)
+				*dest++ = palette[src[x * step]][0];
+			break;
+		case 3:
+			for (x = 0; x < out_width; x++) {
+				const UBYTE *p = palette[src[x * step]];
+				dest[0] = p[0];
+				dest[1] = p[1];
+				dest[2] = p[2];
+				dest += 3;
+			}
+			break;
+		default:
+			for (x = 0; x < out_width; x++) {
+				memcpy(dest, palette[src[x * step]], 4);
+				dest += 4;
+			}
+			break;
+		}
+	}
+	return out_width * out_height * bpp;
 }
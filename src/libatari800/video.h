@@ -4,8 +4,10 @@
 #include <stdio.h>
 
 #include "config.h"
+#include "atari.h"
 
 int LIBATARI800_Video_Initialise(int *argc, char *argv[]);
 void LIBATARI800_Video_Exit(void);
+int LIBATARI800_Video_CopyScreen(UBYTE *dest, int format, int left, int top, int width, int height, int step);
 
 #endif /* LIBATARI800_VIDEO_H_ */
@@ -0,0 +1,121 @@
+/*
+ * libatari800/watch.c - Atari800 as a library - watched memory locations
+ *
+ * Copyright (C) 2024 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libatari800/watch.h"
+#include "memory.h"
+
+static watch_template_t watches[LIBATARI800_MAX_WATCHES];
+static int values[LIBATARI800_MAX_WATCHES];
+static int num_watches = 0;
+
+void (*LIBATARI800_Watch_callback)(int index, int old_value, int new_value) = NULL;
+
+static int WatchSize(const watch_template_t *w)
+{
+	switch (w->decoding) {
+	case LIBATARI800_WATCH_WORD:
+	case LIBATARI800_WATCH_WORD_BE:
+		return 2;
+	case LIBATARI800_WATCH_BCD:
+	case LIBATARI800_WATCH_BCD_LE:
+		return w->length;
+	default:
+		return 1;
+	}
+}
+
+static UBYTE WatchByte(const watch_template_t *w, int offset)
+{
+	UWORD addr = (UWORD)(w->address + offset);
+	if (w->bank == LIBATARI800_WATCH_CPU)
+		return MEMORY_SafeGetByte(addr);
+	return MEMORY_GetXEByte(w->bank, addr);
+}
+
+static int WatchValue(const watch_template_t *w)
+{
+	int value = 0;
+	int i;
+	switch (w->decoding) {
+	case LIBATARI800_WATCH_SBYTE:
+		return (signed char)WatchByte(w, 0);
+	case LIBATARI800_WATCH_WORD:
+		return WatchByte(w, 0) | (WatchByte(w, 1) << 8);
+	case LIBATARI800_WATCH_WORD_BE:
+		return (WatchByte(w, 0) << 8) | WatchByte(w, 1);
+	case LIBATARI800_WATCH_BCD:
+	case LIBATARI800_WATCH_BCD_LE:
+		for (i = 0; i < w->length; i++) {
+			UBYTE b = WatchByte(w, w->decoding == LIBATARI800_WATCH_BCD ? i : w->length - 1 - i);
+			value = value * 100 + (b >> 4) * 10 + (b & 0x0f);
+		}
+		return value;
+	default:
+		return WatchByte(w, 0);
+	}
+}
+
+int LIBATARI800_Watch_Set(const watch_template_t *list, int count)
+{
+	int i;
+	if (count < 0 || count > LIBATARI800_MAX_WATCHES || (count > 0 && list == NULL))
+		return FALSE;
+	for (i = 0; i < count; i++) {
+		const watch_template_t *w = list + i;
+		if (w->decoding > LIBATARI800_WATCH_BCD_LE)
+			return FALSE;
+		if ((w->decoding == LIBATARI800_WATCH_BCD || w->decoding == LIBATARI800_WATCH_BCD_LE)
+		    && (w->length < 1 || w->length > 4))
+			return FALSE;
+		if (w->bank != LIBATARI800_WATCH_CPU
+		    && (w->bank < 0 || w->address < 0x4000 || w->address + WatchSize(w) > 0x8000))
+			return FALSE;
+	}
+	if (count > 0)
+		memcpy(watches, list, count * sizeof(watch_template_t));
+	num_watches = count;
+	LIBATARI800_Watch_Update(FALSE);
+	return TRUE;
+}
+
+void LIBATARI800_Watch_Update(int notify)
+{
+	int i;
+	for (i = 0; i < num_watches; i++) {
+		int value = WatchValue(watches + i);
+		if (value != values[i]) {
+			int old_value = values[i];
+			values[i] = value;
+			if (notify && LIBATARI800_Watch_callback != NULL)
+				LIBATARI800_Watch_callback(i, old_value, value);
+		}
+	}
+}
+
+const int *LIBATARI800_Watch_GetValues(void)
+{
+	return values;
+}
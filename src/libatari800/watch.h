@@ -0,0 +1,18 @@
+#ifndef LIBATARI800_WATCH_H_
+#define LIBATARI800_WATCH_H_
+
+#include "config.h"
+#include "atari.h"
+#include "libatari800/libatari800.h"
+
+extern void (*LIBATARI800_Watch_callback)(int index, int old_value, int new_value);
+
+/* Replaces the watch list with COUNT entries of LIST and reads their values.
+   Returns FALSE, keeping the old list, if an entry is invalid. */
+int LIBATARI800_Watch_Set(const watch_template_t *list, int count);
+/* Reads the watched values; if NOTIFY, calls LIBATARI800_Watch_callback for
+   each one that has changed. */
+void LIBATARI800_Watch_Update(int notify);
+const int *LIBATARI800_Watch_GetValues(void);
+
+#endif /* LIBATARI800_WATCH_H_ */
@@ -1057,6 +1057,29 @@ void MEMORY_CartA0bfEnable(void)
 	}
 }
 
+UBYTE MEMORY_GetXEByte(int bank, UWORD addr)
+{
+	UBYTE portb;
+	int cpu_bank;
+	int in_selftest = addr >= 0x5000 && addr < 0x5800;
+
+	if (addr < 0x4000 || addr >= 0x8000 || bank < 0
+	    || (bank > 0 && ((ULONG)bank + 1) << 14 > atarixe_memory_size))
+		return 0xff;
+	portb = PIA_PORTB | PIA_PORTB_mask;
+	cpu_bank = (portb & 0x10) ? 0 : MEMORY_xe_bank;
+	if (bank == cpu_bank) {
+		/* RAM under Self Test or MapRAM */
+		if (in_selftest && (MEMORY_selftest_enabled
+		                    || (mapram_memory != NULL && (portb & 0xb1) == 0x30)))
+			return under_atarixl_os[addr - 0x4000];
+		return MEMORY_mem[addr];
+	}
+	if (in_selftest && MEMORY_selftest_enabled && ANTIC_xe_ptr == atarixe_memory + (bank << 14))
+		return antic_bank_under_selftest[addr - 0x5000];
+	return atarixe_memory[(bank << 14) + addr - 0x4000];
+}
+
 void MEMORY_GetCharset(UBYTE *cs)
 {
 	/* copy font, but change screencode order to ATASCII order */
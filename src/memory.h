@@ -119,6 +119,11 @@ void MEMORY_CartA0bfEnable(void);
 #define MEMORY_CopyFromCart(addr1, addr2, src) memcpy(MEMORY_mem + (addr1), src, (addr2) - (addr1) + 1)
 #define MEMORY_CopyToCart(addr1, addr2, dst) memcpy(dst, MEMORY_mem + (addr1), (addr2) - (addr1) + 1)
 void MEMORY_GetCharset(UBYTE *cs);
+/* Reads the byte at ADDR (0x4000-0x7fff) of XE extended RAM bank BANK
+   (0 is base RAM, 1.. as in MEMORY_xe_bank), whether or not the bank is
+   currently visible to the CPU, without side effects. Returns 0xff if there
+   is no such bank. */
+UBYTE MEMORY_GetXEByte(int bank, UWORD addr);
 
 /* Mosaic and Axlon 400/800 RAM extensions */
 extern int MEMORY_mosaic_num_banks;
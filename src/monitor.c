@@ -1538,10 +1538,23 @@ static void monitor_break_PC(void)
 	}
 }
 
+#ifdef CPU_MONITOR_CORE
+/* The fast core doesn't record the history, see CPU_SelectCore(). */
+static void warn_history_off(void)
+{
+	if (CPU_GO != CPU_GO_monitor)
+		printf("History recording is off, so this may be stale. "
+		       "Start with -monitor-hooks to turn it on.\n");
+}
+#else
+#define warn_history_off()
+#endif
+
 /* Displays last 64 executed instructions. */
 static void show_history(void)
 {
 	int i;
+	warn_history_off();
 	for (i = 0; i < CPU_REMEMBER_PC_STEPS; i++) {
 		int j;
 		int k;
@@ -1564,6 +1577,7 @@ static void show_history(void)
 static void show_last_jumps(void)
 {
 	int i;
+	warn_history_off();
 	for (i = 0; i < CPU_REMEMBER_JMP_STEPS; i++)
 		show_instruction(stdout, CPU_remember_JMP[(CPU_remember_jmp_curpos + i) % CPU_REMEMBER_JMP_STEPS]);
 }
@@ -2933,11 +2947,15 @@ static void show_POKEY(void)
 	printf("SKSTAT=%02X    SKCTL= %02X\n", POKEY_SKSTAT, POKEY_SKCTL);
 #ifdef STEREO_SOUND
 	if (POKEYSND_stereo_enabled) {
-		printf("Second chip:\n");
-		printf("AUDF1= %02X    AUDF2= %02X    AUDF3= %02X    AUDF4= %02X    AUDCTL=%02X\n",
-			   POKEY_AUDF[POKEY_CHAN1 + POKEY_CHIP2], POKEY_AUDF[POKEY_CHAN2 + POKEY_CHIP2], POKEY_AUDF[POKEY_CHAN3 + POKEY_CHIP2], POKEY_AUDF[POKEY_CHAN4 + POKEY_CHIP2], POKEY_AUDCTL[1]);
-		printf("AUDC1= %02X    AUDC2= %02X    AUDC3= %02X    AUDC4= %02X\n",
-			   POKEY_AUDC[POKEY_CHAN1 + POKEY_CHIP2], POKEY_AUDC[POKEY_CHAN2 + POKEY_CHIP2], POKEY_AUDC[POKEY_CHAN3 + POKEY_CHIP2], POKEY_AUDC[POKEY_CHAN4 + POKEY_CHIP2]);
+		static const char * const chip_names[] = { "Second", "Third", "Fourth" };
+		int chip;
+		for (chip = 1; chip < (POKEYSND_quad_enabled ? 4 : 2); chip++) {
+			printf("%s chip:\n", chip_names[chip - 1]);
+			printf("AUDF1= %02X    AUDF2= %02X    AUDF3= %02X    AUDF4= %02X    AUDCTL=%02X\n",
+				   POKEY_AUDF[POKEY_CHAN1 + chip * 4], POKEY_AUDF[POKEY_CHAN2 + chip * 4], POKEY_AUDF[POKEY_CHAN3 + chip * 4], POKEY_AUDF[POKEY_CHAN4 + chip * 4], POKEY_AUDCTL[chip]);
+			printf("AUDC1= %02X    AUDC2= %02X    AUDC3= %02X    AUDC4= %02X\n",
+				   POKEY_AUDC[POKEY_CHAN1 + chip * 4], POKEY_AUDC[POKEY_CHAN2 + chip * 4], POKEY_AUDC[POKEY_CHAN3 + chip * 4], POKEY_AUDC[POKEY_CHAN4 + chip * 4]);
+		}
 	}
 #endif
 }
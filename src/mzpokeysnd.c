@@ -24,7 +24,11 @@
 
 #include "config.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#if defined(DEBUG) || defined(MZPOKEYSND_DUMP_FILTERS)
+#include <stdio.h>
+#endif
 
 #ifdef ASAP /* external project, see http://asap.sf.net */
 #include "asap_internal.h"
@@ -61,7 +65,7 @@ static const double pokeymix[61+CONSOLE_VOL] = { /* Nonlinear POKEY mixing array
 
 #define SND_FILTER_SIZE  2048
 
-#define NPOKEYS 2
+#define NPOKEYS POKEY_MAXPOKEYS
 
 
 /* M_PI was not defined in MSVC headers */
@@ -69,7 +73,7 @@ static const double pokeymix[61+CONSOLE_VOL] = { /* Nonlinear POKEY mixing array
 # define M_PI 3.141592653589793
 #endif
 
-static int num_cur_pokeys = 0;
+static int num_channels = 0;
 
 /* Filter */
 static int pokey_frq; /* Hz - for easier resampling */
@@ -99,6 +103,7 @@ static int poly4tbl[15];
 static int poly5tbl[31];
 static unsigned char poly17tbl[131071];
 static int poly9tbl[511];
+static int polies_built = 0;
 
 
 struct stPokeyState;
@@ -110,7 +115,7 @@ typedef void (*event_t)(struct stPokeyState* ps, int p5v, int p4v, int p917v);
 /* Change queue event value type */
 typedef double qev_t;
 #else
-typedef unsigned char qev_t;
+typedef int qev_t;
 #endif
 
 static double ticks_per_sample;
@@ -119,19 +124,12 @@ static double samp_pos;
 /* State variables for single Pokey Chip */
 typedef struct stPokeyState
 {
-    int curtick;
     /* Poly positions */
     int poly4pos;
     int poly5pos;
     int poly17pos;
     int poly9pos;
-
-    /* Change queue */
-    qev_t ovola;
-    int qet[1322]; /* maximal length of filter */
-    qev_t qev[1322];
-    int qebeg;
-    int qeend;
+    int polyticks; /* ticks not added to the positions yet */
 
     /* Main divider (64khz/15khz) */
     int mdivk;    /* 28 for 64khz, 114 for 15khz */
@@ -264,6 +262,29 @@ typedef struct stPokeyState
 
 PokeyState pokey_states[NPOKEYS];
 
+/* State of an output channel. The chips heard on the channel share its
+   change queue: the filter is linear, so it runs once on the sum of their
+   outputs instead of once for each chip. */
+typedef struct stMixState
+{
+    int curtick;
+
+    /* Change queue */
+    qev_t ovola;
+    int qet[1322]; /* maximal length of filter */
+    qev_t qev[1322];
+    int qebeg;
+    int qeend;
+
+    /* Sum of the outputs of the chips */
+    qev_t outvol_all;
+
+    int num_chips;
+    PokeyState* chips[NPOKEYS];
+} MixState;
+
+static MixState mix_states[NPOKEYS];
+
 static struct {
     double s16;
     double s8;
@@ -290,11 +311,7 @@ static void ResetPokeyState(PokeyState* ps)
     ps->poly5pos = 0;
     ps->poly9pos = 0;
     ps->poly17pos = 0;
-
-    /* Change queue */
-    ps->ovola = 0;
-    ps->qebeg = 0;
-    ps->qeend = 0;
+    ps->polyticks = 0;
 
     /* Global Pokey controls */
     ps->mdivk = 28;
@@ -420,28 +437,38 @@ static void ResetPokeyState(PokeyState* ps)
     ps->speaker = 0;
 }
 
+static void ResetMixState(MixState* ms)
+{
+    /* Change queue */
+    ms->ovola = 0;
+    ms->qebeg = 0;
+    ms->qeend = 0;
 
-static double read_resam_all(PokeyState* ps)
+    ms->outvol_all = 0;
+}
+
+
+static double read_resam_all(MixState* ms)
 {
-    int i = ps->qebeg;
+    int i = ms->qebeg;
     qev_t avol,bvol;
     double sum;
 
-    if(ps->qebeg == ps->qeend)
+    if(ms->qebeg == ms->qeend)
     {
-        return ps->ovola * filter_data[0]; /* if no events in the queue */
+        return ms->ovola * filter_data[0]; /* if no events in the queue */
     }
 
-    avol = ps->ovola;
+    avol = ms->ovola;
     sum = 0;
 
     /* Separate two loop cases, for wrap-around and without */
-    if(ps->qeend < ps->qebeg) /* With wrap */
+    if(ms->qeend < ms->qebeg) /* With wrap */
     {
         while(i<filter_size)
         {
-            bvol = ps->qev[i];
-            sum += (avol-bvol)*filter_data[ps->curtick - ps->qet[i]];
+            bvol = ms->qev[i];
+            sum += (avol-bvol)*filter_data[ms->curtick - ms->qet[i]];
             avol = bvol;
             ++i;
         }
@@ -449,10 +476,10 @@ static double read_resam_all(PokeyState* ps)
     }
 
     /* without wrap */
-    while(i<ps->qeend)
+    while(i<ms->qeend)
     {
-        bvol = ps->qev[i];
-        sum += (avol-bvol)*filter_data[ps->curtick - ps->qet[i]];
+        bvol = ms->qev[i];
+        sum += (avol-bvol)*filter_data[ms->curtick - ms->qet[i]];
         avol = bvol;
         ++i;
     }
@@ -473,27 +500,27 @@ static double interp_filter_data(int pos, double frac)
 /* returns the filtered output sample value using an interpolated filter */
 /* frac is the fractional distance of the output sample point between
  * input sample values */
-static double interp_read_resam_all(PokeyState* ps, double frac)
+static double interp_read_resam_all(MixState* ms, double frac)
 {
-    int i = ps->qebeg;
+    int i = ms->qebeg;
     qev_t avol,bvol;
     double sum;
 
-    if (ps->qebeg == ps->qeend)
+    if (ms->qebeg == ms->qeend)
     {
-        return ps->ovola * interp_filter_data(0,frac); /* if no events in the queue */
+        return ms->ovola * interp_filter_data(0,frac); /* if no events in the queue */
     }
 
-    avol = ps->ovola;
+    avol = ms->ovola;
     sum = 0;
 
     /* Separate two loop cases, for wrap-around and without */
-    if (ps->qeend < ps->qebeg) /* With wrap */
+    if (ms->qeend < ms->qebeg) /* With wrap */
     {
         while (i < filter_size)
         {
-            bvol = ps->qev[i];
-            sum += (avol-bvol)*interp_filter_data(ps->curtick - ps->qet[i],frac);
+            bvol = ms->qev[i];
+            sum += (avol-bvol)*interp_filter_data(ms->curtick - ms->qet[i],frac);
             avol = bvol;
             ++i;
         }
@@ -501,10 +528,10 @@ static double interp_read_resam_all(PokeyState* ps, double frac)
     }
 
     /* without wrap */
-    while (i < ps->qeend)
+    while (i < ms->qeend)
     {
-        bvol = ps->qev[i];
-        sum += (avol-bvol)*interp_filter_data(ps->curtick - ps->qet[i],frac);
+        bvol = ms->qev[i];
+        sum += (avol-bvol)*interp_filter_data(ms->curtick - ms->qet[i],frac);
         avol = bvol;
         ++i;
     }
@@ -514,43 +541,43 @@ static double interp_read_resam_all(PokeyState* ps, double frac)
     return sum;
 }
 
-static void add_change(PokeyState* ps, qev_t a)
+static void add_change(MixState* ms, qev_t a)
 {
-    ps->qev[ps->qeend] = a;
-    ps->qet[ps->qeend] = ps->curtick; /*0;*/
-    ++ps->qeend;
-    if(ps->qeend >= filter_size)
-        ps->qeend = 0;
+    ms->qev[ms->qeend] = a;
+    ms->qet[ms->qeend] = ms->curtick; /*0;*/
+    ++ms->qeend;
+    if(ms->qeend >= filter_size)
+        ms->qeend = 0;
 }
 
-static void bump_qe_subticks(PokeyState* ps, int subticks)
+static void bump_qe_subticks(MixState* ms, int subticks)
 {
     /* Remove too old events from the queue while bumping */
-    int i = ps->qebeg;
+    int i = ms->qebeg;
     /* we must avoid curtick overflow in a 32-bit int, will happen in 20 min */
     static const int tickoverflowlimit = 1000000000;
-    ps->curtick += subticks;
-    if (ps->curtick > tickoverflowlimit) {
-	    ps->curtick -= tickoverflowlimit/2;
+    ms->curtick += subticks;
+    if (ms->curtick > tickoverflowlimit) {
+	    ms->curtick -= tickoverflowlimit/2;
 	    for (i=0; i<filter_size; i++) {
-		    if (ps->qet[i] > tickoverflowlimit/2) {
-			    ps->qet[i] -= tickoverflowlimit/2;
+		    if (ms->qet[i] > tickoverflowlimit/2) {
+			    ms->qet[i] -= tickoverflowlimit/2;
 		    }
 	    }
     }
 
 
-    if(ps->qeend < ps->qebeg) /* Loop with wrap */
+    if(ms->qeend < ms->qebeg) /* Loop with wrap */
     {
         while(i<filter_size)
         {
-            /*ps->qet[i] += subticks;*/
-            if(ps->curtick - ps->qet[i] >= filter_size - 1)
+            /*ms->qet[i] += subticks;*/
+            if(ms->curtick - ms->qet[i] >= filter_size - 1)
             {
-                ps->ovola = ps->qev[i];
-                ++ps->qebeg;
-                if(ps->qebeg >= filter_size)
-                    ps->qebeg = 0;
+                ms->ovola = ms->qev[i];
+                ++ms->qebeg;
+                if(ms->qebeg >= filter_size)
+                    ms->qebeg = 0;
             }
 	    else {
 		    return;
@@ -560,15 +587,15 @@ static void bump_qe_subticks(PokeyState* ps, int subticks)
         i=0;
     }
     /* loop without wrap */
-    while(i<ps->qeend)
+    while(i<ms->qeend)
     {
-        /*ps->qet[i] += subticks;*/
-        if(ps->curtick - ps->qet[i] >= filter_size - 1)
+        /*ms->qet[i] += subticks;*/
+        if(ms->curtick - ms->qet[i] >= filter_size - 1)
         {
-            ps->ovola = ps->qev[i];
-            ++ps->qebeg;
-            if(ps->qebeg >= filter_size)
-                ps->qebeg = 0;
+            ms->ovola = ms->qev[i];
+            ++ms->qebeg;
+            if(ms->qebeg >= filter_size)
+                ms->qebeg = 0;
         }
 	else {
 	    return;
@@ -931,211 +958,249 @@ static void event3_p917_p5(PokeyState* ps, int p5v, int p4v, int p917v)
     ps->c1t3 = ps->c1t2;
 }
 
-static void advance_ticks(PokeyState* ps, int ticks)
+static qev_t read_outvol(PokeyState* ps)
 {
-    int ta,tbe, tbe0, tbe1, tbe2, tbe3;
-    int p5v,p4v,p917v;
-
-    qev_t outvol_new;
-    int need0=0;
-    int need1=0;
-    int need2=0;
-    int need3=0;
-
-    int need=0;
-
-    if (ticks <= 0) return;
-    if(ps->forcero)
-    {
-        ps->forcero = 0;
 #ifdef NONLINEAR_MIXING
-        outvol_new = pokeymix[ps->outvol_0 + ps->outvol_1 + ps->outvol_2 + ps->outvol_3 + ps->speaker];
+    return pokeymix[ps->outvol_0 + ps->outvol_1 + ps->outvol_2 + ps->outvol_3 + ps->speaker];
 #else
-        outvol_new = ps->outvol_0 + ps->outvol_1 + ps->outvol_2 + ps->outvol_3;
-        outvol_new += ps->speaker;
+    return ps->outvol_0 + ps->outvol_1 + ps->outvol_2 + ps->outvol_3 + ps->speaker;
 #endif /* NONLINEAR_MIXING */
-        if(outvol_new != ps->outvol_all)
-        {
-            ps->outvol_all = outvol_new;
-            add_change(ps, outvol_new);
-        }
-    }
-
-    while(ticks>0)
-    {
-        tbe0 = ps->c0divpos;
-        tbe1 = ps->c1divpos;
-        tbe2 = ps->c2divpos;
-        tbe3 = ps->c3divpos;
-
-        tbe = ticks+1;
+}
 
+/* Returns the number of ticks to the next event of the chip, or tbe if
+   there is no event sooner */
+static int next_event(PokeyState* ps, int tbe)
+{
 #ifdef NONLINEAR_MIXING
-        if(tbe0 < tbe)
-            tbe = tbe0;
-        if(tbe1 < tbe)
-            tbe = tbe1;
-        if(tbe2 < tbe)
-            tbe = tbe2;
-        if(tbe3 < tbe)
-            tbe = tbe3;
+    if(ps->c0divpos < tbe)
+        tbe = ps->c0divpos;
+    if(ps->c1divpos < tbe)
+        tbe = ps->c1divpos;
+    if(ps->c2divpos < tbe)
+        tbe = ps->c2divpos;
+    if(ps->c3divpos < tbe)
+        tbe = ps->c3divpos;
 #else
-        if(!ps->c0stop && tbe0 < tbe)
-            tbe = tbe0;
-        if(!ps->c1stop && tbe1 < tbe)
-            tbe = tbe1;
-        if(!ps->c2stop && tbe2 < tbe)
-            tbe = tbe2;
-        if(!ps->c3stop && tbe3 < tbe)
-            tbe = tbe3;
+    if(!ps->c0stop && ps->c0divpos < tbe)
+        tbe = ps->c0divpos;
+    if(!ps->c1stop && ps->c1divpos < tbe)
+        tbe = ps->c1divpos;
+    if(!ps->c2stop && ps->c2divpos < tbe)
+        tbe = ps->c2divpos;
+    if(!ps->c3stop && ps->c3divpos < tbe)
+        tbe = ps->c3divpos;
 #endif
+    return tbe;
+}
 
-        if(tbe>ticks)
-            ta = ticks;
-        else
-        {
-            ta = tbe;
-            need = 1;
-        }
+/* Advances the chip by ta ticks, which must not be more than next_event()
+   returns, and clocks the channels whose counters expire. Returns nonzero if the
+   output of the chip changed. */
+static int advance_chip(PokeyState* ps, int ta)
+{
+    int tbe0 = ps->c0divpos;
+    int tbe1 = ps->c1divpos;
+    int tbe2 = ps->c2divpos;
+    int tbe3 = ps->c3divpos;
+    int p5v,p4v,p917v;
 
-        ticks -= ta;
+    qev_t outvol_new;
+    int need0=0;
+    int need1=0;
+    int need2=0;
+    int need3=0;
 
 #ifdef NONLINEAR_MIXING
-        ps->c0divpos -= ta;
-        ps->c1divpos -= ta;
-        ps->c2divpos -= ta;
-        ps->c3divpos -= ta;
+    ps->c0divpos -= ta;
+    ps->c1divpos -= ta;
+    ps->c2divpos -= ta;
+    ps->c3divpos -= ta;
 #else
-        if(!ps->c0stop) ps->c0divpos -= ta;
-        if(!ps->c1stop) ps->c1divpos -= ta;
-        if(!ps->c2stop) ps->c2divpos -= ta;
-        if(!ps->c3stop) ps->c3divpos -= ta;
+    if(!ps->c0stop) ps->c0divpos -= ta;
+    if(!ps->c1stop) ps->c1divpos -= ta;
+    if(!ps->c2stop) ps->c2divpos -= ta;
+    if(!ps->c3stop) ps->c3divpos -= ta;
 #endif
 
-        advance_polies(ps,ta);
-        bump_qe_subticks(ps,ta);
+    /* the poly positions are only needed when a channel is clocked */
+    ps->polyticks += ta;
 
-        if(need)
-        {
-            p5v = poly5tbl[ps->poly5pos] & 1;
-            p4v = poly4tbl[ps->poly4pos] & 1;
-            if(ps->selpoly9)
-                p917v = poly9tbl[ps->poly9pos] & 1;
-            else
-                p917v = poly17tbl[ps->poly17pos] & 1;
+    if(ta != tbe0 && ta != tbe1 && ta != tbe2 && ta != tbe3)
+        return 0;
+
+    advance_polies(ps,ps->polyticks);
+    ps->polyticks = 0;
+    p5v = poly5tbl[ps->poly5pos] & 1;
+    p4v = poly4tbl[ps->poly4pos] & 1;
+    if(ps->selpoly9)
+        p917v = poly9tbl[ps->poly9pos] & 1;
+    else
+        p917v = poly17tbl[ps->poly17pos] & 1;
 
 #ifdef NONLINEAR_MIXING
-            if(ta == tbe0)
+    if(ta == tbe0)
 #else
-            if(!ps->c0stop && ta == tbe0)
+    if(!ps->c0stop && ta == tbe0)
 #endif
-            {
-                ps->event_0(ps,p5v,p4v,p917v);
-                ps->c0divpos = ps->c0divstart;
-                need0 = 1;
-            }
+    {
+        ps->event_0(ps,p5v,p4v,p917v);
+        ps->c0divpos = ps->c0divstart;
+        need0 = 1;
+    }
 #ifdef NONLINEAR_MIXING
-            if(ta == tbe1)
+    if(ta == tbe1)
 #else
-            if(!ps->c1stop && ta == tbe1)
+    if(!ps->c1stop && ta == tbe1)
 #endif
-            {
-                ps->event_1(ps,p5v,p4v,p917v);
-                ps->c1divpos = ps->c1divstart;
-                if(ps->c1_f0)
-                    ps->c0divpos = ps->c0divstart_p;
-                need1 = 1;
-                /*two-tone filter*/
-                /*use if send break is on and two-tone mode is on*/
-                /*reset channel 1 if channel 2 changed*/
-                if((ps->skctl & 0x88) == 0x88) {
-                    ps->c0divpos = ps->c0divstart;
-                    /* it doesn't change the output state */
-                    /*need0 = 1;*/
-                }
-            }
+    {
+        ps->event_1(ps,p5v,p4v,p917v);
+        ps->c1divpos = ps->c1divstart;
+        if(ps->c1_f0)
+            ps->c0divpos = ps->c0divstart_p;
+        need1 = 1;
+        /*two-tone filter*/
+        /*use if send break is on and two-tone mode is on*/
+        /*reset channel 1 if channel 2 changed*/
+        if((ps->skctl & 0x88) == 0x88) {
+            ps->c0divpos = ps->c0divstart;
+            /* it doesn't change the output state */
+            /*need0 = 1;*/
+        }
+    }
 #ifdef NONLINEAR_MIXING
-            if(ta == tbe2)
+    if(ta == tbe2)
 #else
-            if(!ps->c2stop && ta == tbe2)
+    if(!ps->c2stop && ta == tbe2)
 #endif
-            {
-                ps->event_2(ps,p5v,p4v,p917v);
-                ps->c2divpos = ps->c2divstart;
-                need2 = 1;
-                if(ps->c0sw4)
-                    need0 = 1;
-            }
+    {
+        ps->event_2(ps,p5v,p4v,p917v);
+        ps->c2divpos = ps->c2divstart;
+        need2 = 1;
+        if(ps->c0sw4)
+            need0 = 1;
+    }
 #ifdef NONLINEAR_MIXING
-            if(ta == tbe3)
+    if(ta == tbe3)
 #else
-            if(!ps->c3stop && ta == tbe3)
+    if(!ps->c3stop && ta == tbe3)
 #endif
-            {
-                ps->event_3(ps,p5v,p4v,p917v);
-                ps->c3divpos = ps->c3divstart;
-                if(ps->c3_f2)
-                    ps->c2divpos = ps->c2divstart_p;
-                need3 = 1;
-                if(ps->c1sw4)
-                    need1 = 1;
-            }
+    {
+        ps->event_3(ps,p5v,p4v,p917v);
+        ps->c3divpos = ps->c3divstart;
+        if(ps->c3_f2)
+            ps->c2divpos = ps->c2divstart_p;
+        need3 = 1;
+        if(ps->c1sw4)
+            need1 = 1;
+    }
 
-            if(need0)
-            {
+    if(need0)
+    {
 #ifdef NONLINEAR_MIXING
-                ps->outvol_0 = ps->readout_0(ps);
+        ps->outvol_0 = ps->readout_0(ps);
 #else
-                ps->outvol_0 = 2*ps->readout_0(ps);
+        ps->outvol_0 = 2*ps->readout_0(ps);
 #endif
-            }
-            if(need1)
-            {
+    }
+    if(need1)
+    {
 #ifdef NONLINEAR_MIXING
-                ps->outvol_1 = ps->readout_1(ps);
+        ps->outvol_1 = ps->readout_1(ps);
 #else
-                ps->outvol_1 = 2*ps->readout_1(ps);
+        ps->outvol_1 = 2*ps->readout_1(ps);
 #endif
-            }
-            if(need2)
-            {
+    }
+    if(need2)
+    {
 #ifdef NONLINEAR_MIXING
-                ps->outvol_2 = ps->readout_2(ps);
+        ps->outvol_2 = ps->readout_2(ps);
 #else
-                ps->outvol_2 = 2*ps->readout_2(ps);
+        ps->outvol_2 = 2*ps->readout_2(ps);
 #endif
-            }
-            if(need3)
-            {
+    }
+    if(need3)
+    {
 #ifdef NONLINEAR_MIXING
-                ps->outvol_3 = ps->readout_3(ps);
+        ps->outvol_3 = ps->readout_3(ps);
 #else
-                ps->outvol_3 = 2*ps->readout_3(ps);
+        ps->outvol_3 = 2*ps->readout_3(ps);
 #endif
-            }
+    }
 
-#ifdef NONLINEAR_MIXING
-            outvol_new = pokeymix[ps->outvol_0 + ps->outvol_1 + ps->outvol_2 + ps->outvol_3 + ps->speaker];
-#else
-            outvol_new = ps->outvol_0 + ps->outvol_1 + ps->outvol_2 + ps->outvol_3;
-            outvol_new += ps->speaker;
-#endif /* NONLINEAR_MIXING */
-            if(outvol_new != ps->outvol_all)
-            {
-                ps->outvol_all = outvol_new;
-                add_change(ps, outvol_new);
-            }
+    outvol_new = read_outvol(ps);
+    if(outvol_new == ps->outvol_all)
+        return 0;
+    ps->outvol_all = outvol_new;
+    return 1;
+}
+
+/* Queues the sum of the outputs of the chips if it changed */
+static void update_mix(MixState* ms)
+{
+    qev_t outvol_new = ms->chips[0]->outvol_all;
+    int i;
+
+    for(i=1; i<ms->num_chips; i++)
+        outvol_new += ms->chips[i]->outvol_all;
+    if(outvol_new != ms->outvol_all)
+    {
+        ms->outvol_all = outvol_new;
+        add_change(ms, outvol_new);
+    }
+}
+
+/* Advances all chips of the channel together, from one event of any of
+   them to the next, so that their changes enter the queue in order. */
+static void advance_ticks(MixState* ms, int ticks)
+{
+    int ta;
+    int changed=0;
+    int i;
+
+    if (ticks <= 0) return;
+    for(i=0; i<ms->num_chips; i++)
+    {
+        PokeyState* ps = ms->chips[i];
+        /* don't let the ticks of a silent chip overflow */
+        if(ps->polyticks > 1000000000)
+        {
+            advance_polies(ps,ps->polyticks);
+            ps->polyticks = 0;
+        }
+        if(ps->forcero)
+        {
+            ps->forcero = 0;
+            ps->outvol_all = read_outvol(ps);
+            changed = 1;
         }
     }
+    if(changed)
+        update_mix(ms);
+
+    while(ticks>0)
+    {
+        ta = ticks;
+        for(i=0; i<ms->num_chips; i++)
+            ta = next_event(ms->chips[i], ta);
+        ticks -= ta;
+
+        bump_qe_subticks(ms,ta);
+
+        changed = 0;
+        for(i=0; i<ms->num_chips; i++)
+            changed |= advance_chip(ms->chips[i], ta);
+        if(changed)
+            update_mix(ms);
+    }
 }
 
-static double generate_sample(PokeyState* ps)
+static double generate_sample(MixState* ms)
 {
     /*unsigned long ta = (subticks+pokey_frq)/POKEYSND_playback_freq;
     subticks = (subticks+pokey_frq)%POKEYSND_playback_freq;*/
 
-    advance_ticks(ps, pokey_frq/POKEYSND_playback_freq);
-    return read_resam_all(ps);
+    advance_ticks(ms, pokey_frq/POKEYSND_playback_freq);
+    return read_resam_all(ms);
 }
 
 /******************************************
@@ -1242,6 +1307,121 @@ found:
   return size;
 }
 
+/* The clock that the POKEY output is resampled from, a multiple of the
+   playback rate */
+static int resample_pokey_frq(int playback_freq)
+{
+  return (int)(((double)pokey_frq_ideal/playback_freq) + 0.5) * playback_freq;
+}
+
+/* Tables of remez_filter_table() for the usual playback rates, so that
+   starting the sound doesn't run the Remez exchange */
+typedef struct {
+  int playback_freq;
+  int quality;
+  double cutoff;
+  int size;
+  const double *data;
+} precomputed_filter_t;
+
+#ifdef MZPOKEYSND_DUMP_FILTERS
+/* mzfilters.inc is being made, so it isn't used */
+static const precomputed_filter_t precomputed_filters[] = {{0, 0, 0.0, 0, NULL}};
+
+#define NUM_FILTER_QUALITIES 3
+static const int precomputed_rates[] = {44100, 48000};
+
+/* Writes mzfilters.inc in the current directory, with the tables of
+   precomputed_rates at all qualities. */
+static void dump_filters(void)
+{
+  FILE *fp = fopen("mzfilters.inc", "w");
+  double cutoffs[sizeof(precomputed_rates)/sizeof(precomputed_rates[0])][NUM_FILTER_QUALITIES];
+  int sizes[sizeof(precomputed_rates)/sizeof(precomputed_rates[0])][NUM_FILTER_QUALITIES];
+  int r, q, i;
+
+  if (fp == NULL)
+  {
+    perror("mzfilters.inc");
+    exit(1);
+  }
+  fprintf(fp, "/* Filter tables made by remez_filter_table() in mzpokeysnd.c for the\n"
+              "   usual playback rates and all qualities, to save the Remez exchange at\n"
+              "   startup. Don't edit: mzpokeysnd.c built with -DMZPOKEYSND_DUMP_FILTERS\n"
+              "   writes this file when the MZPOKEYSND engine starts. */\n");
+  for (r = 0; r < (int) (sizeof(precomputed_rates)/sizeof(precomputed_rates[0])); r++)
+  {
+    for (q = 0; q < NUM_FILTER_QUALITIES; q++)
+    {
+      int size = remez_filter_table((double)precomputed_rates[r]/resample_pokey_frq(precomputed_rates[r]), &cutoffs[r][q], q);
+      sizes[r][q] = size;
+      fprintf(fp, "\nstatic const double filter_%d_q%d[%d] = {", precomputed_rates[r], q, size);
+      for (i = 0; i < size; i++)
+        fprintf(fp, "%s%.17g", i == 0 ? "\n\t" : i % 4 == 0 ? ",\n\t" : ", ", filter_data[i]);
+      fprintf(fp, "\n};\n");
+    }
+  }
+  fprintf(fp, "\nstatic const precomputed_filter_t precomputed_filters[] =\n{");
+  for (r = 0; r < (int) (sizeof(precomputed_rates)/sizeof(precomputed_rates[0])); r++)
+  {
+    for (q = 0; q < NUM_FILTER_QUALITIES; q++)
+      fprintf(fp, "%s\n  {%d, %d, %.17g, %d, filter_%d_q%d}", r == 0 && q == 0 ? "" : ",",
+              precomputed_rates[r], q, cutoffs[r][q], sizes[r][q], precomputed_rates[r], q);
+  }
+  fprintf(fp, "\n};\n");
+  fclose(fp);
+  exit(0);
+}
+#else
+#include "mzfilters.inc"
+#endif /* MZPOKEYSND_DUMP_FILTERS */
+
+/* Fills filter_data for the playback rate and quality, from the precomputed
+   tables when possible. The last table is kept, so reinitialising the sound
+   unchanged costs nothing. */
+static int filter_table(int playback_freq, double *cutoff, int quality)
+{
+  static int last_playback_freq = 0;
+  static int last_quality = -1;
+  static int last_size = 0;
+  static double last_cutoff = 0.0;
+  int i;
+
+  if (last_size != 0 && playback_freq == last_playback_freq && quality == last_quality)
+  {
+    *cutoff = last_cutoff;
+    return last_size;
+  }
+  last_size = 0;
+  for (i = 0; i < (int) (sizeof(precomputed_filters)/sizeof(precomputed_filters[0])); i++)
+  {
+    if (precomputed_filters[i].playback_freq == playback_freq
+        && precomputed_filters[i].quality == quality)
+    {
+      *cutoff = precomputed_filters[i].cutoff;
+      last_size = precomputed_filters[i].size;
+#ifdef DEBUG
+      {
+        /* check that mzfilters.inc is up to date */
+        double remez_cutoff;
+        if (remez_filter_table((double)playback_freq/pokey_frq, &remez_cutoff, quality) != last_size
+            || remez_cutoff != *cutoff
+            || memcmp(filter_data, precomputed_filters[i].data, last_size * sizeof(double)) != 0)
+          fprintf(stderr, "mzpokeysnd: mzfilters.inc differs from remez_filter_table(), rebuild it with -DMZPOKEYSND_DUMP_FILTERS\n");
+      }
+#endif
+      memcpy(filter_data, precomputed_filters[i].data, last_size * sizeof(double));
+      break;
+    }
+  }
+  if (last_size == 0)
+    last_size = remez_filter_table((double)playback_freq/pokey_frq, cutoff, quality);
+  last_playback_freq = playback_freq;
+  last_quality = quality;
+  last_cutoff = *cutoff;
+  return last_size;
+}
+
 static void mzpokeysnd_process_8(void* sndbuffer, int sndn);
 static void mzpokeysnd_process_16(void* sndbuffer, int sndn);
 static void Update_pokey_sound_mz(UWORD addr, UBYTE val, UBYTE chip, UBYTE gain);
@@ -1283,7 +1463,11 @@ int MZPOKEYSND_Init(ULONG freq17, int playback_freq, UBYTE num_pokeys,
                        )
 {
     double cutoff;
+    int i;
 
+#ifdef MZPOKEYSND_DUMP_FILTERS
+    dump_filters();
+#endif
     snd_quality = quality;
 
     POKEYSND_Update_ptr = Update_pokey_sound_mz;
@@ -1368,26 +1552,38 @@ int MZPOKEYSND_Init(ULONG freq17, int playback_freq, UBYTE num_pokeys,
         break;
 #endif
     default:
-        pokey_frq = (int)(((double)pokey_frq_ideal/POKEYSND_playback_freq) + 0.5)
-          * POKEYSND_playback_freq;
-	filter_size = remez_filter_table((double)POKEYSND_playback_freq/pokey_frq,
-					 &cutoff, quality);
+        pokey_frq = resample_pokey_frq(POKEYSND_playback_freq);
+	filter_size = filter_table(POKEYSND_playback_freq, &cutoff, quality);
 	audible_frq = (int ) (cutoff * pokey_frq);
     }
 
-    build_poly4();
-    build_poly5();
-    build_poly9();
-    build_poly17();
+    /* The polynomial tables are constant - build them once per process. */
+    if (!polies_built) {
+        build_poly4();
+        build_poly5();
+        build_poly9();
+        build_poly17();
+        polies_built = 1;
+    }
 
 #ifdef __PLUS
 	if (clear_regs)
 #endif
 	{
-		ResetPokeyState(pokey_states);
-		ResetPokeyState(pokey_states + 1);
+		for (i = 0; i < NPOKEYS; i++) {
+			ResetPokeyState(pokey_states + i);
+			ResetMixState(mix_states + i);
+		}
+	}
+
+	/* the chips are heard in turn on the output channels */
+	num_channels = POKEYSND_num_pokeys < num_pokeys ? POKEYSND_num_pokeys : num_pokeys;
+	for (i = 0; i < num_channels; i++)
+		mix_states[i].num_chips = 0;
+	for (i = 0; i < num_pokeys; i++) {
+		MixState* ms = mix_states + i % num_channels;
+		ms->chips[ms->num_chips++] = pokey_states + i;
 	}
-	num_cur_pokeys = num_pokeys;
 
 	init_syncsound();
 	volume.s8 = POKEYSND_volume * 0xff / 256.0;
@@ -2286,22 +2482,20 @@ static void mzpokeysnd_process_8(void* sndbuffer, int sndn)
     int nsam = sndn;
     UBYTE *buffer = (UBYTE *) sndbuffer;
 
-    if(num_cur_pokeys<1)
+    if(num_channels<1)
         return; /* module was not initialized */
 
-    /* if there are two pokeys, then the signal is stereo
+    /* if there are two channels, then the signal is stereo
        we assume even sndn */
-    while(nsam >= (int) num_cur_pokeys)
+    while(nsam >= num_channels)
     {
-        buffer[0] = (UBYTE)floor(generate_sample(pokey_states)
-         * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 128 + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
-        for(i=1; i<num_cur_pokeys; i++)
+        for(i=0; i<num_channels; i++)
         {
-            buffer[i] = (UBYTE)floor(generate_sample(pokey_states + i)
-             * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 128 + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
+            buffer[i] = (UBYTE)floor(generate_sample(mix_states + i)
+             * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) / mix_states[i].num_chips + 128 + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
         }
-        buffer += num_cur_pokeys;
-        nsam -= num_cur_pokeys;
+        buffer += num_channels;
+        nsam -= num_channels;
     }
 }
 
@@ -2311,22 +2505,20 @@ static void mzpokeysnd_process_16(void* sndbuffer, int sndn)
     int nsam = sndn;
     SWORD *buffer = (SWORD *) sndbuffer;
 
-    if(num_cur_pokeys<1)
+    if(num_channels<1)
         return; /* module was not initialized */
 
-    /* if there are two pokeys, then the signal is stereo
+    /* if there are two channels, then the signal is stereo
        we assume even sndn */
-    while(nsam >= (int) num_cur_pokeys)
+    while(nsam >= num_channels)
     {
-        buffer[0] = (SWORD)floor(generate_sample(pokey_states)
-         * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
-        for(i=1; i<num_cur_pokeys; i++)
+        for(i=0; i<num_channels; i++)
         {
-            buffer[i] = (SWORD)floor(generate_sample(pokey_states + i)
-             * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
+            buffer[i] = (SWORD)floor(generate_sample(mix_states + i)
+             * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) / mix_states[i].num_chips + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
         }
-        buffer += num_cur_pokeys;
-        nsam -= num_cur_pokeys;
+        buffer += num_channels;
+        nsam -= num_channels;
     }
 }
 
@@ -2336,7 +2528,7 @@ static void generate_sync(unsigned int num_ticks)
 	unsigned int ticks;
 	UBYTE *buffer = POKEYSND_process_buffer + POKEYSND_process_buffer_fill;
 	UBYTE *buffer_end = POKEYSND_process_buffer + POKEYSND_process_buffer_length;
-	unsigned int i;
+	int i;
 
 	for (;;) {
 		double int_part;
@@ -2353,21 +2545,22 @@ static void generate_sync(unsigned int num_ticks)
 		samp_pos = new_samp_pos;
 		num_ticks -= ticks;
 
-		for (i = 0; i < num_cur_pokeys; ++i) {
-			/* advance pokey to the new position and produce a sample */
-			advance_ticks(pokey_states + i, ticks);
+		for (i = 0; i < num_channels; ++i) {
+			MixState* ms = mix_states + i;
+			/* advance the channel's pokeys to the new position and produce a sample */
+			advance_ticks(ms, ticks);
 			if (POKEYSND_snd_flags & POKEYSND_BIT16) {
 				*((SWORD *)buffer) = (SWORD)floor(
-					interp_read_resam_all(pokey_states + i, samp_pos)
-					* (volume.s16 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95)
+					interp_read_resam_all(ms, samp_pos)
+					* (volume.s16 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) / ms->num_chips
 					+ 0.5 + 0.5 * rand() / RAND_MAX - 0.25
 				);
 				buffer += 2;
 			}
 			else
 				*buffer++ = (UBYTE)floor(
-					interp_read_resam_all(pokey_states + i, samp_pos)
-					* (volume.s8 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95)
+					interp_read_resam_all(ms, samp_pos)
+					* (volume.s8 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) / ms->num_chips
 					+ 128 + 0.5 + 0.5 * rand() / RAND_MAX - 0.25
 				);
 		}
@@ -2376,8 +2569,8 @@ static void generate_sync(unsigned int num_ticks)
 	POKEYSND_process_buffer_fill = buffer - POKEYSND_process_buffer;
 	if (num_ticks > 0) {
 		/* remaining ticks */
-		for (i = 0; i < num_cur_pokeys; ++i)
-			advance_ticks(pokey_states + i, num_ticks);
+		for (i = 0; i < num_channels; ++i)
+			advance_ticks(mix_states + i, num_ticks);
 	}
 }
 
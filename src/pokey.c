@@ -56,6 +56,7 @@
 #ifdef POKEYREC
 #include "pokeyrec.h"
 #endif
+#include "runahead.h"
 
 #ifdef VOICEBOX
 #include "voicebox.h"
@@ -105,7 +106,7 @@ UBYTE POKEY_GetByte(UWORD addr, int no_side_effects)
 	UBYTE byte = 0xff;
 
 #ifdef STEREO_SOUND
-	if (addr & 0x0010 && POKEYSND_stereo_enabled)
+	if (addr & (POKEYSND_quad_enabled ? 0x0030 : 0x0010) && POKEYSND_stereo_enabled)
 		return 0;
 #endif
 	addr &= 0x0f;
@@ -182,10 +183,50 @@ static int POKEY_siocheck(void)
 #define POKEYSND_Update(addr, val, chip, gain)
 #endif
 
+#ifdef STEREO_SOUND
+/* Writes a register of the second, third or fourth chip. These chips only
+   produce sound: their keyboard, serial port and timer IRQs aren't wired. */
+static void PutByte_sound_chip(int chip, UWORD addr, UBYTE byte)
+{
+	switch (addr) {
+	case POKEY_OFFSET_AUDF1:
+	case POKEY_OFFSET_AUDF2:
+	case POKEY_OFFSET_AUDF3:
+	case POKEY_OFFSET_AUDF4:
+		POKEY_AUDF[(addr >> 1) + (chip << 2)] = byte;
+		break;
+	case POKEY_OFFSET_AUDC1:
+	case POKEY_OFFSET_AUDC2:
+	case POKEY_OFFSET_AUDC3:
+	case POKEY_OFFSET_AUDC4:
+		POKEY_AUDC[(addr >> 1) + (chip << 2)] = byte;
+		break;
+	case POKEY_OFFSET_AUDCTL:
+		POKEY_AUDCTL[chip] = byte;
+		/* determine the base multiplier for the 'div by n' calculations */
+		if (byte & POKEY_CLOCK_15)
+			POKEY_Base_mult[chip] = POKEY_DIV_15;
+		else
+			POKEY_Base_mult[chip] = POKEY_DIV_64;
+		break;
+	case POKEY_OFFSET_STIMER:
+	case POKEY_OFFSET_SKCTL:
+		break;
+	default:
+		return;
+	}
+	POKEYSND_Update(addr, byte, (UBYTE) chip, SOUND_GAIN);
+}
+#endif /* STEREO_SOUND */
+
 void POKEY_PutByte(UWORD addr, UBYTE byte)
 {
 #ifdef STEREO_SOUND
-	addr &= POKEYSND_stereo_enabled ? 0x1f : 0x0f;
+	addr &= POKEYSND_stereo_enabled ? (POKEYSND_quad_enabled ? 0x3f : 0x1f) : 0x0f;
+	if (addr >= POKEY_OFFSET_POKEY2) {
+		PutByte_sound_chip(addr >> 4, addr & 0x0f, byte);
+		return;
+	}
 #else
 	addr &= 0x0f;
 #endif
@@ -257,6 +298,7 @@ void POKEY_PutByte(UWORD addr, UBYTE byte)
 			pot_scanline = 0;	/* slow pot mode */
 		break;
 	case POKEY_OFFSET_SEROUT:
+		RUNAHEAD_CHECK();
 #ifdef VOICEBOX
 		VOICEBOX_SEROUTPutByte(byte);
 #endif
@@ -323,56 +365,6 @@ void POKEY_PutByte(UWORD addr, UBYTE byte)
 			/* TODO other registers should also be reset. */
 		}
 		break;
-#ifdef STEREO_SOUND
-	case POKEY_OFFSET_AUDC1 + POKEY_OFFSET_POKEY2:
-		POKEY_AUDC[POKEY_CHAN1 + POKEY_CHIP2] = byte;
-		POKEYSND_Update(POKEY_OFFSET_AUDC1, byte, 1, SOUND_GAIN);
-		break;
-	case POKEY_OFFSET_AUDC2 + POKEY_OFFSET_POKEY2:
-		POKEY_AUDC[POKEY_CHAN2 + POKEY_CHIP2] = byte;
-		POKEYSND_Update(POKEY_OFFSET_AUDC2, byte, 1, SOUND_GAIN);
-		break;
-	case POKEY_OFFSET_AUDC3 + POKEY_OFFSET_POKEY2:
-		POKEY_AUDC[POKEY_CHAN3 + POKEY_CHIP2] = byte;
-		POKEYSND_Update(POKEY_OFFSET_AUDC3, byte, 1, SOUND_GAIN);
-		break;
-	case POKEY_OFFSET_AUDC4 + POKEY_OFFSET_POKEY2:
-		POKEY_AUDC[POKEY_CHAN4 + POKEY_CHIP2] = byte;
-		POKEYSND_Update(POKEY_OFFSET_AUDC4, byte, 1, SOUND_GAIN);
-		break;
-	case POKEY_OFFSET_AUDCTL + POKEY_OFFSET_POKEY2:
-		POKEY_AUDCTL[1] = byte;
-		/* determine the base multiplier for the 'div by n' calculations */
-		if (byte & POKEY_CLOCK_15)
-			POKEY_Base_mult[1] = POKEY_DIV_15;
-		else
-			POKEY_Base_mult[1] = POKEY_DIV_64;
-
-		POKEYSND_Update(POKEY_OFFSET_AUDCTL, byte, 1, SOUND_GAIN);
-		break;
-	case POKEY_OFFSET_AUDF1 + POKEY_OFFSET_POKEY2:
-		POKEY_AUDF[POKEY_CHAN1 + POKEY_CHIP2] = byte;
-		POKEYSND_Update(POKEY_OFFSET_AUDF1, byte, 1, SOUND_GAIN);
-		break;
-	case POKEY_OFFSET_AUDF2 + POKEY_OFFSET_POKEY2:
-		POKEY_AUDF[POKEY_CHAN2 + POKEY_CHIP2] = byte;
-		POKEYSND_Update(POKEY_OFFSET_AUDF2, byte, 1, SOUND_GAIN);
-		break;
-	case POKEY_OFFSET_AUDF3 + POKEY_OFFSET_POKEY2:
-		POKEY_AUDF[POKEY_CHAN3 + POKEY_CHIP2] = byte;
-		POKEYSND_Update(POKEY_OFFSET_AUDF3, byte, 1, SOUND_GAIN);
-		break;
-	case POKEY_OFFSET_AUDF4 + POKEY_OFFSET_POKEY2:
-		POKEY_AUDF[POKEY_CHAN4 + POKEY_CHIP2] = byte;
-		POKEYSND_Update(POKEY_OFFSET_AUDF4, byte, 1, SOUND_GAIN);
-		break;
-	case POKEY_OFFSET_STIMER + POKEY_OFFSET_POKEY2:
-		POKEYSND_Update(POKEY_OFFSET_STIMER, byte, 1, SOUND_GAIN);
-		break;
-	case POKEY_OFFSET_SKCTL + POKEY_OFFSET_POKEY2:
-		POKEYSND_Update(POKEY_OFFSET_SKCTL, byte, 1, SOUND_GAIN);
-		break;
-#endif
 	}
 }
 
@@ -686,6 +678,22 @@ void POKEY_StateSave(void)
 	StateSav_SaveINT(&POKEY_DivNIRQ[0], 4);
 	StateSav_SaveINT(&POKEY_DivNMax[0], 4);
 	StateSav_SaveINT(&POKEY_Base_mult[0], 1);
+#ifdef RUNAHEAD
+	if (StateSav_quick) {
+		/* not in state files, but run-ahead must come back to the same values */
+		StateSav_SaveINT(&pot_scanline, 1);
+		StateSav_SaveUBYTE((UBYTE *) &random_scanline_counter, sizeof(random_scanline_counter));
+#ifdef STEREO_SOUND
+		/* the sound of the other chips too */
+		if (POKEYSND_num_pokeys > 1) {
+			StateSav_SaveUBYTE(&POKEY_AUDF[4], 4 * (POKEYSND_num_pokeys - 1));
+			StateSav_SaveUBYTE(&POKEY_AUDC[4], 4 * (POKEYSND_num_pokeys - 1));
+			StateSav_SaveUBYTE(&POKEY_AUDCTL[1], POKEYSND_num_pokeys - 1);
+			StateSav_SaveINT(&POKEY_Base_mult[1], POKEYSND_num_pokeys - 1);
+		}
+#endif
+	}
+#endif
 }
 
 void POKEY_StateRead(void)
@@ -717,6 +725,28 @@ void POKEY_StateRead(void)
 	StateSav_ReadINT(&POKEY_DivNIRQ[0], 4);
 	StateSav_ReadINT(&POKEY_DivNMax[0], 4);
 	StateSav_ReadINT(&POKEY_Base_mult[0], 1);
+#ifdef RUNAHEAD
+	if (StateSav_quick) {
+		StateSav_ReadINT(&pot_scanline, 1);
+		StateSav_ReadUBYTE((UBYTE *) &random_scanline_counter, sizeof(random_scanline_counter));
+#ifdef STEREO_SOUND
+		if (POKEYSND_num_pokeys > 1) {
+			int chip;
+			StateSav_ReadUBYTE(&POKEY_AUDF[4], 4 * (POKEYSND_num_pokeys - 1));
+			StateSav_ReadUBYTE(&POKEY_AUDC[4], 4 * (POKEYSND_num_pokeys - 1));
+			StateSav_ReadUBYTE(&POKEY_AUDCTL[1], POKEYSND_num_pokeys - 1);
+			StateSav_ReadINT(&POKEY_Base_mult[1], POKEYSND_num_pokeys - 1);
+			for (chip = 1; chip < POKEYSND_num_pokeys; chip++) {
+				for (i = 0; i < 4; i++) {
+					POKEY_PutByte((UWORD) ((chip << 4) + POKEY_OFFSET_AUDF1 + i * 2), POKEY_AUDF[(chip << 2) + i]);
+					POKEY_PutByte((UWORD) ((chip << 4) + POKEY_OFFSET_AUDC1 + i * 2), POKEY_AUDC[(chip << 2) + i]);
+				}
+				POKEY_PutByte((UWORD) ((chip << 4) + POKEY_OFFSET_AUDCTL), POKEY_AUDCTL[chip]);
+			}
+		}
+#endif
+	}
+#endif
 }
 
 #endif
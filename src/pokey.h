@@ -39,6 +39,8 @@
 #define POKEY_OFFSET_SKSTAT 0x0f
 
 #define POKEY_OFFSET_POKEY2 0x10			/* offset to second pokey chip (STEREO expansion) */
+#define POKEY_OFFSET_POKEY3 0x20			/* offsets to third and fourth chips (QUAD expansion) */
+#define POKEY_OFFSET_POKEY4 0x30
 
 #ifndef ASAP
 
@@ -95,7 +97,7 @@ void POKEY_StateRead(void);
 #define POKEY_POLY9_SIZE  0x01ff
 #define POKEY_POLY17_SIZE 0x0001ffff
 
-#define POKEY_MAXPOKEYS         2		/* max number of emulated chips */
+#define POKEY_MAXPOKEYS         4		/* max number of emulated chips */
 
 /* channel/chip definitions */
 #define POKEY_CHAN1       0
@@ -45,6 +45,9 @@
 #include "antic.h"
 #include "gtia.h"
 #include "util.h"
+#ifdef RUNAHEAD
+#include "runahead.h"
+#endif
 
 #ifdef WORDS_UNALIGNED_OK
 #  define READ_U32(x)     (*(ULONG *) (x))
@@ -151,6 +154,7 @@ int POKEYSND_bienias_fix = TRUE;  /* when TRUE, high frequencies get emulated: b
 #endif
 #ifndef ASAP
 int POKEYSND_stereo_enabled = FALSE;
+int POKEYSND_quad_enabled = FALSE;
 #endif
 
 int POKEYSND_volume = 0x100;
@@ -235,20 +239,26 @@ static int pokeysnd_init_rf(ULONG freq17, int playback_freq,
 
 int POKEYSND_DoInit(void)
 {
+	/* With four chips, the first and third are heard on the left channel,
+	   the second and fourth on the right one. */
+	UBYTE num_chips = POKEYSND_num_pokeys;
+	if (num_chips == 2 && POKEYSND_quad_enabled)
+		num_chips = 4;
+
 #ifdef AUDIO_RECORDING
 	File_Export_StopRecording();
 #endif
 
 	if (POKEYSND_enable_new_pokey)
 		return MZPOKEYSND_Init(snd_freq17, POKEYSND_playback_freq,
-				POKEYSND_num_pokeys, POKEYSND_snd_flags, mz_quality
+				num_chips, POKEYSND_snd_flags, mz_quality
 #ifdef __PLUS
 				, mz_clear_regs
 #endif
 		);
 	else
 		return pokeysnd_init_rf(snd_freq17, POKEYSND_playback_freq,
-				POKEYSND_num_pokeys, POKEYSND_snd_flags);
+				num_chips, POKEYSND_snd_flags);
 }
 
 int POKEYSND_Init(ULONG freq17, int playback_freq, UBYTE num_pokeys,
@@ -395,6 +405,11 @@ static int pokeysnd_init_rf(ULONG freq17, int playback_freq,
 
 void POKEYSND_Update(UWORD addr, UBYTE val, UBYTE chip, UBYTE gain)
 {
+#ifdef RUNAHEAD
+	/* Only the real frames are heard. */
+	if (RUNAHEAD_active)
+		return;
+#endif
     Update_synchronized_sound();
 	POKEYSND_Update_ptr(addr, val, chip, gain);
 }
@@ -410,6 +425,11 @@ static void Update_pokey_sound_rf(UWORD addr, UBYTE val, UBYTE chip,
 	/* calculate the chip_offs for the channel arrays */
 	chip_offs = chip << 2;
 
+	/* two chips share each output channel, so they get half of the gain
+	   not to overflow the 8-bit samples */
+	if (Num_pokeys > 2)
+		gain = (gain + 1) >> 1;
+
 	/* determine which address was changed */
 	switch (addr & 0x0f) {
 	case POKEY_OFFSET_AUDF1:
@@ -1097,6 +1117,10 @@ void POKEYSND_UpdateConsol(int set)
 {
 	if (!POKEYSND_console_sound_enabled)
 		return;
+#ifdef RUNAHEAD
+	if (RUNAHEAD_active)
+		return;
+#endif
 	if (set)
 		Update_synchronized_sound();
 	POKEYSND_UpdateConsol_ptr(set);
@@ -177,6 +177,14 @@ extern void dc_set_baud(int baud);
 #include <termios.h>
 #endif /* defined(R_SERIAL) && !defined(DREAMCAST) */
 
+/* Where threads are available, a poller thread does all socket/port I/O,
+   so the emulation thread never waits for the host. */
+#if defined(HAVE_LIBPTHREAD) && !defined(HAVE_WINDOWS_H) && !defined(DREAMCAST)
+#define R_POLLER
+#include <pthread.h>
+#include <poll.h>
+#endif
+
 #include "atari.h"
 #include "rdevice.h"
 #include "cpu.h"
@@ -184,6 +192,7 @@ extern void dc_set_baud(int baud);
 #include "log.h"
 #include "memory.h"
 #include "util.h"
+#include "runahead.h"
 
 #define Peek(a)    MEMORY_dGetByte(a)
 #define DPeek(a)   MEMORY_dGetWord(a)
@@ -208,14 +217,107 @@ static int retval;
 
 static char MESSAGE[256];
 static char command_buf[256];
-static char bufout[256];
 static int concurrent;
 
 static int command_end = 0;
 static int translation = 1;
 static int trans_cr = 0;
 static int linefeeds = 1;
-static int bufend = 0;
+
+/*---------------------------------------------------------------------------
+   Ring buffers - input (host -> Atari) and output (Atari -> host, used
+   by the poller thread only). head and tail are free running counters.
+---------------------------------------------------------------------------*/
+#define RBUF_SIZE 8192   /* must be a power of two */
+
+typedef struct
+{
+  UBYTE data[RBUF_SIZE];
+  unsigned int head;  /* next byte written */
+  unsigned int tail;  /* next byte read */
+} rbuf_t;
+
+static rbuf_t inbuf;
+#ifdef R_POLLER
+static rbuf_t outbuf;
+#endif
+
+/* set when input was dropped because inbuf was full */
+static int overrun = 0;
+
+#ifdef R_POLLER
+static pthread_mutex_t rbuf_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define RBUF_LOCK    pthread_mutex_lock(&rbuf_mutex)
+#define RBUF_UNLOCK  pthread_mutex_unlock(&rbuf_mutex)
+#else
+#define RBUF_LOCK
+#define RBUF_UNLOCK
+#endif
+
+/* The functions below expect the caller to hold RBUF_LOCK. */
+static unsigned int rbuf_count(const rbuf_t *b)
+{
+  return b->head - b->tail;
+}
+
+static int rbuf_put(rbuf_t *b, UBYTE c)
+{
+  if(b->head - b->tail >= RBUF_SIZE)
+  {
+    overrun = 1;
+    return 0;
+  }
+  b->data[b->head++ & (RBUF_SIZE - 1)] = c;
+  return 1;
+}
+
+static void rbuf_puts(rbuf_t *b, const char *str)
+{
+  while(*str != '\0')
+    rbuf_put(b, (UBYTE) *str++);
+}
+
+static int rbuf_get(rbuf_t *b)
+{
+  if(b->head == b->tail)
+    return -1;
+  return b->data[b->tail++ & (RBUF_SIZE - 1)];
+}
+
+static int rbuf_peek(const rbuf_t *b)
+{
+  if(b->head == b->tail)
+    return -1;
+  return b->data[b->tail & (RBUF_SIZE - 1)];
+}
+
+static void rbuf_clear(rbuf_t *b)
+{
+  b->head = b->tail = 0;
+}
+
+/* Input buffer helpers that take the lock themselves. */
+static void inbuf_put(UBYTE c)
+{
+  RBUF_LOCK;
+  rbuf_put(&inbuf, c);
+  RBUF_UNLOCK;
+}
+
+static void inbuf_puts(const char *str)
+{
+  RBUF_LOCK;
+  rbuf_puts(&inbuf, str);
+  RBUF_UNLOCK;
+}
+
+static void inbuf_clear(void)
+{
+  RBUF_LOCK;
+  rbuf_clear(&inbuf);
+  overrun = 0;
+  RBUF_UNLOCK;
+}
 
 #ifndef R_NETWORK
 int RDevice_serial_enabled = 1;
@@ -228,22 +330,294 @@ char RDevice_serial_device[FILENAME_MAX];
    Host Support Function - If Disconnect signal is found, then close socket
    and clean up.
 ---------------------------------------------------------------------------*/
-#ifdef R_NETWORK
+#if defined(R_NETWORK) && !defined(R_POLLER)
 static void catch_disconnect(int sig)
 {
   DBG_APRINT("R*: Disconnected....");
   close(rdev_fd);
   connected = 0;
   do_once = 0;
-  bufout[0] = 0;
-  strcat(bufout, "\r\nNO CARRIER\r\n");
-  bufend = 13;
-#if 0
-  Poke(747,bufend);
-  Poke(748,0);
-#endif
+  inbuf_clear();
+  inbuf_puts("\r\nNO CARRIER\r\n");
 }
-#endif /* R_NETWORK */
+#endif /* defined(R_NETWORK) && !defined(R_POLLER) */
+
+#ifdef R_POLLER
+/*---------------------------------------------------------------------------
+   Host Support Function - Poller thread. Moves bytes between the socket
+   or serial port and the ring buffers and answers telnet negotiation,
+   so R: calls from the emulated machine never wait for the host.
+---------------------------------------------------------------------------*/
+static pthread_t poller_thread;
+static int poller_running = 0;
+static volatile int poller_stop = 0;
+static volatile int carrier_lost = 0;
+static int poller_fd = -1;
+static int poller_telnet = 0;
+static int wake_pipe[2] = { -1, -1 };
+
+enum { TELNET_DATA, TELNET_IAC, TELNET_OPTION, TELNET_SUB };
+static int telnet_state = TELNET_DATA;
+static UBYTE telnet_verb;
+
+/* Feeds one received byte through the telnet parser.
+   Called with RBUF_LOCK held. */
+static void telnet_byte(UBYTE c)
+{
+  switch(telnet_state)
+  {
+    case TELNET_DATA:
+      if(poller_telnet && (c == 0xff))
+        telnet_state = TELNET_IAC;
+      else
+        rbuf_put(&inbuf, c);
+      break;
+    case TELNET_IAC:
+      if(c == 0xff)
+      { /* escaped 0xff */
+        rbuf_put(&inbuf, c);
+        telnet_state = TELNET_DATA;
+      }
+      else if(c == 0xfa)
+        telnet_state = TELNET_SUB;
+      else if((c >= 0xfb) && (c <= 0xfe))
+      {
+        telnet_verb = c;
+        telnet_state = TELNET_OPTION;
+      }
+      else
+        telnet_state = TELNET_DATA;
+      break;
+    case TELNET_OPTION:
+      switch(telnet_verb)
+      {
+        case 0xfd: /*DO*/
+          if((c == 0x01) || (c == 0x03))
+            telnet_verb = 0xfb; /* WILL ECHO and GO AHEAD (char mode) */
+          else
+            telnet_verb = 0xfc; /* WONT */
+          break;
+        case 0xfb: /*WILL*/
+          telnet_verb = 0xfe; /*DONT*/
+          break;
+        case 0xfe: /*DONT*/
+          telnet_verb = 0xfc;
+          break;
+        default: /*WONT*/
+          telnet_verb = 0xfe;
+          break;
+      }
+      rbuf_put(&outbuf, 0xff);
+      rbuf_put(&outbuf, telnet_verb);
+      rbuf_put(&outbuf, c);
+      telnet_state = TELNET_DATA;
+      break;
+    default: /* wait for end of sub negotiation */
+      if(c == 0xf0)
+        telnet_state = TELNET_DATA;
+      break;
+  }
+}
+
+static int would_block(void)
+{
+  return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+}
+
+static void *poller_main(void *arg)
+{
+  UBYTE buf[1024];
+  struct pollfd fds[2];
+  int i;
+  int n;
+  unsigned int room;
+  unsigned int pending;
+  sigset_t sigpipe;
+
+  /* a write to a dropped connection fails with EPIPE in this thread
+     instead of raising SIGPIPE in the whole process */
+  sigemptyset(&sigpipe);
+  sigaddset(&sigpipe, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &sigpipe, NULL);
+
+  while(!poller_stop)
+  {
+    RBUF_LOCK;
+    room = RBUF_SIZE - rbuf_count(&inbuf);
+    pending = rbuf_count(&outbuf);
+    RBUF_UNLOCK;
+
+    fds[0].fd = poller_fd;
+    fds[0].events = (room > 0 ? POLLIN : 0) | (pending > 0 ? POLLOUT : 0);
+    fds[0].revents = 0;
+    fds[1].fd = wake_pipe[0];
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+
+    /* with a full input buffer, look again shortly */
+    n = poll(fds, 2, room > 0 ? -1 : 10);
+    if(n < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      break;
+    }
+
+    if(fds[1].revents & POLLIN)
+    {
+      while(read(wake_pipe[0], buf, sizeof(buf)) > 0) {};
+    }
+
+    if(fds[0].revents & POLLIN)
+    {
+      if(room > sizeof(buf))
+        room = sizeof(buf);
+      n = read(poller_fd, buf, room);
+      if(n > 0)
+      {
+        RBUF_LOCK;
+        for(i = 0; i < n; i++)
+          telnet_byte(buf[i]);
+        RBUF_UNLOCK;
+      }
+      else if((n == 0) || !would_block())
+      {
+        /* end of file on a readable descriptor is a hangup; polling
+           again would return at once and spin */
+        carrier_lost = 1;
+        break;
+      }
+    }
+    else if(fds[0].revents & (POLLERR | POLLHUP | POLLNVAL))
+    {
+      carrier_lost = 1;
+      break;
+    }
+
+    if(fds[0].revents & POLLOUT)
+    {
+      RBUF_LOCK;
+      pending = rbuf_count(&outbuf);
+      if(pending > sizeof(buf))
+        pending = sizeof(buf);
+      for(i = 0; i < (int) pending; i++)
+        buf[i] = outbuf.data[(outbuf.tail + i) & (RBUF_SIZE - 1)];
+      RBUF_UNLOCK;
+
+      n = write(poller_fd, buf, pending);
+      if(n > 0)
+      {
+        RBUF_LOCK;
+        outbuf.tail += n;
+        RBUF_UNLOCK;
+      }
+      else if((n < 0) && !would_block())
+      {
+        carrier_lost = 1;
+        break;
+      }
+    }
+  }
+  return arg;
+}
+
+static void poller_wake(void)
+{
+  char c = 0;
+  if(poller_running && (write(wake_pipe[1], &c, 1) != 1))
+  {
+    DBG_APRINT("R*: warning, could not wake poller");
+  }
+}
+
+static void poller_stop_thread(void)
+{
+  if(!poller_running)
+    return;
+  poller_stop = 1;
+  poller_wake();
+  pthread_join(poller_thread, NULL);
+  poller_running = 0;
+  close(wake_pipe[0]);
+  close(wake_pipe[1]);
+  wake_pipe[0] = wake_pipe[1] = -1;
+}
+
+static void poller_start(int fd, int telnet)
+{
+  poller_stop_thread();
+  if(pipe(wake_pipe) != 0)
+  {
+    perror("pipe");
+    return;
+  }
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+  fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+
+  poller_fd = fd;
+  poller_telnet = telnet;
+  poller_stop = 0;
+  carrier_lost = 0;
+  telnet_state = TELNET_DATA;
+  RBUF_LOCK;
+  rbuf_clear(&outbuf);
+  RBUF_UNLOCK;
+  if(pthread_create(&poller_thread, NULL, poller_main, NULL) != 0)
+  {
+    perror("pthread_create");
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    wake_pipe[0] = wake_pipe[1] = -1;
+    return;
+  }
+  poller_running = 1;
+}
+
+/* Reports a connection dropped by the host side. */
+static void check_carrier(void)
+{
+  if(!(poller_running && carrier_lost))
+    return;
+  DBG_APRINT("R*: Disconnected....");
+  poller_stop_thread();
+  close(rdev_fd);
+  connected = 0;
+  do_once = 0;
+  carrier_lost = 0;
+  if(poller_telnet)
+    inbuf_puts("\r\nNO CARRIER\r\n");
+}
+
+#else /* R_POLLER */
+
+#define poller_running 0
+#define poller_start(fd, telnet)
+#define poller_stop_thread()
+#define check_carrier()
+
+#endif /* R_POLLER */
+
+#ifndef DREAMCAST
+/* Sends bytes to the host, through the poller when it is running. */
+static int rdevice_write(const UBYTE *data, int len)
+{
+#ifdef R_POLLER
+  if(poller_running)
+  {
+    int i;
+    RBUF_LOCK;
+    for(i = 0; i < len; i++)
+      if(!rbuf_put(&outbuf, data[i]))
+        break;
+    RBUF_UNLOCK;
+    poller_wake();
+    return i;
+  }
+#endif /* R_POLLER */
+  return write(rdev_fd, (char *) data, len);
+}
+#endif /* DREAMCAST */
 
 /*---------------------------------------------------------------------------
    Host Support Function - XIO 34 - Called from RDevice_SPEC
@@ -747,6 +1121,7 @@ static void open_connection(char * address, int port)
 #endif /* HAVE_WINDOWS_H */
   if((address != NULL) && (strlen(address) > 0))
   {
+    poller_stop_thread();
     close(rdev_fd);
     close(sock);
     do_once = 1;
@@ -793,10 +1168,10 @@ static void open_connection(char * address, int port)
       DBG_APRINT(MESSAGE);
 #endif
     }
-#ifndef HAVE_WINDOWS_H
+#if !defined(HAVE_WINDOWS_H) && !defined(R_POLLER)
     signal(SIGPIPE, catch_disconnect); /*Need to see if the other end disconnects...*/
     signal(SIGHUP, catch_disconnect); /*Need to see if the other end disconnects...*/
-#endif /* HAVE_WINDOWS_H */
+#endif /* !defined(HAVE_WINDOWS_H) && !defined(R_POLLER) */
     snprintf(MESSAGE, sizeof(MESSAGE), "R*: Connecting to %s", address);
     DBG_APRINT(MESSAGE);
 #ifdef HAVE_WINDOWS_H
@@ -804,10 +1179,12 @@ static void open_connection(char * address, int port)
 #else
     fcntl(rdev_fd, F_SETFL, O_NONBLOCK);
 #endif /* HAVE_WINDOWS_H */
+    /* the poller sends the negotiation once the connection is up */
+    poller_start(rdev_fd, 1);
 
     /* Telnet negotiation */
     snprintf(MESSAGE, sizeof(MESSAGE), "%c%c%c%c%c%c%c%c%c", 0xff, 0xfb, 0x01, 0xff, 0xfb, 0x03, 0xff, 0xfd, 0x0f3);
-    if(write(rdev_fd, MESSAGE, 9) != 9)
+    if(rdevice_write((UBYTE *)MESSAGE, 9) != 9)
     {
       DBG_APRINT("R*: warning, 'write' did not write all bytes");
     }
@@ -845,7 +1222,10 @@ static void open_connection_serial(int port)
   struct termios options;
 
   if(connected)
+  {
+    poller_stop_thread();
     close(rdev_fd);
+  }
   do_once = 1;
 
   if (*RDevice_serial_device)  /* got a device name from command line */
@@ -896,6 +1276,8 @@ static void open_connection_serial(int port)
     cfsetispeed(&options, B115200);
     cfsetospeed(&options, B115200);
     tcsetattr(rdev_fd, TCSANOW, &options);
+
+    poller_start(rdev_fd, 0);
   }
 #endif /* not DREAMCAST */
 }
@@ -942,11 +1324,12 @@ void RDevice_OPEN(void)
   int  direction;
   int  devnum;
 
+  RUNAHEAD_CHECK();
   CPU_regA = 1;
   CPU_regY = 1;
   CPU_ClrN;
 
-  bufend = 0;
+  inbuf_clear();
 
   port = Peek(Devices_ICAX2Z);
   direction = Peek(Devices_ICAX1Z);
@@ -989,11 +1372,13 @@ void RDevice_OPEN(void)
 ---------------------------------------------------------------------------*/
 void RDevice_CLOS(void)
 {
+  RUNAHEAD_CHECK();
   CPU_regA = 1;
   CPU_regY = 1;
   CPU_ClrN;
   concurrent = 0;
-  bufend = 0;
+  inbuf_clear();
+  poller_stop_thread();
   close(rdev_fd);
 }
 
@@ -1002,43 +1387,24 @@ void RDevice_CLOS(void)
 ---------------------------------------------------------------------------*/
 void RDevice_READ(void)
 {
-  int j;
+  int c;
 
-  /*bufend = Peek(747);*/
-  /*printf("Bufend = %d.\n", bufend);*/
+  RUNAHEAD_CHECK();
+  check_carrier();
 
-/*  if(bufend >= 0) */
-/*  { */
-    if(translation)
-    {
-      if(bufout[0] == 0x0d)
-      {
-        CPU_regA = 0x9b;
-      }
-    }
-    else
-    {
-      CPU_regA = bufout[0];
-    }
+  RBUF_LOCK;
+  c = rbuf_get(&inbuf);
+  if(c < 0)
+    c = 0;  /* nothing received */
+  if(translation && (c == 0x0d))
+    c = 0x9b;
 
-    bufend--;
-
-    for(j = 0; j <= bufend; j++)
-    {
-      bufout[j] = bufout[j+1];
-    }
-
-    /*Cycle the buffer again to skip over linefeed....*/
-    if(translation && linefeeds && (bufout[0] == 0x0a))
-    {
-      for(j = 0; j <= bufend; j++)
-      {
-        bufout[j] = bufout[j+1];
-      }
-    }
-    /*return; ???*/
-/*  } */
+  /*Skip over linefeed....*/
+  if(translation && linefeeds && (rbuf_peek(&inbuf) == 0x0a))
+    rbuf_get(&inbuf);
+  RBUF_UNLOCK;
 
+  CPU_regA = c;
   CPU_regY = 1;
   CPU_ClrN;
 }
@@ -1055,10 +1421,11 @@ void RDevice_WRIT(void)
   int port;
 #endif
 
+  RUNAHEAD_CHECK();
   CPU_regY = 1;
   CPU_ClrN;
 
-  /*bufend = Peek(747);*/
+  check_carrier();
 
   /* Translation mode */
   if(translation)
@@ -1070,20 +1437,17 @@ void RDevice_WRIT(void)
       {
         if((RDevice_serial_enabled == 0) && (connected == 0))
         { /* local echo */
-          bufend++;
-          bufout[bufend-1] = out_char;
-          bufout[bufend] = 0;
+          inbuf_put(out_char);
 
           command_end = 0;
           command_buf[command_end] = 0;
-          strcat(bufout, "OK\r\n");
-          bufend += 4;
+          inbuf_puts("OK\r\n");
 
         }
         else
         {
 #ifndef DREAMCAST
-          if(write(rdev_fd, (char *)&out_char, 1) != 1) /* Write return */
+          if(rdevice_write(&out_char, 1) != 1) /* Write return */
           {
             DBG_APRINT("R*: warning, 'write' did not write all bytes");
           }
@@ -1094,6 +1458,10 @@ void RDevice_WRIT(void)
         out_char = 0x0a;  /*set char for line feed to be output later....*/
       }
     }
+    else
+    {
+      out_char = CPU_regA;
+    }
   }
   else
   {
@@ -1116,9 +1484,7 @@ void RDevice_WRIT(void)
 #ifdef R_NETWORK
   if((RDevice_serial_enabled == 0) && (connected == 0))
   { /* Local echo - only do if in socket mode */
-    bufend++;
-    bufout[bufend-1] = out_char;
-    bufout[bufend] = 0;
+    inbuf_put(out_char);
 
     /* Grab Command */
     if((out_char == 0x9b) || (out_char == 0x0d))
@@ -1143,8 +1509,7 @@ void RDevice_WRIT(void)
           open_connection((char *)(strchr(command_buf, ' ')+1), port); /*send string after first space in line*/
         }
         command_buf[command_end] = 0;
-        strcat(bufout, "OK\r\n");
-        bufend += 4;
+        inbuf_puts("OK\r\n");
       /*Change translation command 'ATDL'*/
       }
       else if((command_buf[0] == 'A') && (command_buf[1] == 'T') && (command_buf[2] == 'D') && (command_buf[3] == 'L'))
@@ -1152,8 +1517,7 @@ void RDevice_WRIT(void)
         trans_cr = (trans_cr + 1) % 2;
 
         command_buf[command_end] = 0;
-        strcat(bufout, "OK\r\n");
-        bufend += 4;
+        inbuf_puts("OK\r\n");
       }
     }
     else
@@ -1174,7 +1538,7 @@ void RDevice_WRIT(void)
   else
 #endif /* R_NETWORK */
 #ifndef DREAMCAST
-    if((connected) && (write(rdev_fd, (char *)&out_char, 1) < 1))
+    if((connected) && (rdevice_write(&out_char, 1) < 1))
     { /* returns -1 if disconnected or 0 if could not send */
       perror("write");
       DBG_APRINT("R*: ERROR on write.");
@@ -1215,6 +1579,7 @@ void RDevice_STAT(void)
   int on;
   unsigned char telnet_command[2];
   /*static char IACctr = 0;*/
+  RUNAHEAD_CHECK();
   on = 1;
 
   if(Peek(764) == 1)
@@ -1223,6 +1588,8 @@ void RDevice_STAT(void)
   }
   devnum = MEMORY_dGetByte(Devices_ICDNOZ);
 
+  check_carrier();
+
 #ifdef R_NETWORK
   if(connected == 0)
   {
@@ -1279,19 +1646,20 @@ void RDevice_STAT(void)
           }
         }
         DBG_APRINT(MESSAGE);
-#ifndef HAVE_WINDOWS_H
+#if !defined(HAVE_WINDOWS_H) && !defined(R_POLLER)
         signal(SIGPIPE, catch_disconnect); /*Need to see if the other end disconnects...*/
         signal(SIGHUP, catch_disconnect); /*Need to see if the other end disconnects...*/
-#endif /* HAVE_WINDOWS_H */
+#endif /* !defined(HAVE_WINDOWS_H) && !defined(R_POLLER) */
 #ifdef HAVE_WINDOWS_H
         retval = ioctlsocket(rdev_fd, FIONBIO, &ioctlsocket_non_block);
 #else
         retval = fcntl( rdev_fd, F_SETFL, O_NONBLOCK);
 #endif /* HAVE_WINDOWS_H */
+        poller_start(rdev_fd, 1);
 
         /* Telnet negotiation */
         snprintf(MESSAGE, sizeof(MESSAGE), "%c%c%c%c%c%c%c%c%c", 0xff, 0xfb, 0x01, 0xff, 0xfb, 0x03, 0xff, 0xfd, 0x0f3);
-        if(write(rdev_fd, MESSAGE, 9) != 9)
+        if(rdevice_write((UBYTE *)MESSAGE, 9) != 9)
         {
           DBG_APRINT("R*: warning, 'write' did not write all bytes");
         }
@@ -1304,9 +1672,8 @@ void RDevice_STAT(void)
         retval = write(rdev_fd, &IACdontLinemode, 3);
         retval = write(rdev_fd, &IACwontLinemode, 3);
   */
-        bufout[0] = 0;
-        strcat(bufout, CONNECT_STRING);
-        bufend = strlen(CONNECT_STRING);
+        inbuf_clear();
+        inbuf_puts(CONNECT_STRING);
         close(sock);
       }
     }
@@ -1314,8 +1681,9 @@ void RDevice_STAT(void)
   else
 #endif /* R_NETWORK */
   {
-    /* Actually reading and setting the Atari input buffer here */
-    if(concurrent)
+    /* Actually reading and setting the Atari input buffer here,
+       unless the poller thread already does it */
+    if(concurrent && !poller_running)
     {
 #ifndef DREAMCAST
       bytesread = read(rdev_fd, (char *)&one, 1);
@@ -1379,17 +1747,20 @@ void RDevice_STAT(void)
         }
         else
         {
-          bufend++;
-          bufout[bufend-1] = one;
-          bufout[bufend] = 0;
+          inbuf_put(one);
           /*return;*/
         }
       }
     }
   }
 
-  /* Set all values at all memory locations we modify on exit */
-  Poke(746,0);
+  /* Set all values at all memory locations we modify on exit:
+     746 - error bits (0x10: input buffer overrun),
+     747/748 - characters waiting in the input buffer,
+     749 - characters waiting to be sent */
+  RBUF_LOCK;
+  Poke(746, overrun ? 0x10 : 0);
+  overrun = 0;
   Poke(748,0);
   Poke(749,0);
   CPU_regA = 1;
@@ -1398,7 +1769,13 @@ void RDevice_STAT(void)
 
   if(concurrent)
   {
-    Poke(747,bufend);
+    unsigned int count = rbuf_count(&inbuf);
+    Poke(747, count & 0xff);
+    Poke(748, count >> 8);
+#ifdef R_POLLER
+    count = rbuf_count(&outbuf);
+    Poke(749, count > 255 ? 255 : count);
+#endif /* R_POLLER */
   }
   else
   {
@@ -1406,6 +1783,7 @@ void RDevice_STAT(void)
     /*Poke(747,8);*/
     Poke(747,(12+48+192)); /* Write 0xfc to address 747 */
   }
+  RBUF_UNLOCK;
 }
 
 /*---------------------------------------------------------------------------
@@ -1415,6 +1793,7 @@ void RDevice_SPEC(void)
 {
   int iccom;
 
+  RUNAHEAD_CHECK();
   iccom = Peek(Devices_ICCOMZ);
   snprintf(MESSAGE, sizeof(MESSAGE), "R*: XIO %d", iccom);
   DBG_APRINT(MESSAGE);
@@ -1458,6 +1837,7 @@ void RDevice_SPEC(void)
 ---------------------------------------------------------------------------*/
 void RDevice_INIT(void)
 {
+  RUNAHEAD_CHECK();
   DBG_APRINT("R*: INIT");
   CPU_regA = 1;
   CPU_regY = 1;
@@ -1466,6 +1846,7 @@ void RDevice_INIT(void)
 
 void RDevice_Exit(void)
 {
+  poller_stop_thread();
 #ifdef HAVE_WINDOWS_H
   WSACleanup();
 #endif /* HAVE_WINDOWS_H */
@@ -0,0 +1,220 @@
+/*
+ * romcache.c - persistent cache of ROM and cartridge image identification
+ *
+ * Copyright (C) 2024 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#include "atari.h"
+#include "crc32.h"
+#include "log.h"
+#include "romcache.h"
+#include "util.h"
+
+/* The cache file consists of lines:
+     F <crc32> <size> <mtime> <path>   - CRC32 of a file
+     C <crc32> <kb> <type>             - type of a raw cartridge image
+   New entries are appended, so a later line overrides an earlier one, and
+   several processes can share one file. */
+
+typedef struct entry_t {
+	struct entry_t *next;
+	ULONG crc;
+	long size;     /* file size in bytes or image size in KB */
+	long mtime;    /* F entries only */
+	int type;      /* C entries only */
+	char path[1];  /* F entries only, allocated with the entry */
+} entry_t;
+
+enum { NUM_BUCKETS = 1024 };
+
+static entry_t *files[NUM_BUCKETS];
+static entry_t *carts[NUM_BUCKETS];
+static char *cache_filename = NULL;
+
+static unsigned int HashString(char const *s)
+{
+	unsigned int h = 5381;
+	while (*s != '\0')
+		h = h * 33 + (unsigned char)*s++;
+	return h % NUM_BUCKETS;
+}
+
+static entry_t *FindFile(char const *path)
+{
+	entry_t *e;
+	for (e = files[HashString(path)]; e != NULL; e = e->next)
+		if (strcmp(e->path, path) == 0)
+			return e;
+	return NULL;
+}
+
+static entry_t *FindCart(ULONG crc, int kb)
+{
+	entry_t *e;
+	for (e = carts[crc % NUM_BUCKETS]; e != NULL; e = e->next)
+		if (e->crc == crc && e->size == kb)
+			return e;
+	return NULL;
+}
+
+static void SetFile(char const *path, ULONG crc, long size, long mtime)
+{
+	entry_t *e = FindFile(path);
+	if (e == NULL) {
+		unsigned int h = HashString(path);
+		e = (entry_t *)Util_malloc(sizeof(entry_t) + strlen(path));
+		strcpy(e->path, path);
+		e->next = files[h];
+		files[h] = e;
+	}
+	e->crc = crc;
+	e->size = size;
+	e->mtime = mtime;
+}
+
+static void SetCart(ULONG crc, int kb, int type)
+{
+	entry_t *e = FindCart(crc, kb);
+	if (e == NULL) {
+		e = (entry_t *)Util_malloc(sizeof(entry_t));
+		e->path[0] = '\0';
+		e->crc = crc;
+		e->size = kb;
+		e->next = carts[crc % NUM_BUCKETS];
+		carts[crc % NUM_BUCKETS] = e;
+	}
+	e->type = type;
+}
+
+/* Appends a line to the cache file. */
+static void Append(char const *format, ...)
+{
+	FILE *fp;
+	va_list args;
+	if (cache_filename == NULL)
+		return;
+	fp = fopen(cache_filename, "a");
+	if (fp == NULL)
+		return;
+	va_start(args, format);
+	vfprintf(fp, format, args);
+	va_end(args);
+	fclose(fp);
+}
+
+int ROMCACHE_Open(char const *filename)
+{
+	FILE *fp;
+	char line[FILENAME_MAX + 64];
+
+	ROMCACHE_Close();
+	cache_filename = Util_strdup(filename);
+
+	fp = fopen(filename, "r");
+	if (fp == NULL)
+		/* A missing cache is created on first use. */
+		return !Util_fileexists(filename);
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		unsigned long crc;
+		long size;
+		long mtime;
+		int type;
+		int pos;
+		Util_chomp(line);
+		if (sscanf(line, "F %lx %ld %ld %n", &crc, &size, &mtime, &pos) == 3 && line[pos] != '\0')
+			SetFile(line + pos, (ULONG)crc, size, mtime);
+		else if (sscanf(line, "C %lx %ld %d", &crc, &size, &type) == 3)
+			SetCart((ULONG)crc, (int)size, type);
+	}
+	fclose(fp);
+	return TRUE;
+}
+
+void ROMCACHE_Close(void)
+{
+	int i;
+	for (i = 0; i < NUM_BUCKETS; i++) {
+		while (files[i] != NULL) {
+			entry_t *next = files[i]->next;
+			free(files[i]);
+			files[i] = next;
+		}
+		while (carts[i] != NULL) {
+			entry_t *next = carts[i]->next;
+			free(carts[i]);
+			carts[i] = next;
+		}
+	}
+	free(cache_filename);
+	cache_filename = NULL;
+}
+
+int ROMCACHE_FileCRC(char const *filename, FILE *f, int len, ULONG *result)
+{
+#ifdef HAVE_STAT
+	struct stat st;
+	entry_t *e;
+
+	if (cache_filename == NULL || stat(filename, &st) != 0)
+		return CRC32_FromFile(f, result);
+
+	e = FindFile(filename);
+	if (e != NULL && e->size == len && e->mtime == (long)st.st_mtime) {
+		*result = e->crc;
+		return TRUE;
+	}
+	if (!CRC32_FromFile(f, result))
+		return FALSE;
+	SetFile(filename, *result, len, (long)st.st_mtime);
+	Append("F %08lx %d %ld %s\n", (unsigned long)*result, len, (long)st.st_mtime, filename);
+	return TRUE;
+#else
+	return CRC32_FromFile(f, result);
+#endif
+}
+
+int ROMCACHE_GetCartType(ULONG crc, int kb)
+{
+	entry_t *e = FindCart(crc, kb);
+	return e == NULL ? 0 : e->type;
+}
+
+void ROMCACHE_SetCartType(ULONG crc, int kb, int type)
+{
+	entry_t *e;
+
+	if (cache_filename == NULL)
+		return;
+	e = FindCart(crc, kb);
+	if (e != NULL && e->type == type)
+		return;
+	SetCart(crc, kb, type);
+	Append("C %08lx %d %d\n", (unsigned long)crc, kb, type);
+}
@@ -0,0 +1,36 @@
+#ifndef ROMCACHE_H_
+#define ROMCACHE_H_
+
+#include <stdio.h>
+
+#include "atari.h"
+
+/* Persistent cache of facts about ROM and cartridge image files, kept in a
+   text file that can be shared by many emulator processes. It remembers
+   CRC32s of files (keyed by path, size and modification time), so ROM
+   searching doesn't have to read unchanged files again, and the types chosen
+   for raw cartridge images (keyed by CRC32 and size), so ambiguous images
+   don't need to be identified again. */
+
+/* Loads the cache from FILENAME and appends new entries to it from now on.
+   Returns FALSE if the file exists but cannot be read. */
+int ROMCACHE_Open(char const *filename);
+
+/* Forgets the cache contents. */
+void ROMCACHE_Close(void);
+
+/* Stores in *RESULT the CRC32 of the stream F of LEN bytes, opened from
+   FILENAME and positioned at its start. The file is only read if the cache
+   has no entry for it or it has changed since.
+   Returns non-zero on success or 0 on read error. */
+int ROMCACHE_FileCRC(char const *filename, FILE *f, int len, ULONG *result);
+
+/* Returns the cartridge type remembered for a raw image of KB kilobytes
+   with checksum CRC, or 0 (CARTRIDGE_NONE) if there is none. */
+int ROMCACHE_GetCartType(ULONG crc, int kb);
+
+/* Remembers TYPE as the cartridge type of a raw image of KB kilobytes
+   with checksum CRC. */
+void ROMCACHE_SetCartType(ULONG crc, int kb, int type);
+
+#endif /* ROMCACHE_H_ */
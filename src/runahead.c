@@ -0,0 +1,246 @@
+/*
+ * runahead.c - emulating frames ahead of the displayed one to reduce input lag
+ *
+ * Copyright (C) 2024 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "antic.h"
+#include "atari.h"
+#include "cassette.h"
+#include "gtia.h"
+#include "input.h"
+#include "log.h"
+#include "pokey.h"
+#include "runahead.h"
+#include "screen.h"
+#include "statesav.h"
+#include "util.h"
+#ifdef AF80
+#include "af80.h"
+#endif
+#ifdef BIT3
+#include "bit3.h"
+#endif
+#ifdef IDE
+#include "ide.h"
+#endif
+#ifdef NETSIO
+#include "netsio.h"
+#endif
+#ifdef PBI_BB
+#include "pbi_bb.h"
+#endif
+#ifdef PBI_MIO
+#include "pbi_mio.h"
+#endif
+#ifdef PBI_XLD
+#include "pbi_xld.h"
+#endif
+#ifdef XEP80_EMULATION
+#include "xep80.h"
+#endif
+
+int RUNAHEAD_frames = 0;
+int RUNAHEAD_active = FALSE;
+
+static jmp_buf abort_jmp;
+static ULONG *ahead_screen = NULL;
+
+int RUNAHEAD_ReadConfig(char *string, char *ptr)
+{
+	if (strcmp(string, "RUNAHEAD_FRAMES") == 0) {
+		int value = Util_sscandec(ptr);
+		if (value < 0 || value > RUNAHEAD_MAX_FRAMES)
+			return FALSE;
+		RUNAHEAD_frames = value;
+	}
+	else return FALSE;
+	return TRUE;
+}
+
+void RUNAHEAD_WriteConfig(FILE *fp)
+{
+	fprintf(fp, "RUNAHEAD_FRAMES=%d\n", RUNAHEAD_frames);
+}
+
+int RUNAHEAD_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+
+		if (strcmp(argv[i], "-runahead") == 0) {
+			if (i_a) {
+				RUNAHEAD_frames = Util_sscandec(argv[++i]);
+				if (RUNAHEAD_frames < 0 || RUNAHEAD_frames > RUNAHEAD_MAX_FRAMES) {
+					Log_print("Invalid number of run-ahead frames, must be 0-%d", RUNAHEAD_MAX_FRAMES);
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0)
+				Log_print("\t-runahead <n>    Show the frame <n> frames ahead to reduce input lag (0-%d)", RUNAHEAD_MAX_FRAMES);
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	return TRUE;
+}
+
+void RUNAHEAD_Exit(void)
+{
+#ifdef ANTIC_LINE_CACHE
+	ANTIC_ForgetLines(ahead_screen);
+#endif
+	free(ahead_screen);
+	ahead_screen = NULL;
+}
+
+/* Returns FALSE if something in use keeps state outside the state saves,
+   or does I/O without going through SIO or the OS patches. */
+static int CanRunAhead(void)
+{
+	if (CASSETTE_readable || CASSETTE_writable)
+		return FALSE;
+	if (INPUT_mouse_mode == INPUT_MOUSE_ST || INPUT_mouse_mode == INPUT_MOUSE_AMIGA
+	 || INPUT_mouse_mode == INPUT_MOUSE_TRAK)
+		return FALSE;
+#ifdef AF80
+	if (AF80_enabled)
+		return FALSE;
+#endif
+#ifdef BIT3
+	if (BIT3_enabled)
+		return FALSE;
+#endif
+#ifdef IDE
+	if (IDE_enabled)
+		return FALSE;
+#endif
+#ifdef NETSIO
+	if (netsio_enabled)
+		return FALSE;
+#endif
+#ifdef PBI_BB
+	if (PBI_BB_enabled)
+		return FALSE;
+#endif
+#ifdef PBI_MIO
+	if (PBI_MIO_enabled)
+		return FALSE;
+#endif
+#ifdef PBI_XLD
+	if (PBI_XLD_enabled)
+		return FALSE;
+#endif
+#ifdef XEP80_EMULATION
+	if (XEP80_enabled)
+		return FALSE;
+#endif
+	return TRUE;
+}
+
+void RUNAHEAD_Frame(void)
+{
+	ULONG *main_screen = Screen_atari;
+	unsigned int cpu_clock = ANTIC_screenline_cpu_clock;
+	int wsync_halt = ANTIC_wsync_halt;
+#ifdef NEW_CYCLE_EXACT
+	int delayed_wsync = ANTIC_delayed_wsync;
+#endif
+	int aborted = FALSE;
+	int i;
+
+	if (RUNAHEAD_frames <= 0 || !CanRunAhead() || !StateSav_SaveQuickState()) {
+#ifdef ANTIC_LINE_CACHE
+		/* the real frame is shown, not the last look-ahead frame */
+		ANTIC_ForgetLines(ahead_screen);
+#endif
+		return;
+	}
+	if (ahead_screen == NULL) {
+		ahead_screen = (ULONG *) Util_malloc(Screen_WIDTH * Screen_HEIGHT);
+		/* ANTIC doesn't draw the outermost columns */
+		memset(ahead_screen, 0, Screen_WIDTH * Screen_HEIGHT);
+	}
+
+	/* Draw on a separate screen, so that the real frame is still there
+	   if the look-ahead is abandoned. */
+	Screen_atari = ahead_screen;
+	RUNAHEAD_active = TRUE;
+	if (setjmp(abort_jmp) == 0) {
+		/* The current frame is drawn, but POKEY hasn't finished it yet. */
+		for (i = 1; i <= RUNAHEAD_frames; i++) {
+			POKEY_Frame();
+			GTIA_Frame();
+			ANTIC_Frame(i == RUNAHEAD_frames ? TRUE : ANTIC_COLLISIONS_ONLY);
+		}
+		memcpy(main_screen, ahead_screen, Screen_WIDTH * Screen_HEIGHT);
+	}
+	else
+		aborted = TRUE;
+	Screen_atari = main_screen;
+#ifdef ANTIC_LINE_CACHE
+	/* ANTIC keeps the lines of each screen apart, so the look-ahead frames
+	   skip the lines that are the same as in the last look-ahead frame.
+	   The lines of the real frame are gone once it is overwritten. If the
+	   look-ahead is abandoned, the real frame is shown instead, and it is
+	   the look-ahead screen that no longer matches the display. */
+	if (aborted) {
+		ANTIC_ForgetLines(ahead_screen);
+		memset(Screen_dirty_lines, 1, sizeof(Screen_dirty_lines));
+	}
+	else
+		ANTIC_ForgetLines(main_screen);
+#endif
+
+	/* The CPU clock isn't in the state, but POKEY and the sound are timed
+	   by it. Sound stays off until the real state is back. WSYNC is not
+	   in the state either, and an abort may come in the middle of a line. */
+	ANTIC_screenline_cpu_clock = cpu_clock;
+	ANTIC_wsync_halt = wsync_halt;
+#ifdef NEW_CYCLE_EXACT
+	ANTIC_delayed_wsync = delayed_wsync;
+#endif
+	StateSav_ReadQuickState();
+	if (aborted)
+		ANTIC_AbortFrame();
+	RUNAHEAD_active = FALSE;
+}
+
+void RUNAHEAD_Abort(void)
+{
+	longjmp(abort_jmp, 1);
+}
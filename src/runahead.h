@@ -0,0 +1,46 @@
+#ifndef RUNAHEAD_H_
+#define RUNAHEAD_H_
+
+#include <stdio.h>
+
+#include "atari.h"
+
+/* Run-ahead hides the latency of games that react to input a frame or more
+   after reading it. After each displayed frame the emulator takes a quick
+   state in memory, emulates RUNAHEAD_frames more frames with the same input,
+   shows the last of them and goes back to the quick state. Only the real
+   frames produce sound, and the look-ahead frames never touch disks or
+   other devices: a look-ahead frame that would do any I/O, or stop in the
+   monitor or the crash menu, is abandoned and the real frame is shown. */
+
+/* Number of frames to run ahead; 0 disables run-ahead. */
+extern int RUNAHEAD_frames;
+#define RUNAHEAD_MAX_FRAMES 4
+
+/* TRUE while look-ahead frames are emulated. */
+extern int RUNAHEAD_active;
+
+int RUNAHEAD_ReadConfig(char *string, char *ptr);
+void RUNAHEAD_WriteConfig(FILE *fp);
+int RUNAHEAD_Initialise(int *argc, char *argv[]);
+void RUNAHEAD_Exit(void);
+
+/* Runs ahead from the end of a frame just drawn on Screen_atari, replacing
+   it with the look-ahead frame. */
+void RUNAHEAD_Frame(void);
+
+/* Abandons the look-ahead frames. Must only be called while RUNAHEAD_active. */
+void RUNAHEAD_Abort(void);
+
+/* Abandons the look-ahead frames if they are being emulated. The quick
+   state only holds the emulated machine, so this goes at the start of
+   anything with effects outside it: host I/O (disks, tape, H:, P:, E:, B:,
+   R:, the serial port, binary loading) and stopping in the monitor or the
+   crash menu. The real frame then does it. */
+#ifdef RUNAHEAD
+#define RUNAHEAD_CHECK() do { if (RUNAHEAD_active) RUNAHEAD_Abort(); } while (0)
+#else
+#define RUNAHEAD_CHECK() do { } while (0)
+#endif
+
+#endif /* RUNAHEAD_H_ */
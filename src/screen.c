@@ -40,9 +40,11 @@
 #include "util.h"
 #if defined(SCREENSHOTS) || defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 #include "file_export.h"
+#include "frame_export.h"
 #endif
 
 ULONG *Screen_atari = NULL;
+UBYTE Screen_dirty_lines[Screen_HEIGHT];
 #ifdef DIRTYRECT
 UBYTE *Screen_dirty = NULL;
 #endif
@@ -872,51 +874,58 @@ void Screen_DrawStatusText(void) {
 }
 
 #ifdef SCREENSHOTS
+/* Draws the next frame, to blend with Screen_atari in an interlaced
+   screenshot. Returns it, to be freed by the caller. */
+static UBYTE *DrawSecondField(void)
+{
+	ULONG *main_screen_atari = Screen_atari;
+	UBYTE *ptr2 = (UBYTE *) Util_malloc(Screen_WIDTH * Screen_HEIGHT);
+	Screen_atari = (ULONG *) ptr2;
+	ANTIC_Frame(TRUE); /* draw on Screen_atari */
+	Screen_atari = main_screen_atari;
+	return ptr2;
+}
+
 int Screen_SaveScreenshot(const char *filename, int interlaced)
 {
 	int result;
-	ULONG *main_screen_atari;
-	UBYTE *ptr1;
 	UBYTE *ptr2;
 
 	if (!File_Export_ImageTypeSupported(filename)) {
 		Log_print("Unsupported image type for file: %s", filename);
 		return FALSE;
 	}
-	main_screen_atari = Screen_atari;
-	ptr1 = (UBYTE *) Screen_atari;
-	if (interlaced) {
-		Screen_atari = (ULONG *) Util_malloc(Screen_WIDTH * Screen_HEIGHT);
-		ptr2 = (UBYTE *) Screen_atari;
-		ANTIC_Frame(TRUE); /* draw on Screen_atari */
-	}
-	else {
-		ptr2 = NULL;
-	}
-	result = File_Export_SaveScreen(filename, ptr1, ptr2);
+	ptr2 = interlaced ? DrawSecondField() : NULL;
+	result = File_Export_SaveScreen(filename, (UBYTE *) Screen_atari, ptr2);
 	if (!result) {
 		Log_print("Failed saving to file: %s", filename);
 	}
-	if (interlaced) {
-		free(Screen_atari);
-		Screen_atari = main_screen_atari;
-	}
+	free(ptr2);
 	return result;
 }
 
 void Screen_SaveNextScreenshot(int interlaced)
 {
 	char filename[FILENAME_MAX];
+	UBYTE *ptr2;
 	if (!screenshot_no_max) {
 		screenshot_no_max = Util_filenamepattern(DEFAULT_SCREENSHOT_FILENAME_FORMAT, screenshot_filename_format, FILENAME_MAX, NULL);
 	}
 	Util_findnextfilename(screenshot_filename_format, &screenshot_no_last, screenshot_no_max, filename, sizeof(filename), TRUE);
-	Screen_SaveScreenshot(filename, interlaced);
+	if (!File_Export_ImageTypeSupported(filename)) {
+		Log_print("Unsupported image type for file: %s", filename);
+		return;
+	}
+	/* saved in the background, not to stop the emulation */
+	ptr2 = interlaced ? DrawSecondField() : NULL;
+	Frame_Export_Queue(filename, (UBYTE *) Screen_atari, ptr2);
+	free(ptr2);
 }
 #endif /* !SCREENSHOTS */
 
 void Screen_EntireDirty(void)
 {
+	memset(Screen_dirty_lines, 1, sizeof(Screen_dirty_lines));
 #ifdef DIRTYRECT
 	if (Screen_dirty)
 		memset(Screen_dirty, 1, Screen_WIDTH * Screen_HEIGHT / 8);
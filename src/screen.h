@@ -21,6 +21,12 @@ extern ULONG *Screen_atari;
 #define Screen_WIDTH  384
 #define Screen_HEIGHT 240
 
+/* Screen_dirty_lines[y] is non-zero if line y of Screen_atari may have
+   changed in the last frame drawn by ANTIC_Frame, including changes by
+   ANTIC_Video* functions (status display, mouse pointer, UI) since then.
+   Displays and encoders can skip the other lines. */
+extern UBYTE Screen_dirty_lines[Screen_HEIGHT];
+
 #ifdef BITPL_SCR
 extern ULONG *Screen_atari_b;
 extern ULONG *Screen_atari1;
@@ -38,6 +38,7 @@
 #include "pbi_proto80.h"
 #include "platform.h"
 #include "screen.h"
+#include "text80.h"
 #include "util.h"
 #include "videomode.h"
 #include "xep80.h"
@@ -828,229 +829,67 @@ void SDL_VIDEO_BlitProto80_32(Uint32 *dest, int first_column, int last_column, i
 	}
 }
 
-#ifdef AF80
-void SDL_VIDEO_BlitAF80_8(Uint32 *dest, int first_column, int last_column, int pitch, int first_line, int last_line, int blink)
+#if defined(AF80) || defined(BIT3)
+void SDL_VIDEO_BlitText80_8(Uint32 *dest, UBYTE const *src, int pitch, int width, int height, int blink)
 {
-	int skip = pitch - (last_column - first_column)*2;
-	register Uint32 *start32 = dest;
-	unsigned int column;
-	UBYTE pixels;
-	register Uint32 quad;
-	for (; first_line < last_line; first_line++) {
-		for (column = first_column; column < last_column; column++) {
-			int i;
-			int colour;
-			pixels = AF80_GetPixels(first_line, column, &colour, blink);
-			for (i = 0; i < 2; i++) {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-				if (pixels & 0x01)
-					quad = colour << 24;
-				else
-					quad = 0;
-				if (pixels & 0x02)
-					quad |= colour << 16;
-				if (pixels & 0x04)
-					quad |= colour << 8;
-				if (pixels & 0x08)
-					quad |= colour;
-#else
-				if (pixels & 0x01)
-					quad = colour;
-				else
-					quad = 0;
-				if (pixels & 0x02)
-					quad |= colour << 8;
-				if (pixels & 0x04)
-					quad |= colour << 16;
-				if (pixels & 0x08)
-					quad |= colour << 24;
-#endif
-				*start32++ = quad;
-				pixels >>= 4;
-			}
-		}
-		start32 += skip;
-	}
-}
-
-void SDL_VIDEO_BlitAF80_16(Uint32 *dest, int first_column, int last_column, int pitch, int first_line, int last_line, int blink, Uint16 *palette16)
-{
-	Uint32 const black = (Uint32)palette16[0];
-	Uint32 const black2 = black << 16;
-	int skip = pitch - (last_column - first_column)*4;
-	register Uint32 *start32 = dest;
-	unsigned int column;
-	UBYTE pixels;
-	register Uint32 quad;
-	for (; first_line < last_line; first_line++) {
-		for (column = first_column; column < last_column; column++) {
-			int i;
-			int colour;
-			pixels = AF80_GetPixels(first_line, column, &colour, blink);
-			for (i = 0; i < 4; i++) {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-				if (pixels & 0x01)
-					quad = palette16[colour] << 16;
-				else
-					quad = black2;
-				if (pixels & 0x02)
-					quad |= palette16[colour];
-				else
-					quad |= black;
-#else
-				if (pixels & 0x01)
-					quad = palette16[colour];
-				else
-					quad = black;
-				if (pixels & 0x02)
-					quad |= palette16[colour] << 16;
-				else
-					quad |= black2;
-#endif
-				*start32++ = quad;
-				pixels >>= 2;
-			}
-		}
-		start32 += skip;
-	}
-}
-
-void SDL_VIDEO_BlitAF80_32(Uint32 *dest, int first_column, int last_column, int pitch, int first_line, int last_line, int blink, Uint32 *palette32)
-{
-	Uint32 const black = palette32[0];
-	int skip = pitch - (last_column - first_column)*8;
-	register Uint32 *start32 = dest;
-	unsigned int column;
-	UBYTE pixels;
-	for (; first_line < last_line; first_line++) {
-		for (column = first_column; column < last_column; column++) {
-			int i;
-			int colour;
-			pixels = AF80_GetPixels(first_line, column, &colour, blink);
-			for (i = 0; i < 8; i++) {
-				if (pixels & 0x01)
-					*start32++ = palette32[colour];
-				else
-					*start32++ = black;
-				pixels >>= 1;
-			}
-		}
-		start32 += skip;
-	}
-}
-#endif /* AF80 */
-
-#ifdef BIT3
-void SDL_VIDEO_BlitBIT3_8(Uint32 *dest, int first_column, int last_column, int pitch, int first_line, int last_line, int blink)
-{
-	int skip = pitch - (last_column - first_column)*2;
-	register Uint32 *start32 = dest;
-	unsigned int column;
-	UBYTE pixels;
-	register Uint32 quad;
-	for (; first_line < last_line; first_line++) {
-		for (column = first_column; column < last_column; column++) {
-			int i;
-			int colour;
-			pixels = BIT3_GetPixels(first_line, column, &colour, blink);
-			for (i = 0; i < 2; i++) {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-				if (pixels & 0x01)
-					quad = colour << 24;
-				else
-					quad = 0;
-				if (pixels & 0x02)
-					quad |= colour << 16;
-				if (pixels & 0x04)
-					quad |= colour << 8;
-				if (pixels & 0x08)
-					quad |= colour;
-#else
-				if (pixels & 0x01)
-					quad = colour;
-				else
-					quad = 0;
-				if (pixels & 0x02)
-					quad |= colour << 8;
-				if (pixels & 0x04)
-					quad |= colour << 16;
-				if (pixels & 0x08)
-					quad |= colour << 24;
-#endif
-				*start32++ = quad;
-				pixels >>= 4;
-			}
-		}
-		start32 += skip;
+	UBYTE colours[TEXT80_NUM_VALUES];
+	register Uint8 *start8;
+	register int pos;
+	TEXT80_GetColours(colours, blink);
+	while (height > 0) {
+		start8 = (Uint8 *)dest;
+		for (pos = 0; pos < width; pos++)
+			start8[pos] = colours[src[pos]];
+		src += TEXT80_WIDTH;
+		dest += pitch;
+		height--;
 	}
 }
 
-void SDL_VIDEO_BlitBIT3_16(Uint32 *dest, int first_column, int last_column, int pitch, int first_line, int last_line, int blink, Uint16 *palette16)
+void SDL_VIDEO_BlitText80_16(Uint32 *dest, UBYTE const *src, int pitch, int width, int height, int blink, Uint16 *palette16)
 {
-	Uint32 const black = (Uint32)palette16[0];
-	Uint32 const black2 = black << 16;
-	int skip = pitch - (last_column - first_column)*4;
+	UBYTE colours[TEXT80_NUM_VALUES];
+	Uint32 lookup[TEXT80_NUM_VALUES];
 	register Uint32 *start32 = dest;
-	unsigned int column;
-	UBYTE pixels;
-	register Uint32 quad;
-	for (; first_line < last_line; first_line++) {
-		for (column = first_column; column < last_column; column++) {
-			int i;
-			int colour;
-			pixels = BIT3_GetPixels(first_line, column, &colour, blink);
-			for (i = 0; i < 4; i++) {
+	register int pos;
+	int i;
+	TEXT80_GetColours(colours, blink);
+	for (i = 0; i < TEXT80_NUM_VALUES; i++)
+		lookup[i] = palette16[colours[i]];
+	width = (width + 1) >> 1;
+	while (height > 0) {
+		for (pos = 0; pos < width; pos++) {
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
-				if (pixels & 0x01)
-					quad = palette16[colour] << 16;
-				else
-					quad = black2;
-				if (pixels & 0x02)
-					quad |= palette16[colour];
-				else
-					quad |= black;
+			start32[pos] = (lookup[src[2 * pos]] << 16) | lookup[src[2 * pos + 1]];
 #else
-				if (pixels & 0x01)
-					quad = palette16[colour];
-				else
-					quad = black;
-				if (pixels & 0x02)
-					quad |= palette16[colour] << 16;
-				else
-					quad |= black2;
+			start32[pos] = lookup[src[2 * pos]] | (lookup[src[2 * pos + 1]] << 16);
 #endif
-				*start32++ = quad;
-				pixels >>= 2;
-			}
 		}
-		start32 += skip;
+		src += TEXT80_WIDTH;
+		start32 += pitch;
+		height--;
 	}
 }
 
-void SDL_VIDEO_BlitBIT3_32(Uint32 *dest, int first_column, int last_column, int pitch, int first_line, int last_line, int blink, Uint32 *palette32)
+void SDL_VIDEO_BlitText80_32(Uint32 *dest, UBYTE const *src, int pitch, int width, int height, int blink, Uint32 *palette32)
 {
-	Uint32 const black = palette32[0];
-	int skip = pitch - (last_column - first_column)*8;
+	UBYTE colours[TEXT80_NUM_VALUES];
+	Uint32 lookup[TEXT80_NUM_VALUES];
 	register Uint32 *start32 = dest;
-	unsigned int column;
-	UBYTE pixels;
-	for (; first_line < last_line; first_line++) {
-		for (column = first_column; column < last_column; column++) {
-			int i;
-			int colour;
-			pixels = BIT3_GetPixels(first_line, column, &colour, blink);
-			for (i = 0; i < 8; i++) {
-				if (pixels & 0x01)
-					*start32++ = palette32[colour];
-				else
-					*start32++ = black;
-				pixels >>= 1;
-			}
-		}
-		start32 += skip;
+	register int pos;
+	int i;
+	TEXT80_GetColours(colours, blink);
+	for (i = 0; i < TEXT80_NUM_VALUES; i++)
+		lookup[i] = palette32[colours[i]];
+	while (height > 0) {
+		for (pos = 0; pos < width; pos++)
+			start32[pos] = lookup[src[pos]];
+		src += TEXT80_WIDTH;
+		start32 += pitch;
+		height--;
 	}
 }
-#endif /* BIT3 */
+#endif /* defined(AF80) || defined(BIT3) */
 
 void SDL_VIDEO_CrtBarrelPercentage(int value) {
 	if (value < 0)
@@ -2045,16 +2045,23 @@ static void DisplayPalBlending(GLvoid *dest)
 #endif /* PAL_BLENDING */
 
 #if NTSC_FILTER
-static void DisplayNTSCEmu(GLvoid *dest)
+/* Filters Atari rows FIRST to LAST-1 into the texture DEST. */
+static void NTSCEmuBand(int first, int last, void *dest)
 {
+	long pitch = VIDEOMODE_actual_width * (bpp_32 ? 4 : 2);
 	(*pixel_formats[SDL_VIDEO_GL_pixel_format].ntsc_blit_func)(
 		FILTER_NTSC_emu,
-		(ATARI_NTSC_IN_T *) ((UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left),
+		(ATARI_NTSC_IN_T *) ((UBYTE *)Screen_atari + Screen_WIDTH * (VIDEOMODE_src_offset_top + first) + VIDEOMODE_src_offset_left),
 		Screen_WIDTH,
 		VIDEOMODE_src_width,
-		VIDEOMODE_src_height,
-		dest,
-		VIDEOMODE_actual_width * (bpp_32 ? 4 : 2));
+		last - first,
+		(Uint8 *)dest + pitch * first,
+		pitch);
+}
+
+static void DisplayNTSCEmu(GLvoid *dest)
+{
+	FILTER_NTSC_ForEachBand(VIDEOMODE_src_height, &NTSCEmuBand, dest);
 }
 #endif
 
@@ -2092,41 +2099,36 @@ static void DisplayProto80(GLvoid *dest)
 }
 #endif
 
-#ifdef AF80
-static void DisplayAF80(GLvoid *dest)
+#if defined(AF80) || defined(BIT3)
+/* Blits the image of an 80-column card; *FRAME counts frames for blinking. */
+static void DisplayText80(GLvoid *dest, TEXT80_t const *text, int *frame)
 {
-	int first_column = (VIDEOMODE_src_offset_left+7) / 8;
-	int last_column = (VIDEOMODE_src_offset_left + VIDEOMODE_src_width) / 8;
-	int first_line = VIDEOMODE_src_offset_top;
-	int last_line = first_line + VIDEOMODE_src_height;
-	static int AF80Frame = 0;
+	UBYTE const *screen = text->pixels + TEXT80_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
 	int blink;
-	AF80Frame++;
-	if (AF80Frame == 60) AF80Frame = 0;
-	blink = AF80Frame >= 30;
+	if (++*frame == 60) *frame = 0;
+	blink = *frame >= 30;
 	if (bpp_32)
-		SDL_VIDEO_BlitAF80_32((Uint32*)dest, first_column, last_column, VIDEOMODE_actual_width, first_line, last_line, blink, SDL_PALETTE_buffer.bpp32);
+		SDL_VIDEO_BlitText80_32((Uint32*)dest, screen, VIDEOMODE_actual_width, VIDEOMODE_src_width, VIDEOMODE_src_height, blink, SDL_PALETTE_buffer.bpp32);
 	else
-		SDL_VIDEO_BlitAF80_16((Uint32*)dest, first_column, last_column, VIDEOMODE_actual_width/2, first_line, last_line, blink, SDL_PALETTE_buffer.bpp16);
+		SDL_VIDEO_BlitText80_16((Uint32*)dest, screen, VIDEOMODE_actual_width/2, VIDEOMODE_src_width, VIDEOMODE_src_height, blink, SDL_PALETTE_buffer.bpp16);
+}
+#endif
+
+#ifdef AF80
+static void DisplayAF80(GLvoid *dest)
+{
+	static int AF80Frame = 0;
+	AF80_UpdateText();
+	DisplayText80(dest, &AF80_text, &AF80Frame);
 }
 #endif
 
 #ifdef BIT3
 static void DisplayBIT3(GLvoid *dest)
 {
-	int first_column = (VIDEOMODE_src_offset_left+7) / 8;
-	int last_column = (VIDEOMODE_src_offset_left + VIDEOMODE_src_width) / 8;
-	int first_line = VIDEOMODE_src_offset_top;
-	int last_line = first_line + VIDEOMODE_src_height;
 	static int BIT3Frame = 0;
-	int blink;
-	BIT3Frame++;
-	if (BIT3Frame == 60) BIT3Frame = 0;
-	blink = BIT3Frame >= 30;
-	if (bpp_32)
-		SDL_VIDEO_BlitBIT3_32((Uint32*)dest, first_column, last_column, VIDEOMODE_actual_width, first_line, last_line, blink, SDL_PALETTE_buffer.bpp32);
-	else
-		SDL_VIDEO_BlitBIT3_16((Uint32*)dest, first_column, last_column, VIDEOMODE_actual_width/2, first_line, last_line, blink, SDL_PALETTE_buffer.bpp16);
+	BIT3_UpdateText();
+	DisplayText80(dest, &BIT3_text, &BIT3Frame);
 }
 #endif
 
@@ -431,6 +431,29 @@ int SDL_VIDEO_SW_ToggleBpp(void)
  ******************************************************************************
  */
 
+/* Darkens a scanline DEST of WIDTH pairs of 16-bit pixels: it gets SRC, or
+   the average of SRC and NEXT if NEXT is not NULL, times FACTOR/32. */
+static void scanLine_16(Uint32 *dest, Uint32 const *src, Uint32 const *next, int width, int factor)
+{
+	int w;
+	if (next != NULL) {
+		for (w = 0; w < width; w++) {
+			Uint32 pixel = src[w];
+			Uint32 pixel2 = next[w];
+			Uint32 a = ((((pixel & 0x07e0f81f)+(pixel2 & 0x07e0f81f)) * factor) & 0xfc1f03e0) >> 5;
+			Uint32 b = ((((pixel >> 5) & 0x07c0f83f)+((pixel2 >> 5) & 0x07c0f83f)) * factor) & 0xf81f07e0;
+			dest[w] = a | b;
+		}
+	} else {
+		for (w = 0; w < width; w++) {
+			Uint32 pixel = src[w];
+			Uint32 a = (((pixel & 0x07e0f81f) * factor) & 0xfc1f03e0) >> 5;
+			Uint32 b = (((pixel >> 5) & 0x07c0f83f) * factor) & 0xf81f07e0;
+			dest[w] = a | b;
+		}
+	}
+}
+
 /* Modified version, which optionally uses interpolation (slower but better).
    Caution! This function assumes that the 16-bit screen format is 565
    (rrrrrggg gggbbbbb). */
@@ -439,7 +462,7 @@ static void scanLines_16(void* pBuffer, int width, int height, int pitch, int sc
 	Uint32* pBuf = (Uint32*)(pBuffer)+pitch/sizeof(Uint32);
 	Uint32* sBuf = (Uint32*)(pBuffer);
 	Uint32* tBuf = (Uint32*)(pBuffer)+pitch*2/sizeof(Uint32);
-	int w, h;
+	int h;
 	static int prev_scanLinesPct;
 
 	pitch = pitch * 2 / (int)sizeof(Uint32);
@@ -476,13 +499,7 @@ static void scanLines_16(void* pBuffer, int width, int height, int pitch, int sc
 	if (SDL_VIDEO_interpolate_scanlines) {
 		scanLinesPct = (100-scanLinesPct) * 32 / 200;
 		for (h = 0; h < height-1; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 pixel2 = tBuf[w];
-				Uint32 a = ((((pixel & 0x07e0f81f)+(pixel2 & 0x07e0f81f)) * scanLinesPct) & 0xfc1f03e0) >> 5;
-				Uint32 b = ((((pixel >> 5) & 0x07c0f83f)+((pixel2 >> 5) & 0x07c0f83f)) * scanLinesPct) & 0xf81f07e0;
-				pBuf[w] = a | b;
-			}
+			scanLine_16(pBuf, sBuf, tBuf, width, scanLinesPct);
 			sBuf += pitch;
 			tBuf += pitch;
 			pBuf += pitch;
@@ -490,18 +507,35 @@ static void scanLines_16(void* pBuffer, int width, int height, int pitch, int sc
 	} else {
 		scanLinesPct = (100-scanLinesPct) * 32 / 100;
 		for (h = 0; h < height; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 a = (((pixel & 0x07e0f81f) * scanLinesPct) & 0xfc1f03e0) >> 5;
-				Uint32 b = (((pixel >> 5) & 0x07c0f83f) * scanLinesPct) & 0xf81f07e0;
-				pBuf[w] = a | b;
-			}
+			scanLine_16(pBuf, sBuf, NULL, width, scanLinesPct);
 			sBuf += pitch;
 			pBuf += pitch;
 		}
 	}
 }
 
+/* Version of scanLine_16 for WIDTH 32-bit pixels, with FACTOR/256. */
+static void scanLine_32(Uint32 *dest, Uint32 const *src, Uint32 const *next, int width, int factor)
+{
+	int w;
+	if (next != NULL) {
+		for (w = 0; w < width; w++) {
+			Uint32 pixel = src[w];
+			Uint32 pixel2 = next[w];
+			Uint32 a = ((((pixel & 0x00ff00ff)+(pixel2 & 0x00ff00ff)) * factor) & 0xff00ff00) >> 8;
+			Uint32 b = ((((pixel & 0x0000ff00)+(pixel2 & 0x0000ff00)) >> 8) * factor) & 0x0000ff00;
+			dest[w] = a | b;
+		}
+	} else {
+		for (w = 0; w < width; w++) {
+			Uint32 pixel = src[w];
+			Uint32 a = (((pixel & 0x00ff00ff) * factor) & 0xff00ff00) >> 8;
+			Uint32 b = (((pixel & 0x0000ff00) >> 8) * factor) & 0x0000ff00;
+			dest[w] = a | b;
+		}
+	}
+}
+
 /* Modified version of scanLines_16, for 32-bit screen.
    Caution! This function assumes that the 32-bit screen format is ARGB
    (aaaaaaaa rrrrrrrr gggggggg bbbbbbbb). */
@@ -510,7 +544,7 @@ static void scanLines_32(void* pBuffer, int width, int height, int pitch, int sc
 	Uint32* pBuf = (Uint32*)(pBuffer)+pitch/sizeof(Uint32);
 	Uint32* sBuf = (Uint32*)(pBuffer);
 	Uint32* tBuf = (Uint32*)(pBuffer)+pitch*2/sizeof(Uint32);
-	int w, h;
+	int h;
 	static int prev_scanLinesPct;
 
 	pitch = pitch * 2 / (int)sizeof(Uint32);
@@ -546,13 +580,7 @@ static void scanLines_32(void* pBuffer, int width, int height, int pitch, int sc
 	if (SDL_VIDEO_interpolate_scanlines) {
 		scanLinesPct = (100-scanLinesPct) * 256 / 200;
 		for (h = 0; h < height-1; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 pixel2 = tBuf[w];
-				Uint32 a = ((((pixel & 0x00ff00ff)+(pixel2 & 0x00ff00ff)) * scanLinesPct) & 0xff00ff00) >> 8;
-				Uint32 b = ((((pixel & 0x0000ff00)+(pixel2 & 0x0000ff00)) >> 8) * scanLinesPct) & 0x0000ff00;
-				pBuf[w] = a | b;
-			}
+			scanLine_32(pBuf, sBuf, tBuf, width, scanLinesPct);
 			sBuf += pitch;
 			tBuf += pitch;
 			pBuf += pitch;
@@ -560,12 +588,7 @@ static void scanLines_32(void* pBuffer, int width, int height, int pitch, int sc
 	} else {
 		scanLinesPct = (100-scanLinesPct) * 256 / 100;
 		for (h = 0; h < height; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 a = (((pixel & 0x00ff00ff) * scanLinesPct) & 0xff00ff00) >> 8;
-				Uint32 b = (((pixel & 0x0000ff00) >> 8) * scanLinesPct) & 0x0000ff00;
-				pBuf[w] = a | b;
-			}
+			scanLine_32(pBuf, sBuf, NULL, width, scanLinesPct);
 			sBuf += pitch;
 			pBuf += pitch;
 		}
@@ -608,34 +631,89 @@ static void DisplayXEP80(void)
 #endif
 
 #ifdef NTSC_FILTER
+/* What DisplayNTSCEmu's bands draw */
+typedef struct {
+	void (*blit)(atari_ntsc_t const *ntsc, ATARI_NTSC_IN_T const *atari_in,
+	             long in_row_width, int in_width, int in_height,
+	             void *rgb_out, long out_pitch);
+	void (*scanline)(Uint32 *dest, Uint32 const *src, Uint32 const *next, int width, int factor);
+	ATARI_NTSC_IN_T const *src;
+	Uint8 *dest; /* rows are doubled, every other one is a scanline */
+	int pitch;
+	int width; /* of scanlines, in Uint32s */
+	int percentage;
+	int factor;
+	int interpolate;
+} ntsc_emu_t;
+
+/* Fills a scanline like scanLines_16/32 would. */
+static void NTSCEmuScanline(ntsc_emu_t const *emu, Uint8 *dest, Uint8 const *src, Uint8 const *next)
+{
+	if (emu->percentage == 100)
+		memset(dest, 0, emu->width * sizeof(Uint32));
+	else if (emu->percentage == 0)
+		memcpy(dest, src, emu->width * sizeof(Uint32));
+	else
+		(*emu->scanline)((Uint32 *) dest, (Uint32 const *) src, (Uint32 const *) next, emu->width, emu->factor);
+}
+
+/* Filters Atari rows FIRST to LAST-1 and fills the scanlines below them,
+   while the filtered rows are still in the cache. */
+static void NTSCEmuBand(int first, int last, void *arg)
+{
+	ntsc_emu_t const *emu = (ntsc_emu_t const *) arg;
+	int y;
+	for (y = first; y < last; y++) {
+		Uint8 *row = emu->dest + 2 * y * emu->pitch;
+		(*emu->blit)(FILTER_NTSC_emu, emu->src + y * Screen_WIDTH, Screen_WIDTH,
+		             VIDEOMODE_src_width, 1, row, 0);
+		if (!emu->interpolate)
+			NTSCEmuScanline(emu, row + emu->pitch, row, NULL);
+		else if (y > first)
+			NTSCEmuScanline(emu, row - emu->pitch, row - 2 * emu->pitch, row);
+	}
+	if (emu->interpolate && last < VIDEOMODE_src_height) {
+		/* The next row belongs to another band, which may not have drawn
+		   it yet, so filter it here too. */
+		Uint32 next[ATARI_NTSC_OUT_WIDTH(Screen_WIDTH)];
+		Uint8 *row = emu->dest + 2 * (last - 1) * emu->pitch;
+		(*emu->blit)(FILTER_NTSC_emu, emu->src + last * Screen_WIDTH, Screen_WIDTH,
+		             VIDEOMODE_src_width, 1, next, 0);
+		NTSCEmuScanline(emu, row + emu->pitch, row, (Uint8 *) next);
+	}
+}
+
 static void DisplayNTSCEmu(void)
 {
 	Uint8 *pixels = (Uint8*)SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top;
+	ntsc_emu_t emu;
+	emu.src = (ATARI_NTSC_IN_T *) ((UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left);
+	emu.pitch = SDL_VIDEO_screen->pitch;
+	emu.percentage = SDL_VIDEO_scanlines_percentage;
+	if (emu.percentage < 0) emu.percentage = 0;
+	if (emu.percentage > 100) emu.percentage = 100;
+	emu.interpolate = SDL_VIDEO_interpolate_scanlines && emu.percentage != 0 && emu.percentage != 100;
 	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
 	case 16:
-		pixels += VIDEOMODE_dest_offset_left * 2;
-		/* blit atari image, doubled vertically */
-		atari_ntsc_blit_rgb16(FILTER_NTSC_emu,
-		                      (ATARI_NTSC_IN_T *) ((UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left),
-		                      Screen_WIDTH,
-		                      VIDEOMODE_src_width,
-		                      VIDEOMODE_src_height,
-		                      pixels,
-		                      SDL_VIDEO_screen->pitch * 2);
-		scanLines_16((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
+		emu.dest = pixels + VIDEOMODE_dest_offset_left * 2;
+		emu.blit = &atari_ntsc_blit_rgb16;
+		emu.scanline = &scanLine_16;
+		emu.width = VIDEOMODE_dest_width / 2;
+		emu.factor = (100 - emu.percentage) * 32 / (emu.interpolate ? 200 : 100);
 		break;
 	case 32:
-		pixels += VIDEOMODE_dest_offset_left * 4;
-		atari_ntsc_blit_argb32(FILTER_NTSC_emu,
-		                      (ATARI_NTSC_IN_T *) ((UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left),
-		                       Screen_WIDTH,
-		                       VIDEOMODE_src_width,
-		                       VIDEOMODE_src_height,
-		                       pixels,
-		                       SDL_VIDEO_screen->pitch * 2);
-		scanLines_32((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
+		emu.dest = pixels + VIDEOMODE_dest_offset_left * 4;
+		emu.blit = &atari_ntsc_blit_argb32;
+		emu.scanline = &scanLine_32;
+		emu.width = VIDEOMODE_dest_width;
+		emu.factor = (100 - emu.percentage) * 256 / (emu.interpolate ? 200 : 100);
 		break;
+	default:
+		return;
 	}
+	/* Scanlines are drawn along with the rows, in bands of rows filtered in
+	   parallel. */
+	FILTER_NTSC_ForEachBand(VIDEOMODE_src_height, &NTSCEmuBand, &emu);
 }
 #endif
 
@@ -668,71 +746,51 @@ static void DisplayProto80(void)
 }
 #endif
 
-#ifdef AF80
-static void DisplayAF80(void)
+#if defined(AF80) || defined(BIT3)
+/* Blits the image of an 80-column card; *FRAME counts frames for blinking. */
+static void DisplayText80(TEXT80_t const *text, int *frame)
 {
-	int first_column = (VIDEOMODE_src_offset_left+7) / 8;
-	int last_column = (VIDEOMODE_src_offset_left + VIDEOMODE_src_width) / 8;
-	int first_line = VIDEOMODE_src_offset_top;
-	int last_line = first_line + VIDEOMODE_src_height;
 	int pitch4 = SDL_VIDEO_screen->pitch / 2;
+	UBYTE const *screen = text->pixels + TEXT80_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
 	Uint8 *pixels = (Uint8*)SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top;
-
-	static int AF80Frame = 0;
 	int blink;
-	AF80Frame++;
-	if (AF80Frame == 60) AF80Frame = 0;
-	blink = AF80Frame >= 30;
+
+	if (++*frame == 60) *frame = 0;
+	blink = *frame >= 30;
 
 	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
 	case 8:
 		pixels += VIDEOMODE_dest_offset_left;
-		SDL_VIDEO_BlitAF80_8((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink);
+		SDL_VIDEO_BlitText80_8((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, blink);
 		break;
 	case 16:
 		pixels += VIDEOMODE_dest_offset_left * 2;
-		SDL_VIDEO_BlitAF80_16((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink, SDL_PALETTE_buffer.bpp16);
+		SDL_VIDEO_BlitText80_16((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, blink, SDL_PALETTE_buffer.bpp16);
 		scanLines_16((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
 		break;
 	default:
 		pixels += VIDEOMODE_dest_offset_left * 4;
-		SDL_VIDEO_BlitAF80_32((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink, SDL_PALETTE_buffer.bpp32);
+		SDL_VIDEO_BlitText80_32((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, blink, SDL_PALETTE_buffer.bpp32);
 		scanLines_32((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
 	}
 }
 #endif
 
+#ifdef AF80
+static void DisplayAF80(void)
+{
+	static int AF80Frame = 0;
+	AF80_UpdateText();
+	DisplayText80(&AF80_text, &AF80Frame);
+}
+#endif
+
 #ifdef BIT3
 static void DisplayBIT3(void)
 {
-	int first_column = (VIDEOMODE_src_offset_left+7) / 8;
-	int last_column = (VIDEOMODE_src_offset_left + VIDEOMODE_src_width) / 8;
-	int first_line = VIDEOMODE_src_offset_top;
-	int last_line = first_line + VIDEOMODE_src_height;
-	int pitch4 = SDL_VIDEO_screen->pitch / 2;
-	Uint8 *pixels = (Uint8*)SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top;
-
 	static int BIT3Frame = 0;
-	int blink;
-	BIT3Frame++;
-	if (BIT3Frame == 60) BIT3Frame = 0;
-	blink = BIT3Frame >= 30;
-
-	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
-	case 8:
-		pixels += VIDEOMODE_dest_offset_left;
-		SDL_VIDEO_BlitBIT3_8((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink);
-		break;
-	case 16:
-		pixels += VIDEOMODE_dest_offset_left * 2;
-		SDL_VIDEO_BlitBIT3_16((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink, SDL_PALETTE_buffer.bpp16);
-		scanLines_16((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
-		break;
-	default:
-		pixels += VIDEOMODE_dest_offset_left * 4;
-		SDL_VIDEO_BlitBIT3_32((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink, SDL_PALETTE_buffer.bpp32);
-		scanLines_32((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
-	}
+	BIT3_UpdateText();
+	DisplayText80(&BIT3_text, &BIT3Frame);
 }
 #endif
 
@@ -48,6 +48,7 @@
 #ifndef BASIC
 #include "statesav.h"
 #endif
+#include "runahead.h"
 #ifdef NETSIO
 #include "netsio.h"
 #endif /* NETSIO */
@@ -1141,6 +1142,7 @@ void SIO_Handler(void)
 	int realsize = 0;
 	int cmd = MEMORY_dGetByte(0x302);
 
+	RUNAHEAD_CHECK();
 	if ((unsigned int)MEMORY_dGetByte(0x300) + (unsigned int)MEMORY_dGetByte(0x301) > 0xff) {
 		/* carry */
 		unit++;
@@ -1528,6 +1530,7 @@ static UBYTE Command_Frame(void)
 /* Enable/disable the command frame */
 void SIO_SwitchCommandFrame(int onoff)
 {
+	RUNAHEAD_CHECK();
 	if (onoff)
 	{				/* Enabled */
 #ifdef NETSIO
@@ -1831,6 +1834,7 @@ int SIO_GetByte(void)
 {
 	int byte = 0;
 
+	RUNAHEAD_CHECK();
 #ifdef NETSIO
 	if (netsio_enabled)
 		return NetSIO_GetByte();
@@ -1950,6 +1954,9 @@ void SIO_StateRead(void)
 		StateSav_ReadFNAME(filename);
 		if (filename[0] == 0)
 			continue;
+		/* A quick state finds the disk still mounted. */
+		if (StateSav_quick && strcmp(filename, SIO_filename[i]) == 0)
+			continue;
 
 		/* If the disk drive wasn't empty or off when saved,
 		   mount the disk */
@@ -101,6 +101,24 @@ static size_t mem_write(const void *buf, size_t len, gzFile stream);
 #define Z_OK    0
 #endif
 
+#ifdef RUNAHEAD
+/* Quick states are kept in memory instead of a file. While one is saved or
+   read, StateFile points at quick_state. */
+static UBYTE *quick_state = NULL;
+static size_t quick_state_size = 0;
+static size_t quick_state_len = 0;
+static size_t quick_pos;
+static size_t quick_write(const void *buf, size_t len);
+static size_t quick_read(void *buf, size_t len);
+#define STATE_WRITE(X, Y, Z) (StateSav_quick ? quick_write(Y, Z) : GZWRITE(X, Y, Z))
+#define STATE_READ(X, Y, Z)  (StateSav_quick ? quick_read(Y, Z) : GZREAD(X, Y, Z))
+#else
+#define STATE_WRITE(X, Y, Z) GZWRITE(X, Y, Z)
+#define STATE_READ(X, Y, Z)  GZREAD(X, Y, Z)
+#endif /* RUNAHEAD */
+
+int StateSav_quick = FALSE;
+
 static gzFile StateFile = NULL;
 static int nFileError = Z_OK;
 
@@ -132,7 +150,7 @@ void StateSav_SaveUBYTE(const UBYTE *data, int num)
 	   directly to the active bits if in a padded location. If not (unlikely)
 	   you'll have to redefine this to save appropriately for cross-platform
 	   compatibility */
-	if (GZWRITE(StateFile, data, num) == 0)
+	if (STATE_WRITE(StateFile, data, num) == 0)
 		GetGZErrorText();
 }
 
@@ -142,7 +160,7 @@ void StateSav_ReadUBYTE(UBYTE *data, int num)
 	if (!StateFile || nFileError != Z_OK)
 		return;
 
-	if (GZREAD(StateFile, data, num) == 0)
+	if (STATE_READ(StateFile, data, num) == 0)
 		GetGZErrorText();
 }
 
@@ -162,14 +180,14 @@ void StateSav_SaveUWORD(const UWORD *data, int num)
 
 		temp = *data++;
 		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
+		if (STATE_WRITE(StateFile, &byte, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
 
 		temp >>= 8;
 		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
+		if (STATE_WRITE(StateFile, &byte, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
@@ -186,12 +204,12 @@ void StateSav_ReadUWORD(UWORD *data, int num)
 	while (num > 0) {
 		UBYTE byte1, byte2;
 
-		if (GZREAD(StateFile, &byte1, 1) == 0) {
+		if (STATE_READ(StateFile, &byte1, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
 
-		if (GZREAD(StateFile, &byte2, 1) == 0) {
+		if (STATE_READ(StateFile, &byte2, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
@@ -224,28 +242,28 @@ void StateSav_SaveINT(const int *data, int num)
 		temp = (unsigned int) temp0;
 
 		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
+		if (STATE_WRITE(StateFile, &byte, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
 
 		temp >>= 8;
 		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
+		if (STATE_WRITE(StateFile, &byte, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
 
 		temp >>= 8;
 		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
+		if (STATE_WRITE(StateFile, &byte, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
 
 		temp >>= 8;
 		byte = (temp & 0x7f) | signbit;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
+		if (STATE_WRITE(StateFile, &byte, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
@@ -264,22 +282,22 @@ void StateSav_ReadINT(int *data, int num)
 		int temp;
 		UBYTE byte1, byte2, byte3, byte4;
 
-		if (GZREAD(StateFile, &byte1, 1) == 0) {
+		if (STATE_READ(StateFile, &byte1, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
 
-		if (GZREAD(StateFile, &byte2, 1) == 0) {
+		if (STATE_READ(StateFile, &byte2, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
 
-		if (GZREAD(StateFile, &byte3, 1) == 0) {
+		if (STATE_READ(StateFile, &byte3, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
 
-		if (GZREAD(StateFile, &byte4, 1) == 0) {
+		if (STATE_READ(StateFile, &byte4, 1) == 0) {
 			GetGZErrorText();
 			break;
 		}
@@ -302,11 +320,14 @@ void StateSav_SaveFNAME(const char *filename)
 	char dirname[FILENAME_MAX]="";
 
 	/* Check to see if file is in application tree, if so, just save as
-	   relative path....*/
-	Util_getcwd(dirname, FILENAME_MAX);
-	if (strncmp(filename, dirname, strlen(dirname)) == 0) {
-		/* XXX: check if '/' or '\\' follows dirname in filename? */
-		filename += strlen(dirname) + 1;
+	   relative path.... Quick states keep the name as it is, so that it can
+	   be compared with the current one. */
+	if (!StateSav_quick) {
+		Util_getcwd(dirname, FILENAME_MAX);
+		if (strncmp(filename, dirname, strlen(dirname)) == 0) {
+			/* XXX: check if '/' or '\\' follows dirname in filename? */
+			filename += strlen(dirname) + 1;
+		}
 	}
 
 	namelen = strlen(filename);
@@ -328,32 +349,8 @@ void StateSav_ReadFNAME(char *filename)
 	filename[namelen] = 0;
 }
 
-int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVerbose)
+static void SaveModules(UBYTE SaveVerbose)
 {
-	UBYTE StateVersion = SAVE_VERSION_NUMBER;
-
-	if (StateFile != NULL) {
-		GZCLOSE(StateFile);
-		StateFile = NULL;
-	}
-	nFileError = Z_OK;
-
-	StateFile = GZOPEN(filename, mode);
-	if (StateFile == NULL) {
-		Log_print("Could not open %s for state save.", filename);
-		GetGZErrorText();
-		return FALSE;
-	}
-	if (GZWRITE(StateFile, "ATARI800", 8) == 0) {
-		GetGZErrorText();
-		GZCLOSE(StateFile);
-		StateFile = NULL;
-		return FALSE;
-	}
-
-	STATESAV_TAG(size);  /* initialize to 0, set to actual size if successful */
-	StateSav_SaveUBYTE(&StateVersion, 1);
-	StateSav_SaveUBYTE(&SaveVerbose, 1);
 	/* The order here is important. Atari800_StateSave must be first because it saves the machine type, and
 	   decisions on what to save/not save are made based off that later in the process */
 	Atari800_StateSave();
@@ -400,68 +397,11 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 #ifdef DREAMCAST
 	DCStateSave();
 #endif
-
-	STATESAV_TAG(size);
-	if (GZCLOSE(StateFile) != 0) {
-		StateFile = NULL;
-		return FALSE;
-	}
-	StateFile = NULL;
-
-	if (nFileError != Z_OK)
-		return FALSE;
-
-	return TRUE;
 }
 
-int StateSav_ReadAtariState(const char *filename, const char *mode)
+/* Returns FALSE if the state needs features not compiled in. */
+static int ReadModules(UBYTE StateVersion, UBYTE SaveVerbose)
 {
-	char header_string[8];
-	UBYTE StateVersion = 0;  /* The version of the save file */
-	UBYTE SaveVerbose = 0;   /* Verbose mode means save basic, OS if patched */
-
-	if (StateFile != NULL) {
-		GZCLOSE(StateFile);
-		StateFile = NULL;
-	}
-	nFileError = Z_OK;
-
-	StateFile = GZOPEN(filename, mode);
-	if (StateFile == NULL) {
-		Log_print("Could not open %s for state read.", filename);
-		GetGZErrorText();
-		return FALSE;
-	}
-
-	if (GZREAD(StateFile, header_string, 8) == 0) {
-		GetGZErrorText();
-		GZCLOSE(StateFile);
-		StateFile = NULL;
-		return FALSE;
-	}
-	if (memcmp(header_string, "ATARI800", 8) != 0) {
-		Log_print("This is not an Atari800 state save file.");
-		GZCLOSE(StateFile);
-		StateFile = NULL;
-		return FALSE;
-	}
-
-	if (GZREAD(StateFile, &StateVersion, 1) == 0
-	 || GZREAD(StateFile, &SaveVerbose, 1) == 0) {
-		Log_print("Failed read from Atari state file.");
-		GetGZErrorText();
-		GZCLOSE(StateFile);
-		StateFile = NULL;
-		return FALSE;
-	}
-
-	if (StateVersion > SAVE_VERSION_NUMBER || StateVersion < 3) {
-		Log_print("Cannot read this state file because it is an incompatible version.");
-		GZCLOSE(StateFile);
-		StateFile = NULL;
-		return FALSE;
-	}
-
 	Atari800_StateRead(StateVersion);
 	if (StateVersion >= 4) {
 		CARTRIDGE_StateRead(StateVersion);
@@ -480,8 +420,6 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 		StateSav_ReadINT(&local_xep80_enabled,1);
 		if (local_xep80_enabled) {
 			Log_print("Cannot read this state file because this version does not support XEP80.");
-			GZCLOSE(StateFile);
-			StateFile = NULL;
 			return FALSE;
 		}
 #endif /* XEP80_EMULATION */
@@ -494,8 +432,6 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_mio_enabled,1);
 			if (local_mio_enabled) {
 				Log_print("Cannot read this state file because this version does not support MIO.");
-				GZCLOSE(StateFile);
-				StateFile = NULL;
 				return FALSE;
 			}
 		}
@@ -508,8 +444,6 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_bb_enabled,1);
 			if (local_bb_enabled) {
 				Log_print("Cannot read this state file because this version does not support the Black Box.");
-				GZCLOSE(StateFile);
-				StateFile = NULL;
 				return FALSE;
 			}
 		}
@@ -522,8 +456,6 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_xld_enabled,1);
 			if (local_xld_enabled) {
 				Log_print("Cannot read this state file because this version does not support the 1400XL/1450XLD.");
-				GZCLOSE(StateFile);
-				StateFile = NULL;
 				return FALSE;
 			}
 		}
@@ -532,6 +464,103 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 #ifdef DREAMCAST
 	DCStateRead();
 #endif
+	return TRUE;
+}
+
+int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVerbose)
+{
+	UBYTE StateVersion = SAVE_VERSION_NUMBER;
+
+	if (StateFile != NULL) {
+		GZCLOSE(StateFile);
+		StateFile = NULL;
+	}
+	nFileError = Z_OK;
+
+	StateFile = GZOPEN(filename, mode);
+	if (StateFile == NULL) {
+		Log_print("Could not open %s for state save.", filename);
+		GetGZErrorText();
+		return FALSE;
+	}
+	if (GZWRITE(StateFile, "ATARI800", 8) == 0) {
+		GetGZErrorText();
+		GZCLOSE(StateFile);
+		StateFile = NULL;
+		return FALSE;
+	}
+
+	STATESAV_TAG(size);  /* initialize to 0, set to actual size if successful */
+	StateSav_SaveUBYTE(&StateVersion, 1);
+	StateSav_SaveUBYTE(&SaveVerbose, 1);
+	SaveModules(SaveVerbose);
+
+	STATESAV_TAG(size);
+	if (GZCLOSE(StateFile) != 0) {
+		StateFile = NULL;
+		return FALSE;
+	}
+	StateFile = NULL;
+
+	if (nFileError != Z_OK)
+		return FALSE;
+
+	return TRUE;
+}
+
+int StateSav_ReadAtariState(const char *filename, const char *mode)
+{
+	char header_string[8];
+	UBYTE StateVersion = 0;  /* The version of the save file */
+	UBYTE SaveVerbose = 0;   /* Verbose mode means save basic, OS if patched */
+
+	if (StateFile != NULL) {
+		GZCLOSE(StateFile);
+		StateFile = NULL;
+	}
+	nFileError = Z_OK;
+
+	StateFile = GZOPEN(filename, mode);
+	if (StateFile == NULL) {
+		Log_print("Could not open %s for state read.", filename);
+		GetGZErrorText();
+		return FALSE;
+	}
+
+	if (GZREAD(StateFile, header_string, 8) == 0) {
+		GetGZErrorText();
+		GZCLOSE(StateFile);
+		StateFile = NULL;
+		return FALSE;
+	}
+	if (memcmp(header_string, "ATARI800", 8) != 0) {
+		Log_print("This is not an Atari800 state save file.");
+		GZCLOSE(StateFile);
+		StateFile = NULL;
+		return FALSE;
+	}
+
+	if (GZREAD(StateFile, &StateVersion, 1) == 0
+	 || GZREAD(StateFile, &SaveVerbose, 1) == 0) {
+		Log_print("Failed read from Atari state file.");
+		GetGZErrorText();
+		GZCLOSE(StateFile);
+		StateFile = NULL;
+		return FALSE;
+	}
+
+	if (StateVersion > SAVE_VERSION_NUMBER || StateVersion < 3) {
+		Log_print("Cannot read this state file because it is an incompatible version.");
+		GZCLOSE(StateFile);
+		StateFile = NULL;
+		return FALSE;
+	}
+
+	if (!ReadModules(StateVersion, SaveVerbose)) {
+		GZCLOSE(StateFile);
+		StateFile = NULL;
+		return FALSE;
+	}
 
 	GZCLOSE(StateFile);
 	StateFile = NULL;
@@ -543,6 +572,66 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 }
 
 
+#ifdef RUNAHEAD
+static size_t quick_write(const void *buf, size_t len)
+{
+	if (quick_pos + len > quick_state_size) {
+		quick_state_size = (quick_pos + len) * 2;
+		quick_state = (UBYTE *) Util_realloc(quick_state, quick_state_size);
+	}
+	memcpy(quick_state + quick_pos, buf, len);
+	quick_pos += len;
+	return len;
+}
+
+static size_t quick_read(void *buf, size_t len)
+{
+	if (quick_pos + len > quick_state_len)
+		return 0;
+	memcpy(buf, quick_state + quick_pos, len);
+	quick_pos += len;
+	return len;
+}
+
+int StateSav_SaveQuickState(void)
+{
+	if (StateFile != NULL)
+		return FALSE;
+	if (quick_state == NULL) {
+		quick_state_size = 0x10000;
+		quick_state = (UBYTE *) Util_malloc(quick_state_size);
+	}
+	nFileError = Z_OK;
+	StateSav_quick = TRUE;
+	StateFile = (gzFile) quick_state;
+	quick_pos = 0;
+	SaveModules(FALSE);
+	quick_state_len = quick_pos;
+	StateFile = NULL;
+	StateSav_quick = FALSE;
+	if (nFileError != Z_OK) {
+		quick_state_len = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+int StateSav_ReadQuickState(void)
+{
+	int result;
+	if (StateFile != NULL || quick_state_len == 0)
+		return FALSE;
+	nFileError = Z_OK;
+	StateSav_quick = TRUE;
+	StateFile = (gzFile) quick_state;
+	quick_pos = 0;
+	result = ReadModules(SAVE_VERSION_NUMBER, FALSE);
+	StateFile = NULL;
+	StateSav_quick = FALSE;
+	return result && nFileError == Z_OK;
+}
+#endif /* RUNAHEAD */
+
 /* Common definitions for in-memory state save used for DREAMCAST and libatari800
  */
 #if defined(MEMCOMPR) || defined(LIBATARI800)
@@ -7,6 +7,17 @@
 int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVerbose);
 int StateSav_ReadAtariState(const char *filename, const char *mode);
 
+#ifdef RUNAHEAD
+/* Save and read back a "quick" state, kept in memory for run-ahead. It leaves
+   out the ROMs and doesn't reload disks and cartridges that are already
+   in place. */
+int StateSav_SaveQuickState(void);
+int StateSav_ReadQuickState(void);
+#endif
+
+/* TRUE while a quick state is being saved or read. */
+extern int StateSav_quick;
+
 void StateSav_SaveUBYTE(const UBYTE *data, int num);
 void StateSav_SaveUWORD(const UWORD *data, int num);
 void StateSav_SaveINT(const int *data, int num);
@@ -36,6 +36,7 @@
 
 #include "cfg.h"
 #include "crc32.h"
+#include "romcache.h"
 #include "log.h"
 #include "memory.h"
 #include "util.h"
@@ -216,7 +217,7 @@ int SYSROM_SetPath(char const *filename, int num, ...)
 		return SYSROM_BADSIZE;
 	}
 	Util_rewind(f);
-	if (!CRC32_FromFile(f, &crc)) {
+	if (!ROMCACHE_FileCRC(filename, f, len, &crc)) {
 		fclose(f);
 		return SYSROM_ERROR;
 	}
@@ -313,7 +314,7 @@ int SYSROM_FindInDir(char const *directory, int only_if_not_set)
 		}
 		Util_rewind(file);
 
-		if (!CRC32_FromFile(file, &crc)) {
+		if (!ROMCACHE_FileCRC(full_filename, file, len, &crc)) {
 			fclose(file);
 			continue;
 		}
@@ -0,0 +1,112 @@
+/*
+ * text80.c - Cell by cell image of an 80 column text display
+ *
+ * Copyright (C) 2024 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "text80.h"
+#include "util.h"
+
+/* No cell shows this key */
+#define NO_KEY 0xffffffff
+
+/* Font bytes expanded to 8 pixel masks of 0x00 or 0xff, as two ULONGs
+   laid out in memory like the pixels. */
+static ULONG masks[256][2];
+static int masks_ready = FALSE;
+
+static void InitMasks(void)
+{
+	int i;
+	for (i = 0; i < 256; i++) {
+		UBYTE pixels[TEXT80_CELL_WIDTH];
+		int j;
+		for (j = 0; j < TEXT80_CELL_WIDTH; j++)
+			pixels[j] = (i >> j) & 1 ? 0xff : 0x00;
+		memcpy(masks[i], pixels, sizeof(pixels));
+	}
+	masks_ready = TRUE;
+}
+
+void TEXT80_Init(TEXT80_t *text, int rows, int cell_height)
+{
+	if (!masks_ready)
+		InitMasks();
+	text->rows = rows;
+	text->cell_height = cell_height;
+	text->pixels = (UBYTE *) Util_malloc(TEXT80_WIDTH * rows * cell_height);
+	text->cells = (ULONG *) Util_malloc(TEXT80_COLUMNS * rows * sizeof(ULONG));
+	memset(text->pixels, 0, TEXT80_WIDTH * rows * cell_height);
+	TEXT80_Invalidate(text);
+}
+
+void TEXT80_Free(TEXT80_t *text)
+{
+	free(text->pixels);
+	free(text->cells);
+	text->pixels = NULL;
+	text->cells = NULL;
+}
+
+void TEXT80_Invalidate(TEXT80_t *text)
+{
+	int i;
+	for (i = 0; i < TEXT80_COLUMNS * text->rows; i++)
+		text->cells[i] = NO_KEY;
+}
+
+int TEXT80_CellChanged(TEXT80_t *text, int row, int column, ULONG key)
+{
+	ULONG *cell = &text->cells[row * TEXT80_COLUMNS + column];
+	if (*cell == key)
+		return FALSE;
+	*cell = key;
+	return TRUE;
+}
+
+void TEXT80_DrawCell(TEXT80_t *text, int row, int column, UBYTE const *data,
+                     UBYTE const *fg, UBYTE const *bg)
+{
+	ULONG *dest = (ULONG *) (text->pixels + (row * text->cell_height * TEXT80_COLUMNS + column) * TEXT80_CELL_WIDTH);
+	int line;
+	for (line = 0; line < text->cell_height; line++) {
+		ULONG const *mask = masks[data[line]];
+		ULONG fg4 = fg[line] * 0x01010101;
+		ULONG bg4 = bg[line] * 0x01010101;
+		dest[0] = (mask[0] & fg4) | (~mask[0] & bg4);
+		dest[1] = (mask[1] & fg4) | (~mask[1] & bg4);
+		dest += TEXT80_WIDTH / sizeof(ULONG);
+	}
+}
+
+void TEXT80_GetColours(UBYTE *colours, int blink)
+{
+	int i;
+	for (i = 0; i < TEXT80_NUM_VALUES; i++) {
+		if (blink ? (i & TEXT80_BLINK_OFF) : (i & TEXT80_BLINK_ON))
+			colours[i] = 0;
+		else
+			colours[i] = i & 0x0f;
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef TEXT80_H_
+#define TEXT80_H_
+
+#include "atari.h"
+
+/* Image of an 80-column text display (AF80, BIT3), kept up to date cell by
+   cell: a cell is only drawn again when what it shows has changed.
+   Pixels are colour numbers 0-15, possibly with one of the TEXT80_BLINK_*
+   bits; TEXT80_GetColours maps them to colour numbers for the current
+   phase of blinking, so blinking text and cursors need no redraw. */
+
+#define TEXT80_COLUMNS 80
+#define TEXT80_CELL_WIDTH 8
+#define TEXT80_WIDTH (TEXT80_COLUMNS * TEXT80_CELL_WIDTH)
+#define TEXT80_MAX_CELL_HEIGHT 16
+
+/* Pixel shown only when blink is FALSE / only when blink is TRUE */
+#define TEXT80_BLINK_OFF 0x10
+#define TEXT80_BLINK_ON 0x20
+/* Number of different pixel values */
+#define TEXT80_NUM_VALUES 0x40
+
+typedef struct {
+	int rows;
+	int cell_height;
+	UBYTE *pixels; /* TEXT80_WIDTH x (rows * cell_height) */
+	ULONG *cells; /* what each cell shows, as given to TEXT80_CellChanged */
+} TEXT80_t;
+
+void TEXT80_Init(TEXT80_t *text, int rows, int cell_height);
+void TEXT80_Free(TEXT80_t *text);
+
+/* Makes TEXT80_CellChanged return TRUE for all cells. */
+void TEXT80_Invalidate(TEXT80_t *text);
+
+/* Returns TRUE if the cell at ROW, COLUMN doesn't show KEY yet, and
+   remembers that it will. KEY must identify everything the cell shows. */
+int TEXT80_CellChanged(TEXT80_t *text, int row, int column, ULONG key);
+
+/* Draws a cell: for each of its lines, the bits of DATA set (bit 0 is
+   leftmost) get pixel value FG and the others BG. */
+void TEXT80_DrawCell(TEXT80_t *text, int row, int column, UBYTE const *data,
+                     UBYTE const *fg, UBYTE const *bg);
+
+/* Fills COLOURS[TEXT80_NUM_VALUES] with the colour number of every pixel
+   value, in the given phase of blinking. */
+void TEXT80_GetColours(UBYTE *colours, int blink);
+
+#endif /* TEXT80_H_ */
@@ -1521,10 +1521,12 @@ static void MakeBlankTapeMenu(void)
    any slider that adjusts tape position. */
 static void TapeSliderLabel(char *label, int value, void *user_data)
 {
+	/* tape time as m:ss, limited so it fits in the label */
+	unsigned int seconds = CASSETTE_GetTime(value + 1) % 6000;
 	if (value >= CASSETTE_GetSize())
-		sprintf(label, "End");
+		snprintf(label, 11, "End %u:%02u", seconds / 60, seconds % 60);
 	else
-		snprintf(label, 11, "%u", (unsigned int)value + 1);
+		snprintf(label, 11, "%u %u:%02u", (unsigned int)(value + 1) % 10000, seconds / 60, seconds % 60);
 }
 
 static void TapeManagement(void)
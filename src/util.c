@@ -50,6 +50,9 @@
 #  include <time.h>
 # endif
 #endif
+#if (defined(HAVE_CLOCK_GETTIME) || defined(HAVE_CLOCK_NANOSLEEP)) && !defined(TIME_WITH_SYS_TIME)
+#include <time.h>
+#endif
 #ifdef HAVE_UNISTD_H
 #include <unistd.h> /* getcwd() */
 #endif
@@ -561,6 +564,11 @@ double Util_time(void)
 #elif defined(DJGPP)
 	/* DJGPP has gettimeofday, but it's not more accurate than uclock */
 	return uclock() * (1.0 / UCLOCKS_PER_SEC);
+#elif defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	/* unlike gettimeofday, doesn't jump when the system clock is set */
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
 #elif defined(HAVE_GETTIMEOFDAY)
 	struct timeval tp;
 	gettimeofday(&tp, NULL);
@@ -590,8 +598,8 @@ void Util_sleep(double s)
 		while ((curtime + s) > Util_time());
 #elif defined(HAVE_NANOSLEEP)
 		struct timespec ts;
-		ts.tv_sec = 0;
-		ts.tv_nsec = s * 1e9;
+		ts.tv_sec = (time_t) s;
+		ts.tv_nsec = (long) ((s - ts.tv_sec) * 1e9);
 		nanosleep(&ts, NULL);
 #elif defined(HAVE_USLEEP)
 		usleep(s * 1e6);
@@ -604,8 +612,8 @@ void Util_sleep(double s)
 #elif defined(HAVE_SELECT)
 		/* linux */
 		struct timeval tp;
-		tp.tv_sec = 0;
-		tp.tv_usec = s * 1e6;
+		tp.tv_sec = (long) s;
+		tp.tv_usec = (long) ((s - tp.tv_sec) * 1e6);
 		select(1, NULL, NULL, NULL, &tp);
 #else
 		double curtime = Util_time();
@@ -615,6 +623,40 @@ void Util_sleep(double s)
 	}
 }
 
+/* Limits of the time before a deadline that Util_sleep_until busy-waits */
+#define MIN_SPIN 0.0002
+#define MAX_SPIN 0.004
+
+void Util_sleep_until(double deadline)
+{
+	static double spin = MIN_SPIN;
+	double wake = deadline - spin;
+	double late;
+
+	if (wake > Util_time()) {
+#if !defined(SUPPORTS_PLATFORM_SLEEP) && !defined(SUPPORTS_PLATFORM_TIME) \
+	&& defined(HAVE_CLOCK_GETTIME) && defined(HAVE_CLOCK_NANOSLEEP) \
+	&& defined(CLOCK_MONOTONIC) && defined(TIMER_ABSTIME)
+		/* an absolute deadline doesn't drift when the sleep is interrupted */
+		struct timespec ts;
+		ts.tv_sec = (time_t) wake;
+		ts.tv_nsec = (long) ((wake - ts.tv_sec) * 1e9);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#else
+		Util_sleep(wake - Util_time());
+#endif
+		/* Follow the worst recent oversleep at once, and relax slowly. */
+		late = Util_time() - wake;
+		if (late > spin)
+			spin = late < MAX_SPIN ? late : MAX_SPIN;
+		else if (spin > MIN_SPIN)
+			spin -= (spin - late) / 64;
+		if (spin < MIN_SPIN)
+			spin = MIN_SPIN;
+	}
+	while (Util_time() < deadline);
+}
+
 char *Util_getcwd(char *buf, size_t size)
 {
 #ifdef HAVE_GETCWD
@@ -224,7 +224,12 @@ FILE *Util_uniqopen(char *filename, const char *mode);
 #endif
 
 void Util_sleep(double s);
+/* Returns time in seconds from a monotonic clock where available. */
 double Util_time(void);
+/* Sleeps until Util_time() reaches DEADLINE. The last moment before the
+   deadline is busy-waited, for as long as sleeping has recently been found
+   to oversleep, so that the wake-up is punctual. */
+void Util_sleep_until(double deadline);
 
 /* Get current working directory. */
 char *Util_getcwd(char *buf, size_t size);
@@ -450,9 +450,8 @@ static void BlitChar(int x, int y, int cur)
 		                     screen_col * XEP80_CHAR_WIDTH];
 		if (cur & cursor_overwrite) {
 			for (font_row=0;font_row < XEP80_char_height; font_row++) {
-				for (font_col=0; font_col < XEP80_CHAR_WIDTH; font_col++)
-					*to++ = on;
-				to += XEP80_SCRN_WIDTH - XEP80_CHAR_WIDTH;
+				memset(to, on, XEP80_CHAR_WIDTH);
+				to += XEP80_SCRN_WIDTH;
 			}
 		}
 		else {
@@ -462,28 +461,17 @@ static void BlitChar(int x, int y, int cur)
 				else
 					from = XEP80_FONTS_atari_fonts[char_set][font_index][ch][font_row];
 
-				for (font_col=0; font_col < XEP80_CHAR_WIDTH; font_col++)
-					*to++ = *from++;
-				to += XEP80_SCRN_WIDTH - XEP80_CHAR_WIDTH;
+				memcpy(to, from, XEP80_CHAR_WIDTH);
+				to += XEP80_SCRN_WIDTH;
 			}
 		}
 
 		to = &XEP80_screen_2[XEP80_SCRN_WIDTH * XEP80_char_height * y +
 		                     screen_col * XEP80_CHAR_WIDTH];
 		if (cur & cursor_overwrite) {
-			if (cursor_blink) {
-				for (font_row=0;font_row < XEP80_char_height; font_row++) {
-					for (font_col=0; font_col < XEP80_CHAR_WIDTH; font_col++)
-						*to++ = off;
-					to += XEP80_SCRN_WIDTH - XEP80_CHAR_WIDTH;
-				}
-			}
-			else {
-				for (font_row=0;font_row < XEP80_char_height; font_row++) {
-					for (font_col=0; font_col < XEP80_CHAR_WIDTH; font_col++)
-						*to++ = on;
-					to += XEP80_SCRN_WIDTH - XEP80_CHAR_WIDTH;
-				}
+			for (font_row=0;font_row < XEP80_char_height; font_row++) {
+				memset(to, cursor_blink ? off : on, XEP80_CHAR_WIDTH);
+				to += XEP80_SCRN_WIDTH;
 			}
 		}
 		else {
@@ -496,19 +484,12 @@ static void BlitChar(int x, int y, int cur)
 					else
 						from = XEP80_FONTS_atari_fonts[char_set][font_index][ch][font_row];
 				}
-				for (font_col=0; font_col < XEP80_CHAR_WIDTH; font_col++) {
-					if (font_blink && !cur) {
-						if ((font_index & XEP80_FONTS_UNDER_FONT_BIT) && font_row == XEP80_FONTS_UNDER_ROW)
-							*to++ = *from++;
-						else {
-							*to++ = blink;
-							from++;
-						}
-					}
-					else
-						*to++ = *from++;
-				}
-				to += XEP80_SCRN_WIDTH - XEP80_CHAR_WIDTH;
+				if (font_blink && !cur
+				    && !((font_index & XEP80_FONTS_UNDER_FONT_BIT) && font_row == XEP80_FONTS_UNDER_ROW))
+					memset(to, blink, XEP80_CHAR_WIDTH);
+				else
+					memcpy(to, from, XEP80_CHAR_WIDTH);
+				to += XEP80_SCRN_WIDTH;
 			}
 		}
 	}
@@ -0,0 +1,341 @@
+/*
+ * Decode the video of an AVI file recorded by the atari800 emulator
+ * (atari800.github.io) with the A8FD codec ("-vcodec a8fd") to raw frames
+ *
+ * Copyright (C) 2024 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/* The format of the frames is described in src/codecs/video_a8fd.c. The
+   frames are written one after another, top line first, either as 24-bit
+   RGB or as the palette indexes, for example to be read by
+   ffmpeg -f rawvideo -pixel_format rgb24 -video_size WxH -framerate 50 -i - */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define A8FD_KEYFRAME 0x01
+#define A8FD_LZ4 0x02
+
+#define OP_SKIP 0x00
+#define OP_PIXELS 0x01
+#define OP_XOR 0x02
+
+static int width = 0;
+static int height = 0;
+static uint8_t palette[256][3];
+static uint8_t *screen = NULL;
+static uint8_t *line_data = NULL;
+static uint32_t line_data_size = 0;
+
+static uint32_t get32(const uint8_t *ptr)
+{
+	return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((uint32_t) ptr[3] << 24);
+}
+
+/* Decompresses an LZ4 block of SIZE bytes at SRC to DEST_SIZE bytes at DEST.
+   Returns 0 if the block is corrupt. */
+static int lz4_decompress(uint8_t *dest, uint32_t dest_size, const uint8_t *src, uint32_t size)
+{
+	const uint8_t *src_end = src + size;
+	uint8_t *ptr = dest;
+	uint8_t *dest_end = dest + dest_size;
+
+	while (src < src_end) {
+		int token = *src++;
+		uint32_t length = token >> 4;
+		uint32_t offset;
+		if (length == 15) {
+			int c;
+			do {
+				if (src >= src_end)
+					return 0;
+				c = *src++;
+				length += c;
+			} while (c == 255);
+		}
+		if (length > (uint32_t) (src_end - src) || length > (uint32_t) (dest_end - ptr))
+			return 0;
+		memcpy(ptr, src, length);
+		ptr += length;
+		src += length;
+		if (src == src_end)
+			break;
+		if (src_end - src < 2)
+			return 0;
+		offset = src[0] | (src[1] << 8);
+		src += 2;
+		if (offset == 0 || offset > (uint32_t) (ptr - dest))
+			return 0;
+		length = (token & 15) + 4;
+		if ((token & 15) == 15) {
+			int c;
+			do {
+				if (src >= src_end)
+					return 0;
+				c = *src++;
+				length += c;
+			} while (c == 255);
+		}
+		if (length > (uint32_t) (dest_end - ptr))
+			return 0;
+		/* the match may overlap the bytes it writes */
+		while (length-- > 0) {
+			*ptr = ptr[-(int) offset];
+			ptr++;
+		}
+	}
+	return ptr == dest_end;
+}
+
+/* Unpacks a line from SRC to DEST, XORing the pixels if XOR is set. Returns
+   the end of the packed line, or NULL if it is corrupt. */
+static const uint8_t *unpack_line(uint8_t *dest, const uint8_t *src, const uint8_t *src_end, int xor)
+{
+	int x = 0;
+	while (x < width) {
+		int c;
+		int count;
+		if (src >= src_end)
+			return NULL;
+		c = *src++;
+		if (c < 0x80) {
+			count = c + 1;
+			if (count > width - x || count > src_end - src)
+				return NULL;
+			while (count-- > 0) {
+				dest[x] = xor ? dest[x] ^ *src : *src;
+				x++;
+				src++;
+			}
+		}
+		else {
+			count = c - 125;
+			if (count > width - x || src >= src_end)
+				return NULL;
+			while (count-- > 0) {
+				dest[x] = xor ? dest[x] ^ *src : *src;
+				x++;
+			}
+			src++;
+		}
+	}
+	return src;
+}
+
+/* Applies a frame of SIZE bytes at BUF to the screen. Returns 0 if the frame
+   is corrupt. */
+static int decode_frame(const uint8_t *buf, uint32_t size)
+{
+	const uint8_t *ptr;
+	const uint8_t *ptr_end;
+	int y = 0;
+
+	if (size == 0)
+		return 1;
+	if (buf[0] & A8FD_LZ4) {
+		uint32_t unpacked_size;
+		if (size < 5)
+			return 0;
+		unpacked_size = get32(buf + 1);
+		if (unpacked_size > line_data_size) {
+			fprintf(stderr, "Frame too large\n");
+			return 0;
+		}
+		if (!lz4_decompress(line_data, unpacked_size, buf + 5, size - 5))
+			return 0;
+		ptr = line_data;
+		ptr_end = line_data + unpacked_size;
+	}
+	else {
+		ptr = buf + 1;
+		ptr_end = buf + size;
+	}
+	if (buf[0] & A8FD_KEYFRAME)
+		memset(screen, 0, width * height);
+
+	while (ptr < ptr_end) {
+		int op = *ptr++;
+		if (op == OP_SKIP) {
+			if (ptr >= ptr_end)
+				return 0;
+			y += *ptr++;
+			if (y > height)
+				return 0;
+			continue;
+		}
+		if (y >= height || (op != OP_PIXELS && op != OP_XOR))
+			return 0;
+		ptr = unpack_line(screen + y * width, ptr, ptr_end, op == OP_XOR);
+		if (ptr == NULL)
+			return 0;
+		y++;
+	}
+	return 1;
+}
+
+static int write_frame(FILE *fp, int indexed)
+{
+	int i;
+	if (indexed)
+		return fwrite(screen, width * height, 1, fp) == 1;
+	for (i = 0; i < width * height; i++) {
+		if (fwrite(palette[screen[i]], 3, 1, fp) != 1)
+			return 0;
+	}
+	return 1;
+}
+
+/* Reads the stream format of the video: a BITMAPINFOHEADER and the
+   palette. */
+static int read_format(const uint8_t *buf, uint32_t size)
+{
+	int i;
+	if (size < 40 + 256 * 4 || memcmp(buf + 16, "A8FD", 4) != 0) {
+		fprintf(stderr, "The video is not in the A8FD format\n");
+		return 0;
+	}
+	width = (int) get32(buf + 4);
+	height = (int) get32(buf + 8);
+	if (width <= 0 || height <= 0 || width > 4096 || height > 4096) {
+		fprintf(stderr, "Invalid video size\n");
+		return 0;
+	}
+	for (i = 0; i < 256; i++) {
+		palette[i][0] = buf[40 + i * 4 + 2];
+		palette[i][1] = buf[40 + i * 4 + 1];
+		palette[i][2] = buf[40 + i * 4];
+	}
+	screen = (uint8_t *) calloc(width * height, 1);
+	/* a skip for each line is the largest a frame can be */
+	line_data_size = height * (3 + width + (width + 127) / 128);
+	line_data = (uint8_t *) malloc(line_data_size);
+	if (screen == NULL || line_data == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 0;
+	}
+	return 1;
+}
+
+static void usage(void)
+{
+	printf("Usage: a8fd_decode [-indexed] input.avi output.raw\n"
+	       "Decodes the video of an AVI file recorded with \"-vcodec a8fd\" to raw frames,\n"
+	       "24-bit RGB or with -indexed one byte of palette index per pixel.\n"
+	       "Use - as the output file to write to the standard output.\n");
+}
+
+int main(int argc, char *argv[])
+{
+	FILE *fp;
+	FILE *out;
+	int indexed = 0;
+	int in_video_stream = 0;
+	long frames = 0;
+	uint8_t *buf = NULL;
+	uint32_t buf_size = 0;
+	uint8_t header[8];
+
+	if (argc > 1 && strcmp(argv[1], "-indexed") == 0) {
+		indexed = 1;
+		argc--;
+		argv++;
+	}
+	if (argc != 3) {
+		usage();
+		return 1;
+	}
+	fp = fopen(argv[1], "rb");
+	if (fp == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	if (strcmp(argv[2], "-") == 0)
+		out = stdout;
+	else {
+		out = fopen(argv[2], "wb");
+		if (out == NULL) {
+			perror(argv[2]);
+			return 1;
+		}
+	}
+
+	/* Walk through the chunks in the order they are in the file: the
+	   contents of RIFF and LIST chunks are chunks too. */
+	while (fread(header, 8, 1, fp) == 1) {
+		uint32_t size = get32(header + 4);
+		if (memcmp(header, "RIFF", 4) == 0 || memcmp(header, "LIST", 4) == 0) {
+			if (fread(header, 4, 1, fp) != 1)
+				break;
+			continue;
+		}
+		if (memcmp(header, "strh", 4) == 0 || memcmp(header, "strf", 4) == 0
+		    || (memcmp(header, "00dc", 4) == 0 && screen != NULL)) {
+			if (size > buf_size) {
+				free(buf);
+				buf = (uint8_t *) malloc(size);
+				buf_size = size;
+				if (buf == NULL) {
+					fprintf(stderr, "Out of memory\n");
+					return 1;
+				}
+			}
+			if (size > 0 && fread(buf, size, 1, fp) != 1) {
+				fprintf(stderr, "Unexpected end of file\n");
+				return 1;
+			}
+			if (size & 1)
+				fgetc(fp);
+			if (header[0] == 's' && header[3] == 'h')
+				in_video_stream = size >= 4 && memcmp(buf, "vids", 4) == 0;
+			else if (header[0] == 's') {
+				if (in_video_stream && screen == NULL && !read_format(buf, size))
+					return 1;
+			}
+			else {
+				if (!decode_frame(buf, size)) {
+					fprintf(stderr, "Frame %ld is corrupt\n", frames);
+					return 1;
+				}
+				if (!write_frame(out, indexed)) {
+					perror(argv[2]);
+					return 1;
+				}
+				frames++;
+			}
+			continue;
+		}
+		/* skip other chunks */
+		if (fseek(fp, size + (size & 1), SEEK_CUR) != 0)
+			break;
+	}
+	if (screen == NULL) {
+		fprintf(stderr, "No video stream found\n");
+		return 1;
+	}
+	fclose(fp);
+	if (out != stdout && fclose(out) != 0) {
+		perror(argv[2]);
+		return 1;
+	}
+	fprintf(stderr, "%ld frames of %dx%d\n", frames, width, height);
+	return 0;
+}